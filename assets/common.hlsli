@@ -0,0 +1,24 @@
+#ifndef COMMON_HLSLI
+#define COMMON_HLSLI
+
+// Vertex layout of Mesh, matching the input layout built by Renderer.
+struct VSInput
+{
+    float4 position : POSITION;
+    float4 normal : NORMAL;
+    float2 texCoord : TEXCOORD;
+    float4 color : COLOR;
+};
+
+struct PSInput
+{
+    float4 position : SV_POSITION;
+    float4 normal : NORMAL;
+    float2 texCoord : TEXCOORD;
+    float4 color : COLOR;
+#if defined(INSTANCE_TINT)
+    nointerpolation uint instanceID : INSTANCEID;
+#endif
+};
+
+#endif
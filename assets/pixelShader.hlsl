@@ -1,16 +1,8 @@
-SamplerState sampler0 : register(s0);
-
-struct PS_INPUT
-{
-    float4 Position : SV_POSITION;
-    float4 Normal   : NORMAL;
-    float2 TexCoord : TEXCOORD;
-    float4 Diffuse  : COLOR;
-};
-
+#include "common.hlsli"
 
+SamplerState sampler0 : register(s0);
 
-float4 main(PS_INPUT input) : SV_TARGET
+float4 main(PSInput input) : SV_TARGET
 {
-    return input.Diffuse;
+    return input.color;
 }
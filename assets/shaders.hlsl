@@ -1,6 +1,22 @@
-cbuffer ObjectBuffer : register(b0)
+// Keywords (Renderer::getGeometryKeywords):
+//   INSTANCE_TINT : tints every instance with a colour derived from its instance index
+//   SHOW_NORMALS  : outputs the vertex normal instead of the vertex colour
+#include "common.hlsli"
+
+struct InstanceData
 {
     float4x4 world;
+};
+
+StructuredBuffer<InstanceData> instances : register(t1);
+
+// Set per draw as root constants (Renderer::RootDrawConstants)
+cbuffer DrawConstants : register(b0)
+{
+    uint firstInstance;
+    // Used by the upscale pass (upscale.hlsl); declared so both agree on the layout
+    uint textureIndex;
+    float2 uvScale;
 }
 
 cbuffer CameraBuffer : register(b1)
@@ -9,37 +25,40 @@ cbuffer CameraBuffer : register(b1)
     float4x4 projection;
 }
 
-struct VSInput
-{
-    float4 position : POSITION;
-    float4 normal : NORMAL;
-    float2 texCoord : TEXCOORD;
-    float4 color : COLOR;
-};
-
-struct PSInput
+PSInput VSMain(VSInput input, uint instanceID : SV_InstanceID)
 {
-    float4 position : SV_POSITION;
-    float4 normal : NORMAL;
-    float2 texCoord : TEXCOORD;
-    float4 color : COLOR;
-};
+    // SV_InstanceID restarts at 0 for every draw
+    uint instance = firstInstance + instanceID;
 
-PSInput VSMain(VSInput input)
-{
     matrix wvp;
-    wvp = mul(world, view);
+    wvp = mul(instances[instance].world, view);
     wvp = mul(wvp, projection);
     
     PSInput result;
     result.position = mul(input.position, wvp);
     result.normal = input.normal;
+    result.texCoord = input.texCoord;
     result.color = input.color;
+#if defined(INSTANCE_TINT)
+    result.instanceID = instance;
+#endif
 
     return result;
 }
 
 float4 PSMain(PSInput input) : SV_TARGET
 {
-    return input.color;
+#if defined(SHOW_NORMALS)
+    float4 color = float4(normalize(input.normal.xyz) * 0.5f + 0.5f, 1.0f);
+#else
+    float4 color = input.color;
+#endif
+
+#if defined(INSTANCE_TINT)
+    uint hash = input.instanceID * 2654435761u;
+    float3 tint = float3((hash >> 8) & 0xff, (hash >> 16) & 0xff, (hash >> 24) & 0xff) / 255.0f;
+    color.rgb *= 0.5f + 0.5f * tint;
+#endif
+
+    return color;
 }
@@ -0,0 +1,41 @@
+// Stretches the part of the scene color target the scene was rendered to over the whole back buffer.
+// Drawn as one triangle covering the screen, without vertex buffers.
+
+Texture2D textures[] : register(t0, space1);
+SamplerState linearSampler : register(s0);
+
+// Set as root constants (Renderer::RootDrawConstants)
+cbuffer DrawConstants : register(b0)
+{
+    uint firstInstance;
+    uint textureIndex;
+    // Fraction of the target the scene covers, Renderer's render scale
+    float2 uvScale;
+}
+
+struct UpscaleInput
+{
+    float4 position : SV_POSITION;
+    float2 texCoord : TEXCOORD;
+};
+
+UpscaleInput VSUpscale(uint vertexID : SV_VertexID)
+{
+    UpscaleInput result;
+    result.texCoord = float2((vertexID << 1) & 2, vertexID & 2);
+    result.position = float4(result.texCoord * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    return result;
+}
+
+float4 PSUpscale(UpscaleInput input) : SV_TARGET
+{
+    Texture2D source = textures[textureIndex];
+
+    float width, height;
+    source.GetDimensions(width, height);
+
+    // Keep the bilinear footprint inside the rendered part; the rest holds older frames.
+    float2 halfTexel = 0.5f / float2(width, height);
+    float2 uv = min(input.texCoord * uvScale, uvScale - halfTexel);
+    return source.SampleLevel(linearSampler, uv, 0);
+}
@@ -1,5 +1,7 @@
 #ifndef __CORE_APPROJECT_H__
 #define __CORE_APPROJECT_H__
+#include <atomic>
+
 #include "Application.h"
 
 class AppProject
@@ -11,16 +13,29 @@ public:
 	virtual void onInit() =0;
 	virtual void onUpdate() =0;
 	virtual void onDraw() =0;
+	// Called repeatedly on the render thread while onUpdate / onDraw run on the game thread.
+	virtual void onRender() =0;
 	virtual void onDestroy() =0;
 
+	// Called once exit is requested, before the game and render threads are joined.
+	virtual void onExit() {}
+
+	// Called on the window thread when the client area changes size. Not called while minimized.
+	virtual void onResize(UINT width, UINT height) {}
+
+	// Called instead of everything else when launched with -precompile, to build
+	// offline data such as the shader cache. Returns false on failure.
+	virtual bool onPrecompile() { return true; }
+
 	// Accessors
 	UINT getWidth()			const { return mWidth; }
 	UINT getHeight()		const { return mHeight; }
 
 	const WCHAR* getTitle() const { return mTitle.c_str(); }
 
-	bool getExit() { return mIsExit; }
-	void setExit(bool exit) { mIsExit = exit; }
+	// Set on the window thread, polled by the game and render threads.
+	bool getExit() const { return mIsExit.load(std::memory_order_acquire); }
+	void setExit(bool exit) { mIsExit.store(exit, std::memory_order_release); }
 
 protected:
 	void setCustomWindowText(LPCWSTR text);
@@ -28,7 +43,7 @@ protected:
 	UINT mWidth;
 	UINT mHeight;
 
-	bool mIsExit;
+	std::atomic<bool> mIsExit;
 
 private:
 	// Window title.
@@ -3,6 +3,7 @@
 
 #include "Application.h"
 #include "AppProject.h"
+#include "Profiler.h"
 
 HWND Application::mhWnd = nullptr;
 
@@ -12,12 +13,23 @@ DWORD WINAPI GameThread(LPVOID lpParam)
 	DWORD selfThreadId = GetCurrentThreadId();
 	AttachThreadInput(mainThreadId, selfThreadId, TRUE);
 
+	Profiler::SetThreadName("GameThread");
+
 	AppProject* pProject = (AppProject*)lpParam;
 	while (!pProject->getExit())
 	{
-		pProject->onUpdate();
+		{
+			PROFILE_ZONE("GameThread");
+
+			pProject->onUpdate();
 
-		pProject->onDraw();
+			pProject->onDraw();
+		}
+
+		// Drains every thread's zones once per game frame, before their rings fill up.
+		if (Profiler::IsEnabled()) {
+			Profiler::getInstance()->collect();
+		}
 	}
 
 	AttachThreadInput(mainThreadId, selfThreadId, FALSE);
@@ -25,13 +37,48 @@ DWORD WINAPI GameThread(LPVOID lpParam)
 	ExitThread(TRUE);
 }
 
+DWORD WINAPI RenderThread(LPVOID lpParam)
+{
+	// Consumes the frames published by GameThread, so recording overlaps the next update.
+	Profiler::SetThreadName("RenderThread");
+
+	AppProject* pProject = (AppProject*)lpParam;
+	while (!pProject->getExit())
+	{
+		PROFILE_ZONE("RenderThread");
+
+		pProject->onRender();
+	}
+
+	ExitThread(TRUE);
+}
+
 int Application::run(AppProject* pProject, HINSTANCE hInstance, int nComdShow)
 {
 	int argc;
 	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
 
+	bool isPrecompile = false;
+	bool isProfile = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (_wcsicmp(argv[i], L"-precompile") == 0 || _wcsicmp(argv[i], L"/precompile") == 0)
+		{
+			isPrecompile = true;
+		}
+		if (_wcsicmp(argv[i], L"-profile") == 0 || _wcsicmp(argv[i], L"/profile") == 0)
+		{
+			isProfile = true;
+		}
+	}
+
 	LocalFree(argv);
 
+	// Build step: produce offline data and exit without opening a window
+	if (isPrecompile) {
+		return pProject->onPrecompile() ? 0 : 1;
+	}
+
 	// EBhE
 	WNDCLASSEX wnd = {};
 	wnd.cbSize = sizeof(WNDCLASSEX);
@@ -70,6 +117,11 @@ int Application::run(AppProject* pProject, HINSTANCE hInstance, int nComdShow)
 		pProject
 	);
 
+	// CPU zones of every thread, written to ProfileTrace.json on exit when launched with -profile
+	Profiler::createInstance();
+	Profiler::SetThreadName("MainThread");
+	Profiler::getInstance()->setEnabled(isProfile);
+
 	// AppProject::onInit()
 	pProject->onInit();
 
@@ -88,6 +140,21 @@ int Application::run(AppProject* pProject, HINSTANCE hInstance, int nComdShow)
 	}
 	SetThreadDescription(hGameThread, L"GameThread");
 
+	DWORD renderThreadID;
+	HANDLE hRenderThread = CreateThread(
+		NULL,
+		0,
+		RenderThread,
+		pProject,
+		0,
+		&renderThreadID
+	);
+
+	if (hRenderThread == NULL) {
+		return 0;
+	}
+	SetThreadDescription(hRenderThread, L"RenderThread");
+
 	BYTE key[256];
 	if (!GetKeyboardState(key)) {
 		OutputDebugStringA("Error");
@@ -113,9 +180,17 @@ int Application::run(AppProject* pProject, HINSTANCE hInstance, int nComdShow)
 		TranslateMessage(&msg);
 	}
 
+	pProject->setExit(true);
+	// Unblock threads waiting on each other before joining them.
+	pProject->onExit();
+
+	if (hRenderThread != NULL) {
+		WaitForSingleObject(hRenderThread, INFINITE);
+		CloseHandle(hRenderThread);
+	}
+
 	if (hGameThread != NULL) {
 		DWORD result;
-		pProject->setExit(true);
 		while (true)
 		{
 			GetExitCodeThread(hGameThread, &result);
@@ -129,6 +204,17 @@ int Application::run(AppProject* pProject, HINSTANCE hInstance, int nComdShow)
 	// AppProject::onDestroy()
 	pProject->onDestroy();
 
+	// Every profiled thread has exited by now
+	if (isProfile) {
+		Profiler* pProfiler = Profiler::getInstance();
+		pProfiler->setEnabled(false);
+		pProfiler->collect();
+		if (!pProfiler->writeChromeTrace("ProfileTrace.json")) {
+			OutputDebugStringA("ERROR: Failed to write ProfileTrace.json\n");
+		}
+	}
+	Profiler::destoryInstance();
+
 	return (int)msg.wParam;
 }
 
@@ -151,6 +237,12 @@ LRESULT Application::WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
 		SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pCreateStruct->lpCreateParams));
 	}
 	return 0;
+	case WM_SIZE:
+		// Client size; the project passes it on to the render thread
+		if (pProject != nullptr && wParam != SIZE_MINIMIZED) {
+			pProject->onResize(LOWORD(lParam), HIWORD(lParam));
+		}
+		return 0;
 	case WM_DESTROY:
 		PostQuitMessage(0);
 		return 0;
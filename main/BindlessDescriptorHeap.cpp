@@ -0,0 +1,47 @@
+#include "stdafx.h"
+#include "BindlessDescriptorHeap.h"
+
+BindlessDescriptorHeap::BindlessDescriptorHeap()
+	: mHeap(nullptr)
+	, mCPUStart()
+	, mGPUStart()
+	, mIncrementSize(0)
+	, mAllocator()
+{
+
+}
+
+HRESULT BindlessDescriptorHeap::Create(ID3D12Device* pDevice, uint32_t persistentCount, uint32_t transientCountPerFrame, uint32_t frameCount)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.NumDescriptors = persistentCount + transientCountPerFrame * frameCount;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	heapDesc.NodeMask = 0;
+
+	HRESULT hr = pDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	mCPUStart = mHeap->GetCPUDescriptorHandleForHeapStart();
+	mGPUStart = mHeap->GetGPUDescriptorHandleForHeapStart();
+	mIncrementSize = pDevice->GetDescriptorHandleIncrementSize(heapDesc.Type);
+	mAllocator.initialize(persistentCount, transientCountPerFrame, frameCount);
+	return S_OK;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE BindlessDescriptorHeap::getCPUHandle(uint32_t index) const
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = mCPUStart;
+	handle.ptr += static_cast<SIZE_T>(mIncrementSize) * index;
+	return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE BindlessDescriptorHeap::getGPUHandle(uint32_t index) const
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE handle = mGPUStart;
+	handle.ptr += static_cast<UINT64>(mIncrementSize) * index;
+	return handle;
+}
@@ -0,0 +1,37 @@
+#ifndef __RENDERER_BINDLESSDESCRIPTORHEAP_H__
+#define __RENDERER_BINDLESSDESCRIPTORHEAP_H__
+
+#include "DescriptorAllocator.h"
+
+using namespace Microsoft::WRL;
+
+// The single shader visible CBV/SRV/UAV heap. Bound once per command list as an unbounded table
+// starting at descriptor 0, so a descriptor's index is what shaders use to reach it.
+class BindlessDescriptorHeap
+{
+public:
+	BindlessDescriptorHeap();
+
+	HRESULT Create(ID3D12Device* pDevice, uint32_t persistentCount, uint32_t transientCountPerFrame, uint32_t frameCount);
+
+	uint32_t allocate() { return mAllocator.allocate(); }
+	void free(uint32_t index, uint64_t fenceValue) { mAllocator.free(index, fenceValue); }
+	void collect(uint64_t completedFenceValue) { mAllocator.collect(completedFenceValue); }
+
+	void beginFrame(uint32_t frameIndex) { mAllocator.beginFrame(frameIndex); }
+	uint32_t allocateTransient(uint32_t count) { return mAllocator.allocateTransient(count); }
+
+	ID3D12DescriptorHeap* getHeap() const { return mHeap.Get(); }
+	D3D12_CPU_DESCRIPTOR_HANDLE getCPUHandle(uint32_t index) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE getGPUHandle(uint32_t index) const;
+	const DescriptorAllocator& getAllocator() const { return mAllocator; }
+
+private:
+	ComPtr<ID3D12DescriptorHeap> mHeap;
+	D3D12_CPU_DESCRIPTOR_HANDLE mCPUStart;
+	D3D12_GPU_DESCRIPTOR_HANDLE mGPUStart;
+	UINT mIncrementSize;
+	DescriptorAllocator mAllocator;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "BoundsStore.h"
+
+#include <cmath>
+
+#if defined(_XM_SSE_INTRINSICS_)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	bool IsVisible(const Frustum& frustum, const float* const* c, uint32_t i)
+	{
+		for (const XMFLOAT4& plane : frustum.planes)
+		{
+			// Same association as the SIMD paths, so every path gives identical results.
+			const float distance = (plane.x * c[0][i] + plane.y * c[1][i]) + (plane.z * c[2][i] + plane.w);
+			const float boxRadius = fabsf(plane.x) * c[3][i] + fabsf(plane.y) * c[4][i] + fabsf(plane.z) * c[5][i];
+			const float radius = (boxRadius < c[6][i]) ? boxRadius : c[6][i];
+			if (distance < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// Plane coefficients and their absolute values broadcast once per cull call.
+	struct PlaneSplat4
+	{
+		__m128 x, y, z, w;
+		__m128 absX, absY, absZ;
+	};
+
+	// Bit n set when volume i + n is visible.
+	int CullMask4(const PlaneSplat4* pPlanes, const float* const* c, uint32_t i)
+	{
+		const __m128 cx = _mm_loadu_ps(c[0] + i);
+		const __m128 cy = _mm_loadu_ps(c[1] + i);
+		const __m128 cz = _mm_loadu_ps(c[2] + i);
+		const __m128 ex = _mm_loadu_ps(c[3] + i);
+		const __m128 ey = _mm_loadu_ps(c[4] + i);
+		const __m128 ez = _mm_loadu_ps(c[5] + i);
+		const __m128 r = _mm_loadu_ps(c[6] + i);
+
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int n = 0; n < Frustum::PlaneCount; ++n)
+		{
+			const PlaneSplat4& p = pPlanes[n];
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.x, cx), _mm_mul_ps(p.y, cy)), _mm_add_ps(_mm_mul_ps(p.z, cz), p.w));
+			const __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.absX, ex), _mm_mul_ps(p.absY, ey)), _mm_mul_ps(p.absZ, ez));
+			const __m128 radius = _mm_min_ps(boxRadius, r);
+			// distance + radius >= 0
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+		return _mm_movemask_ps(visible);
+	}
+#endif
+
+#if defined(_XM_SSE_INTRINSICS_) && defined(__AVX2__)
+	struct PlaneSplat8
+	{
+		__m256 x, y, z, w;
+		__m256 absX, absY, absZ;
+	};
+
+	int CullMask8(const PlaneSplat8* pPlanes, const float* const* c, uint32_t i)
+	{
+		const __m256 cx = _mm256_loadu_ps(c[0] + i);
+		const __m256 cy = _mm256_loadu_ps(c[1] + i);
+		const __m256 cz = _mm256_loadu_ps(c[2] + i);
+		const __m256 ex = _mm256_loadu_ps(c[3] + i);
+		const __m256 ey = _mm256_loadu_ps(c[4] + i);
+		const __m256 ez = _mm256_loadu_ps(c[5] + i);
+		const __m256 r = _mm256_loadu_ps(c[6] + i);
+
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int n = 0; n < Frustum::PlaneCount; ++n)
+		{
+			const PlaneSplat8& p = pPlanes[n];
+			const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.x, cx), _mm256_mul_ps(p.y, cy)), _mm256_add_ps(_mm256_mul_ps(p.z, cz), p.w));
+			const __m256 boxRadius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.absX, ex), _mm256_mul_ps(p.absY, ey)), _mm256_mul_ps(p.absZ, ez));
+			const __m256 radius = _mm256_min_ps(boxRadius, r);
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		return _mm256_movemask_ps(visible);
+	}
+#endif
+
+	// Appends the indices of set bits without branching on each bit.
+	uint32_t AppendMask(int mask, int width, uint32_t first, uint32_t* pOut, uint32_t count)
+	{
+		for (int n = 0; n < width; ++n)
+		{
+			pOut[count] = first + n;
+			count += (mask >> n) & 1;
+		}
+		return count;
+	}
+}
+
+BoundsStore::BoundsStore()
+	: mComponents()
+{
+
+}
+
+BoundsStore::~BoundsStore()
+{
+
+}
+
+void BoundsStore::resize(uint32_t count)
+{
+	for (std::vector<float>& component : mComponents)
+	{
+		component.resize(count);
+	}
+}
+
+void BoundsStore::reserve(uint32_t capacity)
+{
+	for (std::vector<float>& component : mComponents)
+	{
+		component.reserve(capacity);
+	}
+}
+
+void BoundsStore::clear()
+{
+	for (std::vector<float>& component : mComponents)
+	{
+		component.clear();
+	}
+}
+
+void BoundsStore::set(uint32_t index, const Vector3& center, const Vector3& extents, float radius)
+{
+	mComponents[CenterX][index] = center.x;
+	mComponents[CenterY][index] = center.y;
+	mComponents[CenterZ][index] = center.z;
+	mComponents[ExtentX][index] = extents.x;
+	mComponents[ExtentY][index] = extents.y;
+	mComponents[ExtentZ][index] = extents.z;
+	mComponents[Radius][index] = radius;
+}
+
+uint32_t BoundsStore::cull(const Frustum& frustum, uint32_t* pOut) const
+{
+	const float* c[ComponentCount];
+	for (int n = 0; n < ComponentCount; ++n)
+	{
+		c[n] = mComponents[n].data();
+	}
+
+	const uint32_t end = size();
+	uint32_t i = 0;
+	uint32_t count = 0;
+
+#if defined(_XM_SSE_INTRINSICS_) && defined(__AVX2__)
+	{
+		PlaneSplat8 planes[Frustum::PlaneCount];
+		for (int n = 0; n < Frustum::PlaneCount; ++n)
+		{
+			const XMFLOAT4& plane = frustum.planes[n];
+			planes[n].x = _mm256_set1_ps(plane.x);
+			planes[n].y = _mm256_set1_ps(plane.y);
+			planes[n].z = _mm256_set1_ps(plane.z);
+			planes[n].w = _mm256_set1_ps(plane.w);
+			planes[n].absX = _mm256_set1_ps(fabsf(plane.x));
+			planes[n].absY = _mm256_set1_ps(fabsf(plane.y));
+			planes[n].absZ = _mm256_set1_ps(fabsf(plane.z));
+		}
+
+		for (; i + 8 <= end; i += 8)
+		{
+			count = AppendMask(CullMask8(planes, c, i), 8, i, pOut, count);
+		}
+	}
+#endif
+
+#if defined(_XM_SSE_INTRINSICS_)
+	{
+		PlaneSplat4 planes[Frustum::PlaneCount];
+		for (int n = 0; n < Frustum::PlaneCount; ++n)
+		{
+			const XMFLOAT4& plane = frustum.planes[n];
+			planes[n].x = _mm_set1_ps(plane.x);
+			planes[n].y = _mm_set1_ps(plane.y);
+			planes[n].z = _mm_set1_ps(plane.z);
+			planes[n].w = _mm_set1_ps(plane.w);
+			planes[n].absX = _mm_set1_ps(fabsf(plane.x));
+			planes[n].absY = _mm_set1_ps(fabsf(plane.y));
+			planes[n].absZ = _mm_set1_ps(fabsf(plane.z));
+		}
+
+		for (; i + 4 <= end; i += 4)
+		{
+			count = AppendMask(CullMask4(planes, c, i), 4, i, pOut, count);
+		}
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		pOut[count] = i;
+		count += IsVisible(frustum, c, i) ? 1 : 0;
+	}
+
+	return count;
+}
+
+uint32_t BoundsStore::cullScalar(const Frustum& frustum, uint32_t* pOut) const
+{
+	const float* c[ComponentCount];
+	for (int n = 0; n < ComponentCount; ++n)
+	{
+		c[n] = mComponents[n].data();
+	}
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < size(); ++i)
+	{
+		if (IsVisible(frustum, c, i))
+		{
+			pOut[count++] = i;
+		}
+	}
+	return count;
+}
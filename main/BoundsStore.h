@@ -0,0 +1,50 @@
+#ifndef __RENDERER_BOUNDSSTORE_H__
+#define __RENDERER_BOUNDSSTORE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "Frustum.h"
+
+// Structure-of-arrays world-space bounding volumes: an AABB (center, extents) and a sphere
+// sharing its center. cull tests four (SSE) or eight (AVX2) volumes per iteration.
+class BoundsStore
+{
+public:
+	BoundsStore();
+	~BoundsStore();
+
+	void resize(uint32_t count);
+	void reserve(uint32_t capacity);
+	void clear();
+
+	uint32_t size() const { return static_cast<uint32_t>(mComponents[CenterX].size()); }
+
+	void set(uint32_t index, const Vector3& center, const Vector3& extents, float radius);
+	Vector3 getCenter(uint32_t index) const { return Vector3(mComponents[CenterX][index], mComponents[CenterY][index], mComponents[CenterZ][index]); }
+	Vector3 getExtents(uint32_t index) const { return Vector3(mComponents[ExtentX][index], mComponents[ExtentY][index], mComponents[ExtentZ][index]); }
+	float getRadius(uint32_t index) const { return mComponents[Radius][index]; }
+
+	// Writes the indices of volumes not entirely outside the frustum to pOut in ascending order
+	// and returns how many were written. pOut must have room for size() indices.
+	// A volume is rejected when either its box or its sphere lies behind one of the planes.
+	uint32_t cull(const Frustum& frustum, uint32_t* pOut) const;
+
+	// One volume at a time; the reference for cull.
+	uint32_t cullScalar(const Frustum& frustum, uint32_t* pOut) const;
+
+private:
+	enum Component
+	{
+		CenterX, CenterY, CenterZ,
+		ExtentX, ExtentY, ExtentZ,
+		Radius,
+
+		ComponentCount
+	};
+
+	std::vector<float> mComponents[ComponentCount];
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "BundleCache.h"
+
+const uint32_t BundleCache::DefaultStableUseCount;
+
+BundleCache::BundleCache()
+	: mpRecorder(nullptr)
+	, mStableUseCount(DefaultStableUseCount)
+	, mEntries()
+	, mRetired()
+	, mRecordCount(0)
+	, mHitCount(0)
+	, mMutex()
+{
+
+}
+
+BundleCache::~BundleCache()
+{
+	destroy();
+}
+
+void BundleCache::initialize(IBundleRecorder* pRecorder, uint32_t stableUseCount)
+{
+	destroy();
+
+	mpRecorder = pRecorder;
+	mStableUseCount = stableUseCount > 0 ? stableUseCount : 1;
+	mRecordCount.store(0, std::memory_order_relaxed);
+	mHitCount.store(0, std::memory_order_relaxed);
+}
+
+void BundleCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (mpRecorder != nullptr)
+	{
+		for (auto& pair : mEntries)
+		{
+			if (pair.second.pBundle != nullptr)
+			{
+				mpRecorder->destroy(pair.second.pBundle);
+			}
+		}
+		for (const RetiredBundle& retired : mRetired)
+		{
+			mpRecorder->destroy(retired.pBundle);
+		}
+	}
+	mEntries.clear();
+	mRetired.clear();
+}
+
+/// <summary>
+/// The bundle is recorded outside the lock so that workers recording other batches are not held up.
+/// </summary>
+void* BundleCache::acquire(const BundleKey& key, const BundleDraw& draw, uint64_t fenceValue)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto found = mEntries.find(key);
+		if (found == mEntries.end())
+		{
+			Entry entry = {};
+			entry.draw = draw;
+			found = mEntries.emplace(key, entry).first;
+		}
+
+		Entry& entry = found->second;
+		entry.lastFenceValue = fenceValue;
+
+		if (!(entry.draw == draw))
+		{
+			retire(entry, fenceValue);
+			entry.draw = draw;
+			entry.useCount = 0;
+		}
+		else if (entry.pBundle != nullptr)
+		{
+			mHitCount.fetch_add(1, std::memory_order_relaxed);
+			return entry.pBundle;
+		}
+
+		if (++entry.useCount < mStableUseCount)
+		{
+			return nullptr;
+		}
+	}
+
+	void* pBundle = mpRecorder->record(key, draw);
+	if (pBundle == nullptr)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mRecordCount.fetch_add(1, std::memory_order_relaxed);
+
+	// Another thread may have changed the entry meanwhile; this frame can still use the new bundle.
+	auto found = mEntries.find(key);
+	if (found != mEntries.end() && found->second.draw == draw && found->second.pBundle == nullptr)
+	{
+		found->second.pBundle = pBundle;
+	}
+	else
+	{
+		RetiredBundle retired = { pBundle, fenceValue };
+		mRetired.push_back(retired);
+	}
+	return pBundle;
+}
+
+template<typename Predicate>
+void BundleCache::invalidate(Predicate predicate, uint64_t fenceValue)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (auto it = mEntries.begin(); it != mEntries.end();)
+	{
+		if (predicate(it->first))
+		{
+			retire(it->second, fenceValue);
+			it = mEntries.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void BundleCache::invalidateMesh(const void* pMesh, uint64_t fenceValue)
+{
+	invalidate([pMesh](const BundleKey& key) { return key.pMesh == pMesh; }, fenceValue);
+}
+
+void BundleCache::invalidatePipelineState(const void* pPipelineState, uint64_t fenceValue)
+{
+	invalidate([pPipelineState](const BundleKey& key) { return key.pPipelineState == pPipelineState; }, fenceValue);
+}
+
+void BundleCache::evictUnused(uint64_t fenceValue)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (auto it = mEntries.begin(); it != mEntries.end();)
+	{
+		if (it->second.lastFenceValue < fenceValue)
+		{
+			if (it->second.pBundle != nullptr)
+			{
+				mpRecorder->destroy(it->second.pBundle);
+			}
+			it = mEntries.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void BundleCache::collect(uint64_t completedFenceValue)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < mRetired.size(); ++i)
+	{
+		if (mRetired[i].fenceValue <= completedFenceValue)
+		{
+			mpRecorder->destroy(mRetired[i].pBundle);
+		}
+		else
+		{
+			mRetired[kept++] = mRetired[i];
+		}
+	}
+	mRetired.resize(kept);
+}
+
+uint32_t BundleCache::getBundleCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	uint32_t count = 0;
+	for (const auto& pair : mEntries)
+	{
+		if (pair.second.pBundle != nullptr)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+uint32_t BundleCache::getRetiredCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return static_cast<uint32_t>(mRetired.size());
+}
+
+/// <summary>
+/// An invalidation from another thread can carry an older fence value than a frame
+/// that already acquired the bundle, so the bundle also waits for its last acquire.
+/// </summary>
+void BundleCache::retire(Entry& entry, uint64_t fenceValue)
+{
+	if (entry.pBundle != nullptr)
+	{
+		RetiredBundle retired = { entry.pBundle, (entry.lastFenceValue > fenceValue) ? entry.lastFenceValue : fenceValue };
+		mRetired.push_back(retired);
+		entry.pBundle = nullptr;
+	}
+}
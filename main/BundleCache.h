@@ -0,0 +1,121 @@
+#ifndef __RENDERER_BUNDLECACHE_H__
+#define __RENDERER_BUNDLECACHE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// What a cached bundle binds. Opaque so the cache does not depend on D3D12.
+struct BundleKey
+{
+	const void* pMesh;
+	const void* pPipelineState;
+	const void* pRootSignature;
+
+	bool operator==(const BundleKey& key) const { return pMesh == key.pMesh && pPipelineState == key.pPipelineState && pRootSignature == key.pRootSignature; }
+};
+
+// Parameters baked into a bundle; a bundle is only replayed for the same values.
+struct BundleDraw
+{
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	// Mesh::getGeometryId, changes whenever the mesh's buffers are replaced
+	uint32_t geometryId;
+
+	bool operator==(const BundleDraw& draw) const { return firstInstance == draw.firstInstance && instanceCount == draw.instanceCount && geometryId == draw.geometryId; }
+};
+
+// Records the bundles cached by BundleCache. Handles are opaque so the cache can be tested without a device.
+class IBundleRecorder
+{
+public:
+	virtual ~IBundleRecorder() {}
+
+	// Returns a closed bundle drawing key with draw, or nullptr on failure. Called from any thread.
+	virtual void* record(const BundleKey& key, const BundleDraw& draw) = 0;
+	virtual void destroy(void* pBundle) = 0;
+};
+
+// Bundles of static draws, recorded once and replayed every frame the draw stays the same.
+// A draw is only recorded after it was requested unchanged stableUseCount times in a row, so
+// draws that change every frame keep being recorded directly instead of into a new bundle each
+// time. Bundles the GPU may still execute are retired with a fence value and destroyed by
+// collect() once it completes.
+class BundleCache
+{
+public:
+	static const uint32_t DefaultStableUseCount = 2;
+
+	BundleCache();
+	~BundleCache();
+
+	void initialize(IBundleRecorder* pRecorder, uint32_t stableUseCount = DefaultStableUseCount);
+	// The GPU must no longer execute any bundle.
+	void destroy();
+
+	// Thread-safe. Bundle replaying draw, or nullptr if the caller has to record it directly.
+	// fenceValue is signaled after the command lists of the frame being recorded.
+	void* acquire(const BundleKey& key, const BundleDraw& draw, uint64_t fenceValue);
+
+	// Retire every bundle binding pMesh or pPipelineState, e.g. before it is released. Thread-safe;
+	// a bundle acquired for a later fence value than fenceValue is kept until that one completes.
+	void invalidateMesh(const void* pMesh, uint64_t fenceValue);
+	void invalidatePipelineState(const void* pPipelineState, uint64_t fenceValue);
+	// Destroys bundles last acquired before fenceValue, which must have completed.
+	void evictUnused(uint64_t fenceValue);
+	// Destroys retired bundles whose fence value has completed.
+	void collect(uint64_t completedFenceValue);
+
+	uint32_t getBundleCount() const;
+	uint32_t getRetiredCount() const;
+	uint32_t getRecordCount() const { return mRecordCount.load(std::memory_order_relaxed); }
+	uint32_t getHitCount() const { return mHitCount.load(std::memory_order_relaxed); }
+
+private:
+	struct BundleKeyHash
+	{
+		size_t operator()(const BundleKey& key) const
+		{
+			size_t h = std::hash<const void*>()(key.pMesh);
+			h ^= std::hash<const void*>()(key.pPipelineState) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			h ^= std::hash<const void*>()(key.pRootSignature) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			return h;
+		}
+	};
+
+	struct Entry
+	{
+		BundleDraw draw;
+		void* pBundle;
+		// Acquires in a row with the same draw
+		uint32_t useCount;
+		uint64_t lastFenceValue;
+	};
+
+	struct RetiredBundle
+	{
+		void* pBundle;
+		uint64_t fenceValue;
+	};
+
+	template<typename Predicate>
+	void invalidate(Predicate predicate, uint64_t fenceValue);
+	void retire(Entry& entry, uint64_t fenceValue);
+
+	IBundleRecorder* mpRecorder;
+	uint32_t mStableUseCount;
+
+	std::unordered_map<BundleKey, Entry, BundleKeyHash> mEntries;
+	std::vector<RetiredBundle> mRetired;
+
+	// Statistics only, read without the lock
+	std::atomic<uint32_t> mRecordCount;
+	std::atomic<uint32_t> mHitCount;
+	mutable std::mutex mMutex;
+};
+
+#endif
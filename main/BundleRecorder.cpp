@@ -0,0 +1,71 @@
+#include "stdafx.h"
+#include "BundleRecorder.h"
+#include "Mesh.h"
+
+BundleRecorder::BundleRecorder()
+	: mDevice()
+	, mpDescriptorHeap(nullptr)
+	, mDrawConstantsParameter(0)
+{
+
+}
+
+BundleRecorder::~BundleRecorder()
+{
+
+}
+
+void BundleRecorder::initialize(ID3D12Device* pDevice, ID3D12DescriptorHeap* pDescriptorHeap, uint32_t drawConstantsParameter)
+{
+	mDevice = pDevice;
+	mpDescriptorHeap = pDescriptorHeap;
+	mDrawConstantsParameter = drawConstantsParameter;
+}
+
+/// <summary>
+/// Root arguments other than the draw constants are inherited from the executing list,
+/// which is why the bundle sets the same root signature.
+/// </summary>
+void* BundleRecorder::record(const BundleKey& key, const BundleDraw& draw)
+{
+	const Mesh* pMesh = static_cast<const Mesh*>(key.pMesh);
+	ID3D12PipelineState* pPipelineState = static_cast<ID3D12PipelineState*>(const_cast<void*>(key.pPipelineState));
+	ID3D12RootSignature* pRootSignature = static_cast<ID3D12RootSignature*>(const_cast<void*>(key.pRootSignature));
+
+	Bundle* pBundle = new Bundle();
+	if (FAILED(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS(&pBundle->allocator))) ||
+		FAILED(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, pBundle->allocator.Get(), pPipelineState, IID_PPV_ARGS(&pBundle->commandList))))
+	{
+		delete pBundle;
+		return nullptr;
+	}
+
+	ID3D12GraphicsCommandList* pCommandList = pBundle->commandList.Get();
+	pCommandList->SetGraphicsRootSignature(pRootSignature);
+	if (mpDescriptorHeap != nullptr)
+	{
+		pCommandList->SetDescriptorHeaps(1, &mpDescriptorHeap);
+	}
+	pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	pCommandList->IASetVertexBuffers(0, 1, &pMesh->getVertexBufferView());
+	pCommandList->IASetIndexBuffer(&pMesh->getIndexBufferView());
+	pCommandList->SetGraphicsRoot32BitConstant(mDrawConstantsParameter, draw.firstInstance, 0);
+	pCommandList->DrawIndexedInstanced(pMesh->getIndexCount(), draw.instanceCount, 0, 0, 0);
+
+	if (FAILED(pCommandList->Close()))
+	{
+		delete pBundle;
+		return nullptr;
+	}
+	return pBundle;
+}
+
+void BundleRecorder::destroy(void* pBundle)
+{
+	delete static_cast<Bundle*>(pBundle);
+}
+
+ID3D12GraphicsCommandList* BundleRecorder::GetBundle(void* pBundle)
+{
+	return static_cast<Bundle*>(pBundle)->commandList.Get();
+}
@@ -0,0 +1,36 @@
+#ifndef __RENDERER_BUNDLERECORDER_H__
+#define __RENDERER_BUNDLERECORDER_H__
+
+#include "BundleCache.h"
+
+using namespace Microsoft::WRL;
+
+// D3D12 backend of BundleCache: every handle is a bundle with its own allocator that draws a
+// Mesh's instances, the first instance passed as a root constant like Renderer::recordBatches.
+class BundleRecorder final : public IBundleRecorder
+{
+public:
+	BundleRecorder();
+	virtual ~BundleRecorder();
+
+	// Bundles set the same descriptor heap as the lists executing them, so they inherit its tables.
+	void initialize(ID3D12Device* pDevice, ID3D12DescriptorHeap* pDescriptorHeap, uint32_t drawConstantsParameter);
+
+	void* record(const BundleKey& key, const BundleDraw& draw) override;
+	void destroy(void* pBundle) override;
+
+	static ID3D12GraphicsCommandList* GetBundle(void* pBundle);
+
+private:
+	struct Bundle
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		ComPtr<ID3D12GraphicsCommandList> commandList;
+	};
+
+	ComPtr<ID3D12Device> mDevice;
+	ID3D12DescriptorHeap* mpDescriptorHeap;
+	uint32_t mDrawConstantsParameter;
+};
+
+#endif
@@ -0,0 +1,784 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+const uint32_t Bvh::InvalidIndex;
+
+namespace
+{
+	const uint32_t BinCount = 16;
+
+	Aabb Union(const Aabb& a, const Aabb& b)
+	{
+		Aabb result;
+		for (int i = 0; i < 3; ++i)
+		{
+			result.lower[i] = (a.lower[i] < b.lower[i]) ? a.lower[i] : b.lower[i];
+			result.upper[i] = (a.upper[i] > b.upper[i]) ? a.upper[i] : b.upper[i];
+		}
+		return result;
+	}
+
+	// Half the surface area; SAH only compares areas, so the factor does not matter.
+	float Area(const Aabb& a)
+	{
+		const float dx = a.upper[0] - a.lower[0];
+		const float dy = a.upper[1] - a.lower[1];
+		const float dz = a.upper[2] - a.lower[2];
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	bool Contains(const Aabb& outer, const Aabb& inner)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			if (inner.lower[i] < outer.lower[i] || inner.upper[i] > outer.upper[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Overlaps(const Aabb& a, const Aabb& b)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			if (a.upper[i] < b.lower[i] || b.upper[i] < a.lower[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Aabb Fatten(const Aabb& bounds, float margin)
+	{
+		Aabb result;
+		for (int i = 0; i < 3; ++i)
+		{
+			result.lower[i] = bounds.lower[i] - margin;
+			result.upper[i] = bounds.upper[i] + margin;
+		}
+		return result;
+	}
+
+	Aabb EmptyAabb()
+	{
+		Aabb result;
+		for (int i = 0; i < 3; ++i)
+		{
+			result.lower[i] = FLT_MAX;
+			result.upper[i] = -FLT_MAX;
+		}
+		return result;
+	}
+
+	enum FrustumTest
+	{
+		Outside,
+		Intersecting,
+		Inside
+	};
+
+	FrustumTest TestFrustum(const Frustum& frustum, const Aabb& bounds)
+	{
+		const float cx = (bounds.lower[0] + bounds.upper[0]) * 0.5f;
+		const float cy = (bounds.lower[1] + bounds.upper[1]) * 0.5f;
+		const float cz = (bounds.lower[2] + bounds.upper[2]) * 0.5f;
+		const float ex = (bounds.upper[0] - bounds.lower[0]) * 0.5f;
+		const float ey = (bounds.upper[1] - bounds.lower[1]) * 0.5f;
+		const float ez = (bounds.upper[2] - bounds.lower[2]) * 0.5f;
+
+		FrustumTest result = Inside;
+		for (const XMFLOAT4& plane : frustum.planes)
+		{
+			const float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+			const float radius = fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+			if (distance < -radius)
+			{
+				return Outside;
+			}
+			if (distance < radius)
+			{
+				result = Intersecting;
+			}
+		}
+		return result;
+	}
+
+	// Entry distance of the ray into bounds, clamped to 0 when the origin is inside.
+	bool IntersectRay(const Aabb& bounds, const float origin[3], const float inverseDirection[3], float maxDistance, float* pDistance)
+	{
+		float tmin = 0.0f;
+		float tmax = maxDistance;
+		for (int i = 0; i < 3; ++i)
+		{
+			float t0 = (bounds.lower[i] - origin[i]) * inverseDirection[i];
+			float t1 = (bounds.upper[i] - origin[i]) * inverseDirection[i];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			tmin = (t0 > tmin) ? t0 : tmin;
+			tmax = (t1 < tmax) ? t1 : tmax;
+			if (tmin > tmax)
+			{
+				return false;
+			}
+		}
+		*pDistance = tmin;
+		return true;
+	}
+
+	struct BuildRange
+	{
+		uint32_t begin;
+		uint32_t end;
+		uint32_t parent;
+		uint32_t side;
+	};
+
+	/// <summary>
+	/// Binned SAH over all three axes. Reorders objects[begin, end) and returns the split point.
+	/// Falls back to a median split when the centroids cannot be separated.
+	/// </summary>
+	uint32_t SplitSah(uint32_t* objects, const float* centroids, const Aabb* pBounds, uint32_t begin, uint32_t end)
+	{
+		Aabb centroidBounds = EmptyAabb();
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const float* c = centroids + objects[i] * 3;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				centroidBounds.lower[axis] = (c[axis] < centroidBounds.lower[axis]) ? c[axis] : centroidBounds.lower[axis];
+				centroidBounds.upper[axis] = (c[axis] > centroidBounds.upper[axis]) ? c[axis] : centroidBounds.upper[axis];
+			}
+		}
+
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		uint32_t bestBin = 0;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float extent = centroidBounds.upper[axis] - centroidBounds.lower[axis];
+			if (extent <= 0.0f)
+			{
+				continue;
+			}
+			const float scale = BinCount / extent;
+
+			Aabb binBounds[BinCount];
+			uint32_t binCounts[BinCount] = {};
+			for (Aabb& bounds : binBounds)
+			{
+				bounds = EmptyAabb();
+			}
+
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t object = objects[i];
+				uint32_t bin = static_cast<uint32_t>((centroids[object * 3 + axis] - centroidBounds.lower[axis]) * scale);
+				bin = (bin < BinCount) ? bin : BinCount - 1;
+				binBounds[bin] = Union(binBounds[bin], pBounds[object]);
+				binCounts[bin]++;
+			}
+
+			// Sweep from the right to get the cost of every right-hand side, then from the left.
+			float rightAreas[BinCount];
+			uint32_t rightCounts[BinCount];
+			Aabb accumulated = EmptyAabb();
+			uint32_t count = 0;
+			for (uint32_t bin = BinCount - 1; bin > 0; --bin)
+			{
+				accumulated = Union(accumulated, binBounds[bin]);
+				count += binCounts[bin];
+				rightAreas[bin] = (count > 0) ? Area(accumulated) : 0.0f;
+				rightCounts[bin] = count;
+			}
+
+			accumulated = EmptyAabb();
+			count = 0;
+			for (uint32_t bin = 0; bin < BinCount - 1; ++bin)
+			{
+				accumulated = Union(accumulated, binBounds[bin]);
+				count += binCounts[bin];
+				if (count == 0 || rightCounts[bin + 1] == 0)
+				{
+					continue;
+				}
+
+				const float cost = count * Area(accumulated) + rightCounts[bin + 1] * rightAreas[bin + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin + 1;
+				}
+			}
+		}
+
+		if (bestAxis >= 0)
+		{
+			const float lower = centroidBounds.lower[bestAxis];
+			const float scale = BinCount / (centroidBounds.upper[bestAxis] - lower);
+			uint32_t* pMiddle = std::partition(objects + begin, objects + end, [&](uint32_t object)
+			{
+				uint32_t bin = static_cast<uint32_t>((centroids[object * 3 + bestAxis] - lower) * scale);
+				bin = (bin < BinCount) ? bin : BinCount - 1;
+				return bin < bestBin;
+			});
+
+			const uint32_t middle = static_cast<uint32_t>(pMiddle - objects);
+			if (middle > begin && middle < end)
+			{
+				return middle;
+			}
+		}
+
+		return begin + (end - begin) / 2;
+	}
+}
+
+Bvh::Bvh(float margin)
+	: mNodes()
+	, mRoot(InvalidIndex)
+	, mFreeList(InvalidIndex)
+	, mLeafCount(0)
+	, mMargin(margin)
+{
+
+}
+
+Bvh::~Bvh()
+{
+
+}
+
+/// <summary>
+/// Nodes are allocated in pre-order, left subtree first, so the tree is laid out depth-first
+/// and every child has a higher index than its parent.
+/// </summary>
+void Bvh::build(const Aabb* pBounds, const uint32_t* pUserData, uint32_t count, uint32_t* pOutProxies)
+{
+	clear();
+	if (count == 0)
+	{
+		return;
+	}
+
+	mNodes.reserve(count * 2 - 1);
+
+	std::vector<uint32_t> objects(count);
+	std::vector<float> centroids(count * 3);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		objects[i] = i;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			centroids[i * 3 + axis] = (pBounds[i].lower[axis] + pBounds[i].upper[axis]) * 0.5f;
+		}
+	}
+
+	std::vector<BuildRange> stack;
+	stack.push_back({ 0, count, InvalidIndex, 0 });
+	while (!stack.empty())
+	{
+		const BuildRange range = stack.back();
+		stack.pop_back();
+
+		const uint32_t index = allocateNode();
+		mNodes[index].parent = range.parent;
+		if (range.parent != InvalidIndex)
+		{
+			mNodes[range.parent].child[range.side] = index;
+		}
+		else
+		{
+			mRoot = index;
+		}
+
+		if (range.end - range.begin == 1)
+		{
+			const uint32_t object = objects[range.begin];
+			mNodes[index].bounds = Fatten(pBounds[object], mMargin);
+			mNodes[index].userData = pUserData[object];
+			mNodes[index].height = 0;
+			pOutProxies[object] = index;
+			mLeafCount++;
+			continue;
+		}
+
+		const uint32_t middle = SplitSah(objects.data(), centroids.data(), pBounds, range.begin, range.end);
+		stack.push_back({ middle, range.end, index, 1 });
+		stack.push_back({ range.begin, middle, index, 0 });
+	}
+
+	// Children come after their parent, so one backward pass fits every internal node.
+	for (uint32_t i = static_cast<uint32_t>(mNodes.size()); i-- > 0;)
+	{
+		Node& node = mNodes[i];
+		if (!node.isLeaf())
+		{
+			const Node& left = mNodes[node.child[0]];
+			const Node& right = mNodes[node.child[1]];
+			node.bounds = Union(left.bounds, right.bounds);
+			node.height = 1 + ((left.height > right.height) ? left.height : right.height);
+		}
+	}
+}
+
+void Bvh::clear()
+{
+	mNodes.clear();
+	mRoot = InvalidIndex;
+	mFreeList = InvalidIndex;
+	mLeafCount = 0;
+}
+
+uint32_t Bvh::insert(const Aabb& bounds, uint32_t userData)
+{
+	const uint32_t leaf = allocateNode();
+	mNodes[leaf].bounds = Fatten(bounds, mMargin);
+	mNodes[leaf].userData = userData;
+	mNodes[leaf].height = 0;
+
+	insertLeaf(leaf);
+	mLeafCount++;
+	return leaf;
+}
+
+void Bvh::remove(uint32_t proxy)
+{
+	removeLeaf(proxy);
+	freeNode(proxy);
+	mLeafCount--;
+}
+
+bool Bvh::update(uint32_t proxy, const Aabb& bounds)
+{
+	if (Contains(mNodes[proxy].bounds, bounds))
+	{
+		return false;
+	}
+
+	removeLeaf(proxy);
+	mNodes[proxy].bounds = Fatten(bounds, mMargin);
+	insertLeaf(proxy);
+	return true;
+}
+
+void Bvh::refit(uint32_t proxy, const Aabb& bounds)
+{
+	mNodes[proxy].bounds = Fatten(bounds, mMargin);
+	refitAncestors(mNodes[proxy].parent, false);
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+	if (mRoot == InvalidIndex)
+	{
+		return;
+	}
+
+	// The top bit marks subtrees already known to be fully inside; they skip the plane tests.
+	const uint32_t InsideFlag = 0x80000000u;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(mRoot);
+	while (!stack.empty())
+	{
+		const uint32_t entry = stack.back();
+		stack.pop_back();
+
+		const uint32_t index = entry & ~InsideFlag;
+		const Node& node = mNodes[index];
+
+		uint32_t flag = entry & InsideFlag;
+		if (flag == 0)
+		{
+			const FrustumTest test = TestFrustum(frustum, node.bounds);
+			if (test == Outside)
+			{
+				continue;
+			}
+			flag = (test == Inside) ? InsideFlag : 0;
+		}
+
+		if (node.isLeaf())
+		{
+			out.push_back(node.userData);
+		}
+		else
+		{
+			stack.push_back(node.child[1] | flag);
+			stack.push_back(node.child[0] | flag);
+		}
+	}
+}
+
+void Bvh::queryOverlap(const Aabb& bounds, std::vector<uint32_t>& out) const
+{
+	if (mRoot == InvalidIndex)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(mRoot);
+	while (!stack.empty())
+	{
+		const Node& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (!Overlaps(node.bounds, bounds))
+		{
+			continue;
+		}
+
+		if (node.isLeaf())
+		{
+			out.push_back(node.userData);
+		}
+		else
+		{
+			stack.push_back(node.child[1]);
+			stack.push_back(node.child[0]);
+		}
+	}
+}
+
+/// <summary>
+/// Visits the nearer child first and skips every node farther than the closest hit so far.
+/// </summary>
+bool Bvh::raycast(const float origin[3], const float direction[3], float maxDistance, uint32_t* pUserData, float* pDistance) const
+{
+	if (mRoot == InvalidIndex)
+	{
+		return false;
+	}
+
+	float inverseDirection[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		inverseDirection[i] = (direction[i] != 0.0f) ? 1.0f / direction[i] : FLT_MAX;
+	}
+
+	bool isHit = false;
+	float closest = maxDistance;
+
+	float distance;
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	if (IntersectRay(mNodes[mRoot].bounds, origin, inverseDirection, closest, &distance))
+	{
+		stack.push_back(mRoot);
+	}
+
+	while (!stack.empty())
+	{
+		const Node& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (!IntersectRay(node.bounds, origin, inverseDirection, closest, &distance))
+		{
+			continue;
+		}
+
+		if (node.isLeaf())
+		{
+			isHit = true;
+			closest = distance;
+			*pUserData = node.userData;
+			continue;
+		}
+
+		float distances[2];
+		bool isChildHit[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			isChildHit[i] = IntersectRay(mNodes[node.child[i]].bounds, origin, inverseDirection, closest, &distances[i]);
+		}
+
+		const int nearer = (isChildHit[1] && (!isChildHit[0] || distances[1] < distances[0])) ? 1 : 0;
+		const int farther = 1 - nearer;
+		if (isChildHit[farther])
+		{
+			stack.push_back(node.child[farther]);
+		}
+		if (isChildHit[nearer])
+		{
+			stack.push_back(node.child[nearer]);
+		}
+	}
+
+	if (isHit)
+	{
+		*pDistance = closest;
+	}
+	return isHit;
+}
+
+uint32_t Bvh::allocateNode()
+{
+	uint32_t index;
+	if (mFreeList != InvalidIndex)
+	{
+		index = mFreeList;
+		mFreeList = mNodes[index].parent;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(mNodes.size());
+		mNodes.emplace_back();
+	}
+
+	Node& node = mNodes[index];
+	node.parent = InvalidIndex;
+	node.child[0] = InvalidIndex;
+	node.child[1] = InvalidIndex;
+	node.userData = InvalidIndex;
+	node.height = 0;
+	return index;
+}
+
+void Bvh::freeNode(uint32_t index)
+{
+	mNodes[index].parent = mFreeList;
+	mNodes[index].height = -1;
+	mFreeList = index;
+}
+
+/// <summary>
+/// Descends towards the sibling that minimizes the increase in total surface area,
+/// stopping early once going deeper cannot be cheaper, then pairs the leaf with it.
+/// </summary>
+void Bvh::insertLeaf(uint32_t leaf)
+{
+	if (mRoot == InvalidIndex)
+	{
+		mRoot = leaf;
+		mNodes[leaf].parent = InvalidIndex;
+		return;
+	}
+
+	const Aabb leafBounds = mNodes[leaf].bounds;
+
+	uint32_t index = mRoot;
+	while (!mNodes[index].isLeaf())
+	{
+		const Node& node = mNodes[index];
+
+		const float area = Area(node.bounds);
+		const float combinedArea = Area(Union(node.bounds, leafBounds));
+
+		// Cost of making a new parent for this node and the leaf
+		const float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			const Node& child = mNodes[node.child[i]];
+			const float unionArea = Area(Union(leafBounds, child.bounds));
+			childCosts[i] = (child.isLeaf() ? unionArea : unionArea - Area(child.bounds)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+		{
+			break;
+		}
+		index = (childCosts[0] < childCosts[1]) ? node.child[0] : node.child[1];
+	}
+
+	const uint32_t sibling = index;
+	const uint32_t oldParent = mNodes[sibling].parent;
+
+	const uint32_t newParent = allocateNode();
+	mNodes[newParent].parent = oldParent;
+	mNodes[newParent].bounds = Union(leafBounds, mNodes[sibling].bounds);
+	mNodes[newParent].height = mNodes[sibling].height + 1;
+	mNodes[newParent].child[0] = sibling;
+	mNodes[newParent].child[1] = leaf;
+
+	if (oldParent != InvalidIndex)
+	{
+		Node& parent = mNodes[oldParent];
+		parent.child[(parent.child[0] == sibling) ? 0 : 1] = newParent;
+	}
+	else
+	{
+		mRoot = newParent;
+	}
+
+	mNodes[sibling].parent = newParent;
+	mNodes[leaf].parent = newParent;
+
+	refitAncestors(newParent, true);
+}
+
+void Bvh::removeLeaf(uint32_t leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = InvalidIndex;
+		return;
+	}
+
+	const uint32_t parent = mNodes[leaf].parent;
+	const uint32_t grandParent = mNodes[parent].parent;
+	const uint32_t sibling = (mNodes[parent].child[0] == leaf) ? mNodes[parent].child[1] : mNodes[parent].child[0];
+
+	if (grandParent != InvalidIndex)
+	{
+		Node& node = mNodes[grandParent];
+		node.child[(node.child[0] == parent) ? 0 : 1] = sibling;
+		mNodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		refitAncestors(grandParent, true);
+	}
+	else
+	{
+		mRoot = sibling;
+		mNodes[sibling].parent = InvalidIndex;
+		freeNode(parent);
+	}
+}
+
+void Bvh::refitAncestors(uint32_t index, bool rebalance)
+{
+	while (index != InvalidIndex)
+	{
+		if (rebalance)
+		{
+			index = balance(index);
+		}
+
+		Node& node = mNodes[index];
+		const Node& left = mNodes[node.child[0]];
+		const Node& right = mNodes[node.child[1]];
+		node.bounds = Union(left.bounds, right.bounds);
+		node.height = 1 + ((left.height > right.height) ? left.height : right.height);
+
+		index = node.parent;
+	}
+}
+
+/// <summary>
+/// Rotates the taller grandchild subtree up when the children's heights differ by more than one.
+/// Returns the node now at the position of index.
+/// </summary>
+uint32_t Bvh::balance(uint32_t iA)
+{
+	Node* A = &mNodes[iA];
+	if (A->isLeaf() || A->height < 2)
+	{
+		return iA;
+	}
+
+	const uint32_t iB = A->child[0];
+	const uint32_t iC = A->child[1];
+	Node* B = &mNodes[iB];
+	Node* C = &mNodes[iC];
+
+	const int32_t difference = C->height - B->height;
+
+	// Rotate C up
+	if (difference > 1)
+	{
+		const uint32_t iF = C->child[0];
+		const uint32_t iG = C->child[1];
+		Node* F = &mNodes[iF];
+		Node* G = &mNodes[iG];
+
+		C->child[0] = iA;
+		C->parent = A->parent;
+		A->parent = iC;
+
+		if (C->parent != InvalidIndex)
+		{
+			Node& parent = mNodes[C->parent];
+			parent.child[(parent.child[0] == iA) ? 0 : 1] = iC;
+		}
+		else
+		{
+			mRoot = iC;
+		}
+
+		if (F->height > G->height)
+		{
+			C->child[1] = iF;
+			A->child[1] = iG;
+			G->parent = iA;
+			A->bounds = Union(B->bounds, G->bounds);
+			C->bounds = Union(A->bounds, F->bounds);
+			A->height = 1 + ((B->height > G->height) ? B->height : G->height);
+			C->height = 1 + ((A->height > F->height) ? A->height : F->height);
+		}
+		else
+		{
+			C->child[1] = iG;
+			A->child[1] = iF;
+			F->parent = iA;
+			A->bounds = Union(B->bounds, F->bounds);
+			C->bounds = Union(A->bounds, G->bounds);
+			A->height = 1 + ((B->height > F->height) ? B->height : F->height);
+			C->height = 1 + ((A->height > G->height) ? A->height : G->height);
+		}
+		return iC;
+	}
+
+	// Rotate B up
+	if (difference < -1)
+	{
+		const uint32_t iD = B->child[0];
+		const uint32_t iE = B->child[1];
+		Node* D = &mNodes[iD];
+		Node* E = &mNodes[iE];
+
+		B->child[0] = iA;
+		B->parent = A->parent;
+		A->parent = iB;
+
+		if (B->parent != InvalidIndex)
+		{
+			Node& parent = mNodes[B->parent];
+			parent.child[(parent.child[0] == iA) ? 0 : 1] = iB;
+		}
+		else
+		{
+			mRoot = iB;
+		}
+
+		if (D->height > E->height)
+		{
+			B->child[1] = iD;
+			A->child[0] = iE;
+			E->parent = iA;
+			A->bounds = Union(C->bounds, E->bounds);
+			B->bounds = Union(A->bounds, D->bounds);
+			A->height = 1 + ((C->height > E->height) ? C->height : E->height);
+			B->height = 1 + ((A->height > D->height) ? A->height : D->height);
+		}
+		else
+		{
+			B->child[1] = iE;
+			A->child[0] = iD;
+			D->parent = iA;
+			A->bounds = Union(C->bounds, D->bounds);
+			B->bounds = Union(A->bounds, E->bounds);
+			A->height = 1 + ((C->height > D->height) ? C->height : D->height);
+			B->height = 1 + ((A->height > E->height) ? A->height : E->height);
+		}
+		return iB;
+	}
+
+	return iA;
+}
@@ -0,0 +1,87 @@
+#ifndef __MATH_BVH_H__
+#define __MATH_BVH_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.h"
+
+struct Aabb
+{
+	float lower[3];
+	float upper[3];
+};
+
+// Dynamic bounding volume hierarchy over axis-aligned boxes, one object per leaf.
+// Nodes live in a flat array addressed by index; a proxy is the index of an object's leaf and
+// stays valid until the object is removed or the tree is rebuilt.
+//
+// build creates the whole tree top-down with binned SAH and lays it out depth-first.
+// insert / remove / update keep it up to date afterwards, rebalancing with rotations.
+// Leaves store their box enlarged by a margin, so small movements only need a refit.
+class Bvh
+{
+public:
+	static const uint32_t InvalidIndex = UINT32_MAX;
+
+	explicit Bvh(float margin = 0.1f);
+	~Bvh();
+
+	// Replaces the tree. pOutProxies[i] receives the proxy of object i.
+	void build(const Aabb* pBounds, const uint32_t* pUserData, uint32_t count, uint32_t* pOutProxies);
+	void clear();
+
+	uint32_t insert(const Aabb& bounds, uint32_t userData);
+	void remove(uint32_t proxy);
+
+	// Moves an object. Nothing changes while bounds stays inside the leaf's enlarged box,
+	// otherwise the leaf is reinserted. Returns true when it was reinserted.
+	bool update(uint32_t proxy, const Aabb& bounds);
+
+	// Moves an object without changing the topology: only the ancestors' boxes grow or shrink.
+	// Cheaper than update, but the tree degrades when objects travel far.
+	void refit(uint32_t proxy, const Aabb& bounds);
+
+	uint32_t getUserData(uint32_t proxy) const { return mNodes[proxy].userData; }
+	const Aabb& getFatBounds(uint32_t proxy) const { return mNodes[proxy].bounds; }
+	uint32_t getProxyCount() const { return mLeafCount; }
+	int getHeight() const { return (mRoot != InvalidIndex) ? mNodes[mRoot].height : 0; }
+
+	// Append the user data of every object whose enlarged box touches the query to pOut.
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	void queryOverlap(const Aabb& bounds, std::vector<uint32_t>& out) const;
+
+	// Closest object whose enlarged box the ray hits within maxDistance.
+	// direction does not need to be normalized; distances are in units of its length.
+	bool raycast(const float origin[3], const float direction[3], float maxDistance, uint32_t* pUserData, float* pDistance) const;
+
+private:
+	struct Node
+	{
+		Aabb bounds;
+		// Doubles as the next free node while the node is unused
+		uint32_t parent;
+		uint32_t child[2];
+		uint32_t userData;
+		// 0 for leaves, -1 for free nodes
+		int32_t height;
+
+		bool isLeaf() const { return child[0] == InvalidIndex; }
+	};
+
+	uint32_t allocateNode();
+	void freeNode(uint32_t index);
+
+	void insertLeaf(uint32_t leaf);
+	void removeLeaf(uint32_t leaf);
+	void refitAncestors(uint32_t index, bool rebalance);
+	uint32_t balance(uint32_t index);
+
+	std::vector<Node> mNodes;
+	uint32_t mRoot;
+	uint32_t mFreeList;
+	uint32_t mLeafCount;
+	float mMargin;
+};
+
+#endif
@@ -35,6 +35,13 @@ void Camera::setup()
 	width = rect.right - rect.left;
 	height = rect.bottom - rect.top;
 
+	setViewportSize(width, height);
+
+	setClearColor(0.0f, 0.2f, 0.4f, 1.0f);
+}
+
+void Camera::setViewportSize(LONG width, LONG height)
+{
 	// r[|[gݒ
 	{
 		// Viewport
@@ -51,8 +58,6 @@ void Camera::setup()
 		mScissorRect.right = width;
 		mScissorRect.bottom = height;
 	}
-
-	setClearColor(0.0f, 0.2f, 0.4f, 1.0f);
 }
 
 void Camera::update()
@@ -124,19 +129,19 @@ void Camera::update()
 	getTransform()->setLocalRotation(rotation);
 }
 
-void Camera::onRender()
+void Camera::onRender(RenderSnapshot& snapshot)
 {
 	XMVECTOR det;
 	mView = XMMatrixInverse(&det, getTransform()->getWorldMatrix());
 	mProjection = XMMatrixPerspectiveFovLH(1.0f, mViewport.Width / mViewport.Height, 1.0f, 100.0f);
 
-	CameraConstantBuffer buffer;
-
-	XMFLOAT4X4 matrix;
-	XMStoreFloat4x4(&matrix, XMMatrixTranspose(mView));
-	buffer.view = matrix;
-	XMStoreFloat4x4(&matrix, XMMatrixTranspose(mProjection));
-	buffer.projection = matrix;
+	XMStoreFloat4x4(&snapshot.view, XMMatrixTranspose(mView));
+	XMStoreFloat4x4(&snapshot.projection, XMMatrixTranspose(mProjection));
 
-	Renderer::getInstance()->onRegisterDataBuffer(1, &buffer, sizeof(CameraConstantBuffer));
+	snapshot.viewport = mViewport;
+	snapshot.scissorRect = mScissorRect;
+	for (int i = 0; i < 4; ++i)
+	{
+		snapshot.clearColor[i] = mClearColor[i];
+	}
 }
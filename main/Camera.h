@@ -19,7 +19,10 @@ public:
 
 	void setup();
 	void update();
-	void onRender();
+	// Covers the whole back buffer; called again when the window is resized
+	void setViewportSize(LONG width, LONG height);
+	// Writes the camera matrices, viewport and clear color into the frame's snapshot
+	void onRender(struct RenderSnapshot& snapshot);
 
 	UINT getNumViewport() { return mNumViewport; }
 	D3D12_VIEWPORT& getViewport() { return mViewport; }
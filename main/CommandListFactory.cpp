@@ -0,0 +1,56 @@
+#include "stdafx.h"
+#include "CommandListFactory.h"
+
+CommandListFactory::CommandListFactory()
+	: mDevice()
+	, mType(D3D12_COMMAND_LIST_TYPE_DIRECT)
+{
+
+}
+
+CommandListFactory::~CommandListFactory()
+{
+
+}
+
+void CommandListFactory::initialize(ID3D12Device* pDevice, D3D12_COMMAND_LIST_TYPE type)
+{
+	mDevice = pDevice;
+	mType = type;
+}
+
+void* CommandListFactory::create()
+{
+	PooledCommandList* pPooled = new PooledCommandList();
+
+	ThrowIfFailed(mDevice->CreateCommandAllocator(mType, IID_PPV_ARGS(&pPooled->allocator)));
+	ThrowIfFailed(mDevice->CreateCommandList(0, mType, pPooled->allocator.Get(), nullptr, IID_PPV_ARGS(&pPooled->commandList)));
+
+	// Created open; the pool expects closed lists and reopens them in reset.
+	ThrowIfFailed(pPooled->commandList->Close());
+
+	return pPooled;
+}
+
+void CommandListFactory::reset(void* pHandle)
+{
+	PooledCommandList* pPooled = static_cast<PooledCommandList*>(pHandle);
+
+	ThrowIfFailed(pPooled->allocator->Reset());
+	ThrowIfFailed(pPooled->commandList->Reset(pPooled->allocator.Get(), nullptr));
+}
+
+int32_t CommandListFactory::close(void* pHandle)
+{
+	return static_cast<PooledCommandList*>(pHandle)->commandList->Close();
+}
+
+void CommandListFactory::destroy(void* pHandle)
+{
+	delete static_cast<PooledCommandList*>(pHandle);
+}
+
+ID3D12GraphicsCommandList* CommandListFactory::GetCommandList(void* pHandle)
+{
+	return static_cast<PooledCommandList*>(pHandle)->commandList.Get();
+}
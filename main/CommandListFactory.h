@@ -0,0 +1,35 @@
+#ifndef __RENDERER_COMMANDLISTFACTORY_H__
+#define __RENDERER_COMMANDLISTFACTORY_H__
+
+#include "CommandListPool.h"
+
+using namespace Microsoft::WRL;
+
+// D3D12 backend of CommandListPool: every handle is a graphics command list with its own allocator.
+class CommandListFactory final : public ICommandListFactory
+{
+public:
+	CommandListFactory();
+	virtual ~CommandListFactory();
+
+	void initialize(ID3D12Device* pDevice, D3D12_COMMAND_LIST_TYPE type);
+
+	void* create() override;
+	void reset(void* pHandle) override;
+	int32_t close(void* pHandle) override;
+	void destroy(void* pHandle) override;
+
+	static ID3D12GraphicsCommandList* GetCommandList(void* pHandle);
+
+private:
+	struct PooledCommandList
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		ComPtr<ID3D12GraphicsCommandList> commandList;
+	};
+
+	ComPtr<ID3D12Device> mDevice;
+	D3D12_COMMAND_LIST_TYPE mType;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "CommandListPool.h"
+
+CommandListPool::CommandListPool()
+	: mpFactory(nullptr)
+	, mFrames()
+	, mFrameIndex(0)
+	, mMutex()
+{
+
+}
+
+CommandListPool::~CommandListPool()
+{
+	destroy();
+}
+
+void CommandListPool::initialize(ICommandListFactory* pFactory, uint32_t frameCount)
+{
+	destroy();
+
+	mpFactory = pFactory;
+	mFrames.resize(frameCount);
+	for (FrameLists& frame : mFrames)
+	{
+		frame.usedCount = 0;
+	}
+	mFrameIndex = 0;
+}
+
+/// <summary>
+/// Destroys every list. The GPU must no longer reference any of them.
+/// </summary>
+void CommandListPool::destroy()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (FrameLists& frame : mFrames)
+	{
+		for (void* pHandle : frame.handles)
+		{
+			mpFactory->destroy(pHandle);
+		}
+	}
+	mFrames.clear();
+	mpFactory = nullptr;
+}
+
+void CommandListPool::beginFrame(uint32_t frameIndex)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mFrameIndex = frameIndex;
+	mFrames[mFrameIndex].usedCount = 0;
+}
+
+void* CommandListPool::acquire()
+{
+	void* pHandle = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		FrameLists& frame = mFrames[mFrameIndex];
+		if (frame.usedCount == frame.handles.size())
+		{
+			frame.handles.push_back(mpFactory->create());
+		}
+		pHandle = frame.handles[frame.usedCount++];
+	}
+
+	// Only this caller owns the list from here, so the reset needs no lock.
+	mpFactory->reset(pHandle);
+	return pHandle;
+}
+
+uint32_t CommandListPool::getCreatedCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	size_t count = 0;
+	for (const FrameLists& frame : mFrames)
+	{
+		count += frame.handles.size();
+	}
+	return static_cast<uint32_t>(count);
+}
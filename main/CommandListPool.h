@@ -0,0 +1,58 @@
+#ifndef __RENDERER_COMMANDLISTPOOL_H__
+#define __RENDERER_COMMANDLISTPOOL_H__
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Creates and resets the command lists handed out by CommandListPool.
+// Handles are opaque so the pool and recorder do not depend on D3D12.
+class ICommandListFactory
+{
+public:
+	virtual ~ICommandListFactory() {}
+
+	// Returns a new list with its own allocator, closed.
+	virtual void* create() = 0;
+	// Resets the list's allocator and reopens the list for recording.
+	virtual void reset(void* pHandle) = 0;
+	// Closes the list after recording. Returns its HRESULT, negative on failure; may be called from any thread.
+	virtual int32_t close(void* pHandle) = 0;
+	virtual void destroy(void* pHandle) = 0;
+};
+
+// Per-frame pools of command lists, each owning its allocator so that several threads can
+// record at once. Lists of a frame are recycled once the GPU has finished that frame.
+class CommandListPool
+{
+public:
+	CommandListPool();
+	~CommandListPool();
+
+	void initialize(ICommandListFactory* pFactory, uint32_t frameCount);
+	void destroy();
+
+	// Call once the GPU has finished frameIndex: every list acquired for it becomes reusable.
+	void beginFrame(uint32_t frameIndex);
+
+	// Thread-safe. Returns a list of the current frame, reset and open for recording.
+	void* acquire();
+	// Closes a list acquired from this pool once its owner has recorded it. Returns the HRESULT.
+	int32_t close(void* pHandle) { return mpFactory->close(pHandle); }
+
+	uint32_t getCreatedCount() const;
+
+private:
+	struct FrameLists
+	{
+		std::vector<void*> handles;
+		uint32_t usedCount;
+	};
+
+	ICommandListFactory* mpFactory;
+	std::vector<FrameLists> mFrames;
+	uint32_t mFrameIndex;
+	mutable std::mutex mMutex;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "stdafx.h"
+#include "CommandQueueFence.h"
+
+CommandQueueFence::CommandQueueFence()
+	: mQueue()
+	, mFence()
+	, mFenceEvent(NULL)
+{
+
+}
+
+CommandQueueFence::~CommandQueueFence()
+{
+	destroy();
+}
+
+void CommandQueueFence::initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, uint64_t initialValue)
+{
+	mQueue = pQueue;
+	ThrowIfFailed(pDevice->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+	mFence->SetName(L"Frame Fence");
+
+	mFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (mFenceEvent == nullptr)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+void CommandQueueFence::destroy()
+{
+	if (mFenceEvent != NULL)
+	{
+		CloseHandle(mFenceEvent);
+		mFenceEvent = NULL;
+	}
+
+	mFence.Reset();
+	mQueue.Reset();
+}
+
+void CommandQueueFence::signal(uint64_t value)
+{
+	ThrowIfFailed(mQueue->Signal(mFence.Get(), value));
+}
+
+/// <summary>
+/// UINT64_MAX after the device was removed, so nothing is left waiting on it.
+/// </summary>
+uint64_t CommandQueueFence::getCompletedValue()
+{
+	return mFence->GetCompletedValue();
+}
+
+void CommandQueueFence::wait(uint64_t value)
+{
+	if (mFence->GetCompletedValue() < value)
+	{
+		ThrowIfFailed(mFence->SetEventOnCompletion(value, mFenceEvent));
+		WaitForSingleObjectEx(mFenceEvent, INFINITE, FALSE);
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef __RENDERER_COMMANDQUEUEFENCE_H__
+#define __RENDERER_COMMANDQUEUEFENCE_H__
+
+#include "FenceTracker.h"
+
+using namespace Microsoft::WRL;
+
+// IFenceTimeline over one ID3D12Fence signaled by one command queue.
+// The wait event is created once and reused by every blocking wait.
+class CommandQueueFence final : public IFenceTimeline
+{
+public:
+	CommandQueueFence();
+	virtual ~CommandQueueFence();
+
+	void initialize(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, uint64_t initialValue);
+	void destroy();
+
+	ID3D12Fence* getFence() const { return mFence.Get(); }
+
+	void signal(uint64_t value) override;
+	uint64_t getCompletedValue() override;
+	void wait(uint64_t value) override;
+
+private:
+	ComPtr<ID3D12CommandQueue> mQueue;
+	ComPtr<ID3D12Fence> mFence;
+	HANDLE mFenceEvent;
+};
+
+#endif
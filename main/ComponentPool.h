@@ -0,0 +1,114 @@
+#ifndef __OBJECT_COMPONENTPOOL_H__
+#define __OBJECT_COMPONENTPOOL_H__
+
+#include <cstdint>
+#include <vector>
+
+// Sparse set of components keyed by entity index.
+// Components are packed in a dense array, so iterating a pool touches contiguous memory only.
+// Removal swaps the last component into the hole, which keeps the array packed but not ordered.
+template<class T>
+class ComponentPool
+{
+public:
+	static const uint32_t InvalidIndex = UINT32_MAX;
+
+	T& add(uint32_t entity, uint32_t entityIndex, const T& component)
+	{
+		if (entityIndex >= mSparse.size())
+		{
+			mSparse.resize(entityIndex + 1, InvalidIndex);
+		}
+
+		uint32_t& dense = mSparse[entityIndex];
+		if (dense != InvalidIndex)
+		{
+			mComponents[dense] = component;
+			return mComponents[dense];
+		}
+
+		dense = static_cast<uint32_t>(mComponents.size());
+		mEntities.push_back(entity);
+		mEntityIndices.push_back(entityIndex);
+		mComponents.push_back(component);
+		return mComponents.back();
+	}
+
+	void remove(uint32_t entityIndex)
+	{
+		if (!has(entityIndex))
+		{
+			return;
+		}
+
+		const uint32_t dense = mSparse[entityIndex];
+		const uint32_t last = static_cast<uint32_t>(mComponents.size()) - 1;
+		if (dense != last)
+		{
+			mComponents[dense] = mComponents[last];
+			mEntities[dense] = mEntities[last];
+			mEntityIndices[dense] = mEntityIndices[last];
+			mSparse[mEntityIndices[dense]] = dense;
+		}
+
+		mComponents.pop_back();
+		mEntities.pop_back();
+		mEntityIndices.pop_back();
+		mSparse[entityIndex] = InvalidIndex;
+	}
+
+	bool has(uint32_t entityIndex) const
+	{
+		return entityIndex < mSparse.size() && mSparse[entityIndex] != InvalidIndex;
+	}
+
+	T* get(uint32_t entityIndex)
+	{
+		return has(entityIndex) ? &mComponents[mSparse[entityIndex]] : nullptr;
+	}
+
+	const T* get(uint32_t entityIndex) const
+	{
+		return has(entityIndex) ? &mComponents[mSparse[entityIndex]] : nullptr;
+	}
+
+	// Position of the component in the dense arrays, or InvalidIndex
+	uint32_t getDenseIndex(uint32_t entityIndex) const
+	{
+		return has(entityIndex) ? mSparse[entityIndex] : InvalidIndex;
+	}
+
+	void reserve(uint32_t capacity)
+	{
+		mEntities.reserve(capacity);
+		mEntityIndices.reserve(capacity);
+		mComponents.reserve(capacity);
+	}
+
+	void clear()
+	{
+		mSparse.clear();
+		mEntities.clear();
+		mEntityIndices.clear();
+		mComponents.clear();
+	}
+
+	uint32_t size() const { return static_cast<uint32_t>(mComponents.size()); }
+
+	// Dense arrays, parallel to each other
+	T* data() { return mComponents.data(); }
+	const T* data() const { return mComponents.data(); }
+	const uint32_t* entities() const { return mEntities.data(); }
+	const uint32_t* entityIndices() const { return mEntityIndices.data(); }
+
+private:
+	std::vector<uint32_t> mSparse;
+	std::vector<uint32_t> mEntities;
+	std::vector<uint32_t> mEntityIndices;
+	std::vector<T> mComponents;
+};
+
+template<class T>
+const uint32_t ComponentPool<T>::InvalidIndex;
+
+#endif
@@ -0,0 +1,184 @@
+#include "stdafx.h"
+#include "CopyCommandQueue.h"
+
+CopyCommandQueue::CopyCommandQueue()
+	: mDevice()
+	, mQueue()
+	, mCommandList()
+	, mAllocator()
+	, mSubmittedAllocators()
+	, mIsRecording(false)
+	, mStaging()
+	, mpStagingData(nullptr)
+	, mStagingSize(0)
+	, mFence()
+	, mFenceEvent(NULL)
+{
+
+}
+
+CopyCommandQueue::~CopyCommandQueue()
+{
+	destroy();
+}
+
+void CopyCommandQueue::initialize(ID3D12Device* pDevice, uint64_t stagingSize)
+{
+	mDevice = pDevice;
+
+	D3D12_COMMAND_QUEUE_DESC queueDesc{};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Priority = 0;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	queueDesc.NodeMask = 0;
+	ThrowIfFailed(mDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&mQueue)));
+	mQueue->SetName(L"Copy Queue");
+
+	ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+	mFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (mFenceEvent == nullptr)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	D3D12_HEAP_PROPERTIES heapProp{};
+	heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
+	heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProp.CreationNodeMask = 0;
+	heapProp.VisibleNodeMask = 0;
+
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Alignment = 0;
+	resDesc.Width = stagingSize;
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.SampleDesc.Quality = 0;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&heapProp,
+		D3D12_HEAP_FLAG_NONE,
+		&resDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mStaging)
+	));
+
+	// We do not intend to read from this resource on the CPU.
+	D3D12_RANGE readRange;
+	readRange.Begin = 0;
+	readRange.End = 0;
+	ThrowIfFailed(mStaging->Map(0, &readRange, reinterpret_cast<void**>(&mpStagingData)));
+	mStagingSize = stagingSize;
+}
+
+/// <summary>
+/// Releases everything. UploadQueue::destroy must have drained the queue first.
+/// </summary>
+void CopyCommandQueue::destroy()
+{
+	if (mStaging != nullptr)
+	{
+		mStaging->Unmap(0, nullptr);
+		mStaging.Reset();
+		mpStagingData = nullptr;
+		mStagingSize = 0;
+	}
+
+	if (mFenceEvent != NULL)
+	{
+		CloseHandle(mFenceEvent);
+		mFenceEvent = NULL;
+	}
+
+	mSubmittedAllocators.clear();
+	mAllocator.Reset();
+	mCommandList.Reset();
+	mFence.Reset();
+	mQueue.Reset();
+	mDevice.Reset();
+	mIsRecording = false;
+}
+
+void CopyCommandQueue::waitOnQueue(ID3D12CommandQueue* pQueue, uint64_t fenceValue)
+{
+	if (mFence->GetCompletedValue() < fenceValue)
+	{
+		ThrowIfFailed(pQueue->Wait(mFence.Get(), fenceValue));
+	}
+}
+
+void CopyCommandQueue::copy(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size)
+{
+	if (!mIsRecording)
+	{
+		beginRecording();
+	}
+
+	mCommandList->CopyBufferRegion(static_cast<ID3D12Resource*>(pDestination), destinationOffset, mStaging.Get(), stagingOffset, size);
+}
+
+void CopyCommandQueue::submit(uint64_t fenceValue)
+{
+	ThrowIfFailed(mCommandList->Close());
+
+	ID3D12CommandList* ppCommandLists[] = { mCommandList.Get() };
+	mQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	ThrowIfFailed(mQueue->Signal(mFence.Get(), fenceValue));
+
+	SubmittedAllocator submitted;
+	submitted.allocator = mAllocator;
+	submitted.fenceValue = fenceValue;
+	mSubmittedAllocators.push_back(submitted);
+
+	mAllocator.Reset();
+	mIsRecording = false;
+}
+
+uint64_t CopyCommandQueue::getCompletedValue()
+{
+	return mFence->GetCompletedValue();
+}
+
+void CopyCommandQueue::wait(uint64_t fenceValue)
+{
+	if (mFence->GetCompletedValue() < fenceValue)
+	{
+		ThrowIfFailed(mFence->SetEventOnCompletion(fenceValue, mFenceEvent));
+		WaitForSingleObject(mFenceEvent, INFINITE);
+	}
+}
+
+/// <summary>
+/// Opens the command list on the oldest allocator whose batch has completed, or on a new one.
+/// </summary>
+void CopyCommandQueue::beginRecording()
+{
+	if (!mSubmittedAllocators.empty() && mSubmittedAllocators.front().fenceValue <= mFence->GetCompletedValue())
+	{
+		mAllocator = mSubmittedAllocators.front().allocator;
+		mSubmittedAllocators.pop_front();
+		ThrowIfFailed(mAllocator->Reset());
+	}
+	else
+	{
+		ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&mAllocator)));
+	}
+
+	if (mCommandList == nullptr)
+	{
+		ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, mAllocator.Get(), nullptr, IID_PPV_ARGS(&mCommandList)));
+	}
+	else
+	{
+		ThrowIfFailed(mCommandList->Reset(mAllocator.Get(), nullptr));
+	}
+
+	mIsRecording = true;
+}
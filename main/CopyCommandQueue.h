@@ -0,0 +1,59 @@
+#ifndef __RENDERER_COPYCOMMANDQUEUE_H__
+#define __RENDERER_COPYCOMMANDQUEUE_H__
+
+#include <deque>
+
+#include "UploadQueue.h"
+
+using namespace Microsoft::WRL;
+
+// D3D12 backend of UploadQueue: a COPY queue with its own fence and a persistently mapped
+// UPLOAD heap staging buffer. Destination handles are ID3D12Resource buffers.
+// Buffers in the COMMON state need no barriers: the copy promotes them to COPY_DEST and they
+// decay back once the copy queue is done, ready to be promoted to any read state.
+class CopyCommandQueue final : public ICopyQueue
+{
+public:
+	CopyCommandQueue();
+	virtual ~CopyCommandQueue();
+
+	void initialize(ID3D12Device* pDevice, uint64_t stagingSize);
+	void destroy();
+
+	uint8_t* getStagingData() const { return mpStagingData; }
+	uint64_t getStagingSize() const { return mStagingSize; }
+
+	// Makes pQueue wait on the GPU until fenceValue is signalled; the CPU does not block.
+	void waitOnQueue(ID3D12CommandQueue* pQueue, uint64_t fenceValue);
+
+	void copy(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) override;
+	void submit(uint64_t fenceValue) override;
+	uint64_t getCompletedValue() override;
+	void wait(uint64_t fenceValue) override;
+
+private:
+	void beginRecording();
+
+	struct SubmittedAllocator
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		uint64_t fenceValue;
+	};
+
+	ComPtr<ID3D12Device> mDevice;
+	ComPtr<ID3D12CommandQueue> mQueue;
+	ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	ComPtr<ID3D12CommandAllocator> mAllocator;
+	// Allocators of submitted batches, oldest first, reused once their batch has completed
+	std::deque<SubmittedAllocator> mSubmittedAllocators;
+	bool mIsRecording;
+
+	ComPtr<ID3D12Resource> mStaging;
+	uint8_t* mpStagingData;
+	uint64_t mStagingSize;
+
+	ComPtr<ID3D12Fence> mFence;
+	HANDLE mFenceEvent;
+};
+
+#endif
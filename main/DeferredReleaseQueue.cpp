@@ -0,0 +1,124 @@
+#include "DeferredReleaseQueue.h"
+
+DeferredReleaseQueue::DeferredReleaseQueue()
+	: mpFenceTracker(nullptr)
+	, mPending()
+	, mCollecting()
+	, mReleasedCount(0)
+	, mMutex()
+	, mCollectMutex()
+{
+
+}
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+	destroy();
+}
+
+void DeferredReleaseQueue::initialize(FenceTracker* pFenceTracker)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mpFenceTracker = pFenceTracker;
+}
+
+void DeferredReleaseQueue::destroy()
+{
+	std::lock_guard<std::mutex> collectLock(mCollectMutex);
+
+	std::vector<Entry> pending;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mpFenceTracker = nullptr;
+		pending.swap(mPending);
+	}
+
+	for (const Entry& entry : pending)
+	{
+		entry.function(entry.pObject, entry.context);
+	}
+	mReleasedCount += pending.size();
+}
+
+void DeferredReleaseQueue::release(uint64_t fenceValue, DeferredReleaseFunction function, void* pObject, uint64_t context)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mpFenceTracker != nullptr && !mpFenceTracker->isComplete(fenceValue))
+		{
+			Entry entry = { fenceValue, function, pObject, context };
+			mPending.push_back(entry);
+			return;
+		}
+	}
+
+	// Nothing left for the GPU to finish
+	function(pObject, context);
+}
+
+void DeferredReleaseQueue::release(DeferredReleaseFunction function, void* pObject, uint64_t context)
+{
+	uint64_t fenceValue = 0;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mpFenceTracker != nullptr)
+		{
+			fenceValue = mpFenceTracker->getCurrentValue();
+		}
+	}
+	release(fenceValue, function, pObject, context);
+}
+
+/// <summary>
+/// Takes the whole list under the lock, so releases parked by the release functions, or by other
+/// threads meanwhile, wait for the next collect() instead of being run or lost.
+/// </summary>
+uint32_t DeferredReleaseQueue::collect()
+{
+	std::lock_guard<std::mutex> collectLock(mCollectMutex);
+
+	uint64_t completedValue = 0;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mpFenceTracker == nullptr || mPending.empty())
+		{
+			return 0;
+		}
+		completedValue = mpFenceTracker->poll();
+		mCollecting.swap(mPending);
+	}
+
+	uint32_t releasedCount = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < mCollecting.size(); ++i)
+	{
+		const Entry& entry = mCollecting[i];
+		if (entry.fenceValue <= completedValue)
+		{
+			entry.function(entry.pObject, entry.context);
+			++releasedCount;
+		}
+		else
+		{
+			mCollecting[kept++] = entry;
+		}
+	}
+	mCollecting.resize(kept);
+
+	{
+		// Still parked ones go in front of those parked during the loop, keeping the order.
+		std::lock_guard<std::mutex> lock(mMutex);
+		mCollecting.insert(mCollecting.end(), mPending.begin(), mPending.end());
+		mPending.swap(mCollecting);
+		mCollecting.clear();
+	}
+
+	mReleasedCount += releasedCount;
+	return releasedCount;
+}
+
+uint32_t DeferredReleaseQueue::getPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return static_cast<uint32_t>(mPending.size());
+}
@@ -0,0 +1,56 @@
+#ifndef __RENDERER_DEFERREDRELEASEQUEUE_H__
+#define __RENDERER_DEFERREDRELEASEQUEUE_H__
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "FenceTracker.h"
+
+// Frees pObject; context is whatever it was parked with, e.g. an index or a heap range.
+typedef void (*DeferredReleaseFunction)(void* pObject, uint64_t context);
+
+// Objects the GPU may still be reading, parked with the fence value of the last submission
+// using them and released by collect() once the FenceTracker has seen that value complete.
+// Lets a resource be dropped in the middle of a frame without waiting for the GPU.
+// Holds no graphics API objects; what releasing means is up to the function given.
+class DeferredReleaseQueue
+{
+public:
+	DeferredReleaseQueue();
+	~DeferredReleaseQueue();
+
+	void initialize(FenceTracker* pFenceTracker);
+	// Releases everything still parked; the GPU must be idle. Later releases happen at once.
+	void destroy();
+
+	// Thread-safe. Parks pObject until fenceValue has completed.
+	void release(uint64_t fenceValue, DeferredReleaseFunction function, void* pObject, uint64_t context);
+	// Thread-safe. Parks pObject until the work being recorded now has completed.
+	void release(DeferredReleaseFunction function, void* pObject, uint64_t context);
+
+	// Releases, in the calling thread and in parking order, what has completed. Returns how many.
+	uint32_t collect();
+
+	uint32_t getPendingCount() const;
+	uint64_t getReleasedCount() const { return mReleasedCount; }
+
+private:
+	struct Entry
+	{
+		uint64_t fenceValue;
+		DeferredReleaseFunction function;
+		void* pObject;
+		uint64_t context;
+	};
+
+	FenceTracker* mpFenceTracker;
+	std::vector<Entry> mPending;
+	// Swapped with mPending by collect(), so release functions run without the lock held
+	std::vector<Entry> mCollecting;
+	uint64_t mReleasedCount;
+	mutable std::mutex mMutex;
+	std::mutex mCollectMutex;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "DescriptorAllocator.h"
+
+const uint32_t DescriptorAllocator::InvalidIndex;
+
+DescriptorAllocator::DescriptorAllocator()
+	: mPersistentCount(0)
+	, mTransientCountPerFrame(0)
+	, mFrameCount(0)
+	, mNext()
+	, mFreeFenceValues()
+	, mFreeHead(MakeHead(InvalidIndex, 0))
+	, mRetiredHead(InvalidIndex)
+	, mWaiting()
+	, mAllocatedCount(0)
+	, mPendingCount(0)
+	, mTransientBegin(0)
+	, mTransientEnd(0)
+	, mTransientOffset(0)
+{
+
+}
+
+/// <summary>
+/// Descriptors [0, persistentCount) are persistent, followed by frameCount transient regions.
+/// The free list starts in index order, so a fresh heap fills from the front.
+/// </summary>
+void DescriptorAllocator::initialize(uint32_t persistentCount, uint32_t transientCountPerFrame, uint32_t frameCount)
+{
+	mPersistentCount = persistentCount;
+	mTransientCountPerFrame = transientCountPerFrame;
+	mFrameCount = frameCount;
+
+	mNext.reset(new std::atomic<uint32_t>[persistentCount]);
+	mFreeFenceValues.reset(new uint64_t[persistentCount]);
+	for (uint32_t i = 0; i < persistentCount; ++i)
+	{
+		mNext[i].store(i + 1 < persistentCount ? i + 1 : InvalidIndex, std::memory_order_relaxed);
+		mFreeFenceValues[i] = 0;
+	}
+	mFreeHead.store(MakeHead(persistentCount > 0 ? 0 : InvalidIndex, 0), std::memory_order_release);
+	mRetiredHead.store(InvalidIndex, std::memory_order_release);
+	mWaiting.clear();
+
+	mAllocatedCount.store(0, std::memory_order_relaxed);
+	mPendingCount.store(0, std::memory_order_relaxed);
+
+	beginFrame(0);
+}
+
+uint32_t DescriptorAllocator::allocate()
+{
+	uint64_t head = mFreeHead.load(std::memory_order_acquire);
+	for (;;)
+	{
+		const uint32_t index = GetHeadIndex(head);
+		if (index == InvalidIndex)
+		{
+			return InvalidIndex;
+		}
+
+		// May read the link of an index another thread has popped meanwhile; the tag then differs
+		// and the exchange below fails.
+		const uint32_t next = mNext[index].load(std::memory_order_relaxed);
+		if (mFreeHead.compare_exchange_weak(head, MakeHead(next, (head >> 32) + 1), std::memory_order_acquire, std::memory_order_acquire))
+		{
+			mAllocatedCount.fetch_add(1, std::memory_order_relaxed);
+			return index;
+		}
+	}
+}
+
+void DescriptorAllocator::free(uint32_t index, uint64_t fenceValue)
+{
+	if (index >= mPersistentCount)
+	{
+		return;
+	}
+
+	mFreeFenceValues[index] = fenceValue;
+	mPendingCount.fetch_add(1, std::memory_order_relaxed);
+
+	uint32_t head = mRetiredHead.load(std::memory_order_relaxed);
+	do
+	{
+		mNext[index].store(head, std::memory_order_relaxed);
+	} while (!mRetiredHead.compare_exchange_weak(head, index, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void DescriptorAllocator::collect(uint64_t completedFenceValue)
+{
+	// Take every descriptor freed since the last call at once, then sort them out privately.
+	uint32_t index = mRetiredHead.exchange(InvalidIndex, std::memory_order_acquire);
+	while (index != InvalidIndex)
+	{
+		mWaiting.push_back(index);
+		index = mNext[index].load(std::memory_order_relaxed);
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < mWaiting.size(); ++i)
+	{
+		const uint32_t waiting = mWaiting[i];
+		if (mFreeFenceValues[waiting] <= completedFenceValue)
+		{
+			pushFree(waiting);
+		}
+		else
+		{
+			mWaiting[kept++] = waiting;
+		}
+	}
+	mWaiting.resize(kept);
+}
+
+void DescriptorAllocator::pushFree(uint32_t index)
+{
+	mPendingCount.fetch_sub(1, std::memory_order_relaxed);
+	mAllocatedCount.fetch_sub(1, std::memory_order_relaxed);
+
+	uint64_t head = mFreeHead.load(std::memory_order_relaxed);
+	do
+	{
+		mNext[index].store(GetHeadIndex(head), std::memory_order_relaxed);
+	} while (!mFreeHead.compare_exchange_weak(head, MakeHead(index, (head >> 32) + 1), std::memory_order_release, std::memory_order_relaxed));
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex)
+{
+	mTransientBegin = mPersistentCount + mTransientCountPerFrame * (mFrameCount > 0 ? frameIndex % mFrameCount : 0);
+	mTransientEnd = mTransientBegin + mTransientCountPerFrame;
+	mTransientOffset.store(mTransientBegin, std::memory_order_relaxed);
+}
+
+uint32_t DescriptorAllocator::allocateTransient(uint32_t count)
+{
+	uint32_t offset = mTransientOffset.load(std::memory_order_relaxed);
+	do
+	{
+		if (count == 0 || count > mTransientEnd - offset)
+		{
+			return InvalidIndex;
+		}
+	} while (!mTransientOffset.compare_exchange_weak(offset, offset + count, std::memory_order_relaxed));
+
+	return offset;
+}
+
+uint32_t DescriptorAllocator::getTransientUsedCount() const
+{
+	return mTransientOffset.load(std::memory_order_relaxed) - mTransientBegin;
+}
@@ -0,0 +1,73 @@
+#ifndef __RENDERER_DESCRIPTORALLOCATOR_H__
+#define __RENDERER_DESCRIPTORALLOCATOR_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Hands out indices into one shader visible descriptor heap, so shaders can index it directly.
+// The front of the heap holds persistent descriptors, popped from a lock-free free list by any
+// thread. A freed descriptor only goes back on that list once collect() sees the fence value it
+// was freed with completed, as the GPU may still read it until then. The back of the heap is
+// split into one linear region per in-flight frame for descriptors that live a single frame.
+// Holds no graphics API objects.
+class DescriptorAllocator
+{
+public:
+	static const uint32_t InvalidIndex = ~0u;
+
+	DescriptorAllocator();
+
+	void initialize(uint32_t persistentCount, uint32_t transientCountPerFrame, uint32_t frameCount);
+
+	// Thread-safe. InvalidIndex when every persistent descriptor is in use or waiting on a fence.
+	uint32_t allocate();
+	// Thread-safe. fenceValue is the value signaled after the last command list using the descriptor.
+	void free(uint32_t index, uint64_t fenceValue);
+	// Returns the frees whose fence value has completed to the free list. One thread at a time.
+	void collect(uint64_t completedFenceValue);
+
+	// Rewinds frameIndex's transient region; the GPU must have finished the frame that last used it.
+	// Not thread-safe against allocateTransient().
+	void beginFrame(uint32_t frameIndex);
+	// Thread-safe. First of count contiguous descriptors valid for this frame, or InvalidIndex.
+	uint32_t allocateTransient(uint32_t count);
+
+	uint32_t getCapacity() const { return mPersistentCount + mTransientCountPerFrame * mFrameCount; }
+	uint32_t getPersistentCount() const { return mPersistentCount; }
+	// Persistent descriptors not on the free list, including those waiting on a fence
+	uint32_t getAllocatedCount() const { return mAllocatedCount.load(std::memory_order_relaxed); }
+	uint32_t getPendingCount() const { return mPendingCount.load(std::memory_order_relaxed); }
+	uint32_t getTransientUsedCount() const;
+
+private:
+	// Free list head: index in the low half, a tag bumped on every change in the high half, so a
+	// pop that raced with a pop and push of the same index fails its compare-exchange.
+	static uint64_t MakeHead(uint32_t index, uint64_t tag) { return (tag << 32) | index; }
+	static uint32_t GetHeadIndex(uint64_t head) { return static_cast<uint32_t>(head); }
+
+	void pushFree(uint32_t index);
+
+	uint32_t mPersistentCount;
+	uint32_t mTransientCountPerFrame;
+	uint32_t mFrameCount;
+
+	// Links of both lists, one per persistent descriptor; a descriptor is on at most one list.
+	std::unique_ptr<std::atomic<uint32_t>[]> mNext;
+	std::unique_ptr<uint64_t[]> mFreeFenceValues;
+	std::atomic<uint64_t> mFreeHead;
+	// Freed descriptors not yet checked by collect(); only pushed to or taken whole, so needs no tag
+	std::atomic<uint32_t> mRetiredHead;
+	// Retired descriptors whose fence had not completed yet, owned by collect()
+	std::vector<uint32_t> mWaiting;
+
+	std::atomic<uint32_t> mAllocatedCount;
+	std::atomic<uint32_t> mPendingCount;
+
+	uint32_t mTransientBegin;
+	uint32_t mTransientEnd;
+	std::atomic<uint32_t> mTransientOffset;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "FenceTracker.h"
+
+#include <algorithm>
+
+FenceTracker::FenceTracker()
+	: mpTimeline(nullptr)
+	, mCurrentValue(1)
+	, mCompletedValue(0)
+	, mEnqueueHead(nullptr)
+	, mWaiting()
+	, mPendingCount(0)
+{
+
+}
+
+FenceTracker::~FenceTracker()
+{
+	destroy();
+}
+
+void FenceTracker::initialize(IFenceTimeline* pTimeline, uint64_t initialValue)
+{
+	destroy();
+
+	mpTimeline = pTimeline;
+	mCurrentValue.store(initialValue + 1, std::memory_order_release);
+	mCompletedValue.store(initialValue, std::memory_order_release);
+}
+
+void FenceTracker::destroy()
+{
+	RetireNode* pNode = mEnqueueHead.exchange(nullptr, std::memory_order_acquire);
+	while (pNode != nullptr)
+	{
+		RetireNode* pNext = pNode->pNext;
+		delete pNode;
+		pNode = pNext;
+	}
+
+	for (RetireNode* pWaiting : mWaiting)
+	{
+		delete pWaiting;
+	}
+	mWaiting.clear();
+
+	mPendingCount.store(0, std::memory_order_relaxed);
+	mpTimeline = nullptr;
+}
+
+uint64_t FenceTracker::signal()
+{
+	const uint64_t value = mCurrentValue.load(std::memory_order_relaxed);
+	mpTimeline->signal(value);
+	mCurrentValue.store(value + 1, std::memory_order_release);
+	return value;
+}
+
+bool FenceTracker::isComplete(uint64_t value)
+{
+	if (value <= mCompletedValue.load(std::memory_order_acquire))
+	{
+		return true;
+	}
+	return value <= poll();
+}
+
+uint64_t FenceTracker::poll()
+{
+	updateCompleted(mpTimeline->getCompletedValue());
+	return mCompletedValue.load(std::memory_order_acquire);
+}
+
+void FenceTracker::wait(uint64_t value)
+{
+	if (isComplete(value))
+	{
+		return;
+	}
+
+	mpTimeline->wait(value);
+	updateCompleted(value);
+}
+
+void FenceTracker::waitIdle()
+{
+	wait(signal());
+}
+
+void FenceTracker::enqueue(uint64_t value, std::function<void()> callback)
+{
+	RetireNode* pNode = new RetireNode;
+	pNode->value = value;
+	pNode->callback = std::move(callback);
+
+	mPendingCount.fetch_add(1, std::memory_order_relaxed);
+
+	RetireNode* pHead = mEnqueueHead.load(std::memory_order_relaxed);
+	do
+	{
+		pNode->pNext = pHead;
+	} while (!mEnqueueHead.compare_exchange_weak(pHead, pNode, std::memory_order_release, std::memory_order_relaxed));
+}
+
+/// <summary>
+/// Takes everything enqueued so far in one exchange, then runs what has completed in enqueue order.
+/// A callback may enqueue more; those are seen by the next retire().
+/// </summary>
+uint32_t FenceTracker::retire()
+{
+	RetireNode* pNode = mEnqueueHead.exchange(nullptr, std::memory_order_acquire);
+
+	// The list is newest first
+	const size_t firstNew = mWaiting.size();
+	for (; pNode != nullptr; pNode = pNode->pNext)
+	{
+		mWaiting.push_back(pNode);
+	}
+	std::reverse(mWaiting.begin() + firstNew, mWaiting.end());
+
+	if (mWaiting.empty())
+	{
+		return 0;
+	}
+
+	const uint64_t completedValue = poll();
+
+	uint32_t retiredCount = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < mWaiting.size(); ++i)
+	{
+		RetireNode* pWaiting = mWaiting[i];
+		if (pWaiting->value <= completedValue)
+		{
+			pWaiting->callback();
+			delete pWaiting;
+			++retiredCount;
+		}
+		else
+		{
+			mWaiting[kept++] = pWaiting;
+		}
+	}
+	mWaiting.resize(kept);
+
+	mPendingCount.fetch_sub(retiredCount, std::memory_order_relaxed);
+	return retiredCount;
+}
+
+/// <summary>
+/// Several threads may poll at once; the cached value only ever moves forward.
+/// </summary>
+void FenceTracker::updateCompleted(uint64_t completedValue)
+{
+	uint64_t current = mCompletedValue.load(std::memory_order_relaxed);
+	while (completedValue > current)
+	{
+		if (mCompletedValue.compare_exchange_weak(current, completedValue, std::memory_order_release, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+}
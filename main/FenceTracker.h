@@ -0,0 +1,83 @@
+#ifndef __RENDERER_FENCETRACKER_H__
+#define __RENDERER_FENCETRACKER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Fence a queue signals after its submissions. Opaque so FenceTracker does not depend on D3D12.
+class IFenceTimeline
+{
+public:
+	virtual ~IFenceTimeline() {}
+
+	// Signals value once the work submitted so far has completed.
+	virtual void signal(uint64_t value) = 0;
+	// Thread-safe. Every value up to the returned one has completed.
+	virtual uint64_t getCompletedValue() = 0;
+	// Blocks the calling thread until value has completed.
+	virtual void wait(uint64_t value) = 0;
+};
+
+// One monotonically increasing fence value per submission of a queue. Work recorded now
+// completes with getCurrentValue(); signal() closes it and moves on to the next value.
+// Any thread can ask whether a value has completed without blocking, and hand over a callback
+// to run once it has: callbacks are pushed to a lock-free list and run by retire().
+class FenceTracker
+{
+public:
+	FenceTracker();
+	~FenceTracker();
+
+	// Values start after initialValue, which counts as completed.
+	void initialize(IFenceTimeline* pTimeline, uint64_t initialValue = 0);
+	// Drops callbacks that never ran; wait for the GPU and retire() first.
+	void destroy();
+
+	// Value that completes with the work being recorded now. Thread-safe.
+	uint64_t getCurrentValue() const { return mCurrentValue.load(std::memory_order_acquire); }
+	uint64_t getLastSignaledValue() const { return getCurrentValue() - 1; }
+	// Signals the current value after the submissions so far and returns it. Submitting thread only.
+	uint64_t signal();
+
+	// Thread-safe and non-blocking. Reads the fence only when the cached value is behind.
+	bool isComplete(uint64_t value);
+	uint64_t getCompletedValue() const { return mCompletedValue.load(std::memory_order_acquire); }
+	// Re-reads the fence, returns the completed value.
+	uint64_t poll();
+	// Blocks until value has completed; returns at once when it already has.
+	void wait(uint64_t value);
+	// Signals and waits for everything submitted so far.
+	void waitIdle();
+
+	// Thread-safe. Runs callback in retire() once value has completed.
+	void enqueue(uint64_t value, std::function<void()> callback);
+	// Runs the callbacks whose value has completed, in the calling thread. One thread at a time.
+	// Returns how many ran.
+	uint32_t retire();
+
+	uint32_t getPendingCount() const { return mPendingCount.load(std::memory_order_relaxed); }
+
+private:
+	struct RetireNode
+	{
+		uint64_t value;
+		std::function<void()> callback;
+		RetireNode* pNext;
+	};
+
+	void updateCompleted(uint64_t completedValue);
+
+	IFenceTimeline* mpTimeline;
+	std::atomic<uint64_t> mCurrentValue;
+	std::atomic<uint64_t> mCompletedValue;
+
+	// Enqueued callbacks not yet seen by retire(); only pushed to or taken whole, so needs no tag
+	std::atomic<RetireNode*> mEnqueueHead;
+	// Callbacks whose value had not completed yet, owned by retire()
+	std::vector<RetireNode*> mWaiting;
+	std::atomic<uint32_t> mPendingCount;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "FramePacer.h"
+
+#include <chrono>
+
+const uint32_t FramePacer::WaitTimeoutMilliseconds;
+const uint32_t FramePacer::TrackedFrameCount;
+
+FramePacingSettings FramePacingSettings::LowLatency()
+{
+	FramePacingSettings settings;
+	settings.maxFramesInFlight = 1;
+	settings.waitForPresentQueue = true;
+	settings.lateLatchInput = true;
+	settings.syncInterval = 1;
+	return settings;
+}
+
+FramePacingSettings FramePacingSettings::Throughput()
+{
+	FramePacingSettings settings;
+	settings.maxFramesInFlight = 3;
+	settings.waitForPresentQueue = false;
+	settings.lateLatchInput = false;
+	settings.syncInterval = 1;
+	return settings;
+}
+
+uint64_t SystemFrameClock::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FramePacer::FramePacer()
+	: mpClock(nullptr)
+	, mpPresentQueue(nullptr)
+	, mSettings(FramePacingSettings::Throughput())
+	, mInputTimes()
+	, mAverageWaitTime(0)
+	, mAverageLatency(0)
+	, mTimeoutCount(0)
+{
+
+}
+
+void FramePacer::initialize(IFrameClock* pClock, IPresentQueue* pPresentQueue, const FramePacingSettings& settings)
+{
+	mpClock = pClock;
+	mpPresentQueue = pPresentQueue;
+	mSettings = settings;
+	if (mSettings.maxFramesInFlight < 1)
+	{
+		mSettings.maxFramesInFlight = 1;
+	}
+
+	for (std::atomic<uint64_t>& time : mInputTimes)
+	{
+		time.store(0, std::memory_order_relaxed);
+	}
+	mAverageWaitTime.store(0, std::memory_order_relaxed);
+	mAverageLatency.store(0, std::memory_order_relaxed);
+	mTimeoutCount.store(0, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Waiting here rather than in Present moves the time spent blocked on the display before the
+/// frame samples anything, so what it shows is as recent as possible.
+/// </summary>
+void FramePacer::beginFrame(uint64_t frameNumber)
+{
+	(void)frameNumber;
+
+	if (!mSettings.waitForPresentQueue || mpPresentQueue == nullptr)
+	{
+		return;
+	}
+
+	const uint64_t start = mpClock->now();
+	if (!mpPresentQueue->waitForSlot(WaitTimeoutMilliseconds))
+	{
+		mTimeoutCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	Accumulate(mAverageWaitTime, mpClock->now() - start);
+}
+
+void FramePacer::markInputSampled(uint64_t frameNumber)
+{
+	mInputTimes[frameNumber % TrackedFrameCount].store(mpClock->now(), std::memory_order_release);
+}
+
+void FramePacer::markPresented(uint64_t frameNumber)
+{
+	const uint64_t sampled = mInputTimes[frameNumber % TrackedFrameCount].load(std::memory_order_acquire);
+	const uint64_t now = mpClock->now();
+	if (sampled != 0 && sampled <= now)
+	{
+		Accumulate(mAverageLatency, now - sampled);
+	}
+}
+
+void FramePacer::Accumulate(std::atomic<uint64_t>& average, uint64_t sample)
+{
+	// Exponential moving average over roughly the last 16 frames; only one thread updates each average.
+	const uint64_t current = average.load(std::memory_order_relaxed);
+	average.store(current == 0 ? sample : current - current / 16 + sample / 16, std::memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+#ifndef __CORE_FRAMEPACER_H__
+#define __CORE_FRAMEPACER_H__
+
+#include <atomic>
+#include <cstdint>
+
+// How frames are paced against the display.
+struct FramePacingSettings
+{
+	// Frames the swap chain may queue for presentation
+	uint32_t maxFramesInFlight;
+	// Frame start waits until the swap chain has fewer than maxFramesInFlight frames queued
+	bool waitForPresentQueue;
+	// Input is read after that wait, right before the camera update, instead of before it
+	bool lateLatchInput;
+	// Present sync interval: 0 presents immediately, 1 on every vertical blank
+	uint32_t syncInterval;
+
+	// One queued frame, started as late as the display allows
+	static FramePacingSettings LowLatency();
+	// Deep queues that keep the GPU busy, at the cost of older input on screen
+	static FramePacingSettings Throughput();
+};
+
+// Time source of FramePacer, in microseconds.
+class IFrameClock
+{
+public:
+	virtual ~IFrameClock() {}
+
+	virtual uint64_t now() = 0;
+};
+
+// Frames waiting to be displayed, e.g. the swap chain's frame latency waitable object.
+class IPresentQueue
+{
+public:
+	virtual ~IPresentQueue() {}
+
+	// Blocks until fewer than the maximum number of frames are queued. False on timeout.
+	virtual bool waitForSlot(uint32_t timeoutMilliseconds) = 0;
+};
+
+// steady_clock based IFrameClock
+class SystemFrameClock final : public IFrameClock
+{
+public:
+	uint64_t now() override;
+};
+
+// Decides when the game thread starts a frame and measures what that costs and saves.
+// beginFrame and markInputSampled run on the game thread, markPresented on the render thread.
+class FramePacer
+{
+public:
+	// Never block longer than this on the present queue, e.g. while the window is minimized
+	static const uint32_t WaitTimeoutMilliseconds = 1000;
+
+	FramePacer();
+
+	void initialize(IFrameClock* pClock, IPresentQueue* pPresentQueue, const FramePacingSettings& settings);
+	const FramePacingSettings& getSettings() const { return mSettings; }
+
+	// Start of frameNumber, before anything it shows is sampled. Waits for the present queue if configured.
+	void beginFrame(uint64_t frameNumber);
+	// The input frameNumber shows has just been read.
+	void markInputSampled(uint64_t frameNumber);
+	// frameNumber has been handed to the swap chain.
+	void markPresented(uint64_t frameNumber);
+
+	// Moving averages in microseconds
+	uint64_t getAverageWaitTime() const { return mAverageWaitTime.load(std::memory_order_relaxed); }
+	// From input sampled to the frame presented
+	uint64_t getAverageLatency() const { return mAverageLatency.load(std::memory_order_relaxed); }
+	uint32_t getTimeoutCount() const { return mTimeoutCount.load(std::memory_order_relaxed); }
+
+private:
+	// Frames between input sampling and presentation never exceed this
+	static const uint32_t TrackedFrameCount = 8;
+
+	static void Accumulate(std::atomic<uint64_t>& average, uint64_t sample);
+
+	IFrameClock* mpClock;
+	IPresentQueue* mpPresentQueue;
+	FramePacingSettings mSettings;
+
+	// Input sample time of each tracked frame, indexed by frame number
+	std::atomic<uint64_t> mInputTimes[TrackedFrameCount];
+
+	std::atomic<uint64_t> mAverageWaitTime;
+	std::atomic<uint64_t> mAverageLatency;
+	std::atomic<uint32_t> mTimeoutCount;
+};
+
+#endif
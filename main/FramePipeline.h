@@ -0,0 +1,121 @@
+#ifndef __CORE_FRAMEPIPELINE_H__
+#define __CORE_FRAMEPIPELINE_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Hands frame data from the update thread to the render thread through a ring of Count slots.
+// The update stage fills slot N+1 while the render stage consumes slot N, so a frame costs
+// max(update, render) instead of their sum.
+// A published slot is immutable until the render stage releases it.
+//
+// maxLatency bounds how many frames the update stage may run ahead of the last frame
+// the render stage finished: 1 serializes the stages, Count gives full overlap.
+template<class T, uint32_t Count>
+class FramePipeline
+{
+	static_assert(Count >= 1, "FramePipeline needs at least one slot");
+
+public:
+	FramePipeline()
+		: mSlots()
+		, mMutex()
+		, mUpdateCondition()
+		, mRenderCondition()
+		, mPublishedCount(0)
+		, mRenderedCount(0)
+		, mMaxLatency(Count)
+		, mIsShutdown(false)
+	{
+
+	}
+
+	void setMaxLatency(uint32_t latency)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mMaxLatency = (latency < 1) ? 1 : (latency > Count) ? Count : latency;
+		mUpdateCondition.notify_all();
+	}
+	uint32_t getMaxLatency() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mMaxLatency;
+	}
+
+	// Blocks until a slot is free. Returns nullptr after shutdown.
+	T* beginUpdate()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mUpdateCondition.wait(lock, [this] { return mIsShutdown || mPublishedCount - mRenderedCount < mMaxLatency; });
+		if (mIsShutdown)
+		{
+			return nullptr;
+		}
+		return &mSlots[mPublishedCount % Count];
+	}
+
+	// Publishes the slot returned by beginUpdate to the render stage.
+	void endUpdate()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPublishedCount++;
+		}
+		mRenderCondition.notify_one();
+	}
+
+	// Blocks until a frame is published. Returns nullptr after shutdown.
+	const T* beginRender()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mRenderCondition.wait(lock, [this] { return mIsShutdown || mRenderedCount < mPublishedCount; });
+		if (mIsShutdown)
+		{
+			return nullptr;
+		}
+		return &mSlots[mRenderedCount % Count];
+	}
+
+	// Returns the slot obtained from beginRender to the update stage.
+	void endRender()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mRenderedCount++;
+		}
+		mUpdateCondition.notify_one();
+	}
+
+	// Wakes both stages; every later begin call returns nullptr.
+	void shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mIsShutdown = true;
+		}
+		mUpdateCondition.notify_all();
+		mRenderCondition.notify_all();
+	}
+
+	// Frames published by the update stage but not yet released by the render stage
+	uint32_t getPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return static_cast<uint32_t>(mPublishedCount - mRenderedCount);
+	}
+
+private:
+	T mSlots[Count];
+
+	mutable std::mutex mMutex;
+	std::condition_variable mUpdateCondition;
+	std::condition_variable mRenderCondition;
+
+	uint64_t mPublishedCount;
+	uint64_t mRenderedCount;
+	uint32_t mMaxLatency;
+	bool mIsShutdown;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "Frustum.h"
+
+namespace
+{
+	XMFLOAT4 NormalizePlane(float a, float b, float c, float d)
+	{
+		const float length = mathf::Sqrtf(a * a + b * b + c * c);
+		const float inverse = (length > 0.0f) ? 1.0f / length : 0.0f;
+		return XMFLOAT4(a * inverse, b * inverse, c * inverse, d * inverse);
+	}
+}
+
+/// <summary>
+/// Gribb / Hartmann extraction: with clip = p * M, each plane is a sum or difference of columns of M.
+/// </summary>
+Frustum Frustum::FromViewProjection(const XMFLOAT4X4& m)
+{
+	Frustum frustum;
+	frustum.planes[Left] = NormalizePlane(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);
+	frustum.planes[Right] = NormalizePlane(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);
+	frustum.planes[Bottom] = NormalizePlane(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);
+	frustum.planes[Top] = NormalizePlane(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);
+	frustum.planes[Near] = NormalizePlane(m._13, m._23, m._33, m._43);
+	frustum.planes[Far] = NormalizePlane(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);
+	return frustum;
+}
@@ -0,0 +1,28 @@
+#ifndef __MATH_FRUSTUM_H__
+#define __MATH_FRUSTUM_H__
+
+#include "Math.h"
+
+// Six planes (a, b, c, d) with normals pointing inside: a point p is inside
+// when a * p.x + b * p.y + c * p.z + d >= 0 for every plane.
+struct Frustum
+{
+	enum PlaneIndex
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+
+		PlaneCount
+	};
+
+	XMFLOAT4 planes[PlaneCount];
+
+	// Extracts the planes of a row-vector (DirectXMath) view-projection matrix with D3D clip depth [0, w].
+	static Frustum FromViewProjection(const XMFLOAT4X4& viewProjection);
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include "stdafx.h"
+#include "GpuMemoryAllocator.h"
+
+GpuMemoryAllocator::GpuMemoryAllocator()
+	: mDevice()
+	, mHeapSize(0)
+	, mpReleaseQueue(nullptr)
+	, mHeaps()
+	, mMutex()
+{
+
+}
+
+GpuMemoryAllocator::~GpuMemoryAllocator()
+{
+	destroy();
+}
+
+void GpuMemoryAllocator::initialize(ID3D12Device* pDevice, uint64_t heapSize, DeferredReleaseQueue* pReleaseQueue)
+{
+	mDevice = pDevice;
+	mHeapSize = heapSize;
+	mpReleaseQueue = pReleaseQueue;
+}
+
+void GpuMemoryAllocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mHeaps.clear();
+	mDevice.Reset();
+}
+
+/// <summary>
+/// Places the resource in the first heap of its type and class with room for it, creating a
+/// heap when none has. Resources larger than a heap get a dedicated heap of their own.
+/// </summary>
+HRESULT GpuMemoryAllocator::createResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue, GpuAllocation* pAllocation)
+{
+	D3D12_RESOURCE_DESC desc = *pDesc;
+	const ResourceClass resourceClass = GetResourceClass(desc);
+	const D3D12_RESOURCE_ALLOCATION_INFO info = getAllocationInfo(&desc, resourceClass);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	uint32_t heapIndex = ~0u;
+	uint32_t block = TlsfAllocator::InvalidHandle;
+	for (uint32_t i = 0; i < mHeaps.size() && block == TlsfAllocator::InvalidHandle; ++i)
+	{
+		Heap* pHeap = mHeaps[i].get();
+		if (pHeap != nullptr && !pHeap->isDedicated && pHeap->heapType == heapType && pHeap->resourceClass == resourceClass)
+		{
+			heapIndex = i;
+			block = pHeap->allocator.allocate(info.SizeInBytes, info.Alignment);
+		}
+	}
+
+	if (block == TlsfAllocator::InvalidHandle)
+	{
+		const bool isDedicated = info.SizeInBytes > mHeapSize;
+		HRESULT hr = createHeap(heapType, resourceClass, isDedicated ? info.SizeInBytes : mHeapSize, isDedicated, &heapIndex);
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+		block = mHeaps[heapIndex]->allocator.allocate(info.SizeInBytes, info.Alignment);
+	}
+
+	Heap* pHeap = mHeaps[heapIndex].get();
+	HRESULT hr = mDevice->CreatePlacedResource(
+		pHeap->heap.Get(),
+		pHeap->allocator.getOffset(block),
+		&desc,
+		initialState,
+		pClearValue,
+		IID_PPV_ARGS(&pAllocation->resource)
+	);
+	if (FAILED(hr))
+	{
+		releaseRange(heapIndex, block);
+		return hr;
+	}
+
+	if (pHeap->owners.size() <= block)
+	{
+		pHeap->owners.resize(block + 1, nullptr);
+	}
+	pHeap->owners[block] = pAllocation;
+
+	pAllocation->heapIndex = heapIndex;
+	pAllocation->block = block;
+	return S_OK;
+}
+
+void GpuMemoryAllocator::release(GpuAllocation* pAllocation)
+{
+	if (!pAllocation->isValid())
+	{
+		return;
+	}
+
+	if (mpReleaseQueue != nullptr)
+	{
+		ID3D12Resource* pResource = nullptr;
+		uint64_t range = 0;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			// Drop the owner now, so defragment leaves the range alone while it is parked.
+			Heap* pHeap = mHeaps[pAllocation->heapIndex].get();
+			if (pAllocation->block < pHeap->owners.size())
+			{
+				pHeap->owners[pAllocation->block] = nullptr;
+			}
+
+			pResource = pAllocation->resource.Detach();
+			range = (static_cast<uint64_t>(pAllocation->heapIndex) << 32) | pAllocation->block;
+			pAllocation->heapIndex = ~0u;
+			pAllocation->block = TlsfAllocator::InvalidHandle;
+		}
+
+		// Unlocked, as the queue releases at once when the GPU is already done. The resource goes
+		// first, so the range is only reused once nothing is placed in it.
+		mpReleaseQueue->release(&ReleaseResource, pResource, 0);
+		mpReleaseQueue->release(&ReleaseParkedRange, this, range);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	pAllocation->resource.Reset();
+	releaseRange(pAllocation->heapIndex, pAllocation->block);
+
+	pAllocation->heapIndex = ~0u;
+	pAllocation->block = TlsfAllocator::InvalidHandle;
+}
+
+/// <summary>
+/// Render target and depth textures are left out: they are recreated with the swap chain, and
+/// their optimized clear values are not known here.
+/// </summary>
+uint32_t GpuMemoryAllocator::defragment(uint32_t maxMoves, std::vector<GpuAllocationMove>& moves)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::vector<TlsfMove> blockMoves;
+	uint32_t moveCount = 0;
+	for (uint32_t heapIndex = 0; heapIndex < mHeaps.size() && moveCount < maxMoves; ++heapIndex)
+	{
+		Heap* pHeap = mHeaps[heapIndex].get();
+		if (pHeap == nullptr || pHeap->isDedicated || pHeap->resourceClass == RenderTargetTextures)
+		{
+			continue;
+		}
+
+		blockMoves.clear();
+		pHeap->allocator.compact(maxMoves - moveCount, blockMoves);
+		for (const TlsfMove& blockMove : blockMoves)
+		{
+			GpuAllocation* pAllocation = (blockMove.from < pHeap->owners.size()) ? pHeap->owners[blockMove.from] : nullptr;
+
+			// A destination of a move still in progress has nothing to move yet.
+			ComPtr<ID3D12Resource> destination;
+			HRESULT hr = E_FAIL;
+			if (pAllocation != nullptr)
+			{
+				const D3D12_RESOURCE_DESC desc = pAllocation->resource->GetDesc();
+				hr = mDevice->CreatePlacedResource(
+					pHeap->heap.Get(),
+					pHeap->allocator.getOffset(blockMove.to),
+					&desc,
+					D3D12_RESOURCE_STATE_COMMON,
+					nullptr,
+					IID_PPV_ARGS(&destination)
+				);
+			}
+			if (FAILED(hr))
+			{
+				pHeap->allocator.free(blockMove.to);
+				continue;
+			}
+
+			GpuAllocationMove move;
+			move.pAllocation = pAllocation;
+			move.destination = destination;
+			move.block = blockMove.to;
+			moves.push_back(move);
+			++moveCount;
+		}
+	}
+	return moveCount;
+}
+
+void GpuMemoryAllocator::completeMove(GpuAllocationMove& move)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	GpuAllocation* pAllocation = move.pAllocation;
+	Heap* pHeap = mHeaps[pAllocation->heapIndex].get();
+
+	pAllocation->resource = move.destination;
+	pHeap->owners[pAllocation->block] = nullptr;
+	pHeap->allocator.free(pAllocation->block);
+
+	if (pHeap->owners.size() <= move.block)
+	{
+		pHeap->owners.resize(move.block + 1, nullptr);
+	}
+	pHeap->owners[move.block] = pAllocation;
+	pAllocation->block = move.block;
+
+	move.destination.Reset();
+}
+
+GpuMemoryStatistics GpuMemoryAllocator::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	GpuMemoryStatistics statistics{};
+	for (const std::unique_ptr<Heap>& heap : mHeaps)
+	{
+		if (heap == nullptr)
+		{
+			continue;
+		}
+
+		const TlsfStatistics heapStatistics = heap->allocator.getStatistics();
+		++statistics.heapCount;
+		statistics.heapSize += heapStatistics.totalSize;
+		statistics.allocatedSize += heapStatistics.allocatedSize;
+		statistics.allocationCount += heapStatistics.allocationCount;
+		statistics.freeBlockCount += heapStatistics.freeBlockCount;
+		statistics.largestFreeBlock = (heapStatistics.largestFreeBlock > statistics.largestFreeBlock) ? heapStatistics.largestFreeBlock : statistics.largestFreeBlock;
+
+		const float fragmentation = heapStatistics.getFragmentation();
+		statistics.maxFragmentation = (fragmentation > statistics.maxFragmentation) ? fragmentation : statistics.maxFragmentation;
+	}
+	return statistics;
+}
+
+GpuMemoryAllocator::ResourceClass GpuMemoryAllocator::GetResourceClass(const D3D12_RESOURCE_DESC& desc)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		return Buffers;
+	}
+	if ((desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0)
+	{
+		return RenderTargetTextures;
+	}
+	return Textures;
+}
+
+/// <summary>
+/// Size and alignment of the resource. Small single-sample textures are tried at the 4KB
+/// placement alignment first, which the runtime grants when the texture fits in 64KB.
+/// </summary>
+D3D12_RESOURCE_ALLOCATION_INFO GpuMemoryAllocator::getAllocationInfo(D3D12_RESOURCE_DESC* pDesc, ResourceClass resourceClass) const
+{
+	if (resourceClass == Textures && pDesc->SampleDesc.Count == 1)
+	{
+		pDesc->Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		const D3D12_RESOURCE_ALLOCATION_INFO info = mDevice->GetResourceAllocationInfo(0, 1, pDesc);
+		if (info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+		{
+			return info;
+		}
+	}
+
+	pDesc->Alignment = 0;
+	return mDevice->GetResourceAllocationInfo(0, 1, pDesc);
+}
+
+HRESULT GpuMemoryAllocator::createHeap(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass, uint64_t size, bool isDedicated, uint32_t* pHeapIndex)
+{
+	D3D12_HEAP_DESC heapDesc{};
+	heapDesc.Properties.Type = heapType;
+	heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapDesc.Properties.CreationNodeMask = 0;
+	heapDesc.Properties.VisibleNodeMask = 0;
+
+	switch (resourceClass)
+	{
+	case Buffers:
+		heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		break;
+	case Textures:
+		heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		break;
+	case RenderTargetTextures:
+		heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		break;
+	}
+	heapDesc.SizeInBytes = (size + (heapDesc.Alignment - 1)) & ~(heapDesc.Alignment - 1);
+
+	std::unique_ptr<Heap> heap(new Heap());
+	HRESULT hr = mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap->heap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	heap->heapType = heapType;
+	heap->resourceClass = resourceClass;
+	heap->allocator.initialize(heapDesc.SizeInBytes);
+	heap->isDedicated = isDedicated;
+
+	// Reuse the slot of a released dedicated heap.
+	uint32_t heapIndex = 0;
+	while (heapIndex < mHeaps.size() && mHeaps[heapIndex] != nullptr)
+	{
+		++heapIndex;
+	}
+	if (heapIndex == mHeaps.size())
+	{
+		mHeaps.push_back(nullptr);
+	}
+	mHeaps[heapIndex] = std::move(heap);
+
+	*pHeapIndex = heapIndex;
+	return S_OK;
+}
+
+void GpuMemoryAllocator::releaseRange(uint32_t heapIndex, uint32_t block)
+{
+	Heap* pHeap = mHeaps[heapIndex].get();
+	if (block < pHeap->owners.size())
+	{
+		pHeap->owners[block] = nullptr;
+	}
+	pHeap->allocator.free(block);
+
+	if (pHeap->isDedicated && pHeap->allocator.isEmpty())
+	{
+		mHeaps[heapIndex].reset();
+	}
+}
+
+void GpuMemoryAllocator::ReleaseResource(void* pResource, uint64_t)
+{
+	static_cast<ID3D12Resource*>(pResource)->Release();
+}
+
+/// <summary>
+/// Parked ranges outlive destroy() at shutdown, by which time their heap is gone.
+/// </summary>
+void GpuMemoryAllocator::ReleaseParkedRange(void* pAllocator, uint64_t context)
+{
+	GpuMemoryAllocator* pThis = static_cast<GpuMemoryAllocator*>(pAllocator);
+	const uint32_t heapIndex = static_cast<uint32_t>(context >> 32);
+	const uint32_t block = static_cast<uint32_t>(context);
+
+	std::lock_guard<std::mutex> lock(pThis->mMutex);
+	if (pThis->mHeaps.size() > heapIndex && pThis->mHeaps[heapIndex] != nullptr)
+	{
+		pThis->releaseRange(heapIndex, block);
+	}
+}
@@ -0,0 +1,109 @@
+#ifndef __RENDERER_GPUMEMORYALLOCATOR_H__
+#define __RENDERER_GPUMEMORYALLOCATOR_H__
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "TlsfAllocator.h"
+#include "DeferredReleaseQueue.h"
+
+using namespace Microsoft::WRL;
+
+// Placed resource and the heap range it occupies. The allocator refers to it by address
+// until it is released, so it must not be copied or moved in the meantime.
+struct GpuAllocation
+{
+	ComPtr<ID3D12Resource> resource;
+	uint32_t heapIndex;
+	uint32_t block;
+
+	GpuAllocation() : resource(), heapIndex(~0u), block(TlsfAllocator::InvalidHandle) {}
+	bool isValid() const { return resource != nullptr; }
+};
+
+// Replacement resource made by GpuMemoryAllocator::defragment, in the same heap as pAllocation.
+struct GpuAllocationMove
+{
+	GpuAllocation* pAllocation;
+	ComPtr<ID3D12Resource> destination;
+	uint32_t block;
+};
+
+struct GpuMemoryStatistics
+{
+	uint32_t heapCount;
+	uint64_t heapSize;
+	uint64_t allocatedSize;
+	uint32_t allocationCount;
+	uint32_t freeBlockCount;
+	uint64_t largestFreeBlock;
+	// Of the most fragmented heap, see TlsfStatistics.
+	float maxFragmentation;
+};
+
+// Creates resources placed in a few large ID3D12Heaps instead of one implicit heap each.
+// Heaps are kept per heap type and resource class (buffers, textures, render target and depth
+// textures, which tier 1 hardware cannot mix) and split up by a TlsfAllocator each.
+class GpuMemoryAllocator
+{
+public:
+	GpuMemoryAllocator();
+	~GpuMemoryAllocator();
+
+	// With a release queue, release() parks the resource and its range until the GPU is done with them.
+	void initialize(ID3D12Device* pDevice, uint64_t heapSize, DeferredReleaseQueue* pReleaseQueue = nullptr);
+	// Every allocation must have been released and be no longer used by the GPU.
+	void destroy();
+
+	// Thread-safe. Same as CreateCommittedResource, the result goes to pAllocation.
+	HRESULT createResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue, GpuAllocation* pAllocation);
+	// Thread-safe. Without a release queue, the GPU must no longer use the resource.
+	void release(GpuAllocation* pAllocation);
+
+	// Plans up to maxMoves moves towards the start of each buffer and texture heap and creates the
+	// resources to move to, in the COMMON state. The caller copies each allocation into its
+	// destination and calls completeMove once the GPU has finished both the copy and the old resource.
+	uint32_t defragment(uint32_t maxMoves, std::vector<GpuAllocationMove>& moves);
+	// Swaps the destination into the allocation and releases the old resource and range.
+	void completeMove(GpuAllocationMove& move);
+
+	GpuMemoryStatistics getStatistics() const;
+
+private:
+	enum ResourceClass
+	{
+		Buffers,
+		Textures,
+		RenderTargetTextures,
+	};
+
+	struct Heap
+	{
+		ComPtr<ID3D12Heap> heap;
+		D3D12_HEAP_TYPE heapType;
+		ResourceClass resourceClass;
+		TlsfAllocator allocator;
+		// Allocation of each block handle, for defragment
+		std::vector<GpuAllocation*> owners;
+		// Made for one resource larger than mHeapSize, destroyed with it
+		bool isDedicated;
+	};
+
+	static ResourceClass GetResourceClass(const D3D12_RESOURCE_DESC& desc);
+	D3D12_RESOURCE_ALLOCATION_INFO getAllocationInfo(D3D12_RESOURCE_DESC* pDesc, ResourceClass resourceClass) const;
+	HRESULT createHeap(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass, uint64_t size, bool isDedicated, uint32_t* pHeapIndex);
+	void releaseRange(uint32_t heapIndex, uint32_t block);
+	// DeferredReleaseFunctions; the context of a range is heapIndex << 32 | block
+	static void ReleaseResource(void* pResource, uint64_t context);
+	static void ReleaseParkedRange(void* pAllocator, uint64_t context);
+
+	ComPtr<ID3D12Device> mDevice;
+	uint64_t mHeapSize;
+	DeferredReleaseQueue* mpReleaseQueue;
+	// Slots are never moved, since allocations keep their heap's index; released dedicated heaps leave null
+	std::vector<std::unique_ptr<Heap>> mHeaps;
+	mutable std::mutex mMutex;
+};
+
+#endif
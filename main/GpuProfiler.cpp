@@ -0,0 +1,200 @@
+#include "GpuProfiler.h"
+
+const uint32_t GpuProfiler::DroppedZone;
+
+namespace
+{
+	const ProfileZone FrameZone = { "GPU Frame", __FILE__, __LINE__ };
+}
+
+/// <summary>
+/// Relative to the calibration point in whole seconds plus the remainder, so large tick counts
+/// do not lose precision or overflow.
+/// </summary>
+int64_t GpuClockCalibration::toCpuTime(uint64_t timestamp) const
+{
+	const bool isBefore = timestamp < gpuTimestamp;
+	const uint64_t ticks = isBefore ? gpuTimestamp - timestamp : timestamp - gpuTimestamp;
+	const uint64_t nanoseconds = (ticks / frequency) * 1000000000ull + (ticks % frequency) * 1000000000ull / frequency;
+	return isBefore ? cpuTime - static_cast<int64_t>(nanoseconds) : cpuTime + static_cast<int64_t>(nanoseconds);
+}
+
+GpuProfiler::GpuProfiler()
+	: mpQueries(nullptr)
+	, mMaxZoneCount(0)
+	, mCalibrationInterval(0)
+	, mFrames()
+	, mFrameIndex(0)
+	, mOpenZones()
+	, mDroppedZoneCount(0)
+	, mCalibration()
+	, mFramesSinceCalibration(0)
+	, mIsCalibrated(false)
+	, mTimestamps()
+	, mTimings()
+	, mFrameTime(0.0f)
+	, mpTrack(nullptr)
+{
+
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	destroy();
+}
+
+void GpuProfiler::initialize(ITimestampQueries* pQueries, uint32_t frameCount, uint32_t maxZoneCount, uint32_t calibrationInterval)
+{
+	destroy();
+
+	mpQueries = pQueries;
+	mMaxZoneCount = maxZoneCount;
+	mCalibrationInterval = calibrationInterval;
+
+	mFrames.resize(frameCount);
+	for (Frame& frame : mFrames)
+	{
+		frame.zones.reserve(maxZoneCount);
+		frame.isRecorded = false;
+	}
+	mOpenZones.reserve(maxZoneCount);
+	mTimestamps.resize(maxZoneCount * 2);
+	mTimings.reserve(maxZoneCount);
+}
+
+void GpuProfiler::destroy()
+{
+	mFrames.clear();
+	mOpenZones.clear();
+	mTimestamps.clear();
+	mTimings.clear();
+	mIsCalibrated = false;
+	mpQueries = nullptr;
+}
+
+void GpuProfiler::beginFrame(void* pCommandList, uint32_t frameIndex)
+{
+	mFrameIndex = frameIndex;
+	mFrames[frameIndex].zones.clear();
+	mFrames[frameIndex].isRecorded = false;
+	mOpenZones.clear();
+
+	beginZone(pCommandList, &FrameZone);
+}
+
+void GpuProfiler::beginZone(void* pCommandList, const ProfileZone* pZone)
+{
+	Frame& frame = mFrames[mFrameIndex];
+	if (frame.zones.size() >= mMaxZoneCount)
+	{
+		// Still pushed, so the matching endZone pops it
+		mOpenZones.push_back(DroppedZone);
+		++mDroppedZoneCount;
+		return;
+	}
+
+	const uint32_t zone = static_cast<uint32_t>(frame.zones.size());
+	Zone entry = { pZone, static_cast<uint32_t>(mOpenZones.size()) };
+	frame.zones.push_back(entry);
+	mOpenZones.push_back(zone);
+
+	mpQueries->writeTimestamp(pCommandList, getFirstQuery(mFrameIndex) + zone * 2);
+}
+
+void GpuProfiler::endZone(void* pCommandList)
+{
+	if (mOpenZones.empty())
+	{
+		return;
+	}
+
+	const uint32_t zone = mOpenZones.back();
+	mOpenZones.pop_back();
+	if (zone != DroppedZone)
+	{
+		mpQueries->writeTimestamp(pCommandList, getFirstQuery(mFrameIndex) + zone * 2 + 1);
+	}
+}
+
+void GpuProfiler::endFrame(void* pCommandList)
+{
+	while (!mOpenZones.empty())
+	{
+		endZone(pCommandList);
+	}
+
+	Frame& frame = mFrames[mFrameIndex];
+	mpQueries->resolve(pCommandList, getFirstQuery(mFrameIndex), static_cast<uint32_t>(frame.zones.size()) * 2);
+	frame.isRecorded = true;
+}
+
+/// <summary>
+/// Recalibrates first when due: GPU and CPU clocks drift apart slowly, and calibrating is a kernel call.
+/// </summary>
+bool GpuProfiler::collect(uint32_t frameIndex)
+{
+	if (frameIndex >= mFrames.size() || !mFrames[frameIndex].isRecorded)
+	{
+		return false;
+	}
+
+	Frame& frame = mFrames[frameIndex];
+	frame.isRecorded = false;
+	if (frame.zones.empty())
+	{
+		return false;
+	}
+
+	const uint32_t queryCount = static_cast<uint32_t>(frame.zones.size()) * 2;
+	if (!mpQueries->read(getFirstQuery(frameIndex), queryCount, mTimestamps.data()))
+	{
+		return false;
+	}
+
+	if (!mIsCalibrated || ++mFramesSinceCalibration >= mCalibrationInterval)
+	{
+		mIsCalibrated = mpQueries->calibrate(&mCalibration);
+		mFramesSinceCalibration = 0;
+		if (!mIsCalibrated)
+		{
+			return false;
+		}
+	}
+
+	mTimings.clear();
+	for (uint32_t zone = 0; zone < frame.zones.size(); ++zone)
+	{
+		const uint64_t begin = mTimestamps[zone * 2];
+		// Timestamps of different command lists are not strictly ordered on every GPU
+		const uint64_t end = (mTimestamps[zone * 2 + 1] > begin) ? mTimestamps[zone * 2 + 1] : begin;
+
+		GpuZoneTiming timing;
+		timing.pZone = frame.zones[zone].pZone;
+		timing.depth = frame.zones[zone].depth;
+		timing.begin = mCalibration.toCpuTime(begin);
+		timing.end = mCalibration.toCpuTime(end);
+		mTimings.push_back(timing);
+	}
+	mFrameTime = static_cast<float>(static_cast<double>(mTimings[0].end - mTimings[0].begin) / 1000000.0);
+
+	if (Profiler::IsEnabled())
+	{
+		if (mpTrack == nullptr)
+		{
+			mpTrack = Profiler::getInstance()->addSteadyTrack("GPU");
+		}
+		for (const GpuZoneTiming& timing : mTimings)
+		{
+			mpTrack->push(timing.pZone, static_cast<uint64_t>(timing.begin), static_cast<uint64_t>(timing.end));
+		}
+	}
+	return true;
+}
+
+void GpuProfiler::invalidate()
+{
+	for (Frame& frame : mFrames)
+	{
+		frame.isRecorded = false;
+	}
+}
@@ -0,0 +1,121 @@
+#ifndef __RENDERER_GPUPROFILER_H__
+#define __RENDERER_GPUPROFILER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Profiler.h"
+
+// A GPU timestamp and the CPU time sampled at the same moment, so GPU ticks can be placed on the CPU timeline.
+struct GpuClockCalibration
+{
+	uint64_t gpuTimestamp;
+	// steady_clock nanoseconds
+	int64_t cpuTime;
+	// GPU ticks per second
+	uint64_t frequency;
+
+	int64_t toCpuTime(uint64_t timestamp) const;
+};
+
+// Timestamp queries of one queue. Opaque so GpuProfiler does not depend on D3D12.
+class ITimestampQueries
+{
+public:
+	virtual ~ITimestampQueries() {}
+
+	// Writes the GPU time into query once the GPU reaches this point of the command list.
+	virtual void writeTimestamp(void* pCommandList, uint32_t query) = 0;
+	// Copies queries [first, first + count) to where read() finds them after the command list has executed.
+	virtual void resolve(void* pCommandList, uint32_t first, uint32_t count) = 0;
+	virtual bool read(uint32_t first, uint32_t count, uint64_t* pTimestamps) = 0;
+	virtual bool calibrate(GpuClockCalibration* pCalibration) = 0;
+};
+
+// Time a zone took on the GPU, on the CPU timeline
+struct GpuZoneTiming
+{
+	const ProfileZone* pZone;
+	// Zones open around this one when it began
+	uint32_t depth;
+	// steady_clock nanoseconds
+	int64_t begin;
+	int64_t end;
+};
+
+// Per-pass GPU timings from pairs of timestamp queries. Every frame in flight owns a range of
+// queries; a frame's zones are resolved with its last command list and read once its fence has
+// completed, so reading never stalls. The whole frame is the first zone of every frame.
+// Timings are converted to CPU time with a calibration taken every few frames, and pushed to the
+// CPU profiler's "GPU" track while it is enabled.
+class GpuProfiler
+{
+public:
+	GpuProfiler();
+	~GpuProfiler();
+
+	static uint32_t GetQueryCount(uint32_t frameCount, uint32_t maxZoneCount) { return frameCount * maxZoneCount * 2; }
+
+	// maxZoneCount counts the frame's own zone; zones past it are dropped.
+	void initialize(ITimestampQueries* pQueries, uint32_t frameCount, uint32_t maxZoneCount, uint32_t calibrationInterval = 60);
+	void destroy();
+
+	// Recording, on one thread. Zones nest, and may begin and end in different command lists of the same queue.
+	void beginFrame(void* pCommandList, uint32_t frameIndex);
+	void beginZone(void* pCommandList, const ProfileZone* pZone);
+	void endZone(void* pCommandList);
+	// Closes the zones still open and resolves the frame's queries. pCommandList must be the frame's last.
+	void endFrame(void* pCommandList);
+
+	// Reads the frame last recorded for frameIndex, whose fence must have completed.
+	// False when there is none, e.g. right after invalidate().
+	bool collect(uint32_t frameIndex);
+	// Forgets the recorded frames, e.g. when frame indices restart after a resize.
+	void invalidate();
+
+	// Of the last collected frame, in the order the zones began
+	const std::vector<GpuZoneTiming>& getTimings() const { return mTimings; }
+	// Whole frame GPU time of the last collected frame, in milliseconds
+	float getFrameTime() const { return mFrameTime; }
+	uint32_t getDroppedZoneCount() const { return mDroppedZoneCount; }
+
+private:
+	static const uint32_t DroppedZone = ~0u;
+
+	struct Zone
+	{
+		const ProfileZone* pZone;
+		uint32_t depth;
+	};
+
+	struct Frame
+	{
+		// Zone n owns queries 2n and 2n + 1 of the frame's range
+		std::vector<Zone> zones;
+		bool isRecorded;
+	};
+
+	uint32_t getFirstQuery(uint32_t frameIndex) const { return frameIndex * mMaxZoneCount * 2; }
+
+	ITimestampQueries* mpQueries;
+	uint32_t mMaxZoneCount;
+	uint32_t mCalibrationInterval;
+	std::vector<Frame> mFrames;
+
+	// Frame being recorded, and the zones open in it
+	uint32_t mFrameIndex;
+	std::vector<uint32_t> mOpenZones;
+	uint32_t mDroppedZoneCount;
+
+	GpuClockCalibration mCalibration;
+	uint32_t mFramesSinceCalibration;
+	bool mIsCalibrated;
+
+	std::vector<uint64_t> mTimestamps;
+	std::vector<GpuZoneTiming> mTimings;
+	float mFrameTime;
+
+	ProfileEventRing* mpTrack;
+};
+
+#endif
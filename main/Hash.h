@@ -0,0 +1,43 @@
+#ifndef __CORE_HASH_H__
+#define __CORE_HASH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 64-bit FNV-1a. Stable across runs and platforms, so hashes can be written to disk.
+class Hasher
+{
+public:
+	static const uint64_t OffsetBasis = 0xcbf29ce484222325ull;
+	static const uint64_t Prime = 0x100000001b3ull;
+
+	Hasher() : mHash(OffsetBasis) {}
+
+	Hasher& add(const void* pData, size_t size)
+	{
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+		for (size_t i = 0; i < size; ++i)
+		{
+			mHash = (mHash ^ pBytes[i]) * Prime;
+		}
+		return *this;
+	}
+
+	// Only for types without padding; anything else must be added field by field.
+	template<class T>
+	Hasher& add(const T& value) { return add(&value, sizeof(T)); }
+
+	// Includes the terminator, so ("ab", "c") and ("a", "bc") differ.
+	Hasher& addString(const char* pString)
+	{
+		return add(pString, (pString != nullptr) ? strlen(pString) + 1 : 0);
+	}
+
+	uint64_t getHash() const { return mHash; }
+
+private:
+	uint64_t mHash;
+};
+
+#endif
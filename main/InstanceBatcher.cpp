@@ -0,0 +1,97 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+
+InstanceBatcher::InstanceBatcher()
+	: mBatchLookup()
+	, mLastKey()
+	, mLastBatch(UINT32_MAX)
+	, mBatches()
+	, mSubmitBatch()
+	, mSubmitData()
+	, mInstances()
+{
+
+}
+
+void InstanceBatcher::clear()
+{
+	mBatchLookup.clear();
+	mLastBatch = UINT32_MAX;
+
+	mBatches.clear();
+	mSubmitBatch.clear();
+	mSubmitData.clear();
+	mInstances.clear();
+}
+
+void InstanceBatcher::submit(const void* pMesh, const void* pPipelineState, const InstanceData& data)
+{
+	const BatchKey key = { pMesh, pPipelineState };
+
+	// Objects of the same kind tend to be submitted back to back.
+	if (mLastBatch == UINT32_MAX || !(mLastKey == key))
+	{
+		auto result = mBatchLookup.emplace(key, static_cast<uint32_t>(mBatches.size()));
+		if (result.second)
+		{
+			mBatches.push_back({ pMesh, pPipelineState, 0, 0 });
+		}
+		mLastKey = key;
+		mLastBatch = result.first->second;
+	}
+
+	mBatches[mLastBatch].instanceCount++;
+	mSubmitBatch.push_back(mLastBatch);
+	mSubmitData.push_back(data);
+}
+
+/// <summary>
+/// Counting sort of the submissions into one contiguous range per batch
+/// </summary>
+void InstanceBatcher::build()
+{
+	const size_t batchCount = mBatches.size();
+
+	// Order batches by pipeline state first so state changes are minimized.
+	std::vector<uint32_t> order(batchCount);
+	for (uint32_t i = 0; i < batchCount; ++i)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs)
+	{
+		const InstanceBatch& a = mBatches[lhs];
+		const InstanceBatch& b = mBatches[rhs];
+		if (a.pPipelineState != b.pPipelineState)
+		{
+			return std::less<const void*>()(a.pPipelineState, b.pPipelineState);
+		}
+		return std::less<const void*>()(a.pMesh, b.pMesh);
+	});
+
+	std::vector<InstanceBatch> sorted(batchCount);
+	std::vector<uint32_t> cursor(batchCount);
+	uint32_t offset = 0;
+	for (size_t n = 0; n < batchCount; ++n)
+	{
+		InstanceBatch batch = mBatches[order[n]];
+		batch.firstInstance = offset;
+		offset += batch.instanceCount;
+
+		cursor[order[n]] = batch.firstInstance;
+		sorted[n] = batch;
+	}
+
+	mInstances.resize(mSubmitData.size());
+	for (size_t n = 0; n < mSubmitData.size(); ++n)
+	{
+		mInstances[cursor[mSubmitBatch[n]]++] = mSubmitData[n];
+	}
+
+	mBatches.swap(sorted);
+
+	// Batch indices are no longer valid for further submissions.
+	mBatchLookup.clear();
+	mLastBatch = UINT32_MAX;
+}
@@ -0,0 +1,72 @@
+#ifndef __RENDERER_INSTANCEBATCHER_H__
+#define __RENDERER_INSTANCEBATCHER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <unordered_map>
+
+#include <DirectXMath.h>
+
+// Per-instance data read by the vertex shader through a StructuredBuffer.
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 world;
+};
+
+// Instances sharing a mesh and pipeline state, drawn with one DrawIndexedInstanced.
+struct InstanceBatch
+{
+	const void* pMesh;
+	const void* pPipelineState;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+// Groups submitted instances by (mesh, pipeline state) and lays out their data contiguously
+// per group, ordered so that batches sharing a pipeline state are adjacent.
+// Mesh and pipeline state are opaque keys, so the grouping itself does not touch D3D12.
+class InstanceBatcher
+{
+public:
+	InstanceBatcher();
+
+	void clear();
+	void submit(const void* pMesh, const void* pPipelineState, const InstanceData& data);
+	void build();
+
+	const std::vector<InstanceBatch>& getBatches() const { return mBatches; }
+	const std::vector<InstanceData>& getInstances() const { return mInstances; }
+	uint32_t getInstanceCount() const { return static_cast<uint32_t>(mSubmitData.size()); }
+
+private:
+	struct BatchKey
+	{
+		const void* pMesh;
+		const void* pPipelineState;
+
+		bool operator==(const BatchKey& key) const { return pMesh == key.pMesh && pPipelineState == key.pPipelineState; }
+	};
+
+	struct BatchKeyHash
+	{
+		size_t operator()(const BatchKey& key) const
+		{
+			const size_t h0 = std::hash<const void*>()(key.pMesh);
+			const size_t h1 = std::hash<const void*>()(key.pPipelineState);
+			return h0 ^ (h1 + 0x9e3779b9 + (h0 << 6) + (h0 >> 2));
+		}
+	};
+
+	std::unordered_map<BatchKey, uint32_t, BatchKeyHash> mBatchLookup;
+	BatchKey mLastKey;
+	uint32_t mLastBatch;
+
+	std::vector<InstanceBatch> mBatches;
+	std::vector<uint32_t> mSubmitBatch;
+	std::vector<InstanceData> mSubmitData;
+	std::vector<InstanceData> mInstances;
+};
+
+#endif
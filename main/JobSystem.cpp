@@ -0,0 +1,259 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+DEFINE_SIGLETON(JobSystem);
+
+namespace
+{
+	// Index of the worker owning the calling thread, -1 on non-worker threads.
+	thread_local int tWorkerIndex = -1;
+}
+
+JobSystem::JobSystem()
+	: mWorkers()
+	, mSharedMutex()
+	, mSharedQueue()
+	, mQueuedCount(0)
+	, mSleepMutex()
+	, mWakeCondition()
+	, mIsRunning(false)
+{
+
+}
+
+JobSystem::~JobSystem()
+{
+	onDestroy();
+}
+
+/// <summary>
+/// Starts the worker threads.
+/// </summary>
+void JobSystem::onInit(uint32_t workerCount)
+{
+	if (mIsRunning.load())
+	{
+		return;
+	}
+
+	if (workerCount == 0)
+	{
+		const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+	}
+
+	mIsRunning.store(true);
+
+	mWorkers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		mWorkers.emplace_back(new Worker());
+	}
+	// Start threads only after every queue exists, since workers steal from each other.
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		mWorkers[i]->thread = std::thread(&JobSystem::workerMain, this, i);
+#if defined(_WIN32)
+		SetThreadDescription(mWorkers[i]->thread.native_handle(), L"JobWorker");
+#endif
+	}
+}
+
+/// <summary>
+/// Stops and joins the worker threads. Jobs still queued are dropped.
+/// </summary>
+void JobSystem::onDestroy()
+{
+	if (!mIsRunning.load())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mIsRunning.store(false);
+	}
+	mWakeCondition.notify_all();
+
+	for (std::unique_ptr<Worker>& pWorker : mWorkers)
+	{
+		pWorker->thread.join();
+	}
+	mWorkers.clear();
+
+	mSharedQueue.clear();
+	mQueuedCount.store(0);
+}
+
+/// <summary>
+/// Queues count jobs. pCounter is incremented by count and decremented as each job finishes.
+/// </summary>
+void JobSystem::run(Job* pJobs, uint32_t count, JobCounter* pCounter)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	pCounter->mValue.fetch_add(count, std::memory_order_relaxed);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		pJobs[i].pCounter = pCounter;
+	}
+
+	if (mWorkers.empty())
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			execute(&pJobs[i]);
+		}
+		return;
+	}
+
+	const int workerIndex = tWorkerIndex;
+	if (workerIndex >= 0)
+	{
+		WorkStealingQueue<Job, QueueCapacity>& queue = mWorkers[workerIndex]->queue;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			// Counted before the push so a thief never sees the count go below zero.
+			mQueuedCount.fetch_add(1, std::memory_order_release);
+			if (!queue.push(&pJobs[i]))
+			{
+				// Deque is full: run it here rather than growing the deque.
+				mQueuedCount.fetch_sub(1, std::memory_order_relaxed);
+				execute(&pJobs[i]);
+			}
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(mSharedMutex);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			mSharedQueue.push_back(&pJobs[i]);
+		}
+		mQueuedCount.fetch_add(count, std::memory_order_release);
+	}
+
+	// Take the sleep lock so a worker cannot miss the wake-up between checking and sleeping.
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	if (count == 1)
+	{
+		mWakeCondition.notify_one();
+	}
+	else
+	{
+		mWakeCondition.notify_all();
+	}
+}
+
+/// <summary>
+/// Helps executing jobs until every job counted by pCounter has finished.
+/// </summary>
+void JobSystem::wait(const JobCounter* pCounter)
+{
+	const int workerIndex = tWorkerIndex;
+	while (!pCounter->isDone())
+	{
+		Job* pJob = findJob(workerIndex >= 0 ? static_cast<uint32_t>(workerIndex) : getWorkerCount());
+		if (pJob != nullptr)
+		{
+			execute(pJob);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::workerMain(uint32_t workerIndex)
+{
+	tWorkerIndex = static_cast<int>(workerIndex);
+	Profiler::SetThreadName(("JobWorker " + std::to_string(workerIndex)).c_str());
+
+	uint32_t idleCount = 0;
+	while (mIsRunning.load(std::memory_order_relaxed))
+	{
+		Job* pJob = findJob(workerIndex);
+		if (pJob != nullptr)
+		{
+			execute(pJob);
+			idleCount = 0;
+			continue;
+		}
+
+		if (++idleCount < SpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mWakeCondition.wait(lock, [this] { return mQueuedCount.load(std::memory_order_acquire) > 0 || !mIsRunning.load(); });
+		idleCount = 0;
+	}
+
+	tWorkerIndex = -1;
+}
+
+/// <summary>
+/// Own deque first (most recent, cache-warm work), then the shared queue, then stealing.
+/// workerIndex == getWorkerCount() means the caller owns no deque.
+/// </summary>
+Job* JobSystem::findJob(uint32_t workerIndex)
+{
+	const uint32_t workerCount = getWorkerCount();
+
+	Job* pJob = nullptr;
+	if (workerIndex < workerCount)
+	{
+		pJob = mWorkers[workerIndex]->queue.pop();
+	}
+
+	if (pJob == nullptr && mQueuedCount.load(std::memory_order_acquire) > 0)
+	{
+		std::unique_lock<std::mutex> lock(mSharedMutex, std::try_to_lock);
+		if (lock.owns_lock() && !mSharedQueue.empty())
+		{
+			pJob = mSharedQueue.front();
+			mSharedQueue.pop_front();
+		}
+	}
+
+	if (pJob == nullptr)
+	{
+		for (uint32_t i = 1; i <= workerCount && pJob == nullptr; ++i)
+		{
+			const uint32_t victim = (workerIndex + i) % workerCount;
+			if (victim != workerIndex)
+			{
+				pJob = mWorkers[victim]->queue.steal();
+			}
+		}
+	}
+
+	if (pJob != nullptr)
+	{
+		mQueuedCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return pJob;
+}
+
+void JobSystem::execute(Job* pJob)
+{
+	PROFILE_ZONE("Job");
+
+	JobCounter* pCounter = pJob->pCounter;
+	pJob->pFunction(pJob->pData, pJob->begin, pJob->end);
+	pCounter->mValue.fetch_sub(1, std::memory_order_release);
+}
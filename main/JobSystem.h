@@ -0,0 +1,130 @@
+#ifndef __CORE_JOBSYSTEM_H__
+#define __CORE_JOBSYSTEM_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Singleton.h"
+#include "WorkStealingQueue.h"
+
+// Counts the unfinished jobs of a group. Waiting on it is how jobs express dependencies.
+class JobCounter
+{
+public:
+	JobCounter() : mValue(0) {}
+
+	bool isDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> mValue;
+};
+
+typedef void (*JobFunction)(void* pData, uint32_t begin, uint32_t end);
+
+// Calls pFunction(pData, begin, end). Owned by the submitter and must stay alive until
+// its counter reaches zero.
+struct Job
+{
+	JobFunction pFunction;
+	void* pData;
+	uint32_t begin;
+	uint32_t end;
+	JobCounter* pCounter;
+};
+
+// Work-stealing scheduler with one Chase-Lev deque per worker thread.
+// Jobs submitted from a worker go to its own deque, jobs submitted from any other thread
+// (the game thread) go to a shared queue. Idle workers steal from each other.
+class JobSystem final : public Common::Singleton<JobSystem>
+{
+public:
+	JobSystem();
+	virtual ~JobSystem();
+
+	// workerCount == 0 : one worker per hardware thread besides the caller
+	void onInit(uint32_t workerCount = 0);
+	void onDestroy();
+
+	uint32_t getWorkerCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+	void run(Job* pJobs, uint32_t count, JobCounter* pCounter);
+
+	// Executes pending jobs while waiting, so it may also be called from inside a job.
+	void wait(const JobCounter* pCounter);
+
+	// Calls func(begin, end) over [0, count) split into ranges of grainSize, and waits for all of them.
+	template<class Func>
+	void parallelFor(uint32_t count, uint32_t grainSize, const Func& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		if (grainSize == 0)
+		{
+			grainSize = 1;
+		}
+
+		const uint32_t jobCount = (count + grainSize - 1) / grainSize;
+		if (jobCount == 1 || mWorkers.empty())
+		{
+			func(0u, count);
+			return;
+		}
+
+		std::vector<Job> jobs(jobCount);
+		for (uint32_t i = 0; i < jobCount; ++i)
+		{
+			jobs[i].pFunction = &invokeRange<Func>;
+			jobs[i].pData = const_cast<Func*>(&func);
+			jobs[i].begin = i * grainSize;
+			jobs[i].end = (count - jobs[i].begin < grainSize) ? count : jobs[i].begin + grainSize;
+		}
+
+		JobCounter counter;
+		run(jobs.data(), jobCount, &counter);
+		wait(&counter);
+	}
+
+private:
+	static const uint32_t QueueCapacity = 4096;
+	static const uint32_t SpinCount = 64;
+
+	struct Worker
+	{
+		WorkStealingQueue<Job, QueueCapacity> queue;
+		std::thread thread;
+	};
+
+	template<class Func>
+	static void invokeRange(void* pData, uint32_t begin, uint32_t end)
+	{
+		(*static_cast<const Func*>(pData))(begin, end);
+	}
+
+	void workerMain(uint32_t workerIndex);
+
+	Job* findJob(uint32_t workerIndex);
+	void execute(Job* pJob);
+
+	std::vector<std::unique_ptr<Worker>> mWorkers;
+
+	std::mutex mSharedMutex;
+	std::deque<Job*> mSharedQueue;
+
+	// Jobs pushed but not yet taken; idle workers sleep while it is zero.
+	std::atomic<uint32_t> mQueuedCount;
+	std::mutex mSleepMutex;
+	std::condition_variable mWakeCondition;
+	std::atomic<bool> mIsRunning;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "LinearAllocator.h"
+
+FrameLinearAllocator::FrameLinearAllocator()
+	: mpCPUBase(nullptr)
+	, mGPUBase(0)
+	, mFrameSize(0)
+	, mFrameCount(0)
+	, mFrameIndex(0)
+	, mFrameBegin(0)
+	, mFrameEnd(0)
+	, mOffset(0)
+{
+
+}
+
+void FrameLinearAllocator::initialize(uint8_t* pCPUBase, uint64_t gpuBase, uint64_t frameSize, uint32_t frameCount)
+{
+	mpCPUBase = pCPUBase;
+	mGPUBase = gpuBase;
+	mFrameSize = frameSize;
+	mFrameCount = frameCount;
+
+	beginFrame(0);
+}
+
+void FrameLinearAllocator::beginFrame(uint32_t frameIndex)
+{
+	mFrameIndex = frameIndex % mFrameCount;
+	mFrameBegin = mFrameSize * mFrameIndex;
+	mFrameEnd = mFrameBegin + mFrameSize;
+	mOffset = mFrameBegin;
+}
+
+LinearAllocation FrameLinearAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+	LinearAllocation allocation = {};
+
+	// alignment must be a power of two
+	const uint64_t offset = (mOffset + (alignment - 1)) & ~(alignment - 1);
+	if (size == 0 || offset + size > mFrameEnd)
+	{
+		return allocation;
+	}
+
+	mOffset = offset + size;
+
+	allocation.pCPU = mpCPUBase + offset;
+	allocation.gpuAddress = mGPUBase + offset;
+	allocation.offset = offset;
+	allocation.size = size;
+	return allocation;
+}
@@ -0,0 +1,50 @@
+#ifndef __RENDERER_LINEARALLOCATOR_H__
+#define __RENDERER_LINEARALLOCATOR_H__
+
+#include <cstdint>
+
+// Sub-allocation handed out by FrameLinearAllocator.
+struct LinearAllocation
+{
+	uint8_t* pCPU;
+	uint64_t gpuAddress;
+	uint64_t offset;
+	uint64_t size;
+
+	bool isValid() const { return pCPU != nullptr; }
+};
+
+// Bump allocator over a persistently mapped buffer that is split into one region per
+// in-flight frame. A region is only rewound by beginFrame(), so the caller must make sure
+// the GPU has finished the frame that last used it (Renderer does this in moveToNextFrame).
+// Holds no graphics API objects; the backing memory is supplied by the owner.
+class FrameLinearAllocator
+{
+public:
+	static const uint64_t DefaultAlignment = 256;
+
+	FrameLinearAllocator();
+
+	void initialize(uint8_t* pCPUBase, uint64_t gpuBase, uint64_t frameSize, uint32_t frameCount);
+
+	void beginFrame(uint32_t frameIndex);
+	LinearAllocation allocate(uint64_t size, uint64_t alignment = DefaultAlignment);
+
+	uint32_t getFrameIndex() const { return mFrameIndex; }
+	uint32_t getFrameCount() const { return mFrameCount; }
+	uint64_t getFrameSize() const { return mFrameSize; }
+	uint64_t getUsedSize() const { return mOffset - mFrameBegin; }
+
+private:
+	uint8_t* mpCPUBase;
+	uint64_t mGPUBase;
+	uint64_t mFrameSize;
+	uint32_t mFrameCount;
+	uint32_t mFrameIndex;
+
+	uint64_t mFrameBegin;
+	uint64_t mFrameEnd;
+	uint64_t mOffset;
+};
+
+#endif
@@ -2,6 +2,41 @@
 #include "MainProject.h"
 #include "Renderer.h"
 #include "Camera.h"
+#include "Registry.h"
+#include "JobSystem.h"
+#include "Frustum.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Extents and radius of entities without a BoundsComponent
+	const float UnboundedSize = 1.0e30f;
+
+	/// <summary>
+	/// World AABB enclosing the rotated local AABB, and the local sphere scaled by the largest axis scale.
+	/// </summary>
+	void TransformBounds(const Matrix& world, const Vector3& scale, const BoundsComponent& local, BoundsStore* pOut, uint32_t index)
+	{
+		const float* c = local.center.f;
+		const float* e = local.extents.f;
+
+		Vector3 center;
+		Vector3 extents;
+		for (int j = 0; j < 3; ++j)
+		{
+			center.f[j] = c[0] * world.m[0][j] + c[1] * world.m[1][j] + c[2] * world.m[2][j] + world.m[3][j];
+			extents.f[j] = e[0] * fabsf(world.m[0][j]) + e[1] * fabsf(world.m[1][j]) + e[2] * fabsf(world.m[2][j]);
+		}
+
+		float maxScale = fabsf(scale.x);
+		maxScale = (fabsf(scale.y) > maxScale) ? fabsf(scale.y) : maxScale;
+		maxScale = (fabsf(scale.z) > maxScale) ? fabsf(scale.z) : maxScale;
+
+		pOut->set(index, center, extents, local.radius * maxScale);
+	}
+}
 
 #include "Input.h"
 
@@ -10,18 +45,34 @@ MainProject::MainProject(UINT width, UINT height, std::wstring title)
 	, mpCamera(nullptr)
 	, mpPlane(nullptr)
 	, mpRenderer(nullptr)
+	, mpRegistry(nullptr)
+	, mInstanceData()
+	, mWorldBounds()
+	, mVisibleIndices()
+	, mSceneBvh()
+	, mEntityProxies()
+	, mVisibleEntities()
+	, mFramePipeline()
+	, mpUpdateSnapshot(nullptr)
+	, mFrameClock()
+	, mFramePacer()
+	, mFrameNumber(0)
+	, mPendingViewportSize(0)
 {
 	Input::createInstance();
+	JobSystem::createInstance();
 }
 
 MainProject::~MainProject()
 {
+	JobSystem::destoryInstance();
 	Input::destoryInstance();
 }
 
 void MainProject::onInit()
 {
 	Input::getInstance()->onInit();
+	JobSystem::getInstance()->onInit();
 
 	mpCamera = new Camera();
 	mpCamera->getTransform()->setLocalPosition({ 0, 0, -10 });
@@ -30,34 +81,361 @@ void MainProject::onInit()
 
 	mpRenderer = new Renderer();
 
+	// Start each frame once the swap chain has room for it, then read input, so what is shown is recent
+	const FramePacingSettings pacing = FramePacingSettings::LowLatency();
+	mpRenderer->setFramePacing(pacing);
+
 	mpRenderer->onInit();
 
+	mFramePacer.initialize(&mFrameClock, mpRenderer->getPresentQueue(), pacing);
+
 	mpCamera->setup();
 	mpPlane->onSetup();
+
+	mpRegistry = new Registry();
+	createEntities();
 }
 
 void MainProject::onUpdate()
 {
-	Input::getInstance()->onUpdate();
+	PROFILE_ZONE("MainProject::onUpdate");
+
+	// Take the snapshot slot first: waiting for the render thread after reading input would make
+	// late latched input as old as that wait.
+	mpUpdateSnapshot = mFramePipeline.beginUpdate();
+	if (mpUpdateSnapshot == nullptr) {
+		return;
+	}
+
+	// Late latching reads input after the waits for the render thread and the display, right before the camera update.
+	const bool isLateLatch = mFramePacer.getSettings().lateLatchInput;
+	if (!isLateLatch) {
+		sampleInput();
+	}
+
+	mFramePacer.beginFrame(mFrameNumber);
+
+	if (isLateLatch) {
+		sampleInput();
+	}
+
+	const uint64_t viewportSize = mPendingViewportSize.exchange(0, std::memory_order_acquire);
+	if (viewportSize != 0) {
+		mpCamera->setViewportSize(static_cast<LONG>(viewportSize >> 32), static_cast<LONG>(viewportSize & 0xFFFFFFFFu));
+	}
 
 	mpCamera->update();
 	mpPlane->onUpdate();
+	updateEntities();
+}
+
+void MainProject::sampleInput()
+{
+	Input::getInstance()->onUpdate();
+	mFramePacer.markInputSampled(mFrameNumber);
 }
 
 void MainProject::onDraw()
 {
-	mpCamera->onRender();
-	mpPlane->onRender();
+	PROFILE_ZONE("MainProject::onDraw");
+
+	// The slot onUpdate took
+	RenderSnapshot* pSnapshot = mpUpdateSnapshot;
+	if (pSnapshot == nullptr) {
+		return;
+	}
+	mpUpdateSnapshot = nullptr;
+
+	pSnapshot->reset(mFrameNumber++);
+
+	mpCamera->onRender(*pSnapshot);
+	mpPlane->onRender(*pSnapshot);
+	renderEntities(*pSnapshot);
+
+	mFramePipeline.endUpdate();
+}
+
+void MainProject::onRender()
+{
+	PROFILE_ZONE("MainProject::onRender");
+
+	const RenderSnapshot* pSnapshot = mFramePipeline.beginRender();
+	if (pSnapshot == nullptr) {
+		return;
+	}
+
+	mpRenderer->onRender(*pSnapshot);
+	mFramePacer.markPresented(pSnapshot->frameNumber);
+
+	mFramePipeline.endRender();
+}
+
+void MainProject::onExit()
+{
+	// Releases the game or render thread blocked on the other one, so both can be joined.
+	mFramePipeline.shutdown();
+}
+
+/// <summary>
+/// The renderer resizes its swap chain before its next frame, the camera before the next update.
+/// </summary>
+void MainProject::onResize(UINT width, UINT height)
+{
+	if (mpRenderer == nullptr || width == 0 || height == 0) {
+		return;
+	}
 
-	mpRenderer->onRender(mpCamera);
+	mpRenderer->requestResize(width, height);
+	mPendingViewportSize.store((static_cast<uint64_t>(width) << 32) | height, std::memory_order_release);
 }
 
 void MainProject::onDestroy()
 {
+	if (mpRegistry != nullptr) {
+		delete mpRegistry;
+	}
+
+	JobSystem::getInstance()->onDestroy();
+
 	if (mpRenderer != nullptr) {
 		mpRenderer->onDestroy();
 		delete mpRenderer;
 	}
 
 	Input::getInstance()->onDestory();
-}
\ No newline at end of file
+}
+
+bool MainProject::onPrecompile()
+{
+	return Renderer::precompileShaders();
+}
+
+/// <summary>
+/// Spawns a grid of quads as entities.
+/// </summary>
+void MainProject::createEntities()
+{
+	const int GridSize = 16;
+	const float Spacing = 0.5f;
+
+	mpRegistry->reserve(GridSize * GridSize);
+
+	MeshComponent mesh = { mpRenderer->getQuadMesh() };
+	MaterialComponent baseMaterial = { 0 };
+	// The right half of the grid uses the tinted variant, drawn with the base one until it is built
+	MaterialComponent tintedMaterial = { Renderer::getGeometryKeywords().makeKey({ "INSTANCE_TINT" }) };
+
+	const Mesh* pQuadMesh = mpRenderer->getQuadMesh();
+	BoundsComponent bounds;
+	bounds.center = Vector3(pQuadMesh->getBoundsCenter().x, pQuadMesh->getBoundsCenter().y, pQuadMesh->getBoundsCenter().z);
+	bounds.extents = Vector3(pQuadMesh->getBoundsExtents().x, pQuadMesh->getBoundsExtents().y, pQuadMesh->getBoundsExtents().z);
+	bounds.radius = pQuadMesh->getBoundsRadius();
+
+	for (int y = 0; y < GridSize; ++y)
+	{
+		for (int x = 0; x < GridSize; ++x)
+		{
+			TransformComponent transform;
+			transform.position = Vector3((x - GridSize / 2) * Spacing, (y - GridSize / 2) * Spacing, 2.0f);
+			transform.rotation = quaternion::identity;
+			transform.scale = Vector3(0.2f, 0.2f, 0.2f);
+
+			Entity entity = mpRegistry->create();
+			mpRegistry->add(entity, transform);
+			mpRegistry->add(entity, mesh);
+			mpRegistry->add(entity, (x < GridSize / 2) ? baseMaterial : tintedMaterial);
+			mpRegistry->add(entity, bounds);
+		}
+	}
+}
+
+/// <summary>
+/// Rotates every transform, walking the packed transform array in parallel chunks.
+/// </summary>
+void MainProject::updateEntities()
+{
+	const Quaternion delta = quaternion::AxisToRadian(mathf::PIDIV4 * 0.025f, vector3::ZAxis);
+
+	ComponentPool<TransformComponent>& transforms = mpRegistry->getPool<TransformComponent>();
+	TransformComponent* pTransforms = transforms.data();
+	JobSystem::getInstance()->parallelFor(transforms.size(), EntityGrainSize,
+		[pTransforms, delta](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				pTransforms[i].rotation *= delta;
+			}
+		});
+}
+
+/// <summary>
+/// Builds the instance data and world bounds of every renderable entity in parallel,
+/// queries the scene BVH with the camera frustum and appends the visible entities to the snapshot.
+/// </summary>
+void MainProject::renderEntities(RenderSnapshot& snapshot)
+{
+	ComponentPool<MeshComponent>& meshes = mpRegistry->getPool<MeshComponent>();
+	ComponentPool<TransformComponent>& transforms = mpRegistry->getPool<TransformComponent>();
+	ComponentPool<MaterialComponent>& materials = mpRegistry->getPool<MaterialComponent>();
+	ComponentPool<BoundsComponent>& bounds = mpRegistry->getPool<BoundsComponent>();
+
+	const uint32_t count = meshes.size();
+	const uint32_t* pEntityIndices = meshes.entityIndices();
+	mInstanceData.resize(count);
+	mWorldBounds.resize(count);
+
+	InstanceData* pInstanceData = mInstanceData.data();
+	BoundsStore* pWorldBounds = &mWorldBounds;
+	JobSystem::getInstance()->parallelFor(count, EntityGrainSize,
+		[pEntityIndices, pInstanceData, pWorldBounds, &transforms, &bounds](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const TransformComponent* pTransform = transforms.get(pEntityIndices[i]);
+				if (pTransform == nullptr)
+				{
+					pWorldBounds->set(i, vector3::zero, vector3::zero, 0.0f);
+					continue;
+				}
+
+				Matrix trs = matrix::TRS(pTransform->position, pTransform->rotation, pTransform->scale);
+				XMFLOAT4X4 world(trs.f);
+				XMStoreFloat4x4(&pInstanceData[i].world, XMMatrixTranspose(XMLoadFloat4x4(&world)));
+
+				const BoundsComponent* pBounds = bounds.get(pEntityIndices[i]);
+				if (pBounds != nullptr)
+				{
+					TransformBounds(trs, pTransform->scale, *pBounds, pWorldBounds, i);
+				}
+				else
+				{
+					// Without bounds the entity is never culled.
+					pWorldBounds->set(i, pTransform->position, Vector3(UnboundedSize, UnboundedSize, UnboundedSize), UnboundedSize);
+				}
+			}
+		});
+
+	// Starts mVisibleIndices with the unbounded entities, which the BVH does not hold
+	updateSceneBvh();
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, mpCamera->getViewProjectionMatrix());
+	mVisibleEntities.clear();
+	mSceneBvh.queryFrustum(Frustum::FromViewProjection(viewProjection), mVisibleEntities);
+
+	for (uint32_t entityIndex : mVisibleEntities)
+	{
+		mVisibleIndices.push_back(meshes.getDenseIndex(entityIndex));
+	}
+	// Back to dense order, so the instance data is read front to back
+	std::sort(mVisibleIndices.begin(), mVisibleIndices.end());
+
+	const MeshComponent* pMeshes = meshes.data();
+	for (uint32_t i : mVisibleIndices)
+	{
+		const MaterialComponent* pMaterial = materials.get(pEntityIndices[i]);
+		if (pMaterial == nullptr || !transforms.has(pEntityIndices[i]))
+		{
+			continue;
+		}
+
+		SnapshotInstance instance;
+		instance.pMesh = pMeshes[i].pMesh;
+		instance.pPipelineState = mpRenderer->getPipelineState(pMaterial->keywords);
+		instance.data = pInstanceData[i];
+		snapshot.instances.push_back(instance);
+	}
+}
+
+/// <summary>
+/// Moves the BVH proxies of bounded entities to this frame's world bounds, inserting new entities
+/// and removing the ones that lost their mesh, transform or bounds.
+/// An empty tree is built in one go with SAH instead of one insertion at a time.
+/// </summary>
+void MainProject::updateSceneBvh()
+{
+	ComponentPool<MeshComponent>& meshes = mpRegistry->getPool<MeshComponent>();
+	ComponentPool<TransformComponent>& transforms = mpRegistry->getPool<TransformComponent>();
+	ComponentPool<BoundsComponent>& bounds = mpRegistry->getPool<BoundsComponent>();
+
+	for (uint32_t entityIndex = 0; entityIndex < mEntityProxies.size(); ++entityIndex)
+	{
+		uint32_t& proxy = mEntityProxies[entityIndex];
+		if (proxy != Bvh::InvalidIndex && (!meshes.has(entityIndex) || !transforms.has(entityIndex) || !bounds.has(entityIndex)))
+		{
+			mSceneBvh.remove(proxy);
+			proxy = Bvh::InvalidIndex;
+		}
+	}
+
+	const uint32_t count = meshes.size();
+	const uint32_t* pEntityIndices = meshes.entityIndices();
+
+	std::vector<Aabb> newBounds;
+	std::vector<uint32_t> newEntities;
+	mVisibleIndices.clear();
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t entityIndex = pEntityIndices[i];
+		if (!transforms.has(entityIndex))
+		{
+			continue;
+		}
+
+		// Without bounds the entity is never culled.
+		if (!bounds.has(entityIndex))
+		{
+			mVisibleIndices.push_back(i);
+			continue;
+		}
+
+		const Vector3 center = mWorldBounds.getCenter(i);
+		const Vector3 extents = mWorldBounds.getExtents(i);
+		Aabb aabb;
+		for (int j = 0; j < 3; ++j)
+		{
+			aabb.lower[j] = center.f[j] - extents.f[j];
+			aabb.upper[j] = center.f[j] + extents.f[j];
+		}
+
+		if (entityIndex >= mEntityProxies.size())
+		{
+			mEntityProxies.resize(entityIndex + 1, Bvh::InvalidIndex);
+		}
+
+		const uint32_t proxy = mEntityProxies[entityIndex];
+		if (proxy != Bvh::InvalidIndex)
+		{
+			mSceneBvh.update(proxy, aabb);
+		}
+		else
+		{
+			newBounds.push_back(aabb);
+			newEntities.push_back(entityIndex);
+		}
+	}
+
+	const uint32_t newCount = static_cast<uint32_t>(newEntities.size());
+	if (newCount == 0)
+	{
+		return;
+	}
+
+	if (mSceneBvh.getProxyCount() == 0)
+	{
+		std::vector<uint32_t> proxies(newCount);
+		mSceneBvh.build(newBounds.data(), newEntities.data(), newCount, proxies.data());
+		for (uint32_t n = 0; n < newCount; ++n)
+		{
+			mEntityProxies[newEntities[n]] = proxies[n];
+		}
+	}
+	else
+	{
+		for (uint32_t n = 0; n < newCount; ++n)
+		{
+			mEntityProxies[newEntities[n]] = mSceneBvh.insert(newBounds[n], newEntities[n]);
+		}
+	}
+}
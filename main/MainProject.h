@@ -1,6 +1,14 @@
 #ifndef __MAINPROJECT_H__
 #define __MAINPROJECT_H__
+#include <vector>
+#include <atomic>
+
 #include "AppProject.h"
+#include "FramePipeline.h"
+#include "FramePacer.h"
+#include "RenderSnapshot.h"
+#include "BoundsStore.h"
+#include "Bvh.h"
 
 using namespace DirectX;
 
@@ -13,11 +21,50 @@ public:
 	void onInit() override;
 	void onUpdate() override;
 	void onDraw() override;
+	void onRender() override;
 	void onDestroy() override;
+	void onExit() override;
+	void onResize(UINT width, UINT height) override;
+	bool onPrecompile() override;
 
 private:
+	// Frames the game thread may run ahead of the render thread
+	static const uint32_t MaxFrameLatency = 2;
+
+	// Entities handled per job by the update / render preparation loops
+	static const uint32_t EntityGrainSize = 1024;
+
+	void sampleInput();
+	void createEntities();
+	void updateEntities();
+	void renderEntities(RenderSnapshot& snapshot);
+	void updateSceneBvh();
+
 	class Camera* mpCamera;
 	class Plane* mpPlane;
 	class Renderer* mpRenderer;
+	class Registry* mpRegistry;
+
+	// Instance data of renderable entities, rebuilt every frame
+	std::vector<InstanceData> mInstanceData;
+	// World bounds parallel to mInstanceData, and the indices surviving frustum culling
+	BoundsStore mWorldBounds;
+	std::vector<uint32_t> mVisibleIndices;
+
+	// Bounded entities, keyed by entity index. mEntityProxies maps an entity index to its proxy.
+	Bvh mSceneBvh;
+	std::vector<uint32_t> mEntityProxies;
+	std::vector<uint32_t> mVisibleEntities;
+
+	FramePipeline<RenderSnapshot, MaxFrameLatency> mFramePipeline;
+	// Slot taken by onUpdate and published by onDraw, nullptr after shutdown
+	RenderSnapshot* mpUpdateSnapshot;
+	// When the game thread starts a frame, relative to the display
+	SystemFrameClock mFrameClock;
+	FramePacer mFramePacer;
+	uint64_t mFrameNumber;
+
+	// Size from the window thread the camera has not taken yet, width << 32 | height, 0 when none
+	std::atomic<uint64_t> mPendingViewportSize;
 };
 #endif /* __MAINPROJECT_H__ */
\ No newline at end of file
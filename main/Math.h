@@ -18,27 +18,27 @@ namespace mathf
 	constexpr float Deg2Rad = PI / 180.0f;
 	constexpr float Rad2Deg = 180.0f / PI;
 
-	static float Clamp(float value, const float min, const float max)
+	inline float Clamp(float value, const float min, const float max)
 	{
 		value = max < value ? max : value;
 		value = min > value ? min : value;
 		return value;
 	}
 
-	static float Clamp01(float value)
+	inline float Clamp01(float value)
 	{
 		value = 1.0f < value ? 1.0f : value;
 		value = 0.0f > value ? 0.0f : value;
 		return value;
 	}
 
-	static float Lerp(const float start, const float end, float time)
+	inline float Lerp(const float start, const float end, float time)
 	{
 		time = Clamp01(time);
 		return (1 - time) * start + time * end;
 	}
 
-	static float Slerp(const float start, const float end, float time)
+	inline float Slerp(const float start, const float end, float time)
 	{
 		time = Clamp01(time);
 		return sinf((1.0f - time) * PIDIV2) * start + sinf(time * PI2) * end;
@@ -704,7 +704,6 @@ namespace quaternion
 		float xx = quat.x * quat.x;
 		float yy = quat.y * quat.y;
 		float zz = quat.z * quat.z;
-		float ww = quat.w * quat.w;
 
 		float xy = quat.x * quat.y;
 		float xz = quat.x * quat.z;
@@ -887,7 +886,27 @@ namespace quaternion
 		return mtx;
 	}
 
-	
+
+}
+
+namespace matrix
+{
+	// Scale * Rotation * Translation, built from the quaternion without multiplying matrices
+	inline Matrix TRS(const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+	{
+		Quaternion quat = rotation;
+		Matrix mtx = quaternion::ToMatrix(quat);
+
+		mtx.m[0][0] *= scale.x; mtx.m[0][1] *= scale.x; mtx.m[0][2] *= scale.x;
+		mtx.m[1][0] *= scale.y; mtx.m[1][1] *= scale.y; mtx.m[1][2] *= scale.y;
+		mtx.m[2][0] *= scale.z; mtx.m[2][1] *= scale.z; mtx.m[2][2] *= scale.z;
+
+		mtx.m[3][0] = position.x;
+		mtx.m[3][1] = position.y;
+		mtx.m[3][2] = position.z;
+
+		return mtx;
+	}
 }
 
 #include "MathVector.inl"
@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include "Mesh.h"
+#include "UploadQueue.h"
+
+#include <atomic>
+
+namespace
+{
+	std::atomic<uint32_t> gNextGeometryId(1);
+}
+
+Mesh::Mesh()
+	: mpMemory(nullptr)
+	, mVertexBuffer()
+	, mIndexBuffer()
+	, mVertexBufferView()
+	, mIndexBufferView()
+	, mIndexCount(0)
+	, mUploadTicket(0)
+	, mGeometryId(0)
+	, mBoundsCenter(0.0f, 0.0f, 0.0f)
+	, mBoundsExtents(0.0f, 0.0f, 0.0f)
+	, mBoundsRadius(0.0f)
+{
+
+}
+
+Mesh::~Mesh()
+{
+	Destroy();
+}
+
+HRESULT Mesh::Create(GpuMemoryAllocator* pMemory, UploadQueue* pUploadQueue, const Vertex3D* pVertices, UINT vertexCount, const UINT32* pIndices, UINT indexCount)
+{
+	const UINT vertexBufferSize = sizeof(Vertex3D) * vertexCount;
+	const UINT indexBufferSize = sizeof(UINT32) * indexCount;
+
+	computeBounds(pVertices, vertexCount);
+
+	mpMemory = pMemory;
+
+	HRESULT hr = createBuffer(pUploadQueue, pVertices, vertexBufferSize, &mVertexBuffer);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = createBuffer(pUploadQueue, pIndices, indexBufferSize, &mIndexBuffer);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// Initialize the vertex buffer view.
+	mVertexBufferView.BufferLocation = mVertexBuffer.resource->GetGPUVirtualAddress();
+	mVertexBufferView.StrideInBytes = sizeof(Vertex3D);
+	mVertexBufferView.SizeInBytes = vertexBufferSize;
+
+	mIndexBufferView.BufferLocation = mIndexBuffer.resource->GetGPUVirtualAddress();
+	mIndexBufferView.SizeInBytes = indexBufferSize;
+	mIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+
+	mIndexCount = indexCount;
+	mGeometryId = gNextGeometryId.fetch_add(1);
+	return S_OK;
+}
+
+void Mesh::Destroy()
+{
+	if (mpMemory != nullptr)
+	{
+		mpMemory->release(&mVertexBuffer);
+		mpMemory->release(&mIndexBuffer);
+		mpMemory = nullptr;
+	}
+	mVertexBufferView = {};
+	mIndexBufferView = {};
+	mIndexCount = 0;
+	mGeometryId = 0;
+}
+
+/// <summary>
+/// Placed GPU-only buffer whose contents are queued on the copy queue; mUploadTicket covers the newest copy.
+/// </summary>
+HRESULT Mesh::createBuffer(UploadQueue* pUploadQueue, const void* pData, UINT size, GpuAllocation* pBuffer)
+{
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Alignment = 0;
+	resDesc.Width = size;
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.SampleDesc.Quality = 0;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	// COMMON: the copy queue promotes it to COPY_DEST, draws promote it to the vertex and index states.
+	HRESULT hr = mpMemory->createResource(D3D12_HEAP_TYPE_DEFAULT, &resDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, pBuffer);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	mUploadTicket = pUploadQueue->upload(pBuffer->resource.Get(), 0, pData, size);
+	return S_OK;
+}
+
+/// <summary>
+/// AABB of the vertices, and the smallest sphere around its center containing them all.
+/// </summary>
+void Mesh::computeBounds(const Vertex3D* pVertices, UINT vertexCount)
+{
+	if (vertexCount == 0)
+	{
+		return;
+	}
+
+	XMVECTOR minimum = XMLoadFloat3(&pVertices[0].position);
+	XMVECTOR maximum = minimum;
+	for (UINT i = 1; i < vertexCount; ++i)
+	{
+		const XMVECTOR position = XMLoadFloat3(&pVertices[i].position);
+		minimum = XMVectorMin(minimum, position);
+		maximum = XMVectorMax(maximum, position);
+	}
+
+	const XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+	XMStoreFloat3(&mBoundsCenter, center);
+	XMStoreFloat3(&mBoundsExtents, XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f));
+
+	float radiusSq = 0.0f;
+	for (UINT i = 0; i < vertexCount; ++i)
+	{
+		const float lengthSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&pVertices[i].position), center)));
+		radiusSq = (lengthSq > radiusSq) ? lengthSq : radiusSq;
+	}
+	mBoundsRadius = sqrtf(radiusSq);
+}
@@ -0,0 +1,63 @@
+#ifndef __RENDERER_MESH_H__
+#define __RENDERER_MESH_H__
+
+#include "GpuMemoryAllocator.h"
+
+using namespace DirectX;
+using namespace Microsoft::WRL;
+
+class UploadQueue;
+
+struct Vertex3D
+{
+	XMFLOAT3 position;
+	XMFLOAT3 normal;
+	XMFLOAT2 texCoord;
+	XMFLOAT4 color;
+};
+
+// Vertex and index buffers shared by every GameObject drawn with it.
+// The buffers are placed in DEFAULT heaps of a GpuMemoryAllocator and filled through the copy queue.
+class Mesh
+{
+public:
+	Mesh();
+	~Mesh();
+
+	HRESULT Create(GpuMemoryAllocator* pMemory, UploadQueue* pUploadQueue, const Vertex3D* pVertices, UINT vertexCount, const UINT32* pIndices, UINT indexCount);
+	// Gives the buffers back to the allocator; go through Renderer::releaseMesh so cached draws are dropped first.
+	void Destroy();
+
+	const D3D12_VERTEX_BUFFER_VIEW& getVertexBufferView() const { return mVertexBufferView; }
+	const D3D12_INDEX_BUFFER_VIEW& getIndexBufferView() const { return mIndexBufferView; }
+	UINT getIndexCount() const { return mIndexCount; }
+	// UploadQueue ticket of the buffer contents; draws must not run before it completes.
+	uint64_t getUploadTicket() const { return mUploadTicket; }
+	// Unique to each Create call, so cached draws can tell the buffers were replaced.
+	uint32_t getGeometryId() const { return mGeometryId; }
+
+	// Local-space bounds of the vertices: an AABB and a sphere sharing its center
+	const XMFLOAT3& getBoundsCenter() const { return mBoundsCenter; }
+	const XMFLOAT3& getBoundsExtents() const { return mBoundsExtents; }
+	float getBoundsRadius() const { return mBoundsRadius; }
+
+private:
+	HRESULT createBuffer(UploadQueue* pUploadQueue, const void* pData, UINT size, GpuAllocation* pBuffer);
+	void computeBounds(const Vertex3D* pVertices, UINT vertexCount);
+
+	GpuMemoryAllocator* mpMemory;
+	GpuAllocation mVertexBuffer;
+	GpuAllocation mIndexBuffer;
+
+	D3D12_VERTEX_BUFFER_VIEW mVertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW mIndexBufferView;
+	UINT mIndexCount;
+	uint64_t mUploadTicket;
+	uint32_t mGeometryId;
+
+	XMFLOAT3 mBoundsCenter;
+	XMFLOAT3 mBoundsExtents;
+	float mBoundsRadius;
+};
+
+#endif
@@ -1,4 +1,3 @@
-#include "stdafx.h"
 #include "Object.h"
 
 GameObject::GameObject()
@@ -10,4 +9,5 @@ GameObject::GameObject()
 
 GameObject::~GameObject()
 {
+	delete mpTransform;
 }
@@ -0,0 +1,50 @@
+#include "ParallelCommandRecorder.h"
+
+ParallelCommandRecorder::ParallelCommandRecorder()
+	: mpPool(nullptr)
+	, mMaxRangeCount(1)
+	, mMinItemsPerRange(1)
+	, mHandles()
+	, mCloseResults()
+{
+
+}
+
+void ParallelCommandRecorder::initialize(CommandListPool* pPool, uint32_t maxRangeCount, uint32_t minItemsPerRange)
+{
+	mpPool = pPool;
+	mMaxRangeCount = (maxRangeCount > 0) ? maxRangeCount : 1;
+	mMinItemsPerRange = (minItemsPerRange > 0) ? minItemsPerRange : 1;
+}
+
+/// <summary>
+/// As many chunks as allowed while each keeps at least minItemsPerRange items,
+/// since every list costs its own state setup and submission.
+/// Always at least one, so an empty frame still gets a list.
+/// </summary>
+uint32_t ParallelCommandRecorder::ComputeRangeCount(uint32_t itemCount, uint32_t maxRangeCount, uint32_t minItemsPerRange)
+{
+	if (minItemsPerRange == 0)
+	{
+		minItemsPerRange = 1;
+	}
+
+	uint32_t rangeCount = itemCount / minItemsPerRange;
+	if (rangeCount > maxRangeCount)
+	{
+		rangeCount = maxRangeCount;
+	}
+	return (rangeCount > 0) ? rangeCount : 1;
+}
+
+int32_t ParallelCommandRecorder::getCloseResult() const
+{
+	for (int32_t result : mCloseResults)
+	{
+		if (result < 0)
+		{
+			return result;
+		}
+	}
+	return 0;
+}
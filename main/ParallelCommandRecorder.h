@@ -0,0 +1,78 @@
+#ifndef __RENDERER_PARALLELCOMMANDRECORDER_H__
+#define __RENDERER_PARALLELCOMMANDRECORDER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "CommandListPool.h"
+#include "JobSystem.h"
+
+// Splits a draw range into contiguous chunks recorded on the job system, one pooled command
+// list per chunk. The returned lists are in chunk order regardless of which worker finished
+// first, so submitting them in one ExecuteCommandLists preserves the draw order.
+class ParallelCommandRecorder
+{
+public:
+	ParallelCommandRecorder();
+
+	void initialize(CommandListPool* pPool, uint32_t maxRangeCount, uint32_t minItemsPerRange);
+
+	// Number of chunks [0, itemCount) is split into.
+	static uint32_t ComputeRangeCount(uint32_t itemCount, uint32_t maxRangeCount, uint32_t minItemsPerRange);
+
+	// Calls func(pHandle, begin, end) once per chunk with a list open for recording, and closes
+	// the list after it. func runs on workers and must not throw; the lists are acquired and the
+	// close results checked on the calling thread, see getCloseResult().
+	template<class Func>
+	const std::vector<void*>& record(uint32_t itemCount, const Func& func)
+	{
+		const uint32_t rangeCount = ComputeRangeCount(itemCount, mMaxRangeCount, mMinItemsPerRange);
+		mHandles.resize(rangeCount);
+		mCloseResults.resize(rangeCount);
+		for (uint32_t range = 0; range < rangeCount; ++range)
+		{
+			mHandles[range] = mpPool->acquire();
+		}
+
+		CommandListPool* pPool = mpPool;
+		void* const* ppHandles = mHandles.data();
+		int32_t* pCloseResults = mCloseResults.data();
+		auto recordRanges = [pPool, ppHandles, pCloseResults, itemCount, rangeCount, &func](uint32_t first, uint32_t last)
+		{
+			for (uint32_t range = first; range < last; ++range)
+			{
+				const uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * range / rangeCount);
+				const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * (range + 1) / rangeCount);
+
+				func(ppHandles[range], begin, end);
+				pCloseResults[range] = pPool->close(ppHandles[range]);
+			}
+		};
+
+		JobSystem* pJobSystem = JobSystem::getInstance();
+		if (pJobSystem != nullptr && rangeCount > 1)
+		{
+			pJobSystem->parallelFor(rangeCount, 1, recordRanges);
+		}
+		else
+		{
+			recordRanges(0, rangeCount);
+		}
+
+		return mHandles;
+	}
+
+	// First failed close of the last record(), or 0 (S_OK) when every list closed.
+	int32_t getCloseResult() const;
+
+private:
+	CommandListPool* mpPool;
+	uint32_t mMaxRangeCount;
+	uint32_t mMinItemsPerRange;
+
+	std::vector<void*> mHandles;
+	// HRESULT of closing each list, written by the worker that recorded it
+	std::vector<int32_t> mCloseResults;
+};
+
+#endif
@@ -0,0 +1,249 @@
+#include "PipelineCacheFile.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	template<class T>
+	void Write(std::vector<uint8_t>& out, const T& value)
+	{
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+		out.insert(out.end(), pBytes, pBytes + sizeof(T));
+	}
+
+	// Sequential reads that fail once the data runs out.
+	class Reader
+	{
+	public:
+		Reader(const uint8_t* pData, size_t size) : mpData(pData), mRemaining(size) {}
+
+		template<class T>
+		bool read(T* pValue)
+		{
+			return read(pValue, sizeof(T));
+		}
+
+		bool read(void* pOut, size_t size)
+		{
+			if (size > mRemaining)
+			{
+				return false;
+			}
+			memcpy(pOut, mpData, size);
+			mpData += size;
+			mRemaining -= size;
+			return true;
+		}
+
+		const uint8_t* skip(size_t size)
+		{
+			if (size > mRemaining)
+			{
+				return nullptr;
+			}
+			const uint8_t* pBegin = mpData;
+			mpData += size;
+			mRemaining -= size;
+			return pBegin;
+		}
+
+	private:
+		const uint8_t* mpData;
+		size_t mRemaining;
+	};
+
+	bool ReadFingerprint(Reader& reader, PipelineCacheFingerprint* pOut)
+	{
+		return reader.read(&pOut->vendorId)
+			&& reader.read(&pOut->deviceId)
+			&& reader.read(&pOut->subSysId)
+			&& reader.read(&pOut->revision)
+			&& reader.read(&pOut->driverVersion)
+			&& reader.read(&pOut->applicationVersion);
+	}
+
+	void WriteFingerprint(std::vector<uint8_t>& out, const PipelineCacheFingerprint& fingerprint)
+	{
+		Write(out, fingerprint.vendorId);
+		Write(out, fingerprint.deviceId);
+		Write(out, fingerprint.subSysId);
+		Write(out, fingerprint.revision);
+		Write(out, fingerprint.driverVersion);
+		Write(out, fingerprint.applicationVersion);
+	}
+
+	uint64_t Checksum(const uint8_t* pData, size_t size)
+	{
+		return Hasher().add(pData, size).getHash();
+	}
+}
+
+const uint32_t PipelineCacheFile::Magic;
+const uint32_t PipelineCacheFile::FormatVersion;
+
+bool PipelineCacheFingerprint::operator==(const PipelineCacheFingerprint& other) const
+{
+	return vendorId == other.vendorId
+		&& deviceId == other.deviceId
+		&& subSysId == other.subSysId
+		&& revision == other.revision
+		&& driverVersion == other.driverVersion
+		&& applicationVersion == other.applicationVersion;
+}
+
+PipelineCacheFile::PipelineCacheFile()
+	: mFingerprint()
+	, mEntries()
+	, mUsedKeys()
+	, mIsDirty(false)
+{
+
+}
+
+PipelineCacheFile::~PipelineCacheFile()
+{
+
+}
+
+PipelineCacheFile::LoadResult PipelineCacheFile::deserialize(const uint8_t* pData, size_t size)
+{
+	mEntries.clear();
+	mUsedKeys.clear();
+	mIsDirty = true;
+
+	Reader reader(pData, size);
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	if (!reader.read(&magic) || magic != Magic || !reader.read(&version))
+	{
+		return InvalidHeader;
+	}
+	if (version != FormatVersion)
+	{
+		return VersionMismatch;
+	}
+
+	PipelineCacheFingerprint fingerprint;
+	uint32_t entryCount = 0;
+	if (!ReadFingerprint(reader, &fingerprint) || !reader.read(&entryCount))
+	{
+		return InvalidHeader;
+	}
+	if (fingerprint != mFingerprint)
+	{
+		return FingerprintMismatch;
+	}
+
+	bool isDamaged = false;
+	for (uint32_t i = 0; i < entryCount; ++i)
+	{
+		uint64_t key = 0;
+		uint64_t checksum = 0;
+		uint32_t blobSize = 0;
+		const uint8_t* pBlob = nullptr;
+		if (!reader.read(&key) || !reader.read(&checksum) || !reader.read(&blobSize)
+			|| (pBlob = reader.skip(blobSize)) == nullptr)
+		{
+			// Truncated; nothing after this point can be trusted.
+			isDamaged = true;
+			break;
+		}
+
+		if (Checksum(pBlob, blobSize) != checksum)
+		{
+			isDamaged = true;
+			continue;
+		}
+
+		mEntries[key].assign(pBlob, pBlob + blobSize);
+	}
+
+	mIsDirty = isDamaged;
+	return isDamaged ? Damaged : Loaded;
+}
+
+void PipelineCacheFile::serialize(std::vector<uint8_t>& out) const
+{
+	std::vector<uint64_t> keys;
+	keys.reserve(mEntries.size());
+	for (const auto& entry : mEntries)
+	{
+		keys.push_back(entry.first);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	out.clear();
+	Write(out, Magic);
+	Write(out, FormatVersion);
+	WriteFingerprint(out, mFingerprint);
+	Write(out, static_cast<uint32_t>(keys.size()));
+
+	for (uint64_t key : keys)
+	{
+		const std::vector<uint8_t>& blob = mEntries.find(key)->second;
+		Write(out, key);
+		Write(out, Checksum(blob.data(), blob.size()));
+		Write(out, static_cast<uint32_t>(blob.size()));
+		out.insert(out.end(), blob.begin(), blob.end());
+	}
+}
+
+const std::vector<uint8_t>* PipelineCacheFile::find(uint64_t key) const
+{
+	auto it = mEntries.find(key);
+	return (it != mEntries.end()) ? &it->second : nullptr;
+}
+
+void PipelineCacheFile::store(uint64_t key, const void* pData, size_t size)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	mEntries[key].assign(pBytes, pBytes + size);
+	mUsedKeys.insert(key);
+	mIsDirty = true;
+}
+
+bool PipelineCacheFile::remove(uint64_t key)
+{
+	mUsedKeys.erase(key);
+	if (mEntries.erase(key) == 0)
+	{
+		return false;
+	}
+	mIsDirty = true;
+	return true;
+}
+
+void PipelineCacheFile::clear()
+{
+	if (!mEntries.empty())
+	{
+		mIsDirty = true;
+	}
+	mEntries.clear();
+	mUsedKeys.clear();
+}
+
+uint32_t PipelineCacheFile::removeUnused()
+{
+	uint32_t removedCount = 0;
+	for (auto it = mEntries.begin(); it != mEntries.end();)
+	{
+		if (mUsedKeys.count(it->first) == 0)
+		{
+			it = mEntries.erase(it);
+			++removedCount;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	if (removedCount > 0)
+	{
+		mIsDirty = true;
+	}
+	return removedCount;
+}
@@ -0,0 +1,88 @@
+#ifndef __RENDERER_PIPELINECACHEFILE_H__
+#define __RENDERER_PIPELINECACHEFILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Identifies the driver a cache was written for. Cached pipeline blobs are only valid
+// for the same adapter and driver, and for the same revision of the application's pipelines.
+struct PipelineCacheFingerprint
+{
+	uint32_t vendorId;
+	uint32_t deviceId;
+	uint32_t subSysId;
+	uint32_t revision;
+	uint64_t driverVersion;
+	// Bumped by the application to throw away every cached pipeline
+	uint64_t applicationVersion;
+
+	bool operator==(const PipelineCacheFingerprint& other) const;
+	bool operator!=(const PipelineCacheFingerprint& other) const { return !(*this == other); }
+};
+
+// In-memory image of the on-disk pipeline cache: blobs keyed by pipeline description hash.
+// Knows nothing about D3D12, the file layout is
+//
+//   uint32 magic, uint32 format version, fingerprint, uint32 entry count
+//   per entry: uint64 key, uint64 blob checksum, uint32 blob size, blob bytes
+//
+// A file written by another format version or for another fingerprint is discarded as a whole.
+// An entry whose checksum does not match is dropped; a truncated file keeps the entries before the cut.
+// Entries no pipeline asked for since loading can be pruned before saving, so the file does not
+// keep growing with pipelines the application stopped creating.
+class PipelineCacheFile
+{
+public:
+	static const uint32_t Magic = 0x434f5350; // "PSOC"
+	static const uint32_t FormatVersion = 1;
+
+	enum LoadResult
+	{
+		Loaded,
+		// Some entries were dropped, the rest loaded
+		Damaged,
+		// Nothing loaded
+		InvalidHeader,
+		VersionMismatch,
+		FingerprintMismatch,
+	};
+
+	PipelineCacheFile();
+	~PipelineCacheFile();
+
+	void setFingerprint(const PipelineCacheFingerprint& fingerprint) { mFingerprint = fingerprint; }
+	const PipelineCacheFingerprint& getFingerprint() const { return mFingerprint; }
+
+	// Replaces the entries with the ones in pData. Anything not Loaded marks the cache dirty,
+	// so the next save rewrites the file.
+	LoadResult deserialize(const uint8_t* pData, size_t size);
+	// Entries are written in key order, so the same contents always give the same bytes.
+	void serialize(std::vector<uint8_t>& out) const;
+
+	const std::vector<uint8_t>* find(uint64_t key) const;
+	void store(uint64_t key, const void* pData, size_t size);
+	bool remove(uint64_t key);
+	void clear();
+
+	// Records that key was requested; store() does so too.
+	void markUsed(uint64_t key) { mUsedKeys.insert(key); }
+	// Drops the entries not marked since the last deserialize / clear and returns how many.
+	uint32_t removeUnused();
+
+	uint32_t size() const { return static_cast<uint32_t>(mEntries.size()); }
+
+	// Set by any change since the last deserialize / clearDirty
+	bool isDirty() const { return mIsDirty; }
+	void clearDirty() { mIsDirty = false; }
+
+private:
+	PipelineCacheFingerprint mFingerprint;
+	std::unordered_map<uint64_t, std::vector<uint8_t>> mEntries;
+	std::unordered_set<uint64_t> mUsedKeys;
+	bool mIsDirty;
+};
+
+#endif
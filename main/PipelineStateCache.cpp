@@ -0,0 +1,183 @@
+#include "stdafx.h"
+#include "PipelineStateCache.h"
+#include "PipelineStateKey.h"
+
+#include <cstdio>
+#include <io.h>
+#include <vector>
+
+namespace
+{
+	bool ReadBinaryFile(const std::wstring& path, std::vector<uint8_t>& out)
+	{
+		FILE* file = nullptr;
+		if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || file == nullptr)
+		{
+			return false;
+		}
+
+		const long size = _filelength(_fileno(file));
+		bool isRead = false;
+		if (size >= 0)
+		{
+			out.resize(static_cast<size_t>(size));
+			isRead = fread(out.data(), 1, out.size(), file) == out.size();
+		}
+		fclose(file);
+		return isRead;
+	}
+
+	bool WriteBinaryFile(const std::wstring& path, const std::vector<uint8_t>& data)
+	{
+		FILE* file = nullptr;
+		if (_wfopen_s(&file, path.c_str(), L"wb") != 0 || file == nullptr)
+		{
+			return false;
+		}
+
+		const bool isWritten = fwrite(data.data(), 1, data.size(), file) == data.size();
+		return (fclose(file) == 0) && isWritten;
+	}
+}
+
+PipelineStateCache::PipelineStateCache()
+	: mDevice()
+	, mPath()
+	, mMutex()
+	, mFile()
+	, mHitCount(0)
+	, mMissCount(0)
+{
+
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+
+}
+
+/// <summary>
+/// The fingerprint pins the cache to the adapter and its user-mode driver version,
+/// so a driver update discards the file instead of feeding the driver stale blobs.
+/// </summary>
+void PipelineStateCache::initialize(ID3D12Device* pDevice, IDXGIAdapter* pAdapter, const std::wstring& path)
+{
+	mDevice = pDevice;
+	mPath = path;
+
+	DXGI_ADAPTER_DESC adapterDesc{};
+	pAdapter->GetDesc(&adapterDesc);
+
+	LARGE_INTEGER driverVersion{};
+	pAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+
+	PipelineCacheFingerprint fingerprint;
+	fingerprint.vendorId = adapterDesc.VendorId;
+	fingerprint.deviceId = adapterDesc.DeviceId;
+	fingerprint.subSysId = adapterDesc.SubSysId;
+	fingerprint.revision = adapterDesc.Revision;
+	fingerprint.driverVersion = static_cast<uint64_t>(driverVersion.QuadPart);
+	fingerprint.applicationVersion = ApplicationVersion;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFile.clear();
+	mFile.setFingerprint(fingerprint);
+
+	std::vector<uint8_t> data;
+	if (ReadBinaryFile(mPath, data))
+	{
+		// Anything but a clean load stays dirty, so the next save replaces the file
+		if (mFile.deserialize(data.data(), data.size()) == PipelineCacheFile::Loaded)
+		{
+			mFile.clearDirty();
+		}
+		else
+		{
+			OutputDebugStringA("PipelineStateCache: cache file is stale or damaged, rebuilding\n");
+		}
+	}
+}
+
+/// <summary>
+/// Pipelines not requested during this run are dropped first, so the file only holds what the application still creates.
+/// Writes to a temporary file first, so a crash while saving never leaves a half-written cache behind.
+/// </summary>
+HRESULT PipelineStateCache::save()
+{
+	std::vector<uint8_t> data;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFile.removeUnused();
+		if (!mFile.isDirty())
+		{
+			return S_OK;
+		}
+		mFile.serialize(data);
+		mFile.clearDirty();
+	}
+
+	const std::wstring temporaryPath = mPath + L".tmp";
+	if (!WriteBinaryFile(temporaryPath, data))
+	{
+		return E_FAIL;
+	}
+	if (!MoveFileExW(temporaryPath.c_str(), mPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+	return S_OK;
+}
+
+HRESULT PipelineStateCache::createGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** ppPipelineState)
+{
+	const uint64_t key = HashGraphicsPipelineDesc(desc, rootSignatureHash);
+
+	std::vector<uint8_t> cachedBlob;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFile.markUsed(key);
+		const std::vector<uint8_t>* pBlob = mFile.find(key);
+		if (pBlob != nullptr)
+		{
+			cachedBlob = *pBlob;
+		}
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC cachedDesc = desc;
+	if (!cachedBlob.empty())
+	{
+		cachedDesc.CachedPSO.pCachedBlob = cachedBlob.data();
+		cachedDesc.CachedPSO.CachedBlobSizeInBytes = cachedBlob.size();
+		if (SUCCEEDED(mDevice->CreateGraphicsPipelineState(&cachedDesc, IID_PPV_ARGS(ppPipelineState))))
+		{
+			mHitCount++;
+			return S_OK;
+		}
+
+		// D3D12_ERROR_DRIVER_VERSION_MISMATCH, D3D12_ERROR_ADAPTER_NOT_FOUND, or a blob
+		// that does not match the description after all. Drop it and compile from scratch.
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFile.remove(key);
+	}
+
+	cachedDesc.CachedPSO.pCachedBlob = nullptr;
+	cachedDesc.CachedPSO.CachedBlobSizeInBytes = 0;
+
+	ComPtr<ID3D12PipelineState> pipelineState;
+	HRESULT hr = mDevice->CreateGraphicsPipelineState(&cachedDesc, IID_PPV_ARGS(&pipelineState));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	mMissCount++;
+
+	ComPtr<ID3DBlob> blob;
+	if (SUCCEEDED(pipelineState->GetCachedBlob(&blob)))
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFile.store(key, blob->GetBufferPointer(), blob->GetBufferSize());
+	}
+
+	*ppPipelineState = pipelineState.Detach();
+	return S_OK;
+}
@@ -0,0 +1,45 @@
+#ifndef __RENDERER_PIPELINESTATECACHE_H__
+#define __RENDERER_PIPELINESTATECACHE_H__
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "PipelineCacheFile.h"
+
+using namespace Microsoft::WRL;
+
+// Creates graphics pipelines from driver blobs cached on disk by a previous run,
+// keyed by HashGraphicsPipelineDesc. Safe to call from several threads.
+class PipelineStateCache
+{
+public:
+	// Bump to throw away every cached pipeline, e.g. when the way descriptions are built changes
+	static const uint64_t ApplicationVersion = 1;
+
+	PipelineStateCache();
+	~PipelineStateCache();
+
+	// Loads path when it was written for this adapter and driver; otherwise starts empty.
+	void initialize(ID3D12Device* pDevice, IDXGIAdapter* pAdapter, const std::wstring& path);
+	// Drops pipelines not requested this run, then writes the file back when anything changed since it was loaded.
+	HRESULT save();
+
+	// Uses the cached blob when there is one, falling back to a full compile when the driver rejects it.
+	HRESULT createGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** ppPipelineState);
+
+	uint32_t getHitCount() const { return mHitCount; }
+	uint32_t getMissCount() const { return mMissCount; }
+
+private:
+	ComPtr<ID3D12Device> mDevice;
+	std::wstring mPath;
+
+	std::mutex mMutex;
+	PipelineCacheFile mFile;
+
+	std::atomic<uint32_t> mHitCount;
+	std::atomic<uint32_t> mMissCount;
+};
+
+#endif
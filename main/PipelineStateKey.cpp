@@ -0,0 +1,136 @@
+#include "PipelineStateKey.h"
+#include "Hash.h"
+
+namespace
+{
+	void AddBytecode(Hasher& hasher, const D3D12_SHADER_BYTECODE& bytecode)
+	{
+		const uint64_t length = (bytecode.pShaderBytecode != nullptr) ? bytecode.BytecodeLength : 0;
+		hasher.add(length);
+		if (length > 0)
+		{
+			hasher.add(bytecode.pShaderBytecode, static_cast<size_t>(length));
+		}
+	}
+
+	// Field by field: RenderTargetWriteMask is followed by padding.
+	void AddRenderTargetBlend(Hasher& hasher, const D3D12_RENDER_TARGET_BLEND_DESC& desc)
+	{
+		hasher.add(desc.BlendEnable);
+		hasher.add(desc.LogicOpEnable);
+		hasher.add(desc.SrcBlend);
+		hasher.add(desc.DestBlend);
+		hasher.add(desc.BlendOp);
+		hasher.add(desc.SrcBlendAlpha);
+		hasher.add(desc.DestBlendAlpha);
+		hasher.add(desc.BlendOpAlpha);
+		hasher.add(desc.LogicOp);
+		hasher.add(desc.RenderTargetWriteMask);
+	}
+
+	void AddStencilOp(Hasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& op)
+	{
+		hasher.add(op.StencilFailOp);
+		hasher.add(op.StencilDepthFailOp);
+		hasher.add(op.StencilPassOp);
+		hasher.add(op.StencilFunc);
+	}
+
+	// Field by field: the two UINT8 masks are followed by padding.
+	void AddDepthStencil(Hasher& hasher, const D3D12_DEPTH_STENCIL_DESC& desc)
+	{
+		hasher.add(desc.DepthEnable);
+		hasher.add(desc.DepthWriteMask);
+		hasher.add(desc.DepthFunc);
+		hasher.add(desc.StencilEnable);
+		hasher.add(desc.StencilReadMask);
+		hasher.add(desc.StencilWriteMask);
+		AddStencilOp(hasher, desc.FrontFace);
+		AddStencilOp(hasher, desc.BackFace);
+	}
+
+	void AddStreamOutput(Hasher& hasher, const D3D12_STREAM_OUTPUT_DESC& desc)
+	{
+		const UINT entryCount = (desc.pSODeclaration != nullptr) ? desc.NumEntries : 0;
+		hasher.add(entryCount);
+		for (UINT i = 0; i < entryCount; ++i)
+		{
+			const D3D12_SO_DECLARATION_ENTRY& entry = desc.pSODeclaration[i];
+			hasher.add(entry.Stream);
+			hasher.addString(entry.SemanticName);
+			hasher.add(entry.SemanticIndex);
+			hasher.add(entry.StartComponent);
+			hasher.add(entry.ComponentCount);
+			hasher.add(entry.OutputSlot);
+		}
+
+		const UINT strideCount = (desc.pBufferStrides != nullptr) ? desc.NumStrides : 0;
+		hasher.add(strideCount);
+		if (strideCount > 0)
+		{
+			hasher.add(desc.pBufferStrides, strideCount * sizeof(UINT));
+		}
+		hasher.add(desc.RasterizedStream);
+	}
+
+	void AddInputLayout(Hasher& hasher, const D3D12_INPUT_LAYOUT_DESC& desc)
+	{
+		const UINT elementCount = (desc.pInputElementDescs != nullptr) ? desc.NumElements : 0;
+		hasher.add(elementCount);
+		for (UINT i = 0; i < elementCount; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = desc.pInputElementDescs[i];
+			hasher.addString(element.SemanticName);
+			hasher.add(element.SemanticIndex);
+			hasher.add(element.Format);
+			hasher.add(element.InputSlot);
+			hasher.add(element.AlignedByteOffset);
+			hasher.add(element.InputSlotClass);
+			hasher.add(element.InstanceDataStepRate);
+		}
+	}
+}
+
+/// <summary>
+/// Pointers are followed and hashed by contents; structures with padding are hashed field by field.
+/// Unused render target slots are skipped, so garbage left in them does not change the key.
+/// </summary>
+uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+	Hasher hasher;
+	hasher.add(rootSignatureHash);
+
+	AddBytecode(hasher, desc.VS);
+	AddBytecode(hasher, desc.PS);
+	AddBytecode(hasher, desc.DS);
+	AddBytecode(hasher, desc.HS);
+	AddBytecode(hasher, desc.GS);
+	AddStreamOutput(hasher, desc.StreamOutput);
+
+	const UINT renderTargetCount = (desc.NumRenderTargets < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT)
+		? desc.NumRenderTargets : D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT;
+
+	hasher.add(desc.BlendState.AlphaToCoverageEnable);
+	hasher.add(desc.BlendState.IndependentBlendEnable);
+	const UINT blendCount = desc.BlendState.IndependentBlendEnable ? renderTargetCount : 1;
+	for (UINT i = 0; i < blendCount; ++i)
+	{
+		AddRenderTargetBlend(hasher, desc.BlendState.RenderTarget[i]);
+	}
+
+	hasher.add(desc.SampleMask);
+	hasher.add(desc.RasterizerState);
+	AddDepthStencil(hasher, desc.DepthStencilState);
+	AddInputLayout(hasher, desc.InputLayout);
+	hasher.add(desc.IBStripCutValue);
+	hasher.add(desc.PrimitiveTopologyType);
+
+	hasher.add(renderTargetCount);
+	hasher.add(desc.RTVFormats, renderTargetCount * sizeof(DXGI_FORMAT));
+	hasher.add(desc.DSVFormat);
+	hasher.add(desc.SampleDesc);
+	hasher.add(desc.NodeMask);
+	hasher.add(desc.Flags);
+
+	return hasher.getHash();
+}
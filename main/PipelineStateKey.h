@@ -0,0 +1,15 @@
+#ifndef __RENDERER_PIPELINESTATEKEY_H__
+#define __RENDERER_PIPELINESTATEKEY_H__
+
+#include <cstdint>
+#include <d3d12.h>
+
+// Key of a graphics pipeline in the pipeline cache. Covers everything a compiled pipeline depends on:
+// shader bytecode, stream output, blend / rasterizer / depth-stencil state, input layout,
+// topology, render target and depth formats, sample description, node mask and flags.
+//
+// pRootSignature and CachedPSO are ignored; the root signature is identified by rootSignatureHash,
+// a hash of its serialized blob, because its address is not stable between runs.
+uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+#endif
@@ -0,0 +1,299 @@
+#include "Profiler.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+DEFINE_SIGLETON(Profiler);
+
+std::atomic<bool> Profiler::sIsEnabled(false);
+
+namespace
+{
+	// Ring of the calling thread, set on its first zone
+	thread_local ProfileEventRing* tEventRing = nullptr;
+
+	// Shortest span the tick rate is measured over
+	const int64_t MinCalibrationTime = 10 * 1000 * 1000;
+
+	int64_t GetSteadyTime()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void AppendJsonString(std::string* pOut, const char* text)
+	{
+		pOut->push_back('"');
+		for (const char* c = text; *c != '\0'; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				pOut->push_back('\\');
+				pOut->push_back(*c);
+			}
+			else if (static_cast<unsigned char>(*c) < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*c));
+				pOut->append(escaped);
+			}
+			else
+			{
+				pOut->push_back(*c);
+			}
+		}
+		pOut->push_back('"');
+	}
+}
+
+ProfileEventRing::ProfileEventRing()
+	: mWrite(0)
+	, mWritePadding()
+	, mRead(0)
+	, mReadPadding()
+	, mDroppedCount(0)
+	, mEvents(new ProfileEvent[Capacity])
+{
+
+}
+
+uint32_t ProfileEventRing::drain(std::vector<ProfileEvent>* pOut)
+{
+	const uint32_t read = mRead.load(std::memory_order_relaxed);
+	const uint32_t write = mWrite.load(std::memory_order_acquire);
+	for (uint32_t i = read; i != write; ++i)
+	{
+		pOut->push_back(mEvents[i & Mask]);
+	}
+	mRead.store(write, std::memory_order_release);
+	return write - read;
+}
+
+Profiler::Profiler()
+	: mThreadMutex()
+	, mThreads()
+	, mDrained()
+	, mCapture()
+	, mCaptureLimit(4 * 1024 * 1024)
+	, mCaptureDroppedCount(0)
+	, mEpochTimestamp(GetTimestamp())
+	, mEpochTime(GetSteadyTime())
+	, mTicksPerMicrosecond(1000.0)
+{
+
+}
+
+Profiler::~Profiler()
+{
+	sIsEnabled.store(false);
+}
+
+/// <summary>
+/// Slow path on a thread's first zone only: the ring is created under the lock and cached in a thread_local.
+/// </summary>
+void Profiler::Record(const ProfileZone* pZone, uint64_t begin, uint64_t end)
+{
+	ProfileEventRing* pRing = tEventRing;
+	if (pRing == nullptr)
+	{
+		Profiler* pProfiler = getInstance();
+		if (pProfiler == nullptr)
+		{
+			return;
+		}
+		pRing = &pProfiler->registerThread()->ring;
+	}
+	pRing->push(pZone, begin, end);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	Profiler* pProfiler = getInstance();
+	if (pProfiler == nullptr)
+	{
+		return;
+	}
+
+	ThreadState* pThread = pProfiler->registerThread();
+	std::lock_guard<std::mutex> lock(pProfiler->mThreadMutex);
+	pThread->name = name;
+}
+
+ProfileEventRing* Profiler::addSteadyTrack(const char* name)
+{
+	ThreadState* pTrack = createThreadState();
+	std::lock_guard<std::mutex> lock(mThreadMutex);
+	pTrack->name = name;
+	pTrack->isSteadyTime = true;
+	return &pTrack->ring;
+}
+
+void Profiler::setEnabled(bool isEnabled)
+{
+	sIsEnabled.store(isEnabled);
+}
+
+void Profiler::collect()
+{
+	std::lock_guard<std::mutex> lock(mThreadMutex);
+	for (const std::unique_ptr<ThreadState>& pThread : mThreads)
+	{
+		mDrained.clear();
+		pThread->ring.drain(&mDrained);
+
+		for (const ProfileEvent& event : mDrained)
+		{
+			if (mCapture.size() >= mCaptureLimit)
+			{
+				++mCaptureDroppedCount;
+				continue;
+			}
+
+			CapturedEvent captured;
+			captured.event = event;
+			captured.threadIndex = pThread->index;
+			mCapture.push_back(captured);
+		}
+	}
+}
+
+void Profiler::clear()
+{
+	mCapture.clear();
+	mCaptureDroppedCount = 0;
+}
+
+uint64_t Profiler::getDroppedCount() const
+{
+	std::lock_guard<std::mutex> lock(mThreadMutex);
+	uint64_t droppedCount = mCaptureDroppedCount;
+	for (const std::unique_ptr<ThreadState>& pThread : mThreads)
+	{
+		droppedCount += pThread->ring.getDroppedCount();
+	}
+	return droppedCount;
+}
+
+double Profiler::toMicroseconds(uint64_t timestamp) const
+{
+	return static_cast<double>(static_cast<int64_t>(timestamp - mEpochTimestamp)) / mTicksPerMicrosecond;
+}
+
+double Profiler::steadyToMicroseconds(int64_t steadyTime) const
+{
+	return static_cast<double>(steadyTime - mEpochTime) / 1000.0;
+}
+
+/// <summary>
+/// Complete ("X") events with ts / dur in microseconds, and a thread_name metadata event per thread.
+/// </summary>
+std::string Profiler::exportChromeTrace()
+{
+	calibrate();
+
+	std::string json;
+	json.reserve(mCapture.size() * 96 + 256);
+	json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	char buffer[128];
+	bool isFirst = true;
+	std::vector<bool> isSteadyTime;
+	{
+		std::lock_guard<std::mutex> lock(mThreadMutex);
+		for (const std::unique_ptr<ThreadState>& pThread : mThreads)
+		{
+			isSteadyTime.push_back(pThread->isSteadyTime);
+
+			snprintf(buffer, sizeof(buffer), "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", isFirst ? "" : ",\n", pThread->index);
+			json.append(buffer);
+			AppendJsonString(&json, pThread->name.c_str());
+			json.append("}}");
+			isFirst = false;
+		}
+	}
+
+	for (const CapturedEvent& captured : mCapture)
+	{
+		const ProfileEvent& event = captured.event;
+		json.append(isFirst ? "" : ",\n");
+		json.append("{\"ph\":\"X\",\"pid\":1,\"name\":");
+		AppendJsonString(&json, event.pZone->name);
+		if (isSteadyTime[captured.threadIndex])
+		{
+			snprintf(buffer, sizeof(buffer), ",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				captured.threadIndex, steadyToMicroseconds(static_cast<int64_t>(event.begin)), static_cast<double>(event.end - event.begin) / 1000.0);
+		}
+		else
+		{
+			snprintf(buffer, sizeof(buffer), ",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				captured.threadIndex, toMicroseconds(event.begin), static_cast<double>(event.end - event.begin) / mTicksPerMicrosecond);
+		}
+		json.append(buffer);
+		isFirst = false;
+	}
+
+	json.append("\n]}\n");
+	return json;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	const std::string json = exportChromeTrace();
+	file.write(json.data(), json.size());
+	return file.good();
+}
+
+Profiler::ThreadState* Profiler::registerThread()
+{
+	if (tEventRing != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(mThreadMutex);
+		for (const std::unique_ptr<ThreadState>& pThread : mThreads)
+		{
+			if (&pThread->ring == tEventRing)
+			{
+				return pThread.get();
+			}
+		}
+	}
+
+	ThreadState* pThread = createThreadState();
+	tEventRing = &pThread->ring;
+	return pThread;
+}
+
+Profiler::ThreadState* Profiler::createThreadState()
+{
+	std::lock_guard<std::mutex> lock(mThreadMutex);
+	ThreadState* pThread = new ThreadState();
+	pThread->index = static_cast<uint32_t>(mThreads.size());
+	pThread->name = "Thread " + std::to_string(pThread->index);
+	pThread->isSteadyTime = false;
+	mThreads.emplace_back(pThread);
+	return pThread;
+}
+
+/// <summary>
+/// TSC ticks per microsecond over the whole run, which averages out the error of both clocks.
+/// Waits when too little time has passed to measure it precisely.
+/// </summary>
+void Profiler::calibrate()
+{
+#if defined(PROFILE_USE_TSC)
+	int64_t elapsedTime = GetSteadyTime() - mEpochTime;
+	while (elapsedTime < MinCalibrationTime)
+	{
+		std::this_thread::yield();
+		elapsedTime = GetSteadyTime() - mEpochTime;
+	}
+
+	const uint64_t elapsedTicks = GetTimestamp() - mEpochTimestamp;
+	mTicksPerMicrosecond = static_cast<double>(elapsedTicks) * 1000.0 / static_cast<double>(elapsedTime);
+#endif
+}
@@ -0,0 +1,209 @@
+#ifndef __CORE_PROFILER_H__
+#define __CORE_PROFILER_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Singleton.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PROFILE_USE_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Where a zone is declared. One per PROFILE_ZONE, with static storage, so events only carry a pointer.
+struct ProfileZone
+{
+	const char* name;
+	const char* file;
+	uint32_t line;
+};
+
+struct ProfileEvent
+{
+	const ProfileZone* pZone;
+	uint64_t begin;
+	uint64_t end;
+};
+
+// Events of one thread, written by that thread only and drained by Profiler::collect.
+// Single producer, single consumer; when the consumer falls behind, new events are dropped.
+class ProfileEventRing
+{
+public:
+	static const uint32_t Capacity = 1 << 14;
+
+	ProfileEventRing();
+
+	void push(const ProfileZone* pZone, uint64_t begin, uint64_t end)
+	{
+		const uint32_t write = mWrite.load(std::memory_order_relaxed);
+		if (write - mRead.load(std::memory_order_acquire) >= Capacity)
+		{
+			mDroppedCount.store(mDroppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return;
+		}
+
+		ProfileEvent& event = mEvents[write & Mask];
+		event.pZone = pZone;
+		event.begin = begin;
+		event.end = end;
+		mWrite.store(write + 1, std::memory_order_release);
+	}
+
+	// Consumer side. Appends the events pushed so far to pOut and returns how many.
+	uint32_t drain(std::vector<ProfileEvent>* pOut);
+	uint32_t getDroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
+private:
+	static const uint32_t Mask = Capacity - 1;
+	static const size_t CacheLineSize = 64;
+
+	// Producer and consumer indices on separate cache lines.
+	// Padding instead of alignas, since the ring is heap allocated.
+	std::atomic<uint32_t> mWrite;
+	char mWritePadding[CacheLineSize - sizeof(std::atomic<uint32_t>)];
+	std::atomic<uint32_t> mRead;
+	char mReadPadding[CacheLineSize - sizeof(std::atomic<uint32_t>)];
+	std::atomic<uint32_t> mDroppedCount;
+	std::unique_ptr<ProfileEvent[]> mEvents;
+};
+
+// Scoped CPU zones from any thread, exported as a Chrome trace (chrome://tracing, Perfetto).
+// A zone costs two timestamps and a push to the calling thread's ring; nothing is locked or
+// allocated after the thread's first zone. Timestamps are TSC ticks where the CPU has one,
+// converted to time against steady_clock only when exported.
+//
+// Create before and destroy after every profiled thread; threads keep a pointer to their ring.
+class Profiler final : public Common::Singleton<Profiler>
+{
+public:
+	Profiler();
+	virtual ~Profiler();
+
+	static uint64_t GetTimestamp();
+	static bool IsEnabled() { return sIsEnabled.load(std::memory_order_relaxed); }
+	// Pushes a finished zone to the calling thread's ring, registering the thread on first use.
+	static void Record(const ProfileZone* pZone, uint64_t begin, uint64_t end);
+	// Name of the calling thread in the trace
+	static void SetThreadName(const char* name);
+
+	// Track for events not timed by a CPU thread, e.g. GPU work converted to CPU time. Its events are
+	// steady_clock nanoseconds, pushed by one thread at a time. Lives as long as the profiler.
+	ProfileEventRing* addSteadyTrack(const char* name);
+
+	void setEnabled(bool isEnabled);
+	// Events kept by collect(); later ones are counted as dropped.
+	void setCaptureLimit(size_t maxEventCount) { mCaptureLimit = maxEventCount; }
+
+	// Moves the events of every thread into the capture. Call regularly, e.g. once per frame,
+	// or the rings fill up. One thread at a time.
+	void collect();
+	void clear();
+
+	size_t getEventCount() const { return mCapture.size(); }
+	uint64_t getDroppedCount() const;
+
+	// Microseconds since the profiler was created
+	double toMicroseconds(uint64_t timestamp) const;
+	// Same clock as std::chrono::steady_clock, in nanoseconds since its epoch
+	double steadyToMicroseconds(int64_t steadyTime) const;
+
+	std::string exportChromeTrace();
+	bool writeChromeTrace(const std::string& path);
+
+private:
+	struct ThreadState
+	{
+		ProfileEventRing ring;
+		std::string name;
+		uint32_t index;
+		bool isSteadyTime;
+	};
+
+	struct CapturedEvent
+	{
+		ProfileEvent event;
+		uint32_t threadIndex;
+	};
+
+	static std::atomic<bool> sIsEnabled;
+
+	ThreadState* registerThread();
+	ThreadState* createThreadState();
+	// Measures the tick rate over everything since construction
+	void calibrate();
+
+	mutable std::mutex mThreadMutex;
+	std::vector<std::unique_ptr<ThreadState>> mThreads;
+
+	// Owned by the collecting thread
+	std::vector<ProfileEvent> mDrained;
+	std::vector<CapturedEvent> mCapture;
+	size_t mCaptureLimit;
+	uint64_t mCaptureDroppedCount;
+
+	uint64_t mEpochTimestamp;
+	int64_t mEpochTime;
+	double mTicksPerMicrosecond;
+};
+
+inline uint64_t Profiler::GetTimestamp()
+{
+#if defined(PROFILE_USE_TSC)
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Records the enclosing scope as one event, if profiling was enabled when it started.
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const ProfileZone* pZone)
+		: mpZone(pZone)
+		, mBegin(Profiler::IsEnabled() ? Profiler::GetTimestamp() : 0)
+	{
+
+	}
+
+	~ProfileScope()
+	{
+		if (mBegin != 0)
+		{
+			Profiler::Record(mpZone, mBegin, Profiler::GetTimestamp());
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const ProfileZone* mpZone;
+	uint64_t mBegin;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// PROFILE_ZONE("name") : times the rest of the enclosing scope. name must be a string literal.
+// Compiled out with PROFILE_DISABLE.
+#if defined(PROFILE_DISABLE)
+#define PROFILE_ZONE(name)
+#else
+#define PROFILE_ZONE(name) \
+	static const ProfileZone PROFILE_CONCAT(profileZone, __LINE__) = { name, __FILE__, __LINE__ }; \
+	ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(&PROFILE_CONCAT(profileZone, __LINE__))
+#endif
+
+#endif
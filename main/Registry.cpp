@@ -0,0 +1,91 @@
+#include "Registry.h"
+
+Registry::Registry()
+	: mGenerations()
+	, mFreeIndices()
+	, mAliveCount(0)
+	, mTransforms()
+	, mMeshes()
+	, mMaterials()
+	, mBounds()
+{
+
+}
+
+Registry::~Registry()
+{
+
+}
+
+/// <summary>
+/// Returns a new entity, reusing the index of a destroyed one when available.
+/// </summary>
+Entity Registry::create()
+{
+	uint32_t index;
+	if (!mFreeIndices.empty())
+	{
+		index = mFreeIndices.back();
+		mFreeIndices.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(mGenerations.size());
+		if (index > EntityIndexMask)
+		{
+			return InvalidEntity;
+		}
+		mGenerations.push_back(0);
+	}
+
+	mAliveCount++;
+	return (static_cast<uint32_t>(mGenerations[index]) << EntityIndexBits) | index;
+}
+
+/// <summary>
+/// Removes every component of the entity and invalidates outstanding handles to it.
+/// </summary>
+void Registry::destroy(Entity entity)
+{
+	if (!isAlive(entity))
+	{
+		return;
+	}
+
+	const uint32_t index = GetIndex(entity);
+	mTransforms.remove(index);
+	mMeshes.remove(index);
+	mMaterials.remove(index);
+	mBounds.remove(index);
+
+	mGenerations[index]++;
+	mFreeIndices.push_back(index);
+	mAliveCount--;
+}
+
+bool Registry::isAlive(Entity entity) const
+{
+	const uint32_t index = GetIndex(entity);
+	return entity != InvalidEntity && index < mGenerations.size() && mGenerations[index] == GetGeneration(entity);
+}
+
+void Registry::reserve(uint32_t capacity)
+{
+	mGenerations.reserve(capacity);
+	mTransforms.reserve(capacity);
+	mMeshes.reserve(capacity);
+	mMaterials.reserve(capacity);
+	mBounds.reserve(capacity);
+}
+
+void Registry::clear()
+{
+	mGenerations.clear();
+	mFreeIndices.clear();
+	mAliveCount = 0;
+
+	mTransforms.clear();
+	mMeshes.clear();
+	mMaterials.clear();
+	mBounds.clear();
+}
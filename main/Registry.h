@@ -0,0 +1,118 @@
+#ifndef __OBJECT_REGISTRY_H__
+#define __OBJECT_REGISTRY_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "ComponentPool.h"
+
+// Entity handle: low bits index the component pools, high bits are a generation
+// that invalidates handles of destroyed entities.
+typedef uint32_t Entity;
+
+struct TransformComponent
+{
+	Vector3 position;
+	Quaternion rotation;
+	Vector3 scale;
+};
+
+// Opaque references resolved by the renderer
+struct MeshComponent
+{
+	const class Mesh* pMesh;
+};
+
+// Shader keywords selecting the pipeline variant, a key of Renderer::getGeometryKeywords
+struct MaterialComponent
+{
+	uint32_t keywords;
+};
+
+// Local-space bounding volume: an AABB and a sphere sharing its center
+struct BoundsComponent
+{
+	Vector3 center;
+	Vector3 extents;
+	float radius;
+};
+
+// Owns every entity and its components.
+// Replaces one heap-allocated GameObject per object with packed per-component arrays.
+class Registry
+{
+public:
+	static const Entity InvalidEntity = UINT32_MAX;
+	static const uint32_t EntityIndexBits = 24;
+	static const uint32_t EntityIndexMask = (1u << EntityIndexBits) - 1;
+
+	static uint32_t GetIndex(Entity entity) { return entity & EntityIndexMask; }
+	static uint32_t GetGeneration(Entity entity) { return entity >> EntityIndexBits; }
+
+	Registry();
+	~Registry();
+
+	Entity create();
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+	void reserve(uint32_t capacity);
+	void clear();
+
+	uint32_t getAliveCount() const { return mAliveCount; }
+
+	template<class T> ComponentPool<T>& getPool();
+
+	template<class T> T& add(Entity entity, const T& component) { return getPool<T>().add(entity, GetIndex(entity), component); }
+	template<class T> void remove(Entity entity) { getPool<T>().remove(GetIndex(entity)); }
+	template<class T> bool has(Entity entity) { return getPool<T>().has(GetIndex(entity)); }
+	template<class T> T* get(Entity entity) { return getPool<T>().get(GetIndex(entity)); }
+
+	// Calls func(entity, First&, Rest&...) for every entity owning all of the components.
+	// Walks the dense array of First, so pass the rarest component first.
+	template<class First, class... Rest, class Func>
+	void forEach(Func func)
+	{
+		ComponentPool<First>& pool = getPool<First>();
+		First* pComponents = pool.data();
+		const uint32_t* pEntities = pool.entities();
+		const uint32_t* pIndices = pool.entityIndices();
+
+		const uint32_t count = pool.size();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (!hasAll<Rest...>(pIndices[i]))
+			{
+				continue;
+			}
+			func(pEntities[i], pComponents[i], *getPool<Rest>().get(pIndices[i])...);
+		}
+	}
+
+private:
+	template<class... Ts>
+	bool hasAll(uint32_t index)
+	{
+		bool result = true;
+		bool results[] = { true, (result = result && getPool<Ts>().has(index))... };
+		(void)results;
+		(void)index;
+		return result;
+	}
+
+	std::vector<uint8_t> mGenerations;
+	std::vector<uint32_t> mFreeIndices;
+	uint32_t mAliveCount;
+
+	ComponentPool<TransformComponent> mTransforms;
+	ComponentPool<MeshComponent> mMeshes;
+	ComponentPool<MaterialComponent> mMaterials;
+	ComponentPool<BoundsComponent> mBounds;
+};
+
+template<> inline ComponentPool<TransformComponent>& Registry::getPool<TransformComponent>() { return mTransforms; }
+template<> inline ComponentPool<MeshComponent>& Registry::getPool<MeshComponent>() { return mMeshes; }
+template<> inline ComponentPool<MaterialComponent>& Registry::getPool<MaterialComponent>() { return mMaterials; }
+template<> inline ComponentPool<BoundsComponent>& Registry::getPool<BoundsComponent>() { return mBounds; }
+
+#endif
@@ -0,0 +1,586 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+const uint32_t RenderGraph::InvalidIndex;
+const uint64_t RenderGraph::InvalidOffset;
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + (alignment - 1)) & ~(alignment - 1);
+	}
+
+	bool IsReadOnly(uint32_t state)
+	{
+		return state != RenderGraphState::Common && (state & ~RenderGraphState::ReadOnly) == 0;
+	}
+}
+
+RenderGraph::RenderGraph()
+	: mPasses()
+	, mResources()
+	, mError()
+	, mSchedule()
+	, mFinalBarriers()
+	, mTransientHeapSize(0)
+{
+
+}
+
+void RenderGraph::clear()
+{
+	mPasses.clear();
+	mResources.clear();
+	mError.clear();
+	mSchedule.clear();
+	mFinalBarriers.clear();
+	mTransientHeapSize = 0;
+}
+
+uint32_t RenderGraph::importResource(const std::string& name, uint32_t initialState, uint32_t finalState)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.isImported = true;
+	resource.initialState = initialState;
+	resource.finalState = finalState;
+	resource.offset = InvalidOffset;
+	mResources.push_back(resource);
+	return static_cast<uint32_t>(mResources.size() - 1);
+}
+
+uint32_t RenderGraph::createTransient(const std::string& name, uint64_t size, uint64_t alignment)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.isImported = false;
+	resource.size = size;
+	resource.alignment = (alignment > 0) ? alignment : 1;
+	resource.offset = InvalidOffset;
+	mResources.push_back(resource);
+	return static_cast<uint32_t>(mResources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, const ExecuteFunction& execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.hasSideEffect = false;
+	pass.isCulled = false;
+	pass.hasConflict = false;
+	mPasses.push_back(pass);
+	return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void RenderGraph::read(uint32_t pass, uint32_t resource, uint32_t state)
+{
+	addAccess(pass, resource, state, false);
+}
+
+void RenderGraph::write(uint32_t pass, uint32_t resource, uint32_t state)
+{
+	addAccess(pass, resource, state, true);
+}
+
+void RenderGraph::setSideEffect(uint32_t pass)
+{
+	mPasses[pass].hasSideEffect = true;
+}
+
+void RenderGraph::addAccess(uint32_t pass, uint32_t resource, uint32_t state, bool isWrite)
+{
+	Pass& target = mPasses[pass];
+	for (Access& access : target.accesses)
+	{
+		if (access.resource != resource)
+		{
+			continue;
+		}
+
+		if (access.isWrite && isWrite)
+		{
+			target.hasConflict |= (access.state != state);
+		}
+		else if (isWrite)
+		{
+			access.state = state;
+			access.isWrite = true;
+		}
+		else if (!access.isWrite)
+		{
+			access.state |= state;
+		}
+		return;
+	}
+
+	Access access;
+	access.resource = resource;
+	access.state = state;
+	access.isWrite = isWrite;
+	target.accesses.push_back(access);
+}
+
+bool RenderGraph::compile()
+{
+	mError.clear();
+	mSchedule.clear();
+	mFinalBarriers.clear();
+	mTransientHeapSize = 0;
+
+	if (!validate())
+	{
+		return false;
+	}
+
+	cullPasses();
+	schedulePasses();
+	computeLifetimes();
+	placeTransients();
+	planBarriers();
+	return true;
+}
+
+void RenderGraph::execute(const void* pContext, const BarrierFunction& recordBarriers) const
+{
+	for (uint32_t passIndex : mSchedule)
+	{
+		const Pass& pass = mPasses[passIndex];
+		if (!pass.barriers.empty())
+		{
+			recordBarriers(pContext, pass.barriers.data(), static_cast<uint32_t>(pass.barriers.size()));
+		}
+		if (pass.execute)
+		{
+			pass.execute(pContext);
+		}
+	}
+
+	if (!mFinalBarriers.empty())
+	{
+		recordBarriers(pContext, mFinalBarriers.data(), static_cast<uint32_t>(mFinalBarriers.size()));
+	}
+}
+
+RenderGraphMemoryReport RenderGraph::getMemoryReport() const
+{
+	RenderGraphMemoryReport report;
+	report.transientCount = 0;
+	report.unaliasedSize = 0;
+	report.aliasedSize = mTransientHeapSize;
+
+	for (const Resource& resource : mResources)
+	{
+		if (!resource.isImported && resource.offset != InvalidOffset)
+		{
+			++report.transientCount;
+			report.unaliasedSize = AlignUp(report.unaliasedSize, resource.alignment) + resource.size;
+		}
+	}
+	return report;
+}
+
+/// <summary>
+/// Every access names a resource in a state that fits its kind, and no transient is read
+/// before some earlier pass has written it.
+/// </summary>
+bool RenderGraph::validate()
+{
+	std::vector<bool> isWritten(mResources.size(), false);
+	for (const Pass& pass : mPasses)
+	{
+		if (pass.hasConflict)
+		{
+			mError = "Pass " + pass.name + " writes a resource in two states";
+			return false;
+		}
+
+		for (const Access& access : pass.accesses)
+		{
+			if (access.resource >= mResources.size())
+			{
+				mError = "Pass " + pass.name + " uses an unknown resource";
+				return false;
+			}
+
+			const Resource& resource = mResources[access.resource];
+			if (access.isWrite == IsReadOnly(access.state))
+			{
+				mError = "Pass " + pass.name + " uses " + resource.name + (access.isWrite ? " in a read-only state for writing" : " in a writable state for reading");
+				return false;
+			}
+			if (!access.isWrite && !resource.isImported && !isWritten[access.resource])
+			{
+				mError = "Pass " + pass.name + " reads " + resource.name + " before any pass writes it";
+				return false;
+			}
+		}
+
+		for (const Access& access : pass.accesses)
+		{
+			if (access.isWrite)
+			{
+				isWritten[access.resource] = true;
+			}
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Walks the passes backwards. A pass stays if it has a side effect, writes an imported resource,
+/// or writes something a later pass that stays reads; what it reads is then needed in turn.
+/// </summary>
+void RenderGraph::cullPasses()
+{
+	std::vector<bool> isNeeded(mResources.size(), false);
+	for (uint32_t i = static_cast<uint32_t>(mPasses.size()); i-- > 0;)
+	{
+		Pass& pass = mPasses[i];
+
+		bool isAlive = pass.hasSideEffect;
+		for (const Access& access : pass.accesses)
+		{
+			if (access.isWrite && (mResources[access.resource].isImported || isNeeded[access.resource]))
+			{
+				isAlive = true;
+			}
+		}
+
+		pass.isCulled = !isAlive;
+		pass.barriers.clear();
+		if (!isAlive)
+		{
+			continue;
+		}
+
+		for (const Access& access : pass.accesses)
+		{
+			if (!access.isWrite)
+			{
+				isNeeded[access.resource] = true;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Orders the remaining passes by their dependencies in declaration order (read after write,
+/// write after read, write after write). Among the passes that are ready, the one depending on
+/// the most recently scheduled pass goes first, which keeps transient lifetimes short.
+/// </summary>
+void RenderGraph::schedulePasses()
+{
+	const uint32_t passCount = static_cast<uint32_t>(mPasses.size());
+	std::vector<std::vector<uint32_t>> successors(passCount);
+	std::vector<uint32_t> predecessorCount(passCount, 0);
+
+	std::vector<uint32_t> lastWriter(mResources.size(), InvalidIndex);
+	std::vector<std::vector<uint32_t>> readers(mResources.size());
+
+	const auto addEdge = [&](uint32_t from, uint32_t to)
+	{
+		if (from == InvalidIndex || from == to)
+		{
+			return;
+		}
+		std::vector<uint32_t>& edges = successors[from];
+		if (std::find(edges.begin(), edges.end(), to) == edges.end())
+		{
+			edges.push_back(to);
+			++predecessorCount[to];
+		}
+	};
+
+	for (uint32_t passIndex = 0; passIndex < passCount; ++passIndex)
+	{
+		if (mPasses[passIndex].isCulled)
+		{
+			continue;
+		}
+
+		for (const Access& access : mPasses[passIndex].accesses)
+		{
+			addEdge(lastWriter[access.resource], passIndex);
+			if (access.isWrite)
+			{
+				for (uint32_t reader : readers[access.resource])
+				{
+					addEdge(reader, passIndex);
+				}
+				readers[access.resource].clear();
+				lastWriter[access.resource] = passIndex;
+			}
+			else
+			{
+				readers[access.resource].push_back(passIndex);
+			}
+		}
+	}
+
+	// Position in the schedule of each pass's latest scheduled predecessor, +1 (0 for none).
+	std::vector<uint32_t> readyAfter(passCount, 0);
+	std::vector<uint32_t> ready;
+	for (uint32_t passIndex = 0; passIndex < passCount; ++passIndex)
+	{
+		if (!mPasses[passIndex].isCulled && predecessorCount[passIndex] == 0)
+		{
+			ready.push_back(passIndex);
+		}
+	}
+
+	while (!ready.empty())
+	{
+		size_t best = 0;
+		for (size_t i = 1; i < ready.size(); ++i)
+		{
+			const uint32_t candidate = ready[i];
+			const uint32_t current = ready[best];
+			if (readyAfter[candidate] > readyAfter[current] || (readyAfter[candidate] == readyAfter[current] && candidate < current))
+			{
+				best = i;
+			}
+		}
+
+		const uint32_t passIndex = ready[best];
+		ready.erase(ready.begin() + best);
+		mSchedule.push_back(passIndex);
+
+		const uint32_t position = static_cast<uint32_t>(mSchedule.size());
+		for (uint32_t successor : successors[passIndex])
+		{
+			readyAfter[successor] = position;
+			if (--predecessorCount[successor] == 0)
+			{
+				ready.push_back(successor);
+			}
+		}
+	}
+}
+
+void RenderGraph::computeLifetimes()
+{
+	for (Resource& resource : mResources)
+	{
+		resource.firstUse = InvalidIndex;
+		resource.lastUse = InvalidIndex;
+		resource.offset = InvalidOffset;
+		resource.creationState = RenderGraphState::Common;
+		resource.isAliased = false;
+	}
+
+	for (uint32_t position = 0; position < mSchedule.size(); ++position)
+	{
+		for (const Access& access : mPasses[mSchedule[position]].accesses)
+		{
+			Resource& resource = mResources[access.resource];
+			if (resource.firstUse == InvalidIndex)
+			{
+				resource.firstUse = position;
+			}
+			resource.lastUse = position;
+		}
+	}
+}
+
+/// <summary>
+/// Places transients largest first, each at the lowest offset not overlapping a transient
+/// already placed whose lifetime overlaps its own. A transient sharing memory with any other is
+/// aliased: the first in the frame takes the memory over from the last of the previous frame.
+/// </summary>
+void RenderGraph::placeTransients()
+{
+	std::vector<uint32_t> transients;
+	for (uint32_t i = 0; i < mResources.size(); ++i)
+	{
+		if (!mResources[i].isImported && mResources[i].firstUse != InvalidIndex)
+		{
+			transients.push_back(i);
+		}
+	}
+	std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b)
+	{
+		return mResources[a].size > mResources[b].size;
+	});
+
+	const auto livesOverlap = [](const Resource& a, const Resource& b)
+	{
+		return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+	};
+	const auto memoryOverlaps = [](const Resource& a, const Resource& b)
+	{
+		return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+	};
+
+	std::vector<uint32_t> placed;
+	std::vector<uint32_t> conflicts;
+	for (uint32_t index : transients)
+	{
+		Resource& resource = mResources[index];
+
+		conflicts.clear();
+		for (uint32_t other : placed)
+		{
+			if (livesOverlap(resource, mResources[other]))
+			{
+				conflicts.push_back(other);
+			}
+		}
+		std::sort(conflicts.begin(), conflicts.end(), [this](uint32_t a, uint32_t b)
+		{
+			return mResources[a].offset < mResources[b].offset;
+		});
+
+		uint64_t offset = 0;
+		for (uint32_t other : conflicts)
+		{
+			const Resource& occupied = mResources[other];
+			if (offset + resource.size <= occupied.offset)
+			{
+				break;
+			}
+			const uint64_t end = AlignUp(occupied.offset + occupied.size, resource.alignment);
+			offset = (end > offset) ? end : offset;
+		}
+
+		resource.offset = offset;
+		mTransientHeapSize = (offset + resource.size > mTransientHeapSize) ? offset + resource.size : mTransientHeapSize;
+		placed.push_back(index);
+	}
+
+	for (uint32_t index : placed)
+	{
+		Resource& resource = mResources[index];
+		for (uint32_t other : placed)
+		{
+			if (other != index && memoryOverlaps(resource, mResources[other]))
+			{
+				resource.isAliased = true;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Follows each resource's state through the schedule and gathers the barriers every pass needs
+/// into one batch. A read transitions straight to every read state used until the next write,
+/// so a chain of readers costs one barrier. A transient starts each frame in the state its last
+/// pass left it in, which is also the state it is created in.
+/// </summary>
+void RenderGraph::planBarriers()
+{
+	std::vector<uint32_t> current(mResources.size(), RenderGraphState::Common);
+	std::vector<uint32_t> firstState(mResources.size(), RenderGraphState::Common);
+	for (uint32_t i = 0; i < mResources.size(); ++i)
+	{
+		if (mResources[i].isImported)
+		{
+			current[i] = mResources[i].initialState;
+		}
+	}
+
+	for (uint32_t position = 0; position < mSchedule.size(); ++position)
+	{
+		Pass& pass = mPasses[mSchedule[position]];
+		for (const Access& access : pass.accesses)
+		{
+			const uint32_t index = access.resource;
+			Resource& resource = mResources[index];
+
+			uint32_t target = access.state;
+			if (!access.isWrite)
+			{
+				const bool isFirstTransientUse = !resource.isImported && resource.firstUse == position;
+				if (!isFirstTransientUse && IsReadOnly(current[index]) && (current[index] & target) == target)
+				{
+					continue;
+				}
+
+				for (uint32_t next = position + 1; next < mSchedule.size(); ++next)
+				{
+					const Access* pNextAccess = nullptr;
+					for (const Access& nextAccess : mPasses[mSchedule[next]].accesses)
+					{
+						if (nextAccess.resource == index)
+						{
+							pNextAccess = &nextAccess;
+						}
+					}
+					if (pNextAccess == nullptr)
+					{
+						continue;
+					}
+					if (pNextAccess->isWrite)
+					{
+						break;
+					}
+					target |= pNextAccess->state;
+				}
+			}
+
+			if (!resource.isImported && resource.firstUse == position)
+			{
+				// The transition into the first state follows once the last state is known.
+				if (resource.isAliased)
+				{
+					RenderGraphBarrier barrier;
+					barrier.type = RenderGraphBarrier::Aliasing;
+					barrier.resource = index;
+					barrier.stateBefore = target;
+					barrier.stateAfter = target;
+					pass.barriers.push_back(barrier);
+				}
+				firstState[index] = target;
+				current[index] = target;
+				continue;
+			}
+
+			if (current[index] != target)
+			{
+				RenderGraphBarrier barrier;
+				barrier.type = RenderGraphBarrier::Transition;
+				barrier.resource = index;
+				barrier.stateBefore = current[index];
+				barrier.stateAfter = target;
+				pass.barriers.push_back(barrier);
+				current[index] = target;
+			}
+		}
+	}
+
+	for (uint32_t index = 0; index < mResources.size(); ++index)
+	{
+		Resource& resource = mResources[index];
+		if (resource.isImported)
+		{
+			if (current[index] != resource.finalState)
+			{
+				RenderGraphBarrier barrier;
+				barrier.type = RenderGraphBarrier::Transition;
+				barrier.resource = index;
+				barrier.stateBefore = current[index];
+				barrier.stateAfter = resource.finalState;
+				mFinalBarriers.push_back(barrier);
+			}
+			continue;
+		}
+
+		if (resource.firstUse == InvalidIndex)
+		{
+			continue;
+		}
+
+		resource.creationState = current[index];
+		if (resource.creationState != firstState[index])
+		{
+			RenderGraphBarrier barrier;
+			barrier.type = RenderGraphBarrier::Transition;
+			barrier.resource = index;
+			barrier.stateBefore = resource.creationState;
+			barrier.stateAfter = firstState[index];
+			mPasses[mSchedule[resource.firstUse]].barriers.push_back(barrier);
+		}
+	}
+}
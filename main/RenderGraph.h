@@ -0,0 +1,166 @@
+#ifndef __RENDERER_RENDERGRAPH_H__
+#define __RENDERER_RENDERGRAPH_H__
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Resource states a pass can ask for, mapped to D3D12_RESOURCE_STATES by RenderGraphResources.
+// The read-only states can be combined; a resource is in at most one write state.
+namespace RenderGraphState
+{
+	const uint32_t Common = 0;
+	const uint32_t Present = 1 << 0;
+	const uint32_t RenderTarget = 1 << 1;
+	const uint32_t DepthWrite = 1 << 2;
+	const uint32_t UnorderedAccess = 1 << 3;
+	const uint32_t CopyDest = 1 << 4;
+	const uint32_t DepthRead = 1 << 5;
+	const uint32_t PixelShaderResource = 1 << 6;
+	const uint32_t NonPixelShaderResource = 1 << 7;
+	const uint32_t CopySource = 1 << 8;
+
+	const uint32_t ReadOnly = DepthRead | PixelShaderResource | NonPixelShaderResource | CopySource;
+}
+
+struct RenderGraphBarrier
+{
+	enum Type
+	{
+		Transition,
+		// The resource takes over heap memory another transient used before it, earlier in the
+		// frame or, for the first user of the memory, in the previous frame
+		Aliasing,
+	};
+
+	Type type;
+	uint32_t resource;
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+};
+
+// What aliasing transients saved, in bytes.
+struct RenderGraphMemoryReport
+{
+	uint32_t transientCount;
+	uint64_t unaliasedSize;
+	uint64_t aliasedSize;
+
+	uint64_t getSavedSize() const { return unaliasedSize - aliasedSize; }
+};
+
+// Frame described as passes reading and writing virtual resources. compile() culls the passes
+// nothing depends on, orders the rest, plans every state transition as one batch per pass and
+// packs transient resources into one heap, sharing memory between those whose lifetimes do not
+// overlap. Holds no graphics API objects; RenderGraphResources creates the real resources.
+//
+// A transient's contents are undefined when its first pass starts, so that pass has to clear or
+// fully overwrite it. The graph is compiled once and executed every frame; transients keep the
+// state their last pass left them in from one frame to the next.
+class RenderGraph
+{
+public:
+	static const uint32_t InvalidIndex = ~0u;
+	static const uint64_t InvalidOffset = ~0ull;
+
+	// Receives the context given to execute, e.g. the renderer recording the frame.
+	typedef std::function<void(const void* pContext)> ExecuteFunction;
+	// Records a batch of barriers ahead of a pass, or after the last one.
+	typedef std::function<void(const void* pContext, const RenderGraphBarrier* pBarriers, uint32_t count)> BarrierFunction;
+
+	RenderGraph();
+
+	void clear();
+
+	// A resource owned outside the graph, e.g. a back buffer. It is in initialState before the first
+	// pass and is returned to finalState after the last; passes writing it are never culled.
+	uint32_t importResource(const std::string& name, uint32_t initialState, uint32_t finalState);
+	// A resource only used within the frame. Size and alignment are those of the real resource.
+	uint32_t createTransient(const std::string& name, uint64_t size, uint64_t alignment);
+
+	uint32_t addPass(const std::string& name, const ExecuteFunction& execute);
+	// Accesses of one pass to one resource are combined: read states add up, a write wins.
+	void read(uint32_t pass, uint32_t resource, uint32_t state);
+	void write(uint32_t pass, uint32_t resource, uint32_t state);
+	// Keeps the pass even when nothing reads what it writes.
+	void setSideEffect(uint32_t pass);
+
+	// Returns false and sets getError when the graph is invalid.
+	bool compile();
+	const std::string& getError() const { return mError; }
+
+	void execute(const void* pContext, const BarrierFunction& recordBarriers) const;
+
+	// Compiled results
+	const std::vector<uint32_t>& getSchedule() const { return mSchedule; }
+	const std::vector<RenderGraphBarrier>& getPassBarriers(uint32_t pass) const { return mPasses[pass].barriers; }
+	const std::vector<RenderGraphBarrier>& getFinalBarriers() const { return mFinalBarriers; }
+	bool isPassCulled(uint32_t pass) const { return mPasses[pass].isCulled; }
+
+	uint32_t getResourceCount() const { return static_cast<uint32_t>(mResources.size()); }
+	const std::string& getResourceName(uint32_t resource) const { return mResources[resource].name; }
+	bool isTransient(uint32_t resource) const { return !mResources[resource].isImported; }
+	// InvalidOffset for transients no remaining pass uses.
+	uint64_t getTransientOffset(uint32_t resource) const { return mResources[resource].offset; }
+	// State to create a transient in: the one its last pass leaves it in.
+	uint32_t getTransientCreationState(uint32_t resource) const { return mResources[resource].creationState; }
+	uint64_t getTransientHeapSize() const { return mTransientHeapSize; }
+	RenderGraphMemoryReport getMemoryReport() const;
+
+private:
+	struct Access
+	{
+		uint32_t resource;
+		uint32_t state;
+		bool isWrite;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		ExecuteFunction execute;
+		std::vector<Access> accesses;
+		bool hasSideEffect;
+		bool isCulled;
+		bool hasConflict;
+		std::vector<RenderGraphBarrier> barriers;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		bool isImported;
+		uint32_t initialState;
+		uint32_t finalState;
+		uint64_t size;
+		uint64_t alignment;
+
+		// Schedule positions of the first and last pass using it
+		uint32_t firstUse;
+		uint32_t lastUse;
+		uint64_t offset;
+		uint32_t creationState;
+		// Shares memory with another transient, so its first pass needs an aliasing barrier
+		bool isAliased;
+	};
+
+	void addAccess(uint32_t pass, uint32_t resource, uint32_t state, bool isWrite);
+
+	bool validate();
+	void cullPasses();
+	void schedulePasses();
+	void computeLifetimes();
+	void placeTransients();
+	void planBarriers();
+
+	std::vector<Pass> mPasses;
+	std::vector<Resource> mResources;
+	std::string mError;
+
+	std::vector<uint32_t> mSchedule;
+	std::vector<RenderGraphBarrier> mFinalBarriers;
+	uint64_t mTransientHeapSize;
+};
+
+#endif
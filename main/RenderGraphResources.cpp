@@ -0,0 +1,153 @@
+#include "stdafx.h"
+#include "RenderGraphResources.h"
+
+RenderGraphResources::RenderGraphResources()
+	: mDevice()
+	, mHeap()
+	, mTextures()
+	, mResources()
+	, mBarriers()
+{
+
+}
+
+RenderGraphResources::~RenderGraphResources()
+{
+	destroy();
+}
+
+void RenderGraphResources::initialize(ID3D12Device* pDevice)
+{
+	destroy();
+	mDevice = pDevice;
+}
+
+void RenderGraphResources::destroy()
+{
+	mResources.clear();
+	mTextures.clear();
+	mHeap.Reset();
+	mDevice.Reset();
+}
+
+uint32_t RenderGraphResources::createTexture(RenderGraph& graph, const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* pClearValue)
+{
+	const D3D12_RESOURCE_ALLOCATION_INFO info = mDevice->GetResourceAllocationInfo(0, 1, &desc);
+	const uint32_t resource = graph.createTransient(name, info.SizeInBytes, info.Alignment);
+
+	if (mTextures.size() <= resource)
+	{
+		mTextures.resize(resource + 1);
+	}
+	Texture& texture = mTextures[resource];
+	texture.desc = desc;
+	texture.hasClearValue = (pClearValue != nullptr);
+	if (texture.hasClearValue)
+	{
+		texture.clearValue = *pClearValue;
+	}
+	return resource;
+}
+
+/// <summary>
+/// Each transient is created in the state its last pass leaves it in, since that is the state
+/// the graph expects it in at the start of every frame.
+/// </summary>
+void RenderGraphResources::realize(const RenderGraph& graph)
+{
+	mResources.clear();
+	mResources.resize(graph.getResourceCount());
+	mHeap.Reset();
+
+	const uint64_t heapSize = graph.getTransientHeapSize();
+	if (heapSize == 0)
+	{
+		return;
+	}
+
+	D3D12_HEAP_DESC heapDesc{};
+	heapDesc.SizeInBytes = (heapSize + (D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT - 1)) & ~static_cast<UINT64>(D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+	heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapDesc.Properties.CreationNodeMask = 0;
+	heapDesc.Properties.VisibleNodeMask = 0;
+	heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+	ThrowIfFailed(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+
+	for (uint32_t resource = 0; resource < graph.getResourceCount(); ++resource)
+	{
+		if (!graph.isTransient(resource) || graph.getTransientOffset(resource) == RenderGraph::InvalidOffset)
+		{
+			continue;
+		}
+
+		const Texture& texture = mTextures[resource];
+		ThrowIfFailed(mDevice->CreatePlacedResource(
+			mHeap.Get(),
+			graph.getTransientOffset(resource),
+			&texture.desc,
+			GetState(graph.getTransientCreationState(resource)),
+			texture.hasClearValue ? &texture.clearValue : nullptr,
+			IID_PPV_ARGS(&mResources[resource])
+		));
+
+		const std::string& name = graph.getResourceName(resource);
+		mResources[resource]->SetName(std::wstring(name.begin(), name.end()).c_str());
+	}
+}
+
+void RenderGraphResources::setImported(uint32_t resource, ID3D12Resource* pResource)
+{
+	if (mResources.size() <= resource)
+	{
+		mResources.resize(resource + 1);
+	}
+	mResources[resource] = pResource;
+}
+
+ID3D12Resource* RenderGraphResources::getResource(uint32_t resource) const
+{
+	return mResources[resource].Get();
+}
+
+void RenderGraphResources::recordBarriers(ID3D12GraphicsCommandList* pCommandList, const RenderGraphBarrier* pBarriers, uint32_t count)
+{
+	mBarriers.clear();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const RenderGraphBarrier& barrier = pBarriers[i];
+		ID3D12Resource* pResource = mResources[barrier.resource].Get();
+
+		if (barrier.type == RenderGraphBarrier::Aliasing)
+		{
+			// Any resource that used the memory before may be the one being replaced.
+			mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, pResource));
+		}
+		else
+		{
+			mBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource, GetState(barrier.stateBefore), GetState(barrier.stateAfter)));
+		}
+	}
+
+	if (!mBarriers.empty())
+	{
+		pCommandList->ResourceBarrier(static_cast<UINT>(mBarriers.size()), mBarriers.data());
+	}
+}
+
+D3D12_RESOURCE_STATES RenderGraphResources::GetState(uint32_t state)
+{
+	D3D12_RESOURCE_STATES result = D3D12_RESOURCE_STATE_COMMON;
+	if (state & RenderGraphState::Present)					result |= D3D12_RESOURCE_STATE_PRESENT;
+	if (state & RenderGraphState::RenderTarget)				result |= D3D12_RESOURCE_STATE_RENDER_TARGET;
+	if (state & RenderGraphState::DepthWrite)				result |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	if (state & RenderGraphState::UnorderedAccess)			result |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	if (state & RenderGraphState::CopyDest)					result |= D3D12_RESOURCE_STATE_COPY_DEST;
+	if (state & RenderGraphState::DepthRead)				result |= D3D12_RESOURCE_STATE_DEPTH_READ;
+	if (state & RenderGraphState::PixelShaderResource)		result |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	if (state & RenderGraphState::NonPixelShaderResource)	result |= D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	if (state & RenderGraphState::CopySource)				result |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+	return result;
+}
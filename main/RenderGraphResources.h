@@ -0,0 +1,56 @@
+#ifndef __RENDERER_RENDERGRAPHRESOURCES_H__
+#define __RENDERER_RENDERGRAPHRESOURCES_H__
+
+#include <string>
+#include <vector>
+
+#include "RenderGraph.h"
+
+using namespace Microsoft::WRL;
+
+// D3D12 side of a RenderGraph: places its transient render target and depth textures in one heap
+// at the offsets the graph chose, so transients that never live at the same time share memory,
+// and records the graph's barriers.
+class RenderGraphResources
+{
+public:
+	RenderGraphResources();
+	~RenderGraphResources();
+
+	void initialize(ID3D12Device* pDevice);
+	// The GPU must no longer use any transient.
+	void destroy();
+
+	// Declares a transient render target or depth texture in graph, sized by the device.
+	uint32_t createTexture(RenderGraph& graph, const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* pClearValue);
+	// Creates the heap and every transient the compiled graph kept. The GPU must no longer use the previous ones.
+	void realize(const RenderGraph& graph);
+
+	// Resource an imported handle stands for, e.g. this frame's back buffer.
+	void setImported(uint32_t resource, ID3D12Resource* pResource);
+	ID3D12Resource* getResource(uint32_t resource) const;
+
+	// Records a batch in a single ResourceBarrier call.
+	void recordBarriers(ID3D12GraphicsCommandList* pCommandList, const RenderGraphBarrier* pBarriers, uint32_t count);
+
+	static D3D12_RESOURCE_STATES GetState(uint32_t state);
+
+private:
+	struct Texture
+	{
+		D3D12_RESOURCE_DESC desc;
+		D3D12_CLEAR_VALUE clearValue;
+		bool hasClearValue;
+	};
+
+	ComPtr<ID3D12Device> mDevice;
+	ComPtr<ID3D12Heap> mHeap;
+
+	// Indexed by graph resource
+	std::vector<Texture> mTextures;
+	std::vector<ComPtr<ID3D12Resource>> mResources;
+
+	std::vector<D3D12_RESOURCE_BARRIER> mBarriers;
+};
+
+#endif
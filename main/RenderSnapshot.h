@@ -0,0 +1,41 @@
+#ifndef __RENDERER_RENDERSNAPSHOT_H__
+#define __RENDERER_RENDERSNAPSHOT_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "InstanceBatcher.h"
+
+class Mesh;
+
+struct SnapshotInstance
+{
+	const Mesh* pMesh;
+	ID3D12PipelineState* pPipelineState;
+	InstanceData data;
+};
+
+// Everything the render thread needs to record one frame, filled by the update thread.
+// Read only once published through the FramePipeline.
+struct RenderSnapshot
+{
+	uint64_t frameNumber;
+
+	// Transposed for HLSL
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+
+	D3D12_VIEWPORT viewport;
+	D3D12_RECT scissorRect;
+	float clearColor[4];
+
+	std::vector<SnapshotInstance> instances;
+
+	void reset(uint64_t frame)
+	{
+		frameNumber = frame;
+		instances.clear();
+	}
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include <io.h>
 #include <vector>
 #include <fstream>
+#include <algorithm>
 
 #include "Renderer.h"
 #include "Application.h"
@@ -9,6 +10,26 @@
 #include "Cube.h"
 
 #include "Camera.h"
+#include "Hash.h"
+#include "RootSignatureBuilder.h"
+#include "Profiler.h"
+
+namespace
+{
+	// Compiled shaders, relative to the assets directory
+	const WCHAR ShaderCacheDirectory[] = L"ShaderCache\\";
+
+	// GPU zones of the frame's passes
+	const ProfileZone GpuSceneZone = { "Scene", __FILE__, __LINE__ };
+	const ProfileZone GpuClearZone = { "Clear", __FILE__, __LINE__ };
+	const ProfileZone GpuDrawZone = { "Draw", __FILE__, __LINE__ };
+	const ProfileZone GpuUpscaleZone = { "Upscale", __FILE__, __LINE__ };
+
+	void ReleaseComObject(void* pObject, uint64_t)
+	{
+		static_cast<IUnknown*>(pObject)->Release();
+	}
+}
 
 Renderer* Renderer::gInstance = nullptr;
 
@@ -25,36 +46,60 @@ Renderer::Renderer()
 	, mSwapChain(nullptr)
 	, mCommandQueue(nullptr)
 	, mCommandAllocators()
-	, mBundleAllocator(nullptr)
 	, mRootSignature(nullptr)
+	, mRootSignatureHash(0)
+	, mGpuMemory()
+	, mReleaseQueue()
 
 	// DescriptorHeap
 	, mRTVHeap()
-	, mCBVHeap()
-	, mSRVHeap()
 	, mDSVHeap()
+	, mDescriptorHeap()
 
 	, mRenderTargets()
-	, mDepthStencil(nullptr)
+	, mBackBufferWidth(0)
+	, mBackBufferHeight(0)
+	, mSizeDependents()
+	, mPendingSize(0)
+	, mRenderGraph()
+	, mRenderGraphResources()
+	, mBackBufferResource(RenderGraph::InvalidIndex)
+	, mDepthResource(RenderGraph::InvalidIndex)
+	, mSceneColorResource(RenderGraph::InvalidIndex)
+	, mSceneColorDescriptor(DescriptorAllocator::InvalidIndex)
+	, mpBarrierCommandList(nullptr)
 	, mFrameIndex(0)
 
 	// Asset objects
+	, mShaderCache()
+	, mPipelineStateCache()
+	, mGeometryPermutations()
 	, mPSOGeometory(nullptr)
+	, mPSOUpscale(nullptr)
 	, mCommandList(nullptr)
-	, mBundle(nullptr)
-	, mObjectConstantBuffer()
-	, mSceneConstantBuffer()
-	, mVertexBuffer(nullptr)
-	, mVertexBufferView()
-	, mIndexBuffer(nullptr)
-	, mIndexBufferView()
-	, mIndexCount(0)
+	, mConstantBuffer()
+	, mSceneConstantAddress(0)
+	, mInstanceBatcher()
+	, mQuadMesh()
+	, mCopyQueue()
+	, mUploadQueue()
+	, mCommandListFactory()
+	, mCommandListPool()
+	, mCommandRecorder()
+	, mBundleRecorder()
+	, mBundleCache()
+	, mSubmitCommandLists()
+	, mResolution()
+	, mRenderScale(1.0f)
+	, mTimestampQueries()
+	, mGpuProfiler()
 
 	// Synchronization objects
-	, mSwapChainEvent(NULL)
-	, mFences()
-	, mFenceValues()
-	, mFenceEvent(NULL)
+	, mPresentQueue()
+	, mFramePacing(FramePacingSettings::Throughput())
+	, mFrameFence()
+	, mFenceTracker()
+	, mFrameFenceValues()
 {
 	if (gInstance == nullptr)
 	{
@@ -77,30 +122,58 @@ void Renderer::onInit()
 
 void Renderer::onRegisterDataBuffer(int slot, void* pData, size_t size)
 {
-	memcpy(mDataPtr[slot], pData, size);
+	// Every call gets its own 256-byte aligned region of this frame's upload ring,
+	// so the GPU never sees a constant buffer being overwritten while in flight.
+	LinearAllocation allocation = mConstantBuffer.push(pData, size);
+
+	// Slot 1 : CameraConstantBuffer
+	// Per-object data comes from RenderSnapshot::instances.
+	if (slot == 1)
+	{
+		mSceneConstantAddress = allocation.gpuAddress;
+	}
 }
 
-void Renderer::onRender(Camera* pCamera)
+void Renderer::onRender(const RenderSnapshot& snapshot)
 {
+	PROFILE_ZONE("Renderer::onRender");
+
 	try 
 	{
+		const uint64_t pendingSize = mPendingSize.exchange(0);
+		if (pendingSize != 0)
+		{
+			resize(static_cast<uint32_t>(pendingSize >> 32), static_cast<uint32_t>(pendingSize));
+		}
+
+		CameraConstantBuffer camera;
+		camera.view = snapshot.view;
+		camera.projection = snapshot.projection;
+		onRegisterDataBuffer(1, &camera, sizeof(CameraConstantBuffer));
+
+		for (const SnapshotInstance& instance : snapshot.instances)
+		{
+			mInstanceBatcher.submit(instance.pMesh, instance.pPipelineState, instance.data);
+		}
+
 		PIXBeginEvent(mCommandQueue.Get(), 0, L"Render");
 		{
 			begin();
 			
-			record(pCamera);
+			executeRenderGraph(snapshot);
 
 			end();
 
-			// Execute the command list.
-			ID3D12CommandList* const ppCommandLists[] = { mCommandList.Get() };
-			mCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+			waitForUploads();
+
+			// Execute the command lists in recording order.
+			mCommandQueue->ExecuteCommandLists(static_cast<UINT>(mSubmitCommandLists.size()), mSubmitCommandLists.data());
 		}
 		PIXEndEvent(mCommandQueue.Get());
 
 		// Present the frame.
 		// SyncInterval : ҂t[
-		ThrowIfFailed(mSwapChain->Present(1, 0));
+		ThrowIfFailed(mSwapChain->Present(mFramePacing.syncInterval, 0));
 
 		moveToNextFrame();
 	}
@@ -114,13 +187,72 @@ void Renderer::onRender(Camera* pCamera)
 	}
 }
 
+/// <summary>
+/// Call before onInit, or on the render thread.
+/// </summary>
+void Renderer::setFramePacing(const FramePacingSettings& settings)
+{
+	mFramePacing = settings;
+	if (mSwapChain != nullptr)
+	{
+		ThrowIfFailed(mSwapChain->SetMaximumFrameLatency(mFramePacing.maxFramesInFlight));
+	}
+}
+
+/// <summary>
+/// Zero sizes, e.g. a minimized window, are ignored; the last request before a frame wins.
+/// </summary>
+void Renderer::requestResize(uint32_t width, uint32_t height)
+{
+	if (width == 0 || height == 0)
+	{
+		return;
+	}
+	mPendingSize.store((static_cast<uint64_t>(width) << 32) | height);
+}
+
+/// <summary>
+/// Call before onInit, or on the render thread.
+/// </summary>
+void Renderer::setResolutionSettings(const ResolutionSettings& settings)
+{
+	mResolution.initialize(settings);
+	mRenderScale = mResolution.getScale();
+}
+
 void Renderer::onDestroy()
 {
 	// Ensure that the GPU is no longer referencing resources that are about to be
 	// cleaned up by the destructor.
 	waitForGpu();
 
-	CloseHandle(mFenceEvent);
+	releaseMesh(&mQuadMesh);
+
+	// Anything released from here on goes at once.
+	mReleaseQueue.destroy();
+
+	mUploadQueue.destroy();
+	mCopyQueue.destroy();
+
+	mBundleCache.destroy();
+	mCommandListPool.destroy();
+	mSizeDependents.clear();
+	mRenderGraphResources.destroy();
+	mGpuProfiler.destroy();
+	mTimestampQueries.destroy();
+
+	mGeometryPermutations.destroy();
+
+	// Keep the pipelines compiled this run for the next launch
+	mPipelineStateCache.save();
+	mShaderCache.destroy();
+
+	// Everything waited on above has completed, run what was left to retire.
+	mFenceTracker.retire();
+	mFenceTracker.destroy();
+	mFrameFence.destroy();
+
+	mPresentQueue.destroy();
 }
 
 
@@ -264,12 +396,13 @@ void Renderer::loadPipelineAssets()
 {
 	createDescriptorHeap();
 
+	mShaderCache.initialize(Application::getAssetFullPath(L""), Application::getAssetFullPath(ShaderCacheDirectory), true);
+	mPipelineStateCache.initialize(mDevice.Get(), mAdapter.Get(), Application::getAssetFullPath(L"PipelineCache.bin"));
+
 	loadRootSignature();
 	loadPipelineState();
 
 	createPipelineAssets();
-	setDescriptorResource();
-	setResourceDataPtr();
 }
 
 /// <summary>
@@ -281,30 +414,16 @@ void Renderer::createDescriptorHeap()
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
 		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-		heapDesc.NumDescriptors = FrameCount;
+		heapDesc.NumDescriptors = FrameCount + 1;
 		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 		heapDesc.NodeMask = 0;
 		ThrowIfFailed(mRTVHeap.Create(&heapDesc, mDevice.GetAddressOf()));
 	}
 
-	// ConstantBufferView
+	// CBV/SRV/UAV : one bindless heap, persistent descriptors followed by a region per frame
 	{
-		D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
-		heapDesc.NumDescriptors = 2;
-		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		heapDesc.NodeMask = 0;
-		ThrowIfFailed(mCBVHeap.Create(&heapDesc, mDevice.GetAddressOf()));
-	}
-
-	// ShaderResourceView
-	{
-		D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
-		heapDesc.NumDescriptors = 1;
-		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		heapDesc.NodeMask = 0;
-		ThrowIfFailed(mSRVHeap.Create(&heapDesc, mDevice.GetAddressOf()));
+		ThrowIfFailed(mDescriptorHeap.Create(mDevice.Get(), PersistentDescriptorCount, TransientDescriptorCount, FrameCount));
+		mDescriptorHeap.beginFrame(mFrameIndex);
 	}
 
 	// DepthStencilView
@@ -323,102 +442,60 @@ void Renderer::createDescriptorHeap()
 /// </summary>
 void Renderer::loadRootSignature()
 {
-	D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
+	RootSignatureBuilder builder;
+	builder.setFlags(D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
-	// tOݒ
-	D3D12_ROOT_SIGNATURE_FLAGS flags;
-	{
-		flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-	}
-	rootSignatureDesc.Flags = flags;
+	// DrawConstants (b0) : root constants, the batch's first instance, set before every draw.
+	// The upscale pass reads its source from them in the pixel shader.
+	builder.addConstants(DrawConstantCount, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
 
-	// [gp^̐ݒ
-	D3D12_ROOT_PARAMETER rootParameters[2]{};
-	{
-		// [gp[^[0] 
-		{
-			D3D12_ROOT_PARAMETER& parameter = rootParameters[0];
-			parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-			parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	// CameraConstantBuffer (b1) : root CBV, once per frame
+	builder.addCBV(1, 0, D3D12_SHADER_VISIBILITY_ALL);
 
-			D3D12_DESCRIPTOR_RANGE ranges[2]{};
-			{
-				ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-				ranges[0].NumDescriptors = 1;
-				ranges[0].BaseShaderRegister = 0;
-				ranges[0].RegisterSpace = 0;
-				ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-				ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-				ranges[1].NumDescriptors = 1;
-				ranges[1].BaseShaderRegister = 1;
-				ranges[1].RegisterSpace = 0;
-				ranges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-			}
-
-			parameter.Descriptor.RegisterSpace = 0;
-			parameter.Descriptor.ShaderRegister = 0;
-			parameter.DescriptorTable.pDescriptorRanges = &ranges[0];
-			parameter.DescriptorTable.NumDescriptorRanges = _countof(ranges);
-		}
+	// InstanceData (t1) : root SRV, once per frame
+	builder.addSRV(1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
-		// [gp[^[1]
-		{
-			D3D12_ROOT_PARAMETER& parameter = rootParameters[1];
-			parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-			parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-
-			D3D12_DESCRIPTOR_RANGE ranges[1]{};
-			{
-				ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-				ranges[0].NumDescriptors = 1;
-				ranges[0].BaseShaderRegister = 0;
-				ranges[0].RegisterSpace = 0;
-				ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-			}
-
-			parameter.Descriptor.RegisterSpace = 0;
-			parameter.Descriptor.ShaderRegister = 0;
-			parameter.DescriptorTable.pDescriptorRanges = &ranges[0];
-			parameter.DescriptorTable.NumDescriptorRanges = _countof(ranges);
-		}
+	// Bindless SRVs (t0, space1) : the whole shader visible heap, indexed by descriptor index
+	{
+		D3D12_DESCRIPTOR_RANGE range{};
+		range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		// Unbounded, in its own space so it cannot overlap the root SRV
+		range.NumDescriptors = UINT_MAX;
+		range.BaseShaderRegister = 0;
+		range.RegisterSpace = 1;
+		range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+		builder.addTable(&range, 1, D3D12_SHADER_VISIBILITY_ALL);
+	}
 
+	// Static sampler (s0)
+	{
+		D3D12_STATIC_SAMPLER_DESC sampler{};
+		sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+		sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+		sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+		sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+		sampler.MipLODBias = 0.0f;
+		sampler.MaxAnisotropy = 16;
+		sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+		sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+		sampler.MinLOD = 0.0f;
+		sampler.MaxLOD = D3D12_FLOAT32_MAX;
+		sampler.ShaderRegister = 0;
+		sampler.RegisterSpace = 0;
+		sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		builder.addStaticSampler(sampler);
 	}
-	rootSignatureDesc.pParameters = rootParameters;
-	rootSignatureDesc.NumParameters = _countof(rootParameters);
 
-	// ÓITv[̐ݒ
-	D3D12_STATIC_SAMPLER_DESC rootSamplers[1]{};
+	if (!builder.validate())
 	{
-		// ÓITv[[0]
-		{
-			D3D12_STATIC_SAMPLER_DESC& sampler = rootSamplers[0];
-			sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
-			sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-			sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-			sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-			sampler.MipLODBias = 0.0f;
-			sampler.MaxAnisotropy = 16;
-			sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
-			sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
-			sampler.MinLOD = 0.0f;
-			sampler.MaxLOD = D3D12_FLOAT32_MAX;
-			sampler.ShaderRegister = 0;
-			sampler.RegisterSpace = 0;
-			sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-		}
+		OutputDebugStringA(("ERROR: " + builder.getError() + "\n").c_str());
+		throw std::exception("Invalid root signature layout");
 	}
-	rootSignatureDesc.pStaticSamplers = &rootSamplers[0];
-	rootSignatureDesc.NumStaticSamplers = _countof(rootSamplers);
 
 	ComPtr<ID3DBlob> error;
 	ComPtr<ID3DBlob> signature;
-	ThrowIfFailed(D3D12SerializeRootSignature(
-		&rootSignatureDesc,
-		D3D_ROOT_SIGNATURE_VERSION_1,
-		&signature,
-		&error)
-	);
+	ThrowIfFailed(builder.serialize(&signature, &error));
+	mRootSignatureHash = Hasher().add(signature->GetBufferPointer(), signature->GetBufferSize()).getHash();
 	ThrowIfFailed(mDevice->CreateRootSignature(
 		0,
 		signature->GetBufferPointer(),
@@ -432,8 +509,38 @@ void Renderer::loadRootSignature()
 /// </summary>
 void Renderer::loadPipelineState()
 {
-	ComPtr<ID3DBlob> error;
+	// The base variant is built here, before the first frame; the others on first use, in the background.
+	const bool isInitialized = mGeometryPermutations.initialize(
+		getGeometryKeywords(),
+		[this](uint32_t keywords) -> void*
+		{
+			ID3D12PipelineState* pPipelineState = nullptr;
+			return SUCCEEDED(createGeometryPipelineState(keywords, &pPipelineState)) ? pPipelineState : nullptr;
+		},
+		[](void* pPipelineState)
+		{
+			static_cast<ID3D12PipelineState*>(pPipelineState)->Release();
+		},
+		[this](uint32_t, void* pReplaced)
+		{
+			// Batches of this key bound the base variant until now; their bundles are stale.
+			mBundleCache.invalidatePipelineState(pReplaced, mFenceTracker.getCurrentValue());
+		});
+	if (!isInitialized)
+	{
+		throw std::exception("Failed to build the geometry pipeline state");
+	}
+
+	mPSOGeometory = static_cast<ID3D12PipelineState*>(mGeometryPermutations.acquire(0));
+
+	ThrowIfFailed(createUpscalePipelineState(&mPSOUpscale));
+}
 
+/// <summary>
+/// Builds the geometry pipeline with the given keywords. Runs on the permutation build thread.
+/// </summary>
+HRESULT Renderer::createGeometryPipelineState(uint32_t keywords, ID3D12PipelineState** ppPipelineState)
+{
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{};
 	psoDesc.pRootSignature = mRootSignature.Get();
 	psoDesc.NodeMask = 0;
@@ -455,58 +562,22 @@ void Renderer::loadPipelineState()
 	};
 	psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
 
-#if defined(_DEBUG)
-	// Enable better shader debugging with the graphics debugging tools.
-	UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-	UINT compileFlags = 0;
-#endif
+	// Mapped from the shader cache; compiled only when the cache has no entry yet
+	ShaderDesc vertexShader = getShaderDescs()[GeometryVertexShader];
+	ShaderDesc pixelShader = getShaderDescs()[GeometryPixelShader];
+	getGeometryKeywords().getDefines(keywords, vertexShader.defines);
+	getGeometryKeywords().getDefines(keywords, pixelShader.defines);
 
-	/*
+	HRESULT hr = mShaderCache.load(vertexShader, &psoDesc.VS);
+	if (FAILED(hr))
 	{
-		FILE* file = nullptr;
-		fopen_s(&file, "VertexShader.cso", "rb");
-		long int fsize = _filelength(_fileno(file));
-
-		unsigned char* buffer = new unsigned char[fsize];
-		fread_s(buffer, fsize, fsize, 1, file);
-		fclose(file);
-
-		D3D12_SHADER_BYTECODE byteCode;
-		byteCode.pShaderBytecode = buffer;
-		byteCode.BytecodeLength = fsize;
+		return hr;
+	}
+	hr = mShaderCache.load(pixelShader, &psoDesc.PS);
+	if (FAILED(hr))
+	{
+		return hr;
 	}
-	*/
-
-	// _VF[_
-	ComPtr<ID3DBlob> VS;
-	ThrowIfFailed(D3DCompileFromFile(
-		Application::getAssetFullPath(L"shaders.hlsl").c_str(),
-		nullptr,
-		nullptr,
-		"VSMain",
-		"vs_5_0",
-		compileFlags,
-		0,
-		&VS,
-		&error
-	));
-	psoDesc.VS = { VS->GetBufferPointer(), VS->GetBufferSize() };
-
-	// sNZVF[_
-	ComPtr<ID3DBlob> PS;
-	ThrowIfFailed(D3DCompileFromFile(
-		Application::getAssetFullPath(L"shaders.hlsl").c_str(),
-		nullptr,
-		nullptr,
-		"PSMain",
-		"ps_5_0",
-		compileFlags,
-		0,
-		&PS,
-		&error
-	));
-	psoDesc.PS = { PS->GetBufferPointer(), PS->GetBufferSize() };
 
 	// uhXe[g
 	D3D12_BLEND_DESC blendState;
@@ -571,7 +642,100 @@ void Renderer::loadPipelineState()
 	}
 	psoDesc.DepthStencilState = depthStencilState;
 
-	ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&mPSOGeometory)));
+	return mPipelineStateCache.createGraphicsPipelineState(psoDesc, mRootSignatureHash, ppPipelineState);
+}
+
+/// <summary>
+/// Full screen triangle generated from SV_VertexID : no input layout, no depth, no culling.
+/// </summary>
+HRESULT Renderer::createUpscalePipelineState(ID3D12PipelineState** ppPipelineState)
+{
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{};
+	psoDesc.pRootSignature = mRootSignature.Get();
+	psoDesc.NodeMask = 0;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.SampleDesc.Count = 1;
+	psoDesc.SampleDesc.Quality = 0;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	psoDesc.DepthStencilState.DepthEnable = FALSE;
+	psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+
+	HRESULT hr = mShaderCache.load(getShaderDescs()[UpscaleVertexShader], &psoDesc.VS);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	hr = mShaderCache.load(getShaderDescs()[UpscalePixelShader], &psoDesc.PS);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return mPipelineStateCache.createGraphicsPipelineState(psoDesc, mRootSignatureHash, ppPipelineState);
+}
+
+const std::vector<ShaderDesc>& Renderer::getShaderDescs()
+{
+#if defined(_DEBUG)
+	// Enable better shader debugging with the graphics debugging tools.
+	const uint32_t compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	const uint32_t compileFlags = 0;
+#endif
+
+	static const std::vector<ShaderDesc> shaders =
+	{
+		{ "shaders.hlsl", "VSMain", "vs_5_0", {}, compileFlags },	// GeometryVertexShader
+		{ "shaders.hlsl", "PSMain", "ps_5_0", {}, compileFlags },	// GeometryPixelShader
+		{ "upscale.hlsl", "VSUpscale", "vs_5_1", {}, compileFlags },	// UpscaleVertexShader
+		{ "upscale.hlsl", "PSUpscale", "ps_5_1", {}, compileFlags },	// UpscalePixelShader
+	};
+	return shaders;
+}
+
+const ShaderKeywordSet& Renderer::getGeometryKeywords()
+{
+	static const ShaderKeywordSet keywords = { "INSTANCE_TINT", "SHOW_NORMALS" };
+	return keywords;
+}
+
+/// <summary>
+/// Run at build time with -precompile, so the first launch finds every shader in the cache.
+/// Every variant is compiled, so no keyword combination waits for the compiler either.
+/// </summary>
+bool Renderer::precompileShaders()
+{
+	ShaderCache shaderCache;
+	shaderCache.initialize(Application::getAssetFullPath(L""), Application::getAssetFullPath(ShaderCacheDirectory), true);
+
+	bool isSucceeded = true;
+	const ShaderKeywordSet& keywords = getGeometryKeywords();
+	const std::vector<ShaderDesc>& shaders = getShaderDescs();
+	for (uint32_t shader = 0; shader < shaders.size(); ++shader)
+	{
+		// Only the geometry shaders have keywords
+		const uint32_t variantCount = (shader <= GeometryPixelShader) ? keywords.getVariantCount() : 1;
+		for (uint32_t key = 0; key < variantCount; ++key)
+		{
+			ShaderDesc desc = shaders[shader];
+			keywords.getDefines(key, desc.defines);
+
+			D3D12_SHADER_BYTECODE bytecode;
+			if (FAILED(shaderCache.load(desc, &bytecode)))
+			{
+				OutputDebugStringA(("Failed to compile " + desc.file + " (" + desc.entryPoint + ")\n").c_str());
+				isSucceeded = false;
+			}
+		}
+	}
+	return isSucceeded;
 }
 
 /// <summary>
@@ -587,6 +751,7 @@ void Renderer::setDescriptorResource()
 		{
 			mDevice->CreateRenderTargetView(mRenderTargets[n].Get(), nullptr, mRTVHeap.GetCPUDescriptorHandle(n));
 		}
+		mDevice->CreateRenderTargetView(mRenderGraphResources.getResource(mSceneColorResource), nullptr, mRTVHeap.GetCPUDescriptorHandle(SceneColorView));
 	}
 
 	// fBXNv^q[v : DSV
@@ -597,50 +762,18 @@ void Renderer::setDescriptorResource()
 		dsvDesc.Texture2D.MipSlice = 0;
 		dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
 
-		mDevice->CreateDepthStencilView(mDepthStencil.Get(), &dsvDesc, mDSVHeap.GetCPUDescriptorHandle(0));
-	}
-
-	// fBXNv^q[v : CBV
-	{
-		// fBXNv^[0] : DefaultConstantBuffer
-		{
-			D3D12_CONSTANT_BUFFER_VIEW_DESC bufferDesc{};
-			bufferDesc.BufferLocation = mObjectConstantBuffer->GetGPUVirtualAddress();
-			bufferDesc.SizeInBytes = sizeof(ObjectConstantBuffer);
-			mDevice->CreateConstantBufferView(&bufferDesc, mCBVHeap.GetCPUDescriptorHandle(0));
-		}
-
-		// fBXNv^[1] : SceneConstantBuffer
-		{
-			D3D12_CONSTANT_BUFFER_VIEW_DESC bufferDesc{};
-			bufferDesc.BufferLocation = mSceneConstantBuffer->GetGPUVirtualAddress();
-			bufferDesc.SizeInBytes = sizeof(CameraConstantBuffer);
-			mDevice->CreateConstantBufferView(&bufferDesc, mCBVHeap.GetCPUDescriptorHandle(1));
-		}
-	}
-}
-
-/// <summary>
-/// \[Xƃf[^|C^ݒ
-/// </summary>
-void Renderer::setResourceDataPtr()
-{
-	// DefaultConstantBuffer
-	{
-		D3D12_RANGE readRange;
-		readRange.Begin = 0;
-		readRange.End = 0;
-
-		ThrowIfFailed(mObjectConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mDataPtr[0])));
+		mDevice->CreateDepthStencilView(mRenderGraphResources.getResource(mDepthResource), &dsvDesc, mDSVHeap.GetCPUDescriptorHandle(0));
 	}
 
-	// SceneConstantBuffer
+	// Bindless SRV : scene color, sampled by the upscale pass
 	{
-		D3D12_RANGE readRange;
-		readRange.Begin = 0;
-		readRange.End = 0;
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Texture2D.MipLevels = 1;
 
-		ThrowIfFailed(mSceneConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mDataPtr[1])));
+		mDevice->CreateShaderResourceView(mRenderGraphResources.getResource(mSceneColorResource), &srvDesc, mDescriptorHeap.getCPUHandle(mSceneColorDescriptor));
 	}
 }
 
@@ -676,7 +809,8 @@ void Renderer::createSwapChain(IDXGIFactory4* factory)
 	swapChainDesc1.Scaling = DXGI_SCALING_STRETCH;
 	swapChainDesc1.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
 	swapChainDesc1.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-	swapChainDesc1.Flags = 0;
+	// Lets the game thread wait for room in the present queue before it starts a frame (FramePacer)
+	swapChainDesc1.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
 	//	FullScreen
 	//	tXN[[hgpۂɐݒ
@@ -705,7 +839,10 @@ void Renderer::createSwapChain(IDXGIFactory4* factory)
 	ThrowIfFailed(swapChain.As(&mSwapChain));
 
 	mFrameIndex = mSwapChain->GetCurrentBackBufferIndex();
-	mSwapChainEvent = mSwapChain->GetFrameLatencyWaitableObject();
+	mBackBufferWidth = swapChainDesc1.Width;
+	mBackBufferHeight = swapChainDesc1.Height;
+	ThrowIfFailed(mSwapChain->SetMaximumFrameLatency(mFramePacing.maxFramesInFlight));
+	mPresentQueue.initialize(mSwapChain->GetFrameLatencyWaitableObject());
 }
 
 void Renderer::createCommandAllocator()
@@ -736,37 +873,80 @@ void Renderer::createCommandList()
 
 void Renderer::createSyncObject()
 {
-	for (UINT i = 0; i < FrameCount; ++i) {
-		ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFences[i])));
-		mFenceValues[i] = 0;
-	}
-	++mFenceValues[mFrameIndex];
-
-	// Create an event handle to use for frame synchronization.
-	mFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-	if (mFenceEvent == nullptr)
+	mFrameFence.initialize(mDevice.Get(), mCommandQueue.Get(), 0);
+	mFenceTracker.initialize(&mFrameFence, 0);
+	mReleaseQueue.initialize(&mFenceTracker);
+	for (UINT i = 0; i < FrameCount; ++i)
 	{
-		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		mFrameFenceValues[i] = 0;
 	}
 
-	// GPUFence̒lύX
-	ThrowIfFailed(mCommandQueue->Signal(mFences[mFrameIndex].Get(), mFenceValues[mFrameIndex]));
-
-	// lZbg܂CPUҋ@
-	ThrowIfFailed(mFences[mFrameIndex]->SetEventOnCompletion(mFenceValues[mFrameIndex], mFenceEvent));
-
-	WaitForSingleObject(mFenceEvent, INFINITE);
+	// Make sure the queue is up before anything is submitted to it.
+	mFenceTracker.waitIdle();
 }
 
 void Renderer::createPipelineAssets()
 {
-	LONG width, height;
-	RECT rect;
-	GetWindowRect(Application::getHwnd(), &rect);
-
-	width = rect.right - rect.left;
-	height = rect.bottom - rect.top;
+	// Placed resources : large heaps per heap type and resource class, split up by TLSF
+	mGpuMemory.initialize(mDevice.Get(), GpuHeapSize, &mReleaseQueue);
+
+	// Size dependent : back buffers, then the graph's targets, then the views of both.
+	// Released in the opposite order on resize, so the graph lets go of the back buffer first.
+	mSceneColorDescriptor = mDescriptorHeap.allocate();
+	mSizeDependents.add("BackBuffers",
+		[this](uint32_t, uint32_t) { createBackBuffers(); },
+		[this]()
+		{
+			for (UINT n = 0; n < FrameCount; n++)
+			{
+				mRenderTargets[n].Reset();
+			}
+		});
+	mSizeDependents.add("RenderGraph",
+		[this](uint32_t width, uint32_t height) { createRenderTargets(width, height); },
+		[this]()
+		{
+			mRenderGraph.clear();
+			mRenderGraphResources.destroy();
+		});
+	mSizeDependents.add("Views",
+		[this](uint32_t, uint32_t) { setDescriptorResource(); },
+		[]() {});
+	mSizeDependents.create(mBackBufferWidth, mBackBufferHeight);
+
+	// GPU timings : whole frame and per pass, read back once the frame's fence has completed.
+	// The frame time also drives dynamic resolution.
+	ThrowIfFailed(mTimestampQueries.Create(mDevice.Get(), mCommandQueue.Get(), GpuProfiler::GetQueryCount(FrameCount, MaxGpuZones)));
+	mGpuProfiler.initialize(&mTimestampQueries, FrameCount, MaxGpuZones);
+	mRenderScale = mResolution.getScale();
+
+	// Constant buffers : one persistently mapped upload ring, a region per frame
+	ThrowIfFailed(mConstantBuffer.Create(mDevice.Get(), ConstantBufferFrameSize, FrameCount));
+	mConstantBuffer.beginFrame(mFrameIndex);
+
+	// Draw recording : one allocator per pooled list, so workers never share an allocator
+	mCommandListFactory.initialize(mDevice.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+	mCommandListPool.initialize(&mCommandListFactory, FrameCount);
+	mCommandListPool.beginFrame(mFrameIndex);
+
+	// Uploads : staging ring on a copy queue of its own
+	mCopyQueue.initialize(mDevice.Get(), UploadStagingSize);
+	UploadBatchPolicy uploadPolicy;
+	uploadPolicy.maxBytes = UploadBatchBytes;
+	uploadPolicy.maxCopies = UploadBatchCopies;
+	mUploadQueue.initialize(&mCopyQueue, mCopyQueue.getStagingData(), mCopyQueue.getStagingSize(), uploadPolicy);
+
+	JobSystem* pJobSystem = JobSystem::getInstance();
+	const uint32_t maxRangeCount = (pJobSystem != nullptr) ? pJobSystem->getWorkerCount() + 1 : 1;
+	mCommandRecorder.initialize(&mCommandListPool, maxRangeCount, MinDrawsPerCommandList);
+
+	// Bundles : batches that stay the same from frame to frame are replayed instead of re-recorded
+	mBundleRecorder.initialize(mDevice.Get(), mDescriptorHeap.getHeap(), RootDrawConstants);
+	mBundleCache.initialize(&mBundleRecorder);
+}
 
+void Renderer::createBackBuffers()
+{
 	// \[X̐ : RenderTarget
 	{
 		for (UINT n = 0; n < FrameCount; n++)
@@ -774,109 +954,100 @@ void Renderer::createPipelineAssets()
 			ThrowIfFailed(mSwapChain->GetBuffer(n, IID_PPV_ARGS(&mRenderTargets[n])));
 		}
 	}
+}
 
-	// \[X̐ : DepthStencil
-	{
-		D3D12_HEAP_PROPERTIES heapProp{};
-		heapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
-		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProp.CreationNodeMask = 0;
-		heapProp.VisibleNodeMask = 0;
+/// <summary>
+/// Declares the graph's targets at the back buffer size and compiles the graph around them.
+/// </summary>
+void Renderer::createRenderTargets(uint32_t width, uint32_t height)
+{
+	// Frame passes : transients are placed in the render graph's own heap
+	mRenderGraph.clear();
+	mRenderGraphResources.initialize(mDevice.Get());
 
+	// Scene color : what the scene pass renders to at the render scale, stretched over the back buffer
+	{
 		D3D12_RESOURCE_DESC resDesc{};
 		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 		resDesc.Alignment = 0;
 		resDesc.Width = width;
 		resDesc.Height = height;
 		resDesc.DepthOrArraySize = 1;
-		resDesc.MipLevels = 0;
-		resDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		resDesc.MipLevels = 1;
+		resDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		resDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 		resDesc.SampleDesc.Count = 1;
 		resDesc.SampleDesc.Quality = 0;
-		resDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+		resDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
 		D3D12_CLEAR_VALUE clearValue{};
-		clearValue.Format = DXGI_FORMAT_D32_FLOAT;
-		clearValue.DepthStencil.Depth = 1.0f;
-		clearValue.DepthStencil.Stencil = 0;
+		clearValue.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 
-		for (UINT n = 0; n < FrameCount; n++) {
-			ThrowIfFailed(mDevice->CreateCommittedResource(
-				&heapProp,
-				D3D12_HEAP_FLAG_NONE,
-				&resDesc,
-				D3D12_RESOURCE_STATE_DEPTH_WRITE,
-				&clearValue,
-				IID_PPV_ARGS(&mDepthStencil))
-			);
-		}
+		mSceneColorResource = mRenderGraphResources.createTexture(mRenderGraph, "SceneColor", resDesc, &clearValue);
 	}
 
-	// \[X̐ : DefaultConstantBuffer
+	// \[X̐ : DepthStencil
 	{
-		D3D12_HEAP_PROPERTIES heapProp{};
-		heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProp.CreationNodeMask = 0;
-		heapProp.VisibleNodeMask = 0;
-
 		D3D12_RESOURCE_DESC resDesc{};
-		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 		resDesc.Alignment = 0;
-		resDesc.Width = sizeof(ObjectConstantBuffer);
-		resDesc.Height = 1;
+		resDesc.Width = width;
+		resDesc.Height = height;
 		resDesc.DepthOrArraySize = 1;
 		resDesc.MipLevels = 1;
-		resDesc.Format = DXGI_FORMAT_UNKNOWN;
+		resDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		resDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 		resDesc.SampleDesc.Count = 1;
 		resDesc.SampleDesc.Quality = 0;
-		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		ThrowIfFailed(mDevice->CreateCommittedResource(
-			&heapProp,
-			D3D12_HEAP_FLAG_NONE,
-			&resDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&mObjectConstantBuffer))
-		);
+		resDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+		D3D12_CLEAR_VALUE clearValue{};
+		clearValue.Format = DXGI_FORMAT_D32_FLOAT;
+		clearValue.DepthStencil.Depth = 1.0f;
+		clearValue.DepthStencil.Stencil = 0;
+
+		// A single depth buffer is shared by every frame, cleared by the pass that first writes it.
+		mDepthResource = mRenderGraphResources.createTexture(mRenderGraph, "Depth", resDesc, &clearValue);
 	}
 
-	// \[X̐ : SceneConstantBuffer
-	{
-		D3D12_HEAP_PROPERTIES heapProp{};
-		heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProp.CreationNodeMask = 0;
-		heapProp.VisibleNodeMask = 0;
+	buildRenderGraph();
+}
 
-		D3D12_RESOURCE_DESC resDesc{};
-		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		resDesc.Alignment = 0;
-		resDesc.Width = sizeof(CameraConstantBuffer);
-		resDesc.Height = 1;
-		resDesc.DepthOrArraySize = 1;
-		resDesc.MipLevels = 1;
-		resDesc.Format = DXGI_FORMAT_UNKNOWN;
-		resDesc.SampleDesc.Count = 1;
-		resDesc.SampleDesc.Quality = 0;
-		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		ThrowIfFailed(mDevice->CreateCommittedResource(
-			&heapProp,
-			D3D12_HEAP_FLAG_NONE,
-			&resDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&mSceneConstantBuffer))
-		);
+/// <summary>
+/// Waits for the frames in flight only, since they are what still references the back buffers.
+/// Every frame slot is free afterwards, so the per-frame rings follow the new back buffer index.
+/// </summary>
+void Renderer::resize(uint32_t width, uint32_t height)
+{
+	if (width == mBackBufferWidth && height == mBackBufferHeight)
+	{
+		return;
 	}
+
+	mFenceTracker.wait(mFenceTracker.getLastSignaledValue());
+
+	mSizeDependents.release();
+
+	// Keep the flags the swap chain was created with, or the frame latency waitable object stops working.
+	ThrowIfFailed(mSwapChain->ResizeBuffers(FrameCount, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT));
+	mBackBufferWidth = width;
+	mBackBufferHeight = height;
+
+	mSizeDependents.create(width, height);
+
+	mFrameIndex = mSwapChain->GetCurrentBackBufferIndex();
+	mConstantBuffer.beginFrame(mFrameIndex);
+	mDescriptorHeap.beginFrame(mFrameIndex);
+	mCommandListPool.beginFrame(mFrameIndex);
+
+	// Frame times measured at the old size say little about the new one.
+	mGpuProfiler.invalidate();
+	mResolution.reset();
+	mRenderScale = mResolution.getScale();
+
+	char message[128];
+	sprintf_s(message, "Resized to %ux%u\n", width, height);
+	OutputDebugStringA(message);
 }
 
 void Renderer::createAssets()
@@ -891,232 +1062,345 @@ void Renderer::createAssets()
 			{ { -1.0f, -1.0f,  0.0f }, { 0.0f, 1.0f, 0.0f},{ 0.0f, 1.0f}, { 0.0f, 0.0f, 1.0f, 1.0f } },
 			{ {  1.0f, -1.0f,  0.0f }, { 0.0f, 1.0f, 0.0f},{ 1.0f, 1.0f}, { 0.0f, 0.0f, 0.0f, 1.0f } }
 		};
-		const UINT vertexBufferSize = sizeof(triangleVertices);
-
-		D3D12_HEAP_PROPERTIES heapProp{};
-		heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProp.CreationNodeMask = 0;
-		heapProp.VisibleNodeMask = 0;
-
-		D3D12_RESOURCE_DESC resDesc{};
-		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		resDesc.Alignment = 0;
-		resDesc.Width = vertexBufferSize;
-		resDesc.Height = 1;
-		resDesc.DepthOrArraySize = 1;
-		resDesc.MipLevels = 1;
-		resDesc.Format = DXGI_FORMAT_UNKNOWN;
-		resDesc.SampleDesc.Count = 1;
-		resDesc.SampleDesc.Quality = 0;
-		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		ThrowIfFailed(mDevice->CreateCommittedResource(
-			&heapProp,
-			D3D12_HEAP_FLAG_NONE,
-			&resDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&mVertexBuffer))
-		);
-
-		// Copy the triangle data to the vertex buffer.
-		UINT8* pVertexDataBegin;
-
-		// We do not intend to read from this resource on the CPU.
-		D3D12_RANGE readRange;
-		readRange.Begin = 0;
-		readRange.End = 0;
-
-		ThrowIfFailed(mVertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-		memcpy(pVertexDataBegin, triangleVertices, sizeof(triangleVertices));
-		mVertexBuffer->Unmap(0, nullptr);
-
-		// Initialize the vertex buffer view.
-		mVertexBufferView.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
-		mVertexBufferView.StrideInBytes = sizeof(Vertex3D);
-		mVertexBufferView.SizeInBytes = vertexBufferSize;
-	}
-
-	// CxbNXobt@̍쐬
-	{
 		UINT32 indices[] =
 		{
 			0,1,2,
 			1,3,2
 		};
-		const UINT indexBufferSize = sizeof(indices);
-
-		D3D12_HEAP_PROPERTIES heapProp{};
-		heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProp.CreationNodeMask = 0;
-		heapProp.VisibleNodeMask = 0;
-
-		D3D12_RESOURCE_DESC resDesc{};
-		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		resDesc.Alignment = 0;
-		resDesc.Width = indexBufferSize;
-		resDesc.Height = 1;
-		resDesc.DepthOrArraySize = 1;
-		resDesc.MipLevels = 1;
-		resDesc.Format = DXGI_FORMAT_UNKNOWN;
-		resDesc.SampleDesc.Count = 1;
-		resDesc.SampleDesc.Quality = 0;
-		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		ThrowIfFailed(mDevice->CreateCommittedResource(
-			&heapProp,
-			D3D12_HEAP_FLAG_NONE,
-			&resDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&mIndexBuffer))
-		);
-
-		UINT8* pIndexDataBegin;
 
-		D3D12_RANGE readRange;
-		readRange.Begin = 0;
-		readRange.End = 0;
-
-		ThrowIfFailed(mIndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-		memcpy(pIndexDataBegin, indices, indexBufferSize);
-		mIndexBuffer->Unmap(0, nullptr);
+		ThrowIfFailed(mQuadMesh.Create(&mGpuMemory, &mUploadQueue, triangleVertices, _countof(triangleVertices), indices, _countof(indices)));
+	}
+}
 
-		mIndexBufferView.BufferLocation = mIndexBuffer->GetGPUVirtualAddress();
-		mIndexBufferView.SizeInBytes = indexBufferSize;
-		mIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+/// <summary>
+/// Declares the frame's passes and what they access. The graph derives every barrier from this,
+/// and places transients whose lifetimes do not overlap in the same memory.
+/// </summary>
+void Renderer::buildRenderGraph()
+{
+	mBackBufferResource = mRenderGraph.importResource("BackBuffer", RenderGraphState::Present, RenderGraphState::Present);
 
-		mIndexCount = _countof(indices);
+	// A pass may move mpBarrierCommandList on, so its GPU zone ends in whatever list that is afterwards.
+	const uint32_t scenePass = mRenderGraph.addPass("Scene", [this](const void* pContext)
+	{
+		mGpuProfiler.beginZone(mpBarrierCommandList, &GpuSceneZone);
+		record(static_cast<const RenderSnapshot*>(pContext));
+		mGpuProfiler.endZone(mpBarrierCommandList);
+	});
+	mRenderGraph.write(scenePass, mSceneColorResource, RenderGraphState::RenderTarget);
+	mRenderGraph.write(scenePass, mDepthResource, RenderGraphState::DepthWrite);
+
+	const uint32_t upscalePass = mRenderGraph.addPass("Upscale", [this](const void*)
+	{
+		mGpuProfiler.beginZone(mpBarrierCommandList, &GpuUpscaleZone);
+		recordUpscale();
+		mGpuProfiler.endZone(mpBarrierCommandList);
+	});
+	mRenderGraph.read(upscalePass, mSceneColorResource, RenderGraphState::PixelShaderResource);
+	mRenderGraph.write(upscalePass, mBackBufferResource, RenderGraphState::RenderTarget);
+
+	if (!mRenderGraph.compile())
+	{
+		OutputDebugStringA(("ERROR: Render graph: " + mRenderGraph.getError() + "\n").c_str());
+		throw std::exception("Failed to compile the render graph");
 	}
+	mRenderGraphResources.realize(mRenderGraph);
 
-	// oh
-	{
-		// Create the Bundle Allocator
-		ThrowIfFailed(mDevice->CreateCommandAllocator(
-			D3D12_COMMAND_LIST_TYPE_BUNDLE,
-			IID_PPV_ARGS(&mBundleAllocator))
-		);
+	const RenderGraphMemoryReport report = mRenderGraph.getMemoryReport();
+	char message[256];
+	sprintf_s(message, "Render graph: %u transients, %llu bytes placed in %llu (%llu saved by aliasing)\n",
+		report.transientCount, report.unaliasedSize, report.aliasedSize, report.getSavedSize());
+	OutputDebugStringA(message);
+}
 
-		// Create and record the bundle
-		{
-			ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, mBundleAllocator.Get(), mPSOGeometory.Get(), IID_PPV_ARGS(&mBundle)));
-			mBundle->SetGraphicsRootSignature(mRootSignature.Get());
-			mBundle->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			mBundle->IASetVertexBuffers(0, 1, &mVertexBufferView);
-			mBundle->IASetIndexBuffer(&mIndexBufferView);
-			mBundle->DrawIndexedInstanced(mIndexCount, 1, 0, 0, 0);
-			ThrowIfFailed(mBundle->Close());
-		}
-	}
+/// <summary>
+/// Runs the passes in the compiled order, each after its barriers.
+/// </summary>
+void Renderer::executeRenderGraph(const RenderSnapshot& snapshot)
+{
+	mRenderGraph.execute(&snapshot, [this](const void*, const RenderGraphBarrier* pBarriers, uint32_t count)
+	{
+		mRenderGraphResources.recordBarriers(mpBarrierCommandList, pBarriers, count);
+	});
 }
 
 void Renderer::begin()
 {
-	resetCommandList(mCommandAllocators[mFrameIndex].Get());
+	PROFILE_ZONE("Renderer::begin");
 
-#if 1
-	{
-		D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(mRenderTargets[mFrameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-		mCommandList->ResourceBarrier(1, &barrier);
-	}
-#else
-	// Indicate that the back buffer will be used as a render target.
-	{
-		// Xbv`FC\\(D3D12_RESOURCE_STATE_PRESENT)  _[^[Qbg(D3D12_RESOURCE_STATE_RENDER_TARGET)
+	resetCommandList(mCommandAllocators[mFrameIndex].Get());
+	mGpuProfiler.beginFrame(mCommandList.Get(), mFrameIndex);
 
-		D3D12_RESOURCE_BARRIER barrier;
-		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-		barrier.Transition.pResource = mRenderTargets[mFrameIndex].Get();
-		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	mSubmitCommandLists.clear();
+	mSubmitCommandLists.push_back(mCommandList.Get());
 
-		mCommandList->ResourceBarrier(1, &barrier);
-	}
-#endif
+	// The graph transitions the back buffer from and back to present around the passes that use it.
+	mRenderGraphResources.setImported(mBackBufferResource, mRenderTargets[mFrameIndex].Get());
+	mpBarrierCommandList = mCommandList.Get();
 }
 
-void Renderer::record(Camera* pCamera)
+void Renderer::record(const RenderSnapshot* pSnapshot)
 {
+	PROFILE_ZONE("Renderer::record");
+
 	// Signatureݒ
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
-	if (pCamera != nullptr)
+	if (pSnapshot != nullptr)
 	{
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(mRTVHeap.GetCPUDescriptorHandle(mFrameIndex));
+		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(mRTVHeap.GetCPUDescriptorHandle(SceneColorView));
 		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(mDSVHeap.GetCPUDescriptorHandle(0));
 
+		D3D12_VIEWPORT viewport;
+		D3D12_RECT scissorRect;
+		getSceneViewport(*pSnapshot, &viewport, &scissorRect);
+
 		// RS : Rasterizer
 		// r[|[gƃVU[`̐ݒ
-		mCommandList->RSSetViewports(pCamera->getNumViewport(), &pCamera->getViewport());
-		mCommandList->RSSetScissorRects(pCamera->getNumViewport(), &pCamera->getScissorRect());
+		mCommandList->RSSetViewports(1, &viewport);
+		mCommandList->RSSetScissorRects(1, &scissorRect);
 
-		mCommandList->ClearRenderTargetView(rtvHandle, pCamera->getClearColor(), 0, nullptr);
+		mGpuProfiler.beginZone(mCommandList.Get(), &GpuClearZone);
+		mCommandList->ClearRenderTargetView(rtvHandle, pSnapshot->clearColor, 0, nullptr);
 		mCommandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+		mGpuProfiler.endZone(mCommandList.Get());
 
 		// RootParameterIndex
 		// Signatureɐݒ肵p[^ɕRÂ
-		ID3D12DescriptorHeap* ppHeaps[] = { mCBVHeap.GetHeap() };
+		ID3D12DescriptorHeap* ppHeaps[] = { mDescriptorHeap.getHeap() };
 		mCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+		mCommandList->SetGraphicsRootDescriptorTable(RootBindlessTable, mDescriptorHeap.getGPUHandle(0));
 
 		// SetConstantBuffer
-		mCommandList->SetGraphicsRootDescriptorTable(0, mCBVHeap.GetGPUDescriptorHandle(0));
-
-		// Ήp[^^CvD3D12_ROOT_PARAMETER_TYPE_CBV̏ꍇ
-		//mCommandList->SetGraphicsRootConstantBufferView(0,mConstantBuffer[0]->GetGPUVirtualAddress() + sizeof(ConstantBuffer) * mFrameIndex);
+		mCommandList->SetGraphicsRootConstantBufferView(RootCameraConstants, mSceneConstantAddress);
 
 		// OM : Output Merger
 		mCommandList->OMSetRenderTargets(1, &rtvHandle, TRUE, &dsvHandle);
 
 		// IuWFNg`
-		PIXBeginEvent(mCommandList.Get(), 0, L"Draw Object");
 		{
-			// Use Bundle
-			//mCommandList->ExecuteBundle(mBundle.Get());
+			// Spans the draw lists: begins before them in this list, ends in the list submitted after them.
+			mGpuProfiler.beginZone(mCommandList.Get(), &GpuDrawZone);
 
-			// IA : Input Assember
-			mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			mCommandList->IASetVertexBuffers(0, 1, &mVertexBufferView);
-			mCommandList->IASetIndexBuffer(&mIndexBufferView);
+			// Group instances by (mesh, pipeline state) and upload their data in one block.
+			mInstanceBatcher.build();
 
-			mCommandList->DrawIndexedInstanced(mIndexCount, 1, 0, 0, 0);
+			const std::vector<InstanceData>& instances = mInstanceBatcher.getInstances();
+			D3D12_GPU_VIRTUAL_ADDRESS instanceAddress = 0;
+			if (!instances.empty())
+			{
+				instanceAddress = mConstantBuffer.push(instances.data(), sizeof(InstanceData) * instances.size()).gpuAddress;
+			}
+
+			// Batches are split into contiguous ranges, each recorded on a worker into its own list.
+			const uint32_t batchCount = static_cast<uint32_t>(mInstanceBatcher.getBatches().size());
+			const std::vector<void*>& drawLists = mCommandRecorder.record(batchCount,
+				[this, pSnapshot, instanceAddress](void* pHandle, uint32_t begin, uint32_t end)
+				{
+					PROFILE_ZONE("Renderer::recordBatches");
+					ID3D12GraphicsCommandList* pCommandList = CommandListFactory::GetCommandList(pHandle);
+
+					PIXBeginEvent(pCommandList, 0, L"Draw Object");
+					setDrawState(pCommandList, *pSnapshot);
+					recordBatches(pCommandList, begin, end, instanceAddress);
+					PIXEndEvent(pCommandList);
+				});
+			// Closed by the recorder on the workers; failures surface here, on the render thread.
+			ThrowIfFailed(mCommandRecorder.getCloseResult());
+
+			for (void* pHandle : drawLists)
+			{
+				mSubmitCommandLists.push_back(CommandListFactory::GetCommandList(pHandle));
+			}
+
+			// Barriers of later passes must execute after the draw lists, so they go in a list submitted after them.
+			if (!drawLists.empty())
+			{
+				mpBarrierCommandList = CommandListFactory::GetCommandList(mCommandListPool.acquire());
+				mSubmitCommandLists.push_back(mpBarrierCommandList);
+			}
+
+			mGpuProfiler.endZone(mpBarrierCommandList);
 		}
-		PIXEndEvent(mCommandList.Get());
 	}
 }
 
-void Renderer::end()
+/// <summary>
+/// State every draw list needs, since command lists do not inherit state from each other.
+/// </summary>
+void Renderer::setDrawState(ID3D12GraphicsCommandList* pCommandList, const RenderSnapshot& snapshot)
 {
-#if 1
-	{
-		D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(mRenderTargets[mFrameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-		mCommandList->ResourceBarrier(1, &barrier);
-	}
-#else
-	// Indicate that the back buffer will now be used to present.
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(mRTVHeap.GetCPUDescriptorHandle(SceneColorView));
+	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(mDSVHeap.GetCPUDescriptorHandle(0));
+
+	D3D12_VIEWPORT viewport;
+	D3D12_RECT scissorRect;
+	getSceneViewport(snapshot, &viewport, &scissorRect);
+
+	pCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+
+	ID3D12DescriptorHeap* ppHeaps[] = { mDescriptorHeap.getHeap() };
+	pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+	pCommandList->SetGraphicsRootDescriptorTable(RootBindlessTable, mDescriptorHeap.getGPUHandle(0));
+	pCommandList->SetGraphicsRootConstantBufferView(RootCameraConstants, mSceneConstantAddress);
+
+	pCommandList->RSSetViewports(1, &viewport);
+	pCommandList->RSSetScissorRects(1, &scissorRect);
+	pCommandList->OMSetRenderTargets(1, &rtvHandle, TRUE, &dsvHandle);
+
+	// IA : Input Assember
+	pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+/// <summary>
+/// The snapshot's viewport scaled down to the render scale. The scene fills the top left of the
+/// scene color target, which the upscale pass then stretches over the back buffer.
+/// </summary>
+void Renderer::getSceneViewport(const RenderSnapshot& snapshot, D3D12_VIEWPORT* pViewport, D3D12_RECT* pScissorRect) const
+{
+	*pViewport = snapshot.viewport;
+	pViewport->TopLeftX *= mRenderScale;
+	pViewport->TopLeftY *= mRenderScale;
+	pViewport->Width *= mRenderScale;
+	pViewport->Height *= mRenderScale;
+
+	const LONG width = static_cast<LONG>(mResolution.getScaledSize(mBackBufferWidth));
+	const LONG height = static_cast<LONG>(mResolution.getScaledSize(mBackBufferHeight));
+	pScissorRect->left = static_cast<LONG>(snapshot.scissorRect.left * mRenderScale);
+	pScissorRect->top = static_cast<LONG>(snapshot.scissorRect.top * mRenderScale);
+	pScissorRect->right = (std::min)(static_cast<LONG>(snapshot.scissorRect.right * mRenderScale + 0.5f), width);
+	pScissorRect->bottom = (std::min)(static_cast<LONG>(snapshot.scissorRect.bottom * mRenderScale + 0.5f), height);
+}
+
+/// <summary>
+/// Stretches the rendered part of scene color over the back buffer with one fullscreen triangle.
+/// Recorded after the scene pass's barriers, so it goes to the list submitted after the draw lists.
+/// </summary>
+void Renderer::recordUpscale()
+{
+	ID3D12GraphicsCommandList* pCommandList = mpBarrierCommandList;
+	PIXBeginEvent(pCommandList, 0, L"Upscale");
+
+	pCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+
+	ID3D12DescriptorHeap* ppHeaps[] = { mDescriptorHeap.getHeap() };
+	pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+	pCommandList->SetGraphicsRootDescriptorTable(RootBindlessTable, mDescriptorHeap.getGPUHandle(0));
+
+	// DrawConstants : first instance (unused), source descriptor, uv scale
+	const float scaleX = static_cast<float>(mResolution.getScaledSize(mBackBufferWidth)) / mBackBufferWidth;
+	const float scaleY = static_cast<float>(mResolution.getScaledSize(mBackBufferHeight)) / mBackBufferHeight;
+	UINT constants[DrawConstantCount] = { 0, mSceneColorDescriptor, 0, 0 };
+	memcpy(&constants[2], &scaleX, sizeof(float));
+	memcpy(&constants[3], &scaleY, sizeof(float));
+	pCommandList->SetGraphicsRoot32BitConstants(RootDrawConstants, DrawConstantCount, constants, 0);
+
+	const D3D12_VIEWPORT viewport = { 0.0f, 0.0f, static_cast<float>(mBackBufferWidth), static_cast<float>(mBackBufferHeight), 0.0f, 1.0f };
+	const D3D12_RECT scissorRect = { 0, 0, static_cast<LONG>(mBackBufferWidth), static_cast<LONG>(mBackBufferHeight) };
+	pCommandList->RSSetViewports(1, &viewport);
+	pCommandList->RSSetScissorRects(1, &scissorRect);
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(mRTVHeap.GetCPUDescriptorHandle(mFrameIndex));
+	pCommandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+
+	pCommandList->SetPipelineState(mPSOUpscale.Get());
+	pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	pCommandList->DrawInstanced(3, 1, 0, 0);
+
+	PIXEndEvent(pCommandList);
+}
+
+/// <summary>
+/// Draws batches [begin, end) of this frame. Only reads the batcher, so ranges can be recorded concurrently.
+/// </summary>
+void Renderer::recordBatches(ID3D12GraphicsCommandList* pCommandList, uint32_t begin, uint32_t end, D3D12_GPU_VIRTUAL_ADDRESS instanceAddress)
+{
+	const std::vector<InstanceBatch>& batches = mInstanceBatcher.getBatches();
+
+	pCommandList->SetGraphicsRootShaderResourceView(RootInstanceData, instanceAddress);
+
+	const Mesh* pCurrentMesh = nullptr;
+	ID3D12PipelineState* pCurrentPipelineState = nullptr;
+	bool isTopologySet = true;
+	for (uint32_t i = begin; i < end; ++i)
 	{
-		// _[^[Qbg(D3D12_RESOURCE_STATE_RENDER_TARGET)  Xbv`FC\\(D3D12_RESOURCE_STATE_PRESENT) 
+		const InstanceBatch& batch = batches[i];
+		const Mesh* pMesh = static_cast<const Mesh*>(batch.pMesh);
+
+		const BundleKey key = { batch.pMesh, batch.pPipelineState, mRootSignature.Get() };
+		const BundleDraw draw = { batch.firstInstance, batch.instanceCount, pMesh->getGeometryId() };
+		void* pBundle = mBundleCache.acquire(key, draw, mFenceTracker.getCurrentValue());
+		if (pBundle != nullptr)
+		{
+			pCommandList->ExecuteBundle(BundleRecorder::GetBundle(pBundle));
+
+			// Do not rely on what the bundle leaves bound; the next direct draw binds everything again.
+			pCurrentPipelineState = nullptr;
+			pCurrentMesh = nullptr;
+			isTopologySet = false;
+			continue;
+		}
+
+		ID3D12PipelineState* pPipelineState = static_cast<ID3D12PipelineState*>(const_cast<void*>(batch.pPipelineState));
+		if (pPipelineState != pCurrentPipelineState)
+		{
+			pCommandList->SetPipelineState(pPipelineState);
+			pCurrentPipelineState = pPipelineState;
+		}
+
+		if (!isTopologySet)
+		{
+			pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			isTopologySet = true;
+		}
 
-		D3D12_RESOURCE_BARRIER barrier;
-		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-		barrier.Transition.pResource = mRenderTargets[mFrameIndex].Get();
-		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		if (pMesh != pCurrentMesh)
+		{
+			pCommandList->IASetVertexBuffers(0, 1, &pMesh->getVertexBufferView());
+			pCommandList->IASetIndexBuffer(&pMesh->getIndexBufferView());
+			pCurrentMesh = pMesh;
+		}
 
-		mCommandList->ResourceBarrier(1, &barrier);
+		// SV_InstanceID restarts at 0 for each draw, so the shader adds the batch's first instance.
+		pCommandList->SetGraphicsRoot32BitConstant(RootDrawConstants, batch.firstInstance, 0);
+		pCommandList->DrawIndexedInstanced(pMesh->getIndexCount(), batch.instanceCount, 0, 0, 0);
+	}
 }
-#endif
 
+void Renderer::end()
+{
+	PROFILE_ZONE("Renderer::end");
+
+	// The graph's final barriers, like the transition to present, were recorded by executeRenderGraph.
+	// The GPU frame ends in the last list submitted, so the frame's whole GPU time is measured.
+	mGpuProfiler.endFrame(mpBarrierCommandList);
 	ThrowIfFailed(mCommandList->Close());
+	if (mpBarrierCommandList != mCommandList.Get())
+	{
+		ThrowIfFailed(mpBarrierCommandList->Close());
+	}
+}
+
+/// <summary>
+/// Holds back this frame's command lists on the GPU until the geometry they draw has been copied.
+/// The CPU never blocks, and a mesh uploaded long ago costs one fence read.
+/// </summary>
+void Renderer::waitForUploads()
+{
+	// Uploads queued since the last frame go out as one submission.
+	mUploadQueue.flush();
+
+	uint64_t ticket = 0;
+	for (const InstanceBatch& batch : mInstanceBatcher.getBatches())
+	{
+		const uint64_t meshTicket = static_cast<const Mesh*>(batch.pMesh)->getUploadTicket();
+		ticket = (meshTicket > ticket) ? meshTicket : ticket;
+	}
+
+	if (mUploadQueue.submit(ticket))
+	{
+		mCopyQueue.waitOnQueue(mCommandQueue.Get(), ticket);
+	}
 }
 
 void Renderer::resetCommandList(ID3D12CommandAllocator* const allocator)
@@ -1137,34 +1421,75 @@ void Renderer::populateCommandList()
 
 }
 
-void Renderer::waitForGpu()
+/// <summary>
+/// Frees a persistent descriptor once the GPU is done with the frame being recorded.
+/// </summary>
+void Renderer::releaseDescriptor(uint32_t index)
 {
-	// GPUFence̒lύX
-	ThrowIfFailed(mCommandQueue->Signal(mFences[mFrameIndex].Get(), mFenceValues[mFrameIndex]));
+	mDescriptorHeap.free(index, mFenceTracker.getCurrentValue());
+}
 
-	// lZbg܂CPUҋ@
-	ThrowIfFailed(mFences[mFrameIndex]->SetEventOnCompletion(mFenceValues[mFrameIndex], mFenceEvent));
-	WaitForSingleObject(mFenceEvent, INFINITE);
+void Renderer::releaseMesh(Mesh* pMesh)
+{
+	mBundleCache.invalidateMesh(pMesh, mFenceTracker.getCurrentValue());
+	pMesh->Destroy();
+}
 
-	++mFenceValues[mFrameIndex];
+void Renderer::deferRelease(IUnknown* pObject)
+{
+	if (pObject != nullptr)
+	{
+		mReleaseQueue.release(&ReleaseComObject, pObject, 0);
+	}
+}
+
+void Renderer::waitForGpu()
+{
+	mFenceTracker.waitIdle();
 }
 
 void Renderer::moveToNextFrame()
 {
-	const UINT64 currentFenceValue = mFenceValues[mFrameIndex];
-	ThrowIfFailed(mCommandQueue->Signal(mFences[mFrameIndex].Get(), currentFenceValue));
+	PROFILE_ZONE("Renderer::moveToNextFrame");
+
+	mFrameFenceValues[mFrameIndex] = mFenceTracker.signal();
 
 	// Update the frame index.
 	mFrameIndex = mSwapChain->GetCurrentBackBufferIndex();
 
 	// If the next frame is not ready to be rendered yet, wait until it is ready.
-	if (mFences[mFrameIndex]->GetCompletedValue() < mFenceValues[mFrameIndex])
+	// With the frame paced on the swap chain this has usually completed already.
+	mFenceTracker.wait(mFrameFenceValues[mFrameIndex]);
+	collectGpuTimings();
+
+	// Frames complete in submission order, so everything freed up to the completed value is unused.
+	const UINT64 completedValue = mFenceTracker.poll();
+	mFenceTracker.retire();
+	mReleaseQueue.collect();
+	mDescriptorHeap.collect(completedValue);
+	mBundleCache.collect(completedValue);
+	if (completedValue > BundleEvictFrames)
 	{
-		ThrowIfFailed(mFences[mFrameIndex]->SetEventOnCompletion(mFenceValues[mFrameIndex], mFenceEvent));
-		WaitForSingleObjectEx(mFenceEvent, INFINITE, FALSE);
+		mBundleCache.evictUnused(completedValue - BundleEvictFrames);
 	}
 
-	mFenceValues[mFrameIndex] = currentFenceValue + 1;
+	// The GPU is done with this frame's constants, rewind its region of the ring.
+	mConstantBuffer.beginFrame(mFrameIndex);
+	mDescriptorHeap.beginFrame(mFrameIndex);
+	mCommandListPool.beginFrame(mFrameIndex);
+	mInstanceBatcher.clear();
+}
+
+/// <summary>
+/// Reads the GPU timings of the frame that last used this slot and feeds its time to the resolution
+/// controller. Its fence has completed, so the timestamps can be read without stalling.
+/// </summary>
+void Renderer::collectGpuTimings()
+{
+	if (mGpuProfiler.collect(mFrameIndex))
+	{
+		mRenderScale = mResolution.update(mGpuProfiler.getFrameTime());
+	}
 }
 
 #if defined(_DEBUG)
@@ -1222,13 +1547,14 @@ void Plane::onUpdate()
 	getTransform()->setLocalRotation(rotation);
 }
 
-void Plane::onRender()
+void Plane::onRender(RenderSnapshot& snapshot)
 {
-	ObjectConstantBuffer buffer;
+	Renderer* pRenderer = Renderer::getInstance();
 
-	XMFLOAT4X4 matrix;
-	XMStoreFloat4x4(&matrix, XMMatrixTranspose(getTransform()->getWorldMatrix()));
-	buffer.world = matrix;
+	SnapshotInstance instance;
+	instance.pMesh = pRenderer->getQuadMesh();
+	instance.pPipelineState = pRenderer->getDefaultPipelineState();
+	XMStoreFloat4x4(&instance.data.world, XMMatrixTranspose(getTransform()->getWorldMatrix()));
 
-	Renderer::getInstance()->onRegisterDataBuffer(0, &buffer, sizeof(ObjectConstantBuffer));
+	snapshot.instances.push_back(instance);
 }
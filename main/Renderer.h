@@ -1,31 +1,40 @@
 #ifndef __RENDERER_H__
 #define __RENDERER_H__
 
+#include <atomic>
+#include <vector>
+
 #include "Object.h"
+#include "Mesh.h"
+#include "InstanceBatcher.h"
+#include "RenderSnapshot.h"
+#include "CommandListFactory.h"
+#include "ParallelCommandRecorder.h"
+#include "BundleRecorder.h"
+#include "SwapChainPresentQueue.h"
+#include "CommandQueueFence.h"
+#include "TimestampQueryHeap.h"
+#include "ResolutionController.h"
+#include "SizeDependentRegistry.h"
+#include "UploadRingBuffer.h"
+#include "CopyCommandQueue.h"
+#include "GpuMemoryAllocator.h"
+#include "BindlessDescriptorHeap.h"
+#include "RenderGraph.h"
+#include "RenderGraphResources.h"
+#include "PipelineStateCache.h"
+#include "ShaderCache.h"
+#include "ShaderPermutationManager.h"
 
 using namespace DirectX;
 using namespace Microsoft::WRL;
 
-struct Vertex3D
-{
-	XMFLOAT3 position;
-	XMFLOAT3 normal;
-	XMFLOAT2 texCoord;
-	XMFLOAT4 color;
-};
-
-// static_assert((sizeof(ConstantBuffer) % 256) == 0, "Constant Buffer size must be 256-byte aligned");
-_declspec(align(256u)) struct ObjectConstantBuffer
-{
-	XMFLOAT4X4 world;
-};
-
 class Plane : public GameObject
 {
 public:
 	void onSetup();
 	void onUpdate();
-	void onRender();
+	void onRender(RenderSnapshot& snapshot);
 };
 
 class DescriptorHeap
@@ -54,11 +63,58 @@ public:
 	ComPtr<ID3D12Device>& getD3DDevice() { return mDevice; }
 
 	void onInit();
-	void onRender(class Camera* pCamera);
+	// Records and presents a frame built by the update thread. Called on the render thread.
+	void onRender(const RenderSnapshot& snapshot);
 	void onDestroy();
 
 	void onRegisterDataBuffer(int slot, void* pData, size_t size);
 
+	// Thread-safe, e.g. from WM_SIZE. The swap chain and everything registered with getSizeDependents
+	// are rebuilt at the start of the next frame; only the frames in flight are waited for.
+	void requestResize(uint32_t width, uint32_t height);
+	// Resources created at the back buffer size. Add to it on the render thread, or before onInit.
+	SizeDependentRegistry* getSizeDependents() { return &mSizeDependents; }
+	// The scene is rendered at a fraction of the back buffer size picked from the GPU frame time,
+	// then stretched over the back buffer.
+	void setResolutionSettings(const ResolutionSettings& settings);
+	float getRenderScale() const { return mRenderScale; }
+
+	const Mesh* getQuadMesh() const { return &mQuadMesh; }
+	// Drops the cached bundles drawing pMesh, then releases its buffers once the frame being recorded completes.
+	void releaseMesh(Mesh* pMesh);
+	// Fills DEFAULT heap resources through the copy queue, e.g. Mesh::Create.
+	UploadQueue* getUploadQueue() { return &mUploadQueue; }
+	// Places resources in shared heaps, e.g. Mesh::Create; also reports their fragmentation.
+	GpuMemoryAllocator* getGpuMemory() { return &mGpuMemory; }
+	// Takes over the reference and releases it once the frame being recorded has completed on the GPU,
+	// so a resource can be dropped at any time without waiting for the GPU. Thread-safe.
+	void deferRelease(IUnknown* pObject);
+	template <class T>
+	void deferRelease(ComPtr<T>& object) { deferRelease(object.Detach()); }
+	DeferredReleaseQueue* getReleaseQueue() { return &mReleaseQueue; }
+	// Shader visible descriptors, indexed from shaders through the bindless table (t0, space1).
+	// allocate() is thread-safe; give descriptors back with releaseDescriptor.
+	BindlessDescriptorHeap* getDescriptorHeap() { return &mDescriptorHeap; }
+	void releaseDescriptor(uint32_t index);
+	// Swap chain queue depth and present interval; FramePacer waits on getPresentQueue at frame start.
+	void setFramePacing(const FramePacingSettings& settings);
+	IPresentQueue* getPresentQueue() { return &mPresentQueue; }
+	// Fence values of the direct queue; getCurrentValue() completes with the frame being recorded.
+	// Any thread may check isComplete or enqueue work to run once a value retires.
+	FenceTracker* getFenceTracker() { return &mFenceTracker; }
+	// Whole frame and per pass GPU timings of the last completed frame
+	const GpuProfiler* getGpuProfiler() const { return &mGpuProfiler; }
+	ID3D12PipelineState* getDefaultPipelineState() const { return mPSOGeometory.Get(); }
+	// Geometry pipeline compiled with keywords (a getGeometryKeywords key).
+	// Returns the default pipeline until that variant has been built in the background.
+	ID3D12PipelineState* getPipelineState(uint32_t keywords) { return static_cast<ID3D12PipelineState*>(mGeometryPermutations.acquire(keywords)); }
+
+	// Every shader the renderer loads; precompileShaders compiles exactly these, in every variant.
+	static const std::vector<ShaderDesc>& getShaderDescs();
+	static const ShaderKeywordSet& getGeometryKeywords();
+	// Fills the shader cache next to the executable. Needs no device.
+	static bool precompileShaders();
+
 private:
 	void createHardwareAdapter(IDXGIFactory4* pFactory, IDXGIAdapter** ppAdapter, bool useWarpDevice, D3D_FEATURE_LEVEL featureLevel, bool requestHighPerformanceAdapter);
 	void createDevice(const D3D_FEATURE_LEVEL& featureLevel);
@@ -67,8 +123,9 @@ private:
 	void loadPipelineAssets();
 	void loadRootSignature();
 	void loadPipelineState();
+	HRESULT createGeometryPipelineState(uint32_t keywords, ID3D12PipelineState** ppPipelineState);
+	HRESULT createUpscalePipelineState(ID3D12PipelineState** ppPipelineState);
 
-	void setResourceDataPtr();
 	void setDescriptorResource();
 
 	void createCommandQueue();
@@ -79,11 +136,25 @@ private:
 	void createPipelineAssets();
 	void createDescriptorHeap();
 
+	// Entries of mSizeDependents, in creation order
+	void createBackBuffers();
+	void createRenderTargets(uint32_t width, uint32_t height);
+	void resize(uint32_t width, uint32_t height);
+
 	void createAssets();
 
+	void buildRenderGraph();
+	void executeRenderGraph(const RenderSnapshot& snapshot);
 	void begin();
-	void record(class Camera* pCamera);
+	void record(const RenderSnapshot* pSnapshot);
+	void setDrawState(ID3D12GraphicsCommandList* pCommandList, const RenderSnapshot& snapshot);
+	// The snapshot's viewport and scissor rectangle scaled to the part of the scene color target in use
+	void getSceneViewport(const RenderSnapshot& snapshot, D3D12_VIEWPORT* pViewport, D3D12_RECT* pScissorRect) const;
+	void recordUpscale();
+	void collectGpuTimings();
+	void recordBatches(ID3D12GraphicsCommandList* pCommandList, uint32_t begin, uint32_t end, D3D12_GPU_VIRTUAL_ADDRESS instanceAddress);
 	void end();
+	void waitForUploads();
 
 	void resetCommandList(ID3D12CommandAllocator* const allocator);
 	void populateCommandList();
@@ -98,7 +169,47 @@ private:
 #endif
 
 private:
+	// Index into getShaderDescs()
+	enum ShaderIndex
+	{
+		GeometryVertexShader,
+		GeometryPixelShader,
+		UpscaleVertexShader,
+		UpscalePixelShader,
+	};
+
+	// Root parameters, ordered from most to least frequently changed
+	enum RootParameter
+	{
+		RootDrawConstants,
+		RootCameraConstants,
+		RootInstanceData,
+		RootBindlessTable,
+	};
+	// DWORDs of per-draw root constants : the batch's first instance, then the upscale pass's
+	// source descriptor and UV scale
+	static const uint32_t DrawConstantCount = 4;
+
 	static const UINT FrameCount = 2;
+	// RTV of the scene color target, after the back buffers'
+	static const UINT SceneColorView = FrameCount;
+	// Per-frame size of the upload ring holding constants and instance data (~128k instances).
+	static const UINT64 ConstantBufferFrameSize = 8 * 1024 * 1024;
+	// Fewer batches than this are not worth a command list of their own
+	static const uint32_t MinDrawsPerCommandList = 32;
+	// Staging ring of the copy queue, and the size or copy count at which a batch is submitted early
+	static const UINT64 UploadStagingSize = 4 * 1024 * 1024;
+	static const UINT64 UploadBatchBytes = 1024 * 1024;
+	static const uint32_t UploadBatchCopies = 256;
+	// Size of each heap placed resources are suballocated from
+	static const UINT64 GpuHeapSize = 64 * 1024 * 1024;
+	// Descriptors of the bindless heap kept until freed, and those valid for one frame, per frame
+	static const uint32_t PersistentDescriptorCount = 65536;
+	static const uint32_t TransientDescriptorCount = 8192;
+	// Cached bundles not drawn for this many frames are destroyed
+	static const UINT64 BundleEvictFrames = 120;
+	// GPU zones per frame : the frame itself, its passes and their steps
+	static const uint32_t MaxGpuZones = 32;
 	static Renderer* gInstance;
 
 	bool								mUseWarpDevice;
@@ -111,40 +222,87 @@ private:
 	ComPtr<ID3D12CommandQueue>			mCommandQueue;
 	ComPtr<ID3D12CommandAllocator>		mCommandAllocators[FrameCount];
 	ComPtr<ID3D12RootSignature>			mRootSignature;
+	// Hash of the serialized root signature, part of every pipeline cache key
+	uint64_t							mRootSignatureHash;
+	// Declared before every placed resource, so its heaps outlive them
+	GpuMemoryAllocator					mGpuMemory;
+	// Objects dropped while the GPU may still use them; outlives everything that parks objects in it
+	DeferredReleaseQueue				mReleaseQueue;
 
 private:
 	DescriptorHeap mRTVHeap;
 	DescriptorHeap mDSVHeap;
-	DescriptorHeap mCBVHeap;
-	DescriptorHeap mSRVHeap;
+	BindlessDescriptorHeap mDescriptorHeap;
 
 	ComPtr<ID3D12Resource> mRenderTargets[FrameCount];
-	ComPtr<ID3D12Resource> mDepthStencil;
-	ComPtr<ID3D12Resource> mObjectConstantBuffer;
-	ComPtr<ID3D12Resource> mSceneConstantBuffer;
-	ComPtr<ID3D12Resource> mVertexBuffer;
-	ComPtr<ID3D12Resource> mIndexBuffer;
-
-	ComPtr<ID3D12CommandAllocator>		mBundleAllocator;
+	uint32_t mBackBufferWidth;
+	uint32_t mBackBufferHeight;
+	// Back buffers, graph targets and their views; rebuilt when the back buffers are resized
+	SizeDependentRegistry mSizeDependents;
+	// width << 32 | height of a requestResize not applied yet, 0 when none
+	std::atomic<uint64_t> mPendingSize;
+
+	// Frame passes and their barriers; the depth buffer is a transient placed in the graph's heap
+	RenderGraph							mRenderGraph;
+	RenderGraphResources				mRenderGraphResources;
+	uint32_t							mBackBufferResource;
+	uint32_t							mDepthResource;
+	// Back buffer sized, so a new render scale needs no new memory; read by the upscale pass through mSceneColorDescriptor
+	uint32_t							mSceneColorResource;
+	uint32_t							mSceneColorDescriptor;
+	// Where the graph records barriers; moves past the parallel draw lists once they are submitted
+	ID3D12GraphicsCommandList*			mpBarrierCommandList;
 
 	UINT								mFrameIndex;
 
 	// Asset objects
+	ShaderCache							mShaderCache;
+	PipelineStateCache					mPipelineStateCache;
+	ShaderPermutationManager			mGeometryPermutations;
 	ComPtr<ID3D12PipelineState>			mPSOGeometory;
+	ComPtr<ID3D12PipelineState>			mPSOUpscale;
 	ComPtr<ID3D12GraphicsCommandList>	mCommandList;
-	ComPtr<ID3D12GraphicsCommandList>	mBundle;
 
-	UINT8* mDataPtr[2];
+	// Constant buffers written this frame
+	UploadRingBuffer					mConstantBuffer;
+	D3D12_GPU_VIRTUAL_ADDRESS			mSceneConstantAddress;
+
+	// Instances registered this frame, drawn one DrawIndexedInstanced per batch
+	InstanceBatcher						mInstanceBatcher;
+
+	Mesh								mQuadMesh;
+
+	// Geometry copied into DEFAULT heaps on a copy queue, waited on by the direct queue only when drawn
+	CopyCommandQueue					mCopyQueue;
+	UploadQueue							mUploadQueue;
+
+	// Draw lists recorded in parallel, submitted between mCommandList and the list holding the final barriers
+	CommandListFactory					mCommandListFactory;
+	CommandListPool						mCommandListPool;
+	ParallelCommandRecorder				mCommandRecorder;
+
+	// Bundles of batches that did not change between frames, replayed by the draw lists
+	BundleRecorder						mBundleRecorder;
+	BundleCache							mBundleCache;
+
+	std::vector<ID3D12CommandList*>		mSubmitCommandLists;
+
+	// Dynamic resolution : scale of the frame being recorded, from the GPU time of completed frames
+	ResolutionController				mResolution;
+	float								mRenderScale;
 
-	D3D12_VERTEX_BUFFER_VIEW			mVertexBufferView;
-	D3D12_INDEX_BUFFER_VIEW				mIndexBufferView;
-	UINT								mIndexCount;
+	// GPU timings : a range of timestamp queries per frame in flight, read once its fence has completed
+	TimestampQueryHeap					mTimestampQueries;
+	GpuProfiler							mGpuProfiler;
 
 	// Synchronization objects
-	HANDLE								mSwapChainEvent;
-	ComPtr<ID3D12Fence>					mFences[FrameCount];
-	UINT64								mFenceValues[FrameCount];
-	HANDLE								mFenceEvent;
+	// Frames waiting for the display, and how many may
+	SwapChainPresentQueue				mPresentQueue;
+	FramePacingSettings					mFramePacing;
+	// One fence value per submission of mCommandQueue, and the value of each back buffer's last frame
+	CommandQueueFence					mFrameFence;
+	FenceTracker						mFenceTracker;
+	UINT64								mFrameFenceValues[FrameCount];
 };
 
 
@@ -0,0 +1,129 @@
+#include "ResolutionController.h"
+
+#include <cmath>
+
+ResolutionSettings ResolutionSettings::Default()
+{
+	ResolutionSettings settings;
+	settings.targetFrameTime = 1000.0f / 60.0f;
+	settings.hysteresis = 0.1f;
+	settings.minScale = 0.5f;
+	settings.maxScale = 1.0f;
+	settings.scaleStep = 0.05f;
+	settings.settleFrames = 4;
+	settings.smoothing = 0.2f;
+	return settings;
+}
+
+ResolutionController::ResolutionController()
+	: mSettings(ResolutionSettings::Default())
+	, mScale(1.0f)
+	, mAverageFrameTime(0.0f)
+	, mHasAverage(false)
+	, mSettleCount(0)
+	, mChangeCount(0)
+{
+
+}
+
+void ResolutionController::initialize(const ResolutionSettings& settings)
+{
+	mSettings = settings;
+	if (mSettings.minScale > mSettings.maxScale)
+	{
+		mSettings.minScale = mSettings.maxScale;
+	}
+	if (mSettings.scaleStep <= 0.0f)
+	{
+		mSettings.scaleStep = mSettings.maxScale - mSettings.minScale;
+	}
+	reset();
+}
+
+void ResolutionController::reset()
+{
+	mScale = mSettings.maxScale;
+	mAverageFrameTime = 0.0f;
+	mHasAverage = false;
+	mSettleCount = 0;
+}
+
+/// <summary>
+/// GPU time is taken to grow with the pixel count, the square of the scale, so over budget the
+/// scale drops straight to sqrt(target / average) of itself, at least one step. Climbing is
+/// one step at a time, and only once the larger scale is expected to stay inside the band.
+/// </summary>
+float ResolutionController::update(float gpuFrameTime)
+{
+	if (mSettleCount > 0)
+	{
+		--mSettleCount;
+		return mScale;
+	}
+
+	if (!mHasAverage)
+	{
+		mAverageFrameTime = gpuFrameTime;
+		mHasAverage = true;
+	}
+	else
+	{
+		mAverageFrameTime += mSettings.smoothing * (gpuFrameTime - mAverageFrameTime);
+	}
+
+	const float upperBound = mSettings.targetFrameTime * (1.0f + mSettings.hysteresis);
+	const float lowerBound = mSettings.targetFrameTime * (1.0f - mSettings.hysteresis);
+
+	if (mAverageFrameTime > upperBound && mScale > mSettings.minScale)
+	{
+		const float fitScale = mScale * std::sqrt(mSettings.targetFrameTime / mAverageFrameTime);
+		const float scale = quantize(fitScale);
+		setScale((scale < mScale) ? scale : quantize(mScale - mSettings.scaleStep));
+	}
+	else if (mAverageFrameTime < lowerBound && mScale < mSettings.maxScale)
+	{
+		const float scale = quantize(mScale + mSettings.scaleStep);
+		const float ratio = scale / mScale;
+		if (mAverageFrameTime * ratio * ratio < upperBound)
+		{
+			setScale(scale);
+		}
+	}
+	return mScale;
+}
+
+uint32_t ResolutionController::getScaledSize(uint32_t size) const
+{
+	const uint32_t scaled = static_cast<uint32_t>(size * mScale + 0.5f);
+	return (scaled > 0) ? scaled : 1;
+}
+
+/// <summary>
+/// Nearest scale at or below scale that is a whole number of steps under maxScale, clamped to the range.
+/// </summary>
+float ResolutionController::quantize(float scale) const
+{
+	const float steps = std::ceil((mSettings.maxScale - scale) / mSettings.scaleStep - 1.0e-3f);
+	float result = mSettings.maxScale - ((steps > 0.0f) ? steps : 0.0f) * mSettings.scaleStep;
+	if (result < mSettings.minScale)
+	{
+		result = mSettings.minScale;
+	}
+	return result;
+}
+
+/// <summary>
+/// Frames already measured ran at the old scale, so the average starts over after settling.
+/// </summary>
+void ResolutionController::setScale(float scale)
+{
+	if (scale == mScale)
+	{
+		return;
+	}
+
+	mScale = scale;
+	mHasAverage = false;
+	mSettleCount = mSettings.settleFrames;
+	++mChangeCount;
+}
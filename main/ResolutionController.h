@@ -0,0 +1,60 @@
+#ifndef __RENDERER_RESOLUTIONCONTROLLER_H__
+#define __RENDERER_RESOLUTIONCONTROLLER_H__
+
+#include <cstdint>
+
+// How the render scale follows the GPU frame time.
+struct ResolutionSettings
+{
+	// GPU time per frame to stay under, in milliseconds
+	float targetFrameTime;
+	// Scale goes down above targetFrameTime * (1 + hysteresis) and up below targetFrameTime * (1 - hysteresis)
+	float hysteresis;
+	float minScale;
+	float maxScale;
+	// Scales are maxScale minus whole steps of this
+	float scaleStep;
+	// Frames measured after a change before the next one, so frames still in flight at the old scale are not judged
+	uint32_t settleFrames;
+	// Weight of the newest frame time in the average
+	float smoothing;
+
+	// 60 Hz budget, 50% to 100% in 5% steps
+	static ResolutionSettings Default();
+};
+
+// Picks the fraction of the output size the scene is rendered at from measured GPU frame times.
+// Over budget it jumps to the scale expected to fit, assuming GPU time follows the pixel count;
+// under budget it climbs back one step at a time. Pure logic, fed by the renderer once per frame.
+class ResolutionController
+{
+public:
+	ResolutionController();
+
+	void initialize(const ResolutionSettings& settings);
+	const ResolutionSettings& getSettings() const { return mSettings; }
+	// Back to maxScale with no history, e.g. after the output was resized.
+	void reset();
+
+	// GPU time of one completed frame in milliseconds. Returns the scale of the frames recorded next.
+	float update(float gpuFrameTime);
+
+	float getScale() const { return mScale; }
+	// Pixels to render along an output axis of size pixels, at least one
+	uint32_t getScaledSize(uint32_t size) const;
+	float getAverageFrameTime() const { return mAverageFrameTime; }
+	uint32_t getChangeCount() const { return mChangeCount; }
+
+private:
+	float quantize(float scale) const;
+	void setScale(float scale);
+
+	ResolutionSettings mSettings;
+	float mScale;
+	float mAverageFrameTime;
+	bool mHasAverage;
+	uint32_t mSettleCount;
+	uint32_t mChangeCount;
+};
+
+#endif
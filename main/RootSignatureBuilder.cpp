@@ -0,0 +1,160 @@
+#include "RootSignatureBuilder.h"
+
+const uint32_t RootSignatureBuilder::MaxCost;
+
+RootSignatureBuilder::RootSignatureBuilder()
+	: mFlags(D3D12_ROOT_SIGNATURE_FLAG_NONE)
+	, mParameters()
+	, mRanges()
+	, mStaticSamplers()
+	, mError()
+{
+
+}
+
+uint32_t RootSignatureBuilder::addConstants(uint32_t num32BitValues, uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility)
+{
+	D3D12_ROOT_PARAMETER parameter{};
+	parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	parameter.ShaderVisibility = visibility;
+	parameter.Constants.ShaderRegister = shaderRegister;
+	parameter.Constants.RegisterSpace = registerSpace;
+	parameter.Constants.Num32BitValues = num32BitValues;
+
+	mParameters.push_back(parameter);
+	mRanges.emplace_back();
+	return getParameterCount() - 1;
+}
+
+uint32_t RootSignatureBuilder::addCBV(uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility)
+{
+	return addDescriptor(D3D12_ROOT_PARAMETER_TYPE_CBV, shaderRegister, registerSpace, visibility);
+}
+
+uint32_t RootSignatureBuilder::addSRV(uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility)
+{
+	return addDescriptor(D3D12_ROOT_PARAMETER_TYPE_SRV, shaderRegister, registerSpace, visibility);
+}
+
+uint32_t RootSignatureBuilder::addUAV(uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility)
+{
+	return addDescriptor(D3D12_ROOT_PARAMETER_TYPE_UAV, shaderRegister, registerSpace, visibility);
+}
+
+uint32_t RootSignatureBuilder::addDescriptor(D3D12_ROOT_PARAMETER_TYPE type, uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility)
+{
+	D3D12_ROOT_PARAMETER parameter{};
+	parameter.ParameterType = type;
+	parameter.ShaderVisibility = visibility;
+	parameter.Descriptor.ShaderRegister = shaderRegister;
+	parameter.Descriptor.RegisterSpace = registerSpace;
+
+	mParameters.push_back(parameter);
+	mRanges.emplace_back();
+	return getParameterCount() - 1;
+}
+
+uint32_t RootSignatureBuilder::addTable(const D3D12_DESCRIPTOR_RANGE* pRanges, uint32_t rangeCount, D3D12_SHADER_VISIBILITY visibility)
+{
+	D3D12_ROOT_PARAMETER parameter{};
+	parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	parameter.ShaderVisibility = visibility;
+
+	mParameters.push_back(parameter);
+	mRanges.emplace_back(pRanges, pRanges + rangeCount);
+	return getParameterCount() - 1;
+}
+
+void RootSignatureBuilder::addStaticSampler(const D3D12_STATIC_SAMPLER_DESC& sampler)
+{
+	mStaticSamplers.push_back(sampler);
+}
+
+uint32_t RootSignatureBuilder::getCost() const
+{
+	uint32_t cost = 0;
+	for (const D3D12_ROOT_PARAMETER& parameter : mParameters)
+	{
+		cost += GetParameterCost(parameter);
+	}
+	return cost;
+}
+
+uint32_t RootSignatureBuilder::GetParameterCost(const D3D12_ROOT_PARAMETER& parameter)
+{
+	switch (parameter.ParameterType)
+	{
+	case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+		return parameter.Constants.Num32BitValues;
+	case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+		return 1;
+	default:
+		// Root CBV, SRV and UAV are 64-bit GPU virtual addresses
+		return 2;
+	}
+}
+
+bool RootSignatureBuilder::validate()
+{
+	mError.clear();
+
+	for (uint32_t i = 0; i < getParameterCount(); ++i)
+	{
+		const D3D12_ROOT_PARAMETER& parameter = mParameters[i];
+		if (parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS && parameter.Constants.Num32BitValues == 0)
+		{
+			mError = "root parameter " + std::to_string(i) + " has no constants";
+			return false;
+		}
+		if (parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE && mRanges[i].empty())
+		{
+			mError = "root parameter " + std::to_string(i) + " is a table without ranges";
+			return false;
+		}
+	}
+
+	const uint32_t cost = getCost();
+	if (cost > MaxCost)
+	{
+		mError = "root signature costs " + std::to_string(cost) + " DWORDs, the limit is " + std::to_string(MaxCost);
+		return false;
+	}
+	return true;
+}
+
+HRESULT RootSignatureBuilder::build(D3D12_ROOT_SIGNATURE_DESC* pDesc)
+{
+	if (!validate())
+	{
+		return E_INVALIDARG;
+	}
+
+	// Range arrays only stop moving once every parameter is added.
+	for (uint32_t i = 0; i < getParameterCount(); ++i)
+	{
+		D3D12_ROOT_PARAMETER& parameter = mParameters[i];
+		if (parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+		{
+			parameter.DescriptorTable.pDescriptorRanges = mRanges[i].data();
+			parameter.DescriptorTable.NumDescriptorRanges = static_cast<UINT>(mRanges[i].size());
+		}
+	}
+
+	pDesc->NumParameters = getParameterCount();
+	pDesc->pParameters = mParameters.empty() ? nullptr : mParameters.data();
+	pDesc->NumStaticSamplers = static_cast<UINT>(mStaticSamplers.size());
+	pDesc->pStaticSamplers = mStaticSamplers.empty() ? nullptr : mStaticSamplers.data();
+	pDesc->Flags = mFlags;
+	return S_OK;
+}
+
+HRESULT RootSignatureBuilder::serialize(ID3DBlob** ppSignature, ID3DBlob** ppError)
+{
+	D3D12_ROOT_SIGNATURE_DESC desc{};
+	HRESULT hr = build(&desc);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	return D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1, ppSignature, ppError);
+}
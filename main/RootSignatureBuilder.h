@@ -0,0 +1,55 @@
+#ifndef __RENDERER_ROOTSIGNATUREBUILDER_H__
+#define __RENDERER_ROOTSIGNATUREBUILDER_H__
+
+#include <cstdint>
+#include <d3d12.h>
+#include <string>
+#include <vector>
+
+// Collects root parameters and checks the layout before it reaches the device. The root
+// signature is limited to 64 DWORDs: a root constant costs one DWORD per value, a root
+// descriptor two and a descriptor table one. Static samplers are free.
+// Parameters should be added from most to least frequently changed.
+class RootSignatureBuilder
+{
+public:
+	static const uint32_t MaxCost = 64;
+
+	RootSignatureBuilder();
+
+	void setFlags(D3D12_ROOT_SIGNATURE_FLAGS flags) { mFlags = flags; }
+
+	// Each returns the index of the root parameter it added.
+	uint32_t addConstants(uint32_t num32BitValues, uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility);
+	uint32_t addCBV(uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility);
+	uint32_t addSRV(uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility);
+	uint32_t addUAV(uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility);
+	// The ranges are copied.
+	uint32_t addTable(const D3D12_DESCRIPTOR_RANGE* pRanges, uint32_t rangeCount, D3D12_SHADER_VISIBILITY visibility);
+	void addStaticSampler(const D3D12_STATIC_SAMPLER_DESC& sampler);
+
+	uint32_t getParameterCount() const { return static_cast<uint32_t>(mParameters.size()); }
+	// Root signature size in DWORDs
+	uint32_t getCost() const;
+	static uint32_t GetParameterCost(const D3D12_ROOT_PARAMETER& parameter);
+
+	// False when the layout is over MaxCost or has an empty parameter; getError() says which.
+	bool validate();
+	const std::string& getError() const { return mError; }
+
+	// Points into the builder, so it is valid until the next add. E_INVALIDARG when validate() fails.
+	HRESULT build(D3D12_ROOT_SIGNATURE_DESC* pDesc);
+	HRESULT serialize(ID3DBlob** ppSignature, ID3DBlob** ppError);
+
+private:
+	uint32_t addDescriptor(D3D12_ROOT_PARAMETER_TYPE type, uint32_t shaderRegister, uint32_t registerSpace, D3D12_SHADER_VISIBILITY visibility);
+
+	D3D12_ROOT_SIGNATURE_FLAGS mFlags;
+	std::vector<D3D12_ROOT_PARAMETER> mParameters;
+	// Ranges of each parameter, empty for all but tables
+	std::vector<std::vector<D3D12_DESCRIPTOR_RANGE>> mRanges;
+	std::vector<D3D12_STATIC_SAMPLER_DESC> mStaticSamplers;
+	std::string mError;
+};
+
+#endif
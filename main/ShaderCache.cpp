@@ -0,0 +1,288 @@
+#include "stdafx.h"
+#include "ShaderCache.h"
+
+#include <cstdio>
+#include <io.h>
+#include <list>
+#include <vector>
+
+namespace
+{
+	std::wstring Widen(const std::string& value)
+	{
+		// Shader and include names are plain ASCII
+		return std::wstring(value.begin(), value.end());
+	}
+
+	// Resolves #include through the same loader the key was hashed with,
+	// so the compiled bytecode always matches its key.
+	class IncludeHandler final : public ID3DInclude
+	{
+	public:
+		explicit IncludeHandler(const ShaderSourceLoader& loader) : mLoader(loader), mSources() {}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR pFileName, LPCVOID, LPCVOID* ppData, UINT* pBytes) override
+		{
+			std::string source;
+			if (!mLoader(pFileName, &source))
+			{
+				return E_FAIL;
+			}
+
+			mSources.push_back(std::move(source));
+			*ppData = mSources.back().data();
+			*pBytes = static_cast<UINT>(mSources.back().size());
+			return S_OK;
+		}
+
+		// Sources are released with the handler.
+		HRESULT __stdcall Close(LPCVOID) override
+		{
+			return S_OK;
+		}
+
+	private:
+		const ShaderSourceLoader& mLoader;
+		std::list<std::string> mSources;
+	};
+}
+
+ShaderCache::ShaderCache()
+	: mSourceDirectory()
+	, mCacheDirectory()
+	, mAllowCompile(false)
+	, mMutex()
+	, mBlobs()
+	, mCompileCount(0)
+{
+
+}
+
+ShaderCache::~ShaderCache()
+{
+	destroy();
+}
+
+void ShaderCache::initialize(const std::wstring& sourceDirectory, const std::wstring& cacheDirectory, bool allowCompile)
+{
+	mSourceDirectory = sourceDirectory;
+	mCacheDirectory = cacheDirectory;
+	mAllowCompile = allowCompile;
+
+	CreateDirectoryW(mCacheDirectory.c_str(), nullptr);
+}
+
+void ShaderCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& entry : mBlobs)
+	{
+		unmapBlob(entry.second);
+	}
+	mBlobs.clear();
+}
+
+/// <summary>
+/// Hashing reads the sources but never compiles; the compiler only runs for a key with no file yet.
+/// </summary>
+HRESULT ShaderCache::load(const ShaderDesc& desc, D3D12_SHADER_BYTECODE* pBytecode)
+{
+	ShaderSourceLoader loader = [this](const std::string& name, std::string* pSource) { return readSource(name, pSource); };
+
+	uint64_t key;
+	if (!HashShader(desc, loader, &key))
+	{
+		return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mBlobs.find(key);
+		if (it != mBlobs.end())
+		{
+			pBytecode->pShaderBytecode = it->second.pBytecode;
+			pBytecode->BytecodeLength = it->second.bytecodeSize;
+			return S_OK;
+		}
+	}
+
+	// Mapping and compiling run unlocked, so one slow compile does not hold up other loads.
+	const std::wstring path = mCacheDirectory + Widen(FormatShaderHash(key)) + L".cso";
+
+	MappedBlob blob;
+	if (!mapBlob(path, key, &blob))
+	{
+		if (!mAllowCompile)
+		{
+			return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+		}
+
+		HRESULT hr = compile(desc, key, path);
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+		if (!mapBlob(path, key, &blob))
+		{
+			return E_FAIL;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto result = mBlobs.emplace(key, blob);
+	if (!result.second)
+	{
+		// Another thread loaded the same shader first
+		unmapBlob(blob);
+	}
+
+	pBytecode->pShaderBytecode = result.first->second.pBytecode;
+	pBytecode->BytecodeLength = result.first->second.bytecodeSize;
+	return S_OK;
+}
+
+void ShaderCache::unmapBlob(const MappedBlob& blob)
+{
+	UnmapViewOfFile(blob.pView);
+	CloseHandle(blob.mapping);
+	CloseHandle(blob.file);
+}
+
+bool ShaderCache::readSource(const std::string& name, std::string* pSource) const
+{
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, (mSourceDirectory + Widen(name)).c_str(), L"rb") != 0 || file == nullptr)
+	{
+		return false;
+	}
+
+	const long size = _filelength(_fileno(file));
+	bool isRead = false;
+	if (size >= 0)
+	{
+		pSource->resize(static_cast<size_t>(size));
+		isRead = fread(&(*pSource)[0], 1, pSource->size(), file) == pSource->size();
+	}
+	fclose(file);
+	return isRead;
+}
+
+/// <summary>
+/// Maps a cache file read-only. A file that fails validation is treated as missing and gets overwritten.
+/// </summary>
+bool ShaderCache::mapBlob(const std::wstring& path, uint64_t key, MappedBlob* pBlob) const
+{
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	HANDLE mapping = nullptr;
+	const uint8_t* pView = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (mapping != nullptr)
+	{
+		pView = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	const uint8_t* pBytecode = nullptr;
+	size_t bytecodeSize = 0;
+	if (pView == nullptr || !ShaderCacheEntry::Parse(pView, static_cast<size_t>(fileSize.QuadPart), key, &pBytecode, &bytecodeSize))
+	{
+		if (pView != nullptr)
+		{
+			UnmapViewOfFile(pView);
+		}
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	pBlob->file = file;
+	pBlob->mapping = mapping;
+	pBlob->pView = pView;
+	pBlob->pBytecode = pBytecode;
+	pBlob->bytecodeSize = bytecodeSize;
+	return true;
+}
+
+/// <summary>
+/// Compiles from the in-memory source and writes the entry through a temporary file,
+/// so a concurrent reader never maps a partial blob.
+/// </summary>
+HRESULT ShaderCache::compile(const ShaderDesc& desc, uint64_t key, const std::wstring& path)
+{
+	ShaderSourceLoader loader = [this](const std::string& name, std::string* pSource) { return readSource(name, pSource); };
+
+	std::string source;
+	if (!loader(desc.file, &source))
+	{
+		return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+	}
+
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderDefine& define : desc.defines)
+	{
+		macros.push_back({ define.name.c_str(), define.value.c_str() });
+	}
+	macros.push_back({ nullptr, nullptr });
+
+	IncludeHandler includeHandler(loader);
+	Microsoft::WRL::ComPtr<ID3DBlob> code;
+	Microsoft::WRL::ComPtr<ID3DBlob> error;
+	HRESULT hr = D3DCompile(
+		source.data(),
+		source.size(),
+		desc.file.c_str(),
+		macros.data(),
+		&includeHandler,
+		desc.entryPoint.c_str(),
+		desc.target.c_str(),
+		desc.flags,
+		0,
+		&code,
+		&error
+	);
+	if (error != nullptr)
+	{
+		OutputDebugStringA(static_cast<const char*>(error->GetBufferPointer()));
+	}
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	mCompileCount++;
+
+	std::vector<uint8_t> entry;
+	ShaderCacheEntry::Write(key, code->GetBufferPointer(), code->GetBufferSize(), entry);
+
+	// Per thread, in case two threads compile the same shader at once
+	const std::wstring temporaryPath = path + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, temporaryPath.c_str(), L"wb") != 0 || file == nullptr)
+	{
+		return E_FAIL;
+	}
+	const bool isWritten = fwrite(entry.data(), 1, entry.size(), file) == entry.size();
+	if (fclose(file) != 0 || !isWritten)
+	{
+		DeleteFileW(temporaryPath.c_str());
+		return E_FAIL;
+	}
+	if (!MoveFileExW(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		// Read the error before DeleteFileW overwrites it
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		DeleteFileW(temporaryPath.c_str());
+		return hr;
+	}
+	return S_OK;
+}
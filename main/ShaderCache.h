@@ -0,0 +1,54 @@
+#ifndef __RENDERER_SHADERCACHE_H__
+#define __RENDERER_SHADERCACHE_H__
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ShaderCacheKey.h"
+
+// Content-addressed store of compiled shaders: one file per HashShader key in the cache directory.
+// Hits are memory-mapped and handed out in place, so loading a cached shader never runs the compiler.
+// Misses are compiled with D3DCompile when compiling is allowed, and written back.
+class ShaderCache
+{
+public:
+	ShaderCache();
+	~ShaderCache();
+
+	void initialize(const std::wstring& sourceDirectory, const std::wstring& cacheDirectory, bool allowCompile);
+	// Unmaps every blob; bytecode handed out before stays valid only until then.
+	void destroy();
+
+	// The returned bytecode lives as long as the cache. Thread safe.
+	HRESULT load(const ShaderDesc& desc, D3D12_SHADER_BYTECODE* pBytecode);
+
+	uint32_t getCompileCount() const { return mCompileCount; }
+
+private:
+	struct MappedBlob
+	{
+		HANDLE file;
+		HANDLE mapping;
+		const uint8_t* pView;
+		const uint8_t* pBytecode;
+		size_t bytecodeSize;
+	};
+
+	static void unmapBlob(const MappedBlob& blob);
+
+	bool readSource(const std::string& name, std::string* pSource) const;
+	bool mapBlob(const std::wstring& path, uint64_t key, MappedBlob* pBlob) const;
+	HRESULT compile(const ShaderDesc& desc, uint64_t key, const std::wstring& path);
+
+	std::wstring mSourceDirectory;
+	std::wstring mCacheDirectory;
+	bool mAllowCompile;
+
+	std::mutex mMutex;
+	std::unordered_map<uint64_t, MappedBlob> mBlobs;
+	std::atomic<uint32_t> mCompileCount;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "ShaderCacheKey.h"
+#include "Hash.h"
+
+#include <cstring>
+#include <unordered_set>
+
+namespace
+{
+	bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	// Parses "# include <name>" or "# include \"name\"" starting at the '#' of a line.
+	bool ParseInclude(const std::string& source, size_t i, std::string* pName)
+	{
+		const size_t end = source.size();
+		++i;
+		while (i < end && IsBlank(source[i])) ++i;
+
+		static const char Keyword[] = "include";
+		const size_t keywordLength = sizeof(Keyword) - 1;
+		if (source.compare(i, keywordLength, Keyword) != 0)
+		{
+			return false;
+		}
+		i += keywordLength;
+		while (i < end && IsBlank(source[i])) ++i;
+
+		if (i >= end || (source[i] != '"' && source[i] != '<'))
+		{
+			return false;
+		}
+		const char close = (source[i] == '"') ? '"' : '>';
+
+		const size_t begin = ++i;
+		while (i < end && source[i] != close && source[i] != '\n') ++i;
+		if (i >= end || source[i] != close)
+		{
+			return false;
+		}
+
+		pName->assign(source, begin, i - begin);
+		return true;
+	}
+
+	void AddString(Hasher& hasher, const std::string& value)
+	{
+		hasher.add(static_cast<uint64_t>(value.size()));
+		hasher.add(value.data(), value.size());
+	}
+
+	template<class T>
+	void Append(std::vector<uint8_t>& out, const T& value)
+	{
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+		out.insert(out.end(), pBytes, pBytes + sizeof(T));
+	}
+}
+
+/// <summary>
+/// Walks the source once, tracking comments and string literals, and checks every
+/// line whose first non-blank character is '#'.
+/// </summary>
+void ScanShaderIncludes(const std::string& source, std::vector<std::string>& out)
+{
+	const size_t end = source.size();
+	bool isLineStart = true;
+
+	size_t i = 0;
+	while (i < end)
+	{
+		const char c = source[i];
+
+		if (c == '/' && i + 1 < end && source[i + 1] == '/')
+		{
+			while (i < end && source[i] != '\n') ++i;
+			continue;
+		}
+		if (c == '/' && i + 1 < end && source[i + 1] == '*')
+		{
+			const size_t close = source.find("*/", i + 2);
+			i = (close == std::string::npos) ? end : close + 2;
+			continue;
+		}
+		if (c == '"')
+		{
+			++i;
+			while (i < end && source[i] != '"' && source[i] != '\n')
+			{
+				i += (source[i] == '\\') ? 2 : 1;
+			}
+			// An unterminated literal ends at the line break, which still starts the next line
+			if (i < end && source[i] == '"')
+			{
+				++i;
+			}
+			isLineStart = false;
+			continue;
+		}
+
+		if (c == '\n')
+		{
+			isLineStart = true;
+		}
+		else if (c == '#' && isLineStart)
+		{
+			std::string name;
+			if (ParseInclude(source, i, &name))
+			{
+				out.push_back(name);
+			}
+			isLineStart = false;
+		}
+		else if (!IsBlank(c) && c != '\r')
+		{
+			isLineStart = false;
+		}
+		++i;
+	}
+}
+
+/// <summary>
+/// Files are hashed depth-first in include order, each one once, name and contents together,
+/// so renaming an include or moving code between files changes the key as well.
+/// </summary>
+bool HashShader(const ShaderDesc& desc, const ShaderSourceLoader& loader, uint64_t* pHash, std::vector<std::string>* pDependencies)
+{
+	Hasher hasher;
+	AddString(hasher, desc.entryPoint);
+	AddString(hasher, desc.target);
+	hasher.add(desc.flags);
+
+	hasher.add(static_cast<uint64_t>(desc.defines.size()));
+	for (const ShaderDefine& define : desc.defines)
+	{
+		AddString(hasher, define.name);
+		AddString(hasher, define.value);
+	}
+
+	std::unordered_set<std::string> visited;
+	std::vector<std::string> stack;
+	stack.push_back(desc.file);
+
+	std::string source;
+	std::vector<std::string> includes;
+	while (!stack.empty())
+	{
+		const std::string name = stack.back();
+		stack.pop_back();
+
+		if (!visited.insert(name).second)
+		{
+			continue;
+		}
+		if (!loader(name, &source))
+		{
+			return false;
+		}
+		if (pDependencies != nullptr)
+		{
+			pDependencies->push_back(name);
+		}
+
+		AddString(hasher, name);
+		AddString(hasher, source);
+
+		includes.clear();
+		ScanShaderIncludes(source, includes);
+		for (auto it = includes.rbegin(); it != includes.rend(); ++it)
+		{
+			stack.push_back(*it);
+		}
+	}
+
+	*pHash = hasher.getHash();
+	return true;
+}
+
+std::string FormatShaderHash(uint64_t hash)
+{
+	static const char Digits[] = "0123456789abcdef";
+
+	std::string result(16, '0');
+	for (int i = 15; i >= 0; --i)
+	{
+		result[i] = Digits[hash & 0xf];
+		hash >>= 4;
+	}
+	return result;
+}
+
+namespace ShaderCacheEntry
+{
+	void Write(uint64_t key, const void* pBytecode, size_t size, std::vector<uint8_t>& out)
+	{
+		out.clear();
+		out.reserve(HeaderSize + size);
+		Append(out, Magic);
+		Append(out, FormatVersion);
+		Append(out, key);
+		Append(out, static_cast<uint64_t>(size));
+		Append(out, Hasher().add(pBytecode, size).getHash());
+
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pBytecode);
+		out.insert(out.end(), pBytes, pBytes + size);
+	}
+
+	bool Parse(const uint8_t* pData, size_t size, uint64_t key, const uint8_t** ppBytecode, size_t* pBytecodeSize)
+	{
+		if (size < HeaderSize)
+		{
+			return false;
+		}
+
+		uint32_t magic;
+		uint32_t version;
+		uint64_t storedKey;
+		uint64_t bytecodeSize;
+		uint64_t checksum;
+		memcpy(&magic, pData, 4);
+		memcpy(&version, pData + 4, 4);
+		memcpy(&storedKey, pData + 8, 8);
+		memcpy(&bytecodeSize, pData + 16, 8);
+		memcpy(&checksum, pData + 24, 8);
+
+		if (magic != Magic || version != FormatVersion || storedKey != key || bytecodeSize != size - HeaderSize)
+		{
+			return false;
+		}
+
+		const uint8_t* pBytecode = pData + HeaderSize;
+		if (Hasher().add(pBytecode, static_cast<size_t>(bytecodeSize)).getHash() != checksum)
+		{
+			return false;
+		}
+
+		*ppBytecode = pBytecode;
+		*pBytecodeSize = static_cast<size_t>(bytecodeSize);
+		return true;
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef __RENDERER_SHADERCACHEKEY_H__
+#define __RENDERER_SHADERCACHEKEY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+// One entry point of one shader file, compiled with a fixed set of defines and flags.
+// file and include names are relative to the shader source directory.
+struct ShaderDesc
+{
+	std::string file;
+	std::string entryPoint;
+	std::string target;
+	std::vector<ShaderDefine> defines;
+	uint32_t flags;
+};
+
+// Reads a shader source or include by name. Returns false when it does not exist.
+typedef std::function<bool(const std::string& name, std::string* pSource)> ShaderSourceLoader;
+
+// Names in #include "..." and #include <...> directives, in source order.
+// Commented-out directives are skipped; conditional ones are all listed.
+void ScanShaderIncludes(const std::string& source, std::vector<std::string>& out);
+
+// Content address of a compiled shader: the source and every file it includes (transitively),
+// the defines, entry point, target profile and compile flags. Fails when a file is missing.
+// pDependencies receives every file read, the shader itself first.
+bool HashShader(const ShaderDesc& desc, const ShaderSourceLoader& loader, uint64_t* pHash, std::vector<std::string>* pDependencies = nullptr);
+
+// 16 lowercase hex digits, used as the cache file name.
+std::string FormatShaderHash(uint64_t hash);
+
+// A cache file is a 32 byte header followed by the bytecode, which stays 4 byte aligned
+// when the file is mapped:
+//   uint32 magic, uint32 format version, uint64 key, uint64 bytecode size, uint64 bytecode checksum
+namespace ShaderCacheEntry
+{
+	const uint32_t Magic = 0x43485344; // "DSHC"
+	const uint32_t FormatVersion = 1;
+	const size_t HeaderSize = 32;
+
+	void Write(uint64_t key, const void* pBytecode, size_t size, std::vector<uint8_t>& out);
+
+	// Validates the header and checksum; on success points pBytecode into pData.
+	bool Parse(const uint8_t* pData, size_t size, uint64_t key, const uint8_t** ppBytecode, size_t* pBytecodeSize);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include "ShaderKeywords.h"
+
+const uint32_t ShaderKeywordSet::MaxKeywords;
+const uint32_t ShaderKeywordSet::InvalidBit;
+
+ShaderKeywordSet::ShaderKeywordSet()
+	: mNames()
+{
+
+}
+
+ShaderKeywordSet::ShaderKeywordSet(std::initializer_list<const char*> names)
+	: mNames()
+{
+	for (const char* pName : names)
+	{
+		add(pName);
+	}
+}
+
+uint32_t ShaderKeywordSet::add(const std::string& name)
+{
+	if (getCount() >= MaxKeywords || getBit(name) != InvalidBit)
+	{
+		return InvalidBit;
+	}
+
+	mNames.push_back(name);
+	return getCount() - 1;
+}
+
+uint32_t ShaderKeywordSet::getBit(const std::string& name) const
+{
+	for (uint32_t bit = 0; bit < getCount(); ++bit)
+	{
+		if (mNames[bit] == name)
+		{
+			return bit;
+		}
+	}
+	return InvalidBit;
+}
+
+uint32_t ShaderKeywordSet::makeKey(const std::vector<std::string>& names) const
+{
+	uint32_t key = 0;
+	for (const std::string& name : names)
+	{
+		const uint32_t bit = getBit(name);
+		if (bit != InvalidBit)
+		{
+			key |= 1u << bit;
+		}
+	}
+	return key;
+}
+
+void ShaderKeywordSet::getDefines(uint32_t key, std::vector<ShaderDefine>& out) const
+{
+	for (uint32_t bit = 0; bit < getCount(); ++bit)
+	{
+		if (key & (1u << bit))
+		{
+			out.push_back({ mNames[bit], "1" });
+		}
+	}
+}
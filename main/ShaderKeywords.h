@@ -0,0 +1,43 @@
+#ifndef __RENDERER_SHADERKEYWORDS_H__
+#define __RENDERER_SHADERKEYWORDS_H__
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "ShaderCacheKey.h"
+
+// Feature keywords a shader can be compiled with. Each keyword is one bit of a variant key,
+// in declaration order; key 0 is the base variant with every feature off.
+class ShaderKeywordSet
+{
+public:
+	static const uint32_t MaxKeywords = 12;
+	static const uint32_t InvalidBit = UINT32_MAX;
+
+	ShaderKeywordSet();
+	ShaderKeywordSet(std::initializer_list<const char*> names);
+
+	// Returns the keyword's bit, or InvalidBit when the set is full or the name is taken.
+	uint32_t add(const std::string& name);
+
+	uint32_t getCount() const { return static_cast<uint32_t>(mNames.size()); }
+	const std::string& getName(uint32_t bit) const { return mNames[bit]; }
+	uint32_t getBit(const std::string& name) const;
+
+	// Every bit a declared keyword can set
+	uint32_t getKeyMask() const { return (1u << getCount()) - 1; }
+	uint32_t getVariantCount() const { return 1u << getCount(); }
+
+	// Unknown names are ignored, so a material never selects a variant that cannot exist.
+	uint32_t makeKey(const std::vector<std::string>& names) const;
+
+	// Appends NAME=1 for every keyword in key, in declaration order.
+	void getDefines(uint32_t key, std::vector<ShaderDefine>& out) const;
+
+private:
+	std::vector<std::string> mNames;
+};
+
+#endif
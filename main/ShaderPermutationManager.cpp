@@ -0,0 +1,158 @@
+#include "ShaderPermutationManager.h"
+
+ShaderPermutationManager::ShaderPermutationManager()
+	: mBuild()
+	, mRelease()
+	, mPublish()
+	, mKeyMask(0)
+	, mVariants()
+	, mThread()
+	, mMutex()
+	, mQueueCondition()
+	, mIdleCondition()
+	, mQueue()
+	, mIsBuilding(false)
+	, mIsExit(false)
+{
+
+}
+
+ShaderPermutationManager::~ShaderPermutationManager()
+{
+	destroy();
+}
+
+bool ShaderPermutationManager::initialize(const ShaderKeywordSet& keywords, const BuildFunction& build, const ReleaseFunction& release, const PublishFunction& publish)
+{
+	destroy();
+
+	mBuild = build;
+	mRelease = release;
+	mPublish = publish;
+	mKeyMask = keywords.getKeyMask();
+
+	const uint32_t variantCount = keywords.getVariantCount();
+	mVariants.reset(new Variant[variantCount]);
+	for (uint32_t key = 0; key < variantCount; ++key)
+	{
+		mVariants[key].state.store(Missing, std::memory_order_relaxed);
+		mVariants[key].pVariant.store(nullptr, std::memory_order_relaxed);
+	}
+
+	void* pBase = mBuild(0);
+	if (pBase == nullptr)
+	{
+		mVariants.reset();
+		return false;
+	}
+	mVariants[0].pVariant.store(pBase, std::memory_order_relaxed);
+	mVariants[0].state.store(Ready, std::memory_order_release);
+
+	mIsExit = false;
+	mThread = std::thread(&ShaderPermutationManager::buildThread, this);
+	return true;
+}
+
+void ShaderPermutationManager::destroy()
+{
+	if (mThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mIsExit = true;
+			mQueue.clear();
+		}
+		mQueueCondition.notify_all();
+		mThread.join();
+	}
+
+	if (mVariants)
+	{
+		for (uint32_t key = 0; key <= mKeyMask; ++key)
+		{
+			void* pVariant = mVariants[key].pVariant.load(std::memory_order_acquire);
+			if (pVariant != nullptr)
+			{
+				mRelease(pVariant);
+			}
+		}
+		mVariants.reset();
+	}
+}
+
+/// <summary>
+/// The fast path is one atomic load. The first miss for a key moves it to Pending
+/// and queues it; every later miss just returns the base variant.
+/// </summary>
+void* ShaderPermutationManager::acquire(uint32_t key)
+{
+	Variant& variant = mVariants[key & mKeyMask];
+
+	uint32_t state = variant.state.load(std::memory_order_acquire);
+	if (state == Ready)
+	{
+		return variant.pVariant.load(std::memory_order_relaxed);
+	}
+
+	if (state == Missing && variant.state.compare_exchange_strong(state, Pending, std::memory_order_acq_rel))
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQueue.push_back(key & mKeyMask);
+		}
+		mQueueCondition.notify_one();
+	}
+
+	return mVariants[0].pVariant.load(std::memory_order_relaxed);
+}
+
+ShaderPermutationManager::VariantState ShaderPermutationManager::getState(uint32_t key) const
+{
+	return static_cast<VariantState>(mVariants[key & mKeyMask].state.load(std::memory_order_acquire));
+}
+
+void ShaderPermutationManager::flush()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdleCondition.wait(lock, [this]() { return mQueue.empty() && !mIsBuilding; });
+}
+
+void ShaderPermutationManager::buildThread()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mQueueCondition.wait(lock, [this]() { return mIsExit || !mQueue.empty(); });
+		if (mIsExit)
+		{
+			break;
+		}
+
+		const uint32_t key = mQueue.front();
+		mQueue.pop_front();
+		mIsBuilding = true;
+		lock.unlock();
+
+		void* pVariant = mBuild(key);
+
+		Variant& variant = mVariants[key];
+		variant.pVariant.store(pVariant, std::memory_order_relaxed);
+		variant.state.store((pVariant != nullptr) ? Ready : Failed, std::memory_order_release);
+
+		// After the store, so nothing recorded from here on still gets the base variant for key.
+		if (pVariant != nullptr && mPublish)
+		{
+			mPublish(key, mVariants[0].pVariant.load(std::memory_order_relaxed));
+		}
+
+		lock.lock();
+		mIsBuilding = false;
+		if (mQueue.empty())
+		{
+			mIdleCondition.notify_all();
+		}
+	}
+
+	mIsBuilding = false;
+	mIdleCondition.notify_all();
+}
@@ -0,0 +1,79 @@
+#ifndef __RENDERER_SHADERPERMUTATIONMANAGER_H__
+#define __RENDERER_SHADERPERMUTATIONMANAGER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ShaderKeywords.h"
+
+// Builds the variants of one shader on demand, on a background thread of its own.
+// acquire never blocks: until a requested variant is built it returns the base variant,
+// which initialize builds up front, so a new material never stalls the frame.
+//
+// A variant is whatever the build function returns for a key (the renderer builds pipeline states);
+// nullptr means the build failed, and the base variant is used for that key from then on.
+class ShaderPermutationManager
+{
+public:
+	typedef std::function<void*(uint32_t key)> BuildFunction;
+	typedef std::function<void(void* pVariant)> ReleaseFunction;
+	// Called on the build thread once key's built variant replaces pReplaced, the base variant
+	// acquire returned for key until then, e.g. to drop whatever was recorded with it.
+	typedef std::function<void(uint32_t key, void* pReplaced)> PublishFunction;
+
+	enum VariantState
+	{
+		Missing,
+		Pending,
+		Ready,
+		Failed,
+	};
+
+	ShaderPermutationManager();
+	~ShaderPermutationManager();
+
+	// Builds the base variant on the calling thread and starts the build thread.
+	// Returns false, leaving the manager unusable, when the base variant fails to build.
+	bool initialize(const ShaderKeywordSet& keywords, const BuildFunction& build, const ReleaseFunction& release, const PublishFunction& publish = PublishFunction());
+	// Finishes the build in progress, drops the queued ones and releases every variant.
+	void destroy();
+
+	// Bits outside the keyword set are ignored. Thread safe.
+	void* acquire(uint32_t key);
+
+	VariantState getState(uint32_t key) const;
+	// Blocks until every requested variant is built.
+	void flush();
+
+private:
+	struct Variant
+	{
+		std::atomic<uint32_t> state;
+		std::atomic<void*> pVariant;
+	};
+
+	void buildThread();
+
+	BuildFunction mBuild;
+	ReleaseFunction mRelease;
+	PublishFunction mPublish;
+
+	uint32_t mKeyMask;
+	std::unique_ptr<Variant[]> mVariants;
+
+	std::thread mThread;
+	std::mutex mMutex;
+	std::condition_variable mQueueCondition;
+	std::condition_variable mIdleCondition;
+	std::deque<uint32_t> mQueue;
+	bool mIsBuilding;
+	bool mIsExit;
+};
+
+#endif
@@ -40,6 +40,6 @@ namespace Common
 	}
 }
 
-#define DEFINE_SIGLETON(type) type* Common::Singleton<type>::mpInstance = nullptr
+#define DEFINE_SIGLETON(type) template<> type* Common::Singleton<type>::mpInstance = nullptr
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "stdafx.h"
+#include "SizeDependentRegistry.h"
+
+SizeDependentRegistry::SizeDependentRegistry()
+	: mEntries()
+	, mWidth(0)
+	, mHeight(0)
+	, mIsCreated(false)
+{
+
+}
+
+void SizeDependentRegistry::add(const std::string& name, const CreateFunction& create, const ReleaseFunction& release)
+{
+	Entry entry = { name, create, release };
+	mEntries.push_back(entry);
+
+	if (mIsCreated)
+	{
+		create(mWidth, mHeight);
+	}
+}
+
+void SizeDependentRegistry::clear()
+{
+	release();
+	mEntries.clear();
+}
+
+void SizeDependentRegistry::create(uint32_t width, uint32_t height)
+{
+	if (mIsCreated)
+	{
+		release();
+	}
+
+	mWidth = width;
+	mHeight = height;
+	for (const Entry& entry : mEntries)
+	{
+		entry.create(width, height);
+	}
+	mIsCreated = true;
+}
+
+void SizeDependentRegistry::release()
+{
+	if (!mIsCreated)
+	{
+		return;
+	}
+
+	for (auto it = mEntries.rbegin(); it != mEntries.rend(); ++it)
+	{
+		it->release();
+	}
+	mIsCreated = false;
+}
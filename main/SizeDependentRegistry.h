@@ -0,0 +1,48 @@
+#ifndef __RENDERER_SIZEDEPENDENTREGISTRY_H__
+#define __RENDERER_SIZEDEPENDENTREGISTRY_H__
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Everything created at the size of the output, e.g. back buffer views and the render graph's targets.
+// Resizing releases the entries newest first, so nothing outlives what it was built from, and
+// recreates them oldest first once the swap chain has its new size.
+class SizeDependentRegistry
+{
+public:
+	typedef std::function<void(uint32_t width, uint32_t height)> CreateFunction;
+	typedef std::function<void()> ReleaseFunction;
+
+	SizeDependentRegistry();
+
+	// Creates the entry at once when the others already exist.
+	void add(const std::string& name, const CreateFunction& create, const ReleaseFunction& release);
+	// Releases every entry and forgets them.
+	void clear();
+
+	void create(uint32_t width, uint32_t height);
+	void release();
+
+	bool isCreated() const { return mIsCreated; }
+	uint32_t getWidth() const { return mWidth; }
+	uint32_t getHeight() const { return mHeight; }
+	uint32_t getEntryCount() const { return static_cast<uint32_t>(mEntries.size()); }
+	const std::string& getEntryName(uint32_t entry) const { return mEntries[entry].name; }
+
+private:
+	struct Entry
+	{
+		std::string name;
+		CreateFunction create;
+		ReleaseFunction release;
+	};
+
+	std::vector<Entry> mEntries;
+	uint32_t mWidth;
+	uint32_t mHeight;
+	bool mIsCreated;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "StagingRing.h"
+
+const uint64_t StagingRing::InvalidOffset;
+
+StagingRing::StagingRing()
+	: mCapacity(0)
+	, mHead(0)
+	, mTail(0)
+	, mUsedSize(0)
+	, mOpenSize(0)
+	, mBatches()
+{
+
+}
+
+void StagingRing::initialize(uint64_t capacity)
+{
+	mCapacity = capacity;
+	mHead = 0;
+	mTail = 0;
+	mUsedSize = 0;
+	mOpenSize = 0;
+	mBatches.clear();
+}
+
+/// <summary>
+/// Allocates after the newest allocation. When the space up to the end of the buffer is
+/// too small the rest of it is skipped and the allocation starts over at offset 0.
+/// </summary>
+uint64_t StagingRing::allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0 || size > mCapacity)
+	{
+		return InvalidOffset;
+	}
+
+	// An empty ring starts over, so its whole capacity is contiguous again.
+	if (mUsedSize == 0)
+	{
+		mHead = 0;
+		mTail = 0;
+	}
+	else if (mUsedSize == mCapacity)
+	{
+		return InvalidOffset;
+	}
+
+	const uint64_t aligned = (mHead + (alignment - 1)) & ~(alignment - 1);
+	uint64_t offset = InvalidOffset;
+	uint64_t consumed = 0;
+
+	if (mHead >= mTail)
+	{
+		// Free space is [head, capacity) followed by [0, tail).
+		if (aligned + size <= mCapacity)
+		{
+			offset = aligned;
+			consumed = aligned + size - mHead;
+		}
+		else if (size <= mTail)
+		{
+			offset = 0;
+			consumed = (mCapacity - mHead) + size;
+		}
+	}
+	else if (aligned + size <= mTail)
+	{
+		// Free space is [head, tail).
+		offset = aligned;
+		consumed = aligned + size - mHead;
+	}
+
+	if (offset == InvalidOffset)
+	{
+		return InvalidOffset;
+	}
+
+	mHead = offset + size;
+	mUsedSize += consumed;
+	mOpenSize += consumed;
+	return offset;
+}
+
+void StagingRing::close(uint64_t fenceValue)
+{
+	if (mOpenSize == 0)
+	{
+		return;
+	}
+
+	Batch batch;
+	batch.fenceValue = fenceValue;
+	batch.end = mHead;
+	batch.size = mOpenSize;
+	mBatches.push_back(batch);
+
+	mOpenSize = 0;
+}
+
+void StagingRing::retire(uint64_t completedFenceValue)
+{
+	while (!mBatches.empty() && mBatches.front().fenceValue <= completedFenceValue)
+	{
+		const Batch& batch = mBatches.front();
+		mTail = batch.end;
+		mUsedSize -= batch.size;
+		mBatches.pop_front();
+	}
+}
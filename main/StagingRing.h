@@ -0,0 +1,52 @@
+#ifndef __RENDERER_STAGINGRING_H__
+#define __RENDERER_STAGINGRING_H__
+
+#include <cstdint>
+#include <deque>
+
+// Ring of byte offsets into a staging buffer whose space is given back by fence value.
+// Allocations made between two close() calls form one batch, which is retired as a whole
+// once the queue it was submitted on has reached its fence value.
+// Holds no graphics API objects; the owner maps offsets to memory.
+class StagingRing
+{
+public:
+	static const uint64_t InvalidOffset = ~0ull;
+
+	StagingRing();
+
+	void initialize(uint64_t capacity);
+
+	// Returns InvalidOffset when there is not enough contiguous space until older batches retire.
+	uint64_t allocate(uint64_t size, uint64_t alignment);
+
+	// Every allocation since the previous close belongs to the batch signalling fenceValue.
+	void close(uint64_t fenceValue);
+	// Gives back the space of every batch whose fence value is at most completedFenceValue.
+	void retire(uint64_t completedFenceValue);
+
+	bool hasOpenAllocations() const { return mOpenSize != 0; }
+	bool hasPendingBatches() const { return !mBatches.empty(); }
+	// Fence value to wait for before the oldest closed batch can be retired.
+	uint64_t getOldestFenceValue() const { return mBatches.empty() ? 0 : mBatches.front().fenceValue; }
+
+	uint64_t getCapacity() const { return mCapacity; }
+	uint64_t getUsedSize() const { return mUsedSize; }
+
+private:
+	struct Batch
+	{
+		uint64_t fenceValue;
+		uint64_t end;
+		uint64_t size;
+	};
+
+	uint64_t mCapacity;
+	uint64_t mHead;
+	uint64_t mTail;
+	uint64_t mUsedSize;
+	uint64_t mOpenSize;
+	std::deque<Batch> mBatches;
+};
+
+#endif
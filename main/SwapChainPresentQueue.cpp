@@ -0,0 +1,37 @@
+#include "stdafx.h"
+#include "SwapChainPresentQueue.h"
+
+SwapChainPresentQueue::SwapChainPresentQueue()
+	: mWaitableObject(NULL)
+{
+
+}
+
+SwapChainPresentQueue::~SwapChainPresentQueue()
+{
+	destroy();
+}
+
+void SwapChainPresentQueue::initialize(HANDLE waitableObject)
+{
+	destroy();
+	mWaitableObject = waitableObject;
+}
+
+void SwapChainPresentQueue::destroy()
+{
+	if (mWaitableObject != NULL)
+	{
+		CloseHandle(mWaitableObject);
+		mWaitableObject = NULL;
+	}
+}
+
+bool SwapChainPresentQueue::waitForSlot(uint32_t timeoutMilliseconds)
+{
+	if (mWaitableObject == NULL)
+	{
+		return true;
+	}
+	return WaitForSingleObjectEx(mWaitableObject, timeoutMilliseconds, TRUE) == WAIT_OBJECT_0;
+}
@@ -0,0 +1,25 @@
+#ifndef __RENDERER_SWAPCHAINPRESENTQUEUE_H__
+#define __RENDERER_SWAPCHAINPRESENTQUEUE_H__
+
+#include "FramePacer.h"
+
+// IPresentQueue over the frame latency waitable object of a swap chain created with
+// DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT. The object is signaled once per
+// frame leaving the queue, so exactly one wait per presented frame keeps it balanced.
+class SwapChainPresentQueue final : public IPresentQueue
+{
+public:
+	SwapChainPresentQueue();
+	virtual ~SwapChainPresentQueue();
+
+	// Takes ownership of the handle returned by GetFrameLatencyWaitableObject.
+	void initialize(HANDLE waitableObject);
+	void destroy();
+
+	bool waitForSlot(uint32_t timeoutMilliseconds) override;
+
+private:
+	HANDLE mWaitableObject;
+};
+
+#endif
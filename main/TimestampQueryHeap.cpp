@@ -0,0 +1,126 @@
+#include "stdafx.h"
+#include "TimestampQueryHeap.h"
+
+TimestampQueryHeap::TimestampQueryHeap()
+	: mQueue()
+	, mQueryHeap()
+	, mReadback()
+	, mFrequency(0)
+	, mPerformanceFrequency()
+{
+
+}
+
+TimestampQueryHeap::~TimestampQueryHeap()
+{
+	destroy();
+}
+
+HRESULT TimestampQueryHeap::Create(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, uint32_t queryCount)
+{
+	mQueue = pQueue;
+	QueryPerformanceFrequency(&mPerformanceFrequency);
+
+	HRESULT hr = pQueue->GetTimestampFrequency(&mFrequency);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc{};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = queryCount;
+	queryHeapDesc.NodeMask = 0;
+	hr = pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&mQueryHeap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	D3D12_HEAP_PROPERTIES heapProp{};
+	heapProp.Type = D3D12_HEAP_TYPE_READBACK;
+	heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProp.CreationNodeMask = 0;
+	heapProp.VisibleNodeMask = 0;
+
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Alignment = 0;
+	resDesc.Width = sizeof(UINT64) * queryCount;
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.SampleDesc.Quality = 0;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	return pDevice->CreateCommittedResource(
+		&heapProp,
+		D3D12_HEAP_FLAG_NONE,
+		&resDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&mReadback)
+	);
+}
+
+void TimestampQueryHeap::destroy()
+{
+	mReadback.Reset();
+	mQueryHeap.Reset();
+	mQueue.Reset();
+}
+
+void TimestampQueryHeap::writeTimestamp(void* pCommandList, uint32_t query)
+{
+	static_cast<ID3D12GraphicsCommandList*>(pCommandList)->EndQuery(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void TimestampQueryHeap::resolve(void* pCommandList, uint32_t first, uint32_t count)
+{
+	static_cast<ID3D12GraphicsCommandList*>(pCommandList)->ResolveQueryData(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count, mReadback.Get(), sizeof(UINT64) * first);
+}
+
+bool TimestampQueryHeap::read(uint32_t first, uint32_t count, uint64_t* pTimestamps)
+{
+	D3D12_RANGE readRange;
+	readRange.Begin = sizeof(UINT64) * first;
+	readRange.End = readRange.Begin + sizeof(UINT64) * count;
+
+	UINT8* pData = nullptr;
+	if (FAILED(mReadback->Map(0, &readRange, reinterpret_cast<void**>(&pData))))
+	{
+		return false;
+	}
+	memcpy(pTimestamps, pData + readRange.Begin, sizeof(UINT64) * count);
+
+	// Nothing was written by the CPU.
+	D3D12_RANGE writeRange;
+	writeRange.Begin = 0;
+	writeRange.End = 0;
+	mReadback->Unmap(0, &writeRange);
+	return true;
+}
+
+/// <summary>
+/// GetClockCalibration samples the CPU side with QueryPerformanceCounter, which is also what
+/// steady_clock reads on Windows; it is converted to steady_clock nanoseconds the same way.
+/// </summary>
+bool TimestampQueryHeap::calibrate(GpuClockCalibration* pCalibration)
+{
+	UINT64 gpuTimestamp = 0;
+	UINT64 cpuTimestamp = 0;
+	if (FAILED(mQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp)) || mFrequency == 0)
+	{
+		return false;
+	}
+
+	const UINT64 frequency = static_cast<UINT64>(mPerformanceFrequency.QuadPart);
+	pCalibration->gpuTimestamp = gpuTimestamp;
+	pCalibration->cpuTime = static_cast<int64_t>((cpuTimestamp / frequency) * 1000000000ull + (cpuTimestamp % frequency) * 1000000000ull / frequency);
+	pCalibration->frequency = mFrequency;
+	return true;
+}
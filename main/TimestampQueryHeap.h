@@ -0,0 +1,32 @@
+#ifndef __RENDERER_TIMESTAMPQUERYHEAP_H__
+#define __RENDERER_TIMESTAMPQUERYHEAP_H__
+
+#include "GpuProfiler.h"
+
+using namespace Microsoft::WRL;
+
+// ITimestampQueries over one timestamp query heap of a direct queue, resolved into a READBACK buffer
+// of the same layout. Command lists are passed as ID3D12GraphicsCommandList*.
+class TimestampQueryHeap final : public ITimestampQueries
+{
+public:
+	TimestampQueryHeap();
+	virtual ~TimestampQueryHeap();
+
+	HRESULT Create(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, uint32_t queryCount);
+	void destroy();
+
+	void writeTimestamp(void* pCommandList, uint32_t query) override;
+	void resolve(void* pCommandList, uint32_t first, uint32_t count) override;
+	bool read(uint32_t first, uint32_t count, uint64_t* pTimestamps) override;
+	bool calibrate(GpuClockCalibration* pCalibration) override;
+
+private:
+	ComPtr<ID3D12CommandQueue> mQueue;
+	ComPtr<ID3D12QueryHeap> mQueryHeap;
+	ComPtr<ID3D12Resource> mReadback;
+	UINT64 mFrequency;
+	LARGE_INTEGER mPerformanceFrequency;
+};
+
+#endif
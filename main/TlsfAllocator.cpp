@@ -0,0 +1,454 @@
+#include "TlsfAllocator.h"
+
+#include <cstddef>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+const uint32_t TlsfAllocator::InvalidHandle;
+
+namespace
+{
+	// Index of the highest set bit; value must not be 0.
+	uint32_t FindLastSet(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	// Index of the lowest set bit; value must not be 0.
+	uint32_t FindFirstSet(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + (alignment - 1)) & ~(alignment - 1);
+	}
+}
+
+float TlsfStatistics::getFragmentation() const
+{
+	const uint64_t freeSize = totalSize - allocatedSize;
+	if (freeSize == 0)
+	{
+		return 0.0f;
+	}
+	return 1.0f - static_cast<float>(static_cast<double>(largestFreeBlock) / static_cast<double>(freeSize));
+}
+
+TlsfAllocator::TlsfAllocator()
+	: mBlocks()
+	, mUnusedBlocks()
+	, mFirstBlock(InvalidHandle)
+	, mFirstLevelMap(0)
+	, mSecondLevelMap()
+	, mFreeHeads()
+	, mTotalSize(0)
+	, mAllocatedSize(0)
+	, mAllocationCount(0)
+{
+
+}
+
+void TlsfAllocator::initialize(uint64_t size)
+{
+	mBlocks.clear();
+	mUnusedBlocks.clear();
+
+	mFirstLevelMap = 0;
+	for (uint32_t first = 0; first < FirstLevelCount; ++first)
+	{
+		mSecondLevelMap[first] = 0;
+		for (uint32_t second = 0; second < SecondLevelCount; ++second)
+		{
+			mFreeHeads[first][second] = InvalidHandle;
+		}
+	}
+
+	mTotalSize = size;
+	mAllocatedSize = 0;
+	mAllocationCount = 0;
+
+	mFirstBlock = InvalidHandle;
+	if (size == 0)
+	{
+		return;
+	}
+
+	mFirstBlock = createBlock();
+	Block& block = mBlocks[mFirstBlock];
+	block.offset = 0;
+	block.size = size;
+	insertFreeBlock(mFirstBlock);
+}
+
+/// <summary>
+/// Takes the head of the first list whose every block is large enough. If that block cannot
+/// also meet the alignment, searches again with room for the worst-case padding, and at last
+/// walks size's own list, which holds blocks both smaller and larger than size.
+/// </summary>
+uint32_t TlsfAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0 || size > mTotalSize)
+	{
+		return InvalidHandle;
+	}
+
+	uint32_t index = findFreeBlock(size);
+	if (index != InvalidHandle && !fits(index, size, alignment))
+	{
+		index = InvalidHandle;
+	}
+	if (index == InvalidHandle && alignment > 1)
+	{
+		index = findFreeBlock(size + alignment - 1);
+	}
+	if (index == InvalidHandle)
+	{
+		uint32_t first;
+		uint32_t second;
+		mapping(size, &first, &second);
+		for (index = mFreeHeads[first][second]; index != InvalidHandle; index = mBlocks[index].nextFree)
+		{
+			if (fits(index, size, alignment))
+			{
+				break;
+			}
+		}
+	}
+	if (index == InvalidHandle)
+	{
+		return InvalidHandle;
+	}
+
+	return allocateFromBlock(index, size, alignment);
+}
+
+uint32_t TlsfAllocator::allocateFromBlock(uint32_t index, uint64_t size, uint64_t alignment)
+{
+	removeFreeBlock(index);
+
+	// Padding in front of the aligned offset stays free as a block of its own.
+	const uint64_t padding = AlignUp(mBlocks[index].offset, alignment) - mBlocks[index].offset;
+	if (padding > 0)
+	{
+		splitBlock(index, padding);
+		insertFreeBlock(index);
+		index = mBlocks[index].nextPhysical;
+	}
+
+	if (mBlocks[index].size > size)
+	{
+		splitBlock(index, size);
+		insertFreeBlock(mBlocks[index].nextPhysical);
+	}
+
+	Block& block = mBlocks[index];
+	block.alignment = alignment;
+	block.isFree = false;
+
+	mAllocatedSize += block.size;
+	++mAllocationCount;
+	return index;
+}
+
+void TlsfAllocator::free(uint32_t handle)
+{
+	Block& block = mBlocks[handle];
+	mAllocatedSize -= block.size;
+	--mAllocationCount;
+
+	uint32_t index = handle;
+	const uint32_t next = block.nextPhysical;
+	if (next != InvalidHandle && mBlocks[next].isFree)
+	{
+		removeFreeBlock(next);
+		mergeBlock(index, next);
+	}
+
+	const uint32_t prev = mBlocks[index].prevPhysical;
+	if (prev != InvalidHandle && mBlocks[prev].isFree)
+	{
+		removeFreeBlock(prev);
+		mergeBlock(prev, index);
+		index = prev;
+	}
+
+	insertFreeBlock(index);
+}
+
+/// <summary>
+/// Walks the allocations from the end of the range and moves each into the lowest free block
+/// that holds it, so the free space gathers at the end.
+/// </summary>
+uint32_t TlsfAllocator::compact(uint32_t maxMoves, std::vector<TlsfMove>& moves)
+{
+	uint32_t last = mFirstBlock;
+	while (last != InvalidHandle && mBlocks[last].nextPhysical != InvalidHandle)
+	{
+		last = mBlocks[last].nextPhysical;
+	}
+
+	const size_t firstMove = moves.size();
+	uint32_t moveCount = 0;
+	uint32_t index = last;
+	while (index != InvalidHandle && moveCount < maxMoves)
+	{
+		const uint32_t prev = mBlocks[index].prevPhysical;
+
+		// Blocks taken by earlier moves have no data yet.
+		bool isTarget = false;
+		for (size_t i = firstMove; i < moves.size() && !isTarget; ++i)
+		{
+			isTarget = (moves[i].to == index);
+		}
+		if (mBlocks[index].isFree || isTarget)
+		{
+			index = prev;
+			continue;
+		}
+
+		const uint64_t size = mBlocks[index].size;
+		const uint64_t alignment = mBlocks[index].alignment;
+
+		uint32_t target = InvalidHandle;
+		for (uint32_t candidate = mFirstBlock; candidate != index; candidate = mBlocks[candidate].nextPhysical)
+		{
+			if (mBlocks[candidate].isFree && fits(candidate, size, alignment))
+			{
+				target = candidate;
+				break;
+			}
+		}
+		if (target == InvalidHandle)
+		{
+			index = prev;
+			continue;
+		}
+
+		TlsfMove move;
+		move.from = index;
+		move.to = allocateFromBlock(target, size, alignment);
+		moves.push_back(move);
+		++moveCount;
+
+		// The split may have put new blocks below index, so its neighbour is read again.
+		index = mBlocks[index].prevPhysical;
+	}
+	return moveCount;
+}
+
+TlsfStatistics TlsfAllocator::getStatistics() const
+{
+	TlsfStatistics statistics;
+	statistics.totalSize = mTotalSize;
+	statistics.allocatedSize = mAllocatedSize;
+	statistics.allocationCount = mAllocationCount;
+	statistics.freeBlockCount = 0;
+	statistics.largestFreeBlock = 0;
+
+	for (uint32_t index = mFirstBlock; index != InvalidHandle; index = mBlocks[index].nextPhysical)
+	{
+		const Block& block = mBlocks[index];
+		if (block.isFree)
+		{
+			++statistics.freeBlockCount;
+			statistics.largestFreeBlock = (block.size > statistics.largestFreeBlock) ? block.size : statistics.largestFreeBlock;
+		}
+	}
+	return statistics;
+}
+
+/// <summary>
+/// Size class of size: the first level is its highest bit, the second level splits that
+/// power-of-two range linearly. Sizes below SecondLevelCount all share the first level 0.
+/// </summary>
+void TlsfAllocator::mapping(uint64_t size, uint32_t* pFirst, uint32_t* pSecond)
+{
+	if (size < SecondLevelCount)
+	{
+		*pFirst = 0;
+		*pSecond = static_cast<uint32_t>(size);
+		return;
+	}
+
+	const uint32_t last = FindLastSet(size);
+	*pFirst = last - SecondLevelBits + 1;
+	*pSecond = static_cast<uint32_t>(size >> (last - SecondLevelBits)) ^ SecondLevelCount;
+}
+
+/// <summary>
+/// Head of the first non-empty list of a class at least one above size's, so any block in it fits.
+/// </summary>
+uint32_t TlsfAllocator::findFreeBlock(uint64_t size) const
+{
+	if (size >= SecondLevelCount)
+	{
+		const uint64_t round = (1ull << (FindLastSet(size) - SecondLevelBits)) - 1;
+		if (size > ~0ull - round)
+		{
+			return InvalidHandle;
+		}
+		size += round;
+	}
+
+	uint32_t first;
+	uint32_t second;
+	mapping(size, &first, &second);
+
+	uint32_t secondMap = (second < 32) ? (mSecondLevelMap[first] & (~0u << second)) : 0;
+	if (secondMap == 0)
+	{
+		const uint64_t firstMap = (first + 1 < 64) ? (mFirstLevelMap & (~0ull << (first + 1))) : 0;
+		if (firstMap == 0)
+		{
+			return InvalidHandle;
+		}
+		first = FindFirstSet(firstMap);
+		secondMap = mSecondLevelMap[first];
+	}
+	second = FindFirstSet(secondMap);
+	return mFreeHeads[first][second];
+}
+
+bool TlsfAllocator::fits(uint32_t index, uint64_t size, uint64_t alignment) const
+{
+	const Block& block = mBlocks[index];
+	return AlignUp(block.offset, alignment) + size <= block.offset + block.size;
+}
+
+uint32_t TlsfAllocator::createBlock()
+{
+	uint32_t index;
+	if (!mUnusedBlocks.empty())
+	{
+		index = mUnusedBlocks.back();
+		mUnusedBlocks.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(mBlocks.size());
+		mBlocks.push_back(Block());
+	}
+
+	Block& block = mBlocks[index];
+	block.offset = 0;
+	block.size = 0;
+	block.alignment = 1;
+	block.prevPhysical = InvalidHandle;
+	block.nextPhysical = InvalidHandle;
+	block.prevFree = InvalidHandle;
+	block.nextFree = InvalidHandle;
+	block.isFree = false;
+	return index;
+}
+
+void TlsfAllocator::destroyBlock(uint32_t index)
+{
+	mUnusedBlocks.push_back(index);
+}
+
+void TlsfAllocator::insertFreeBlock(uint32_t index)
+{
+	Block& block = mBlocks[index];
+
+	uint32_t first;
+	uint32_t second;
+	mapping(block.size, &first, &second);
+
+	block.isFree = true;
+	block.prevFree = InvalidHandle;
+	block.nextFree = mFreeHeads[first][second];
+	if (block.nextFree != InvalidHandle)
+	{
+		mBlocks[block.nextFree].prevFree = index;
+	}
+	mFreeHeads[first][second] = index;
+
+	mFirstLevelMap |= 1ull << first;
+	mSecondLevelMap[first] |= 1u << second;
+}
+
+void TlsfAllocator::removeFreeBlock(uint32_t index)
+{
+	Block& block = mBlocks[index];
+
+	uint32_t first;
+	uint32_t second;
+	mapping(block.size, &first, &second);
+
+	if (block.prevFree != InvalidHandle)
+	{
+		mBlocks[block.prevFree].nextFree = block.nextFree;
+	}
+	else
+	{
+		mFreeHeads[first][second] = block.nextFree;
+	}
+	if (block.nextFree != InvalidHandle)
+	{
+		mBlocks[block.nextFree].prevFree = block.prevFree;
+	}
+
+	if (mFreeHeads[first][second] == InvalidHandle)
+	{
+		mSecondLevelMap[first] &= ~(1u << second);
+		if (mSecondLevelMap[first] == 0)
+		{
+			mFirstLevelMap &= ~(1ull << first);
+		}
+	}
+
+	block.isFree = false;
+	block.prevFree = InvalidHandle;
+	block.nextFree = InvalidHandle;
+}
+
+void TlsfAllocator::splitBlock(uint32_t index, uint64_t size)
+{
+	// createBlock may grow mBlocks, so the block is only referenced afterwards.
+	const uint32_t rest = createBlock();
+	Block& block = mBlocks[index];
+	Block& restBlock = mBlocks[rest];
+
+	restBlock.offset = block.offset + size;
+	restBlock.size = block.size - size;
+	restBlock.prevPhysical = index;
+	restBlock.nextPhysical = block.nextPhysical;
+	if (block.nextPhysical != InvalidHandle)
+	{
+		mBlocks[block.nextPhysical].prevPhysical = rest;
+	}
+
+	block.size = size;
+	block.nextPhysical = rest;
+}
+
+void TlsfAllocator::mergeBlock(uint32_t index, uint32_t next)
+{
+	Block& block = mBlocks[index];
+	const Block& nextBlock = mBlocks[next];
+
+	block.size += nextBlock.size;
+	block.nextPhysical = nextBlock.nextPhysical;
+	if (block.nextPhysical != InvalidHandle)
+	{
+		mBlocks[block.nextPhysical].prevPhysical = index;
+	}
+
+	destroyBlock(next);
+}
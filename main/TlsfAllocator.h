@@ -0,0 +1,99 @@
+#ifndef __RENDERER_TLSFALLOCATOR_H__
+#define __RENDERER_TLSFALLOCATOR_H__
+
+#include <cstdint>
+#include <vector>
+
+// Block moved by TlsfAllocator::compact. The data at from has to be copied to to before from is freed.
+struct TlsfMove
+{
+	uint32_t from;
+	uint32_t to;
+};
+
+struct TlsfStatistics
+{
+	uint64_t totalSize;
+	uint64_t allocatedSize;
+	uint32_t allocationCount;
+	uint32_t freeBlockCount;
+	uint64_t largestFreeBlock;
+
+	// 0 when all free space is one block, towards 1 as it is split into ever smaller ones.
+	float getFragmentation() const;
+};
+
+// Two-level segregated fit allocator over offsets [0, size) of a memory range it does not own.
+// Free blocks are kept in lists by size class, found through two bitmaps, so allocate and free
+// are O(1); freed blocks are merged with free neighbours right away.
+// Holds no graphics API objects; GpuMemoryAllocator places resources at the offsets.
+class TlsfAllocator
+{
+public:
+	static const uint32_t InvalidHandle = ~0u;
+
+	TlsfAllocator();
+
+	void initialize(uint64_t size);
+
+	// Returns InvalidHandle when no free block can hold size bytes at alignment (a power of two).
+	uint32_t allocate(uint64_t size, uint64_t alignment);
+	void free(uint32_t handle);
+
+	uint64_t getOffset(uint32_t handle) const { return mBlocks[handle].offset; }
+	uint64_t getSize(uint32_t handle) const { return mBlocks[handle].size; }
+	uint64_t getAlignment(uint32_t handle) const { return mBlocks[handle].alignment; }
+
+	// Reallocates up to maxMoves allocations, last first, into the lowest free block that fits.
+	// Both ends of a move stay allocated; free each from once its data has been copied.
+	uint32_t compact(uint32_t maxMoves, std::vector<TlsfMove>& moves);
+
+	bool isEmpty() const { return mAllocationCount == 0; }
+	uint64_t getTotalSize() const { return mTotalSize; }
+	TlsfStatistics getStatistics() const;
+
+private:
+	static const uint32_t SecondLevelBits = 4;
+	static const uint32_t SecondLevelCount = 1 << SecondLevelBits;
+	static const uint32_t FirstLevelCount = 64 - SecondLevelBits + 1;
+
+	struct Block
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint64_t alignment;
+		uint32_t prevPhysical;
+		uint32_t nextPhysical;
+		uint32_t prevFree;
+		uint32_t nextFree;
+		bool isFree;
+	};
+
+	static void mapping(uint64_t size, uint32_t* pFirst, uint32_t* pSecond);
+	uint32_t findFreeBlock(uint64_t size) const;
+	bool fits(uint32_t index, uint64_t size, uint64_t alignment) const;
+	uint32_t allocateFromBlock(uint32_t index, uint64_t size, uint64_t alignment);
+
+	uint32_t createBlock();
+	void destroyBlock(uint32_t index);
+	void insertFreeBlock(uint32_t index);
+	void removeFreeBlock(uint32_t index);
+	// Splits size bytes off the front of block; the rest becomes a new free block.
+	void splitBlock(uint32_t index, uint64_t size);
+	// Merges next into index, both physical neighbours.
+	void mergeBlock(uint32_t index, uint32_t next);
+
+	std::vector<Block> mBlocks;
+	std::vector<uint32_t> mUnusedBlocks;
+	uint32_t mFirstBlock;
+
+	uint64_t mFirstLevelMap;
+	uint32_t mSecondLevelMap[FirstLevelCount];
+	uint32_t mFreeHeads[FirstLevelCount][SecondLevelCount];
+
+	uint64_t mTotalSize;
+	uint64_t mAllocatedSize;
+	uint32_t mAllocationCount;
+};
+
+#endif
@@ -1,22 +1,106 @@
 #include "Transform.h"
 
+#include <algorithm>
+
 Transform::Transform()
 	: mLocalPosition(vector3::zero)
 	, mLocalScale(vector3::one)
 	, mLocalRotation(quaternion::identity)
+	, mpParent(nullptr)
+	, mChildren()
+	, mLocalMatrix()
+	, mWorldMatrix()
+	, mIsLocalDirty(true)
+	, mIsWorldDirty(true)
 {
 
 }
 
 Transform::~Transform()
 {
+	setParent(nullptr);
+
+	for (Transform* pChild : mChildren)
+	{
+		pChild->mpParent = nullptr;
+		pChild->markWorldDirty();
+	}
+}
+
+void Transform::setParent(Transform* pParent)
+{
+	if (pParent == mpParent)
+	{
+		return;
+	}
+
+	// Refuse to create a cycle.
+	for (Transform* pAncestor = pParent; pAncestor != nullptr; pAncestor = pAncestor->mpParent)
+	{
+		if (pAncestor == this)
+		{
+			return;
+		}
+	}
+
+	if (mpParent != nullptr)
+	{
+		std::vector<Transform*>& siblings = mpParent->mChildren;
+		siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+	}
+
+	mpParent = pParent;
+	if (mpParent != nullptr)
+	{
+		mpParent->mChildren.push_back(this);
+	}
+
+	markWorldDirty();
+}
+
+XMMATRIX Transform::getLocalMatrix()
+{
+	if (mIsLocalDirty)
+	{
+		Matrix local = matrix::TRS(mLocalPosition, mLocalRotation, mLocalScale);
+		mLocalMatrix = XMFLOAT4X4(local.f);
+		mIsLocalDirty = false;
+	}
+	return XMLoadFloat4x4(&mLocalMatrix);
 }
 
 XMMATRIX Transform::getWorldMatrix()
 {
-	XMMATRIX world = XMMatrixIdentity();
-	world *= XMMatrixScalingFromVector(mLocalScale);
-	world *= XMMatrixRotationQuaternion(mLocalRotation);
-	world *= XMMatrixTranslationFromVector(mLocalPosition);
-	return world;
+	if (mIsWorldDirty)
+	{
+		XMMATRIX world = getLocalMatrix();
+		if (mpParent != nullptr)
+		{
+			world = XMMatrixMultiply(world, mpParent->getWorldMatrix());
+		}
+		XMStoreFloat4x4(&mWorldMatrix, world);
+		mIsWorldDirty = false;
+	}
+	return XMLoadFloat4x4(&mWorldMatrix);
+}
+
+void Transform::markLocalDirty()
+{
+	mIsLocalDirty = true;
+	markWorldDirty();
+}
+
+void Transform::markWorldDirty()
+{
+	// A dirty transform always has dirty descendants, so the walk can stop here.
+	if (mIsWorldDirty)
+	{
+		return;
+	}
+
+	mIsWorldDirty = true;
+	for (Transform* pChild : mChildren)
+	{
+		pChild->markWorldDirty();
+	}
 }
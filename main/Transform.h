@@ -1,6 +1,8 @@
 #ifndef __CORE_TRANSFORM_H__
 #define __CORE_TRANSFORM_H__
 
+#include <vector>
+
 #include "Math.h"
 
 class Transform
@@ -9,21 +11,39 @@ public:
 	Transform();
 	virtual ~Transform();
 
-	void setLocalPosition(Vector3 position) { mLocalPosition = position; }
+	void setLocalPosition(Vector3 position) { mLocalPosition = position; markLocalDirty(); }
 	Vector3 getLocalPosition() const { return mLocalPosition; }
 
-	void setLocalScale(Vector3 scale) { mLocalScale = scale; }
+	void setLocalScale(Vector3 scale) { mLocalScale = scale; markLocalDirty(); }
 	Vector3 getLocalScale() const { return mLocalScale; }
 
-	void setLocalRotation(Quaternion rotation) { mLocalRotation = rotation; }
+	void setLocalRotation(Quaternion rotation) { mLocalRotation = rotation; markLocalDirty(); }
 	Quaternion getLocalRotation() const { return mLocalRotation; }
 
+	// Keeps the local TRS, so the world matrix follows the new parent.
+	void setParent(Transform* pParent);
+	Transform* getParent() const { return mpParent; }
+	const std::vector<Transform*>& getChildren() const { return mChildren; }
+
+	// Cached; only recomputed after this transform or one of its parents changed.
+	XMMATRIX getLocalMatrix();
 	XMMATRIX getWorldMatrix();
 
 private:
+	void markLocalDirty();
+	void markWorldDirty();
+
 	Vector3 mLocalPosition;
 	Vector3 mLocalScale;
 	Quaternion mLocalRotation;
+
+	Transform* mpParent;
+	std::vector<Transform*> mChildren;
+
+	XMFLOAT4X4 mLocalMatrix;
+	XMFLOAT4X4 mWorldMatrix;
+	bool mIsLocalDirty;
+	bool mIsWorldDirty;
 };
 
 #endif
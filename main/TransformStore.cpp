@@ -0,0 +1,361 @@
+#include "TransformStore.h"
+
+#if defined(_XM_SSE_INTRINSICS_)
+#include <immintrin.h>
+#endif
+
+const uint32_t TransformStore::InvalidIndex;
+
+namespace
+{
+	void ComposeMatrix(const float* const* c, uint32_t i, XMFLOAT4X4* pOut)
+	{
+		const float x = c[3][i], y = c[4][i], z = c[5][i], w = c[6][i];
+		const float sx = c[7][i], sy = c[8][i], sz = c[9][i];
+
+		const float xx = x * x, yy = y * y, zz = z * z;
+		const float xy = x * y, xz = x * z, yz = y * z;
+		const float xw = x * w, yw = y * w, zw = z * w;
+
+		XMFLOAT4X4& m = *pOut;
+		m._11 = (1.0f - 2.0f * (yy + zz)) * sx;
+		m._12 = 2.0f * (xy + zw) * sx;
+		m._13 = 2.0f * (xz - yw) * sx;
+		m._14 = 0.0f;
+
+		m._21 = 2.0f * (xy - zw) * sy;
+		m._22 = (1.0f - 2.0f * (xx + zz)) * sy;
+		m._23 = 2.0f * (yz + xw) * sy;
+		m._24 = 0.0f;
+
+		m._31 = 2.0f * (xz + yw) * sz;
+		m._32 = 2.0f * (yz - xw) * sz;
+		m._33 = (1.0f - 2.0f * (xx + yy)) * sz;
+		m._34 = 0.0f;
+
+		m._41 = c[0][i];
+		m._42 = c[1][i];
+		m._43 = c[2][i];
+		m._44 = 1.0f;
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// Transposes four lanes of matrix elements into four rows and stores them.
+	inline void StoreRows4(__m128 c0, __m128 c1, __m128 c2, __m128 c3, XMFLOAT4X4* pOut, int row)
+	{
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&pOut[0].m[row][0], c0);
+		_mm_storeu_ps(&pOut[1].m[row][0], c1);
+		_mm_storeu_ps(&pOut[2].m[row][0], c2);
+		_mm_storeu_ps(&pOut[3].m[row][0], c3);
+	}
+
+	void ComposeMatrix4(const float* const* c, uint32_t i, XMFLOAT4X4* pOut)
+	{
+		const __m128 x = _mm_loadu_ps(c[3] + i);
+		const __m128 y = _mm_loadu_ps(c[4] + i);
+		const __m128 z = _mm_loadu_ps(c[5] + i);
+		const __m128 w = _mm_loadu_ps(c[6] + i);
+
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		const __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+		const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		const __m128 xw = _mm_mul_ps(w, x2), yw = _mm_mul_ps(w, y2), zw = _mm_mul_ps(w, z2);
+
+		const __m128 sx = _mm_loadu_ps(c[7] + i);
+		const __m128 sy = _mm_loadu_ps(c[8] + i);
+		const __m128 sz = _mm_loadu_ps(c[9] + i);
+
+		StoreRows4(
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+			_mm_mul_ps(_mm_add_ps(xy, zw), sx),
+			_mm_mul_ps(_mm_sub_ps(xz, yw), sx),
+			zero, pOut, 0);
+
+		StoreRows4(
+			_mm_mul_ps(_mm_sub_ps(xy, zw), sy),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+			_mm_mul_ps(_mm_add_ps(yz, xw), sy),
+			zero, pOut, 1);
+
+		StoreRows4(
+			_mm_mul_ps(_mm_add_ps(xz, yw), sz),
+			_mm_mul_ps(_mm_sub_ps(yz, xw), sz),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz),
+			zero, pOut, 2);
+
+		StoreRows4(
+			_mm_loadu_ps(c[0] + i),
+			_mm_loadu_ps(c[1] + i),
+			_mm_loadu_ps(c[2] + i),
+			one, pOut, 3);
+	}
+#endif
+
+#if defined(_XM_SSE_INTRINSICS_) && defined(__AVX2__)
+	inline void StoreRows8(__m256 c0, __m256 c1, __m256 c2, __m256 c3, XMFLOAT4X4* pOut, int row)
+	{
+		StoreRows4(_mm256_castps256_ps128(c0), _mm256_castps256_ps128(c1), _mm256_castps256_ps128(c2), _mm256_castps256_ps128(c3), pOut, row);
+		StoreRows4(_mm256_extractf128_ps(c0, 1), _mm256_extractf128_ps(c1, 1), _mm256_extractf128_ps(c2, 1), _mm256_extractf128_ps(c3, 1), pOut + 4, row);
+	}
+
+	void ComposeMatrix8(const float* const* c, uint32_t i, XMFLOAT4X4* pOut)
+	{
+		const __m256 x = _mm256_loadu_ps(c[3] + i);
+		const __m256 y = _mm256_loadu_ps(c[4] + i);
+		const __m256 z = _mm256_loadu_ps(c[5] + i);
+		const __m256 w = _mm256_loadu_ps(c[6] + i);
+
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		const __m256 x2 = _mm256_mul_ps(x, two), y2 = _mm256_mul_ps(y, two), z2 = _mm256_mul_ps(z, two);
+		const __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		const __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+		const __m256 xw = _mm256_mul_ps(w, x2), yw = _mm256_mul_ps(w, y2), zw = _mm256_mul_ps(w, z2);
+
+		const __m256 sx = _mm256_loadu_ps(c[7] + i);
+		const __m256 sy = _mm256_loadu_ps(c[8] + i);
+		const __m256 sz = _mm256_loadu_ps(c[9] + i);
+
+		StoreRows8(
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+			_mm256_mul_ps(_mm256_add_ps(xy, zw), sx),
+			_mm256_mul_ps(_mm256_sub_ps(xz, yw), sx),
+			zero, pOut, 0);
+
+		StoreRows8(
+			_mm256_mul_ps(_mm256_sub_ps(xy, zw), sy),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+			_mm256_mul_ps(_mm256_add_ps(yz, xw), sy),
+			zero, pOut, 1);
+
+		StoreRows8(
+			_mm256_mul_ps(_mm256_add_ps(xz, yw), sz),
+			_mm256_mul_ps(_mm256_sub_ps(yz, xw), sz),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+			zero, pOut, 2);
+
+		StoreRows8(
+			_mm256_loadu_ps(c[0] + i),
+			_mm256_loadu_ps(c[1] + i),
+			_mm256_loadu_ps(c[2] + i),
+			one, pOut, 3);
+	}
+#endif
+}
+
+TransformStore::TransformStore()
+	: mComponents()
+	, mParents()
+	, mSubtreeSizes()
+	, mIsDirty()
+	, mLocalMatrices()
+	, mWorldMatrices()
+{
+
+}
+
+TransformStore::~TransformStore()
+{
+
+}
+
+uint32_t TransformStore::add(const Vector3& position, const Quaternion& rotation, const Vector3& scale, uint32_t parent)
+{
+	const uint32_t index = size();
+
+	if (parent != InvalidIndex)
+	{
+		// The parent's subtree must end at the current tail to stay depth-first.
+		if (parent >= index || parent + mSubtreeSizes[parent] != index)
+		{
+			return InvalidIndex;
+		}
+
+		for (uint32_t ancestor = parent; ancestor != InvalidIndex; ancestor = mParents[ancestor])
+		{
+			mSubtreeSizes[ancestor]++;
+		}
+	}
+
+	mParents.push_back(parent);
+	mSubtreeSizes.push_back(1);
+	mIsDirty.push_back(1);
+	mLocalMatrices.emplace_back();
+	mWorldMatrices.emplace_back();
+
+	mComponents[PositionX].push_back(position.x);
+	mComponents[PositionY].push_back(position.y);
+	mComponents[PositionZ].push_back(position.z);
+
+	mComponents[RotationX].push_back(rotation.x);
+	mComponents[RotationY].push_back(rotation.y);
+	mComponents[RotationZ].push_back(rotation.z);
+	mComponents[RotationW].push_back(rotation.w);
+
+	mComponents[ScaleX].push_back(scale.x);
+	mComponents[ScaleY].push_back(scale.y);
+	mComponents[ScaleZ].push_back(scale.z);
+
+	return index;
+}
+
+void TransformStore::reserve(uint32_t capacity)
+{
+	for (std::vector<float>& component : mComponents)
+	{
+		component.reserve(capacity);
+	}
+
+	mParents.reserve(capacity);
+	mSubtreeSizes.reserve(capacity);
+	mIsDirty.reserve(capacity);
+	mLocalMatrices.reserve(capacity);
+	mWorldMatrices.reserve(capacity);
+}
+
+void TransformStore::clear()
+{
+	for (std::vector<float>& component : mComponents)
+	{
+		component.clear();
+	}
+
+	mParents.clear();
+	mSubtreeSizes.clear();
+	mIsDirty.clear();
+	mLocalMatrices.clear();
+	mWorldMatrices.clear();
+}
+
+void TransformStore::setLocalPosition(uint32_t index, const Vector3& position)
+{
+	mComponents[PositionX][index] = position.x;
+	mComponents[PositionY][index] = position.y;
+	mComponents[PositionZ][index] = position.z;
+	mIsDirty[index] = 1;
+}
+
+Vector3 TransformStore::getLocalPosition(uint32_t index) const
+{
+	return Vector3(mComponents[PositionX][index], mComponents[PositionY][index], mComponents[PositionZ][index]);
+}
+
+void TransformStore::setLocalRotation(uint32_t index, const Quaternion& rotation)
+{
+	mComponents[RotationX][index] = rotation.x;
+	mComponents[RotationY][index] = rotation.y;
+	mComponents[RotationZ][index] = rotation.z;
+	mComponents[RotationW][index] = rotation.w;
+	mIsDirty[index] = 1;
+}
+
+Quaternion TransformStore::getLocalRotation(uint32_t index) const
+{
+	return Quaternion(mComponents[RotationX][index], mComponents[RotationY][index], mComponents[RotationZ][index], mComponents[RotationW][index]);
+}
+
+void TransformStore::setLocalScale(uint32_t index, const Vector3& scale)
+{
+	mComponents[ScaleX][index] = scale.x;
+	mComponents[ScaleY][index] = scale.y;
+	mComponents[ScaleZ][index] = scale.z;
+	mIsDirty[index] = 1;
+}
+
+Vector3 TransformStore::getLocalScale(uint32_t index) const
+{
+	return Vector3(mComponents[ScaleX][index], mComponents[ScaleY][index], mComponents[ScaleZ][index]);
+}
+
+void TransformStore::computeLocalMatrices(uint32_t first, uint32_t count, XMFLOAT4X4* pOut) const
+{
+	const float* c[ComponentCount];
+	for (int n = 0; n < ComponentCount; ++n)
+	{
+		c[n] = mComponents[n].data();
+	}
+
+	const uint32_t end = first + count;
+	uint32_t i = first;
+
+#if defined(_XM_SSE_INTRINSICS_) && defined(__AVX2__)
+	for (; i + 8 <= end; i += 8)
+	{
+		ComposeMatrix8(c, i, pOut + (i - first));
+	}
+#endif
+
+#if defined(_XM_SSE_INTRINSICS_)
+	for (; i + 4 <= end; i += 4)
+	{
+		ComposeMatrix4(c, i, pOut + (i - first));
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		ComposeMatrix(c, i, pOut + (i - first));
+	}
+}
+
+uint32_t TransformStore::updateWorldMatrices()
+{
+	const uint32_t count = size();
+	uint32_t updated = 0;
+
+	uint32_t i = 0;
+	while (i < count)
+	{
+		if (!mIsDirty[i])
+		{
+			++i;
+			continue;
+		}
+
+		// Every world matrix below a changed transform is stale, local matrices only where dirty.
+		const uint32_t end = i + mSubtreeSizes[i];
+		uint32_t j = i;
+		while (j < end)
+		{
+			uint32_t runEnd = j;
+			while (runEnd < end && mIsDirty[runEnd])
+			{
+				mIsDirty[runEnd] = 0;
+				++runEnd;
+			}
+			if (runEnd > j)
+			{
+				computeLocalMatrices(j, runEnd - j, &mLocalMatrices[j]);
+			}
+			else
+			{
+				runEnd = j + 1;
+			}
+
+			for (; j < runEnd; ++j)
+			{
+				const uint32_t parent = mParents[j];
+				if (parent == InvalidIndex)
+				{
+					mWorldMatrices[j] = mLocalMatrices[j];
+				}
+				else
+				{
+					XMStoreFloat4x4(&mWorldMatrices[j], XMMatrixMultiply(XMLoadFloat4x4(&mLocalMatrices[j]), XMLoadFloat4x4(&mWorldMatrices[parent])));
+				}
+			}
+		}
+
+		updated += end - i;
+		i = end;
+	}
+
+	return updated;
+}
@@ -0,0 +1,74 @@
+#ifndef __CORE_TRANSFORMSTORE_H__
+#define __CORE_TRANSFORMSTORE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+// Structure-of-arrays storage for local position / rotation / scale.
+// Each component lives in its own contiguous float array so computeLocalMatrices can
+// load four (SSE) or eight (AVX2) transforms per instruction.
+//
+// Transforms may have a parent. The store is kept in depth-first order, so every subtree
+// occupies [index, index + subtree size) and updateWorldMatrices is a single linear pass
+// that skips clean subtrees entirely.
+class TransformStore
+{
+public:
+	static const uint32_t InvalidIndex = UINT32_MAX;
+
+	TransformStore();
+	~TransformStore();
+
+	// parent must be InvalidIndex, the last added transform or one of its ancestors,
+	// which is what building a hierarchy depth-first produces. Returns InvalidIndex otherwise.
+	uint32_t add(const Vector3& position, const Quaternion& rotation, const Vector3& scale, uint32_t parent = InvalidIndex);
+	void reserve(uint32_t capacity);
+	void clear();
+
+	uint32_t size() const { return static_cast<uint32_t>(mComponents[PositionX].size()); }
+
+	void setLocalPosition(uint32_t index, const Vector3& position);
+	Vector3 getLocalPosition(uint32_t index) const;
+
+	void setLocalRotation(uint32_t index, const Quaternion& rotation);
+	Quaternion getLocalRotation(uint32_t index) const;
+
+	void setLocalScale(uint32_t index, const Vector3& scale);
+	Vector3 getLocalScale(uint32_t index) const;
+
+	uint32_t getParent(uint32_t index) const { return mParents[index]; }
+	uint32_t getSubtreeSize(uint32_t index) const { return mSubtreeSizes[index]; }
+
+	// Writes Scale * Rotation * Translation of transforms [first, first + count) to pOut[0, count).
+	// Builds the matrices directly from the quaternion instead of multiplying three 4x4 matrices.
+	void computeLocalMatrices(uint32_t first, uint32_t count, XMFLOAT4X4* pOut) const;
+
+	// Recomputes the world matrices of changed transforms and their subtrees only.
+	// Returns the number of world matrices that were rebuilt.
+	uint32_t updateWorldMatrices();
+
+	const XMFLOAT4X4& getWorldMatrix(uint32_t index) const { return mWorldMatrices[index]; }
+	const XMFLOAT4X4* getWorldMatrices() const { return mWorldMatrices.data(); }
+
+private:
+	enum Component
+	{
+		PositionX, PositionY, PositionZ,
+		RotationX, RotationY, RotationZ, RotationW,
+		ScaleX, ScaleY, ScaleZ,
+		ComponentCount
+	};
+
+	std::vector<float> mComponents[ComponentCount];
+
+	std::vector<uint32_t> mParents;
+	std::vector<uint32_t> mSubtreeSizes;
+	std::vector<uint8_t> mIsDirty;
+
+	std::vector<XMFLOAT4X4> mLocalMatrices;
+	std::vector<XMFLOAT4X4> mWorldMatrices;
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include "UploadQueue.h"
+
+#include <cstring>
+
+const uint64_t UploadQueue::StagingAlignment;
+
+UploadQueue::UploadQueue()
+	: mpCopyQueue(nullptr)
+	, mpStaging(nullptr)
+	, mPolicy()
+	, mRing()
+	, mOpenFenceValue(1)
+	, mOpenBytes(0)
+	, mOpenCopies(0)
+	, mCompletedFenceValue(0)
+	, mSubmitCount(0)
+	, mMutex()
+{
+
+}
+
+UploadQueue::~UploadQueue()
+{
+	destroy();
+}
+
+void UploadQueue::initialize(ICopyQueue* pCopyQueue, uint8_t* pStaging, uint64_t stagingSize, const UploadBatchPolicy& policy)
+{
+	destroy();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mpCopyQueue = pCopyQueue;
+	mpStaging = pStaging;
+	mPolicy = policy;
+	mRing.initialize(stagingSize);
+
+	// Continue from the copy queue's fence, which may already have been signalled.
+	mCompletedFenceValue = mpCopyQueue->getCompletedValue();
+	mOpenFenceValue = mCompletedFenceValue + 1;
+	mOpenBytes = 0;
+	mOpenCopies = 0;
+	mSubmitCount = 0;
+}
+
+void UploadQueue::destroy()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (mpCopyQueue == nullptr)
+	{
+		return;
+	}
+
+	submitOpenBatch();
+	mpCopyQueue->wait(mOpenFenceValue - 1);
+
+	mRing.initialize(0);
+	mpCopyQueue = nullptr;
+	mpStaging = nullptr;
+}
+
+uint64_t UploadQueue::upload(void* pDestination, uint64_t destinationOffset, const void* pData, uint64_t size)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	const uint8_t* pSource = static_cast<const uint8_t*>(pData);
+	const uint64_t maxPiece = mRing.getCapacity();
+	while (size > 0)
+	{
+		const uint64_t pieceSize = (size < maxPiece) ? size : maxPiece;
+		const uint64_t stagingOffset = allocateStaging(pieceSize);
+
+		memcpy(mpStaging + stagingOffset, pSource, static_cast<size_t>(pieceSize));
+		mpCopyQueue->copy(pDestination, destinationOffset, stagingOffset, pieceSize);
+		mOpenBytes += pieceSize;
+		++mOpenCopies;
+
+		pSource += pieceSize;
+		destinationOffset += pieceSize;
+		size -= pieceSize;
+
+		// The ticket is taken before a policy submit, which signals exactly that value.
+		if (size == 0)
+		{
+			const uint64_t ticket = mOpenFenceValue;
+			if (mOpenBytes >= mPolicy.maxBytes || mOpenCopies >= mPolicy.maxCopies)
+			{
+				submitOpenBatch();
+			}
+			return ticket;
+		}
+	}
+
+	return 0;
+}
+
+uint64_t UploadQueue::flush()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	submitOpenBatch();
+	return mOpenFenceValue - 1;
+}
+
+bool UploadQueue::submit(uint64_t ticket)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (ticket <= mCompletedFenceValue)
+	{
+		return false;
+	}
+	if (ticket >= mOpenFenceValue)
+	{
+		submitOpenBatch();
+	}
+
+	updateCompleted();
+	return ticket > mCompletedFenceValue;
+}
+
+bool UploadQueue::isComplete(uint64_t ticket)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (ticket > mCompletedFenceValue)
+	{
+		updateCompleted();
+	}
+	return ticket <= mCompletedFenceValue;
+}
+
+void UploadQueue::wait(uint64_t ticket)
+{
+	if (!submit(ticket))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mpCopyQueue->wait(ticket);
+	updateCompleted();
+}
+
+/// <summary>
+/// Staging space for size bytes. A full ring first submits the open batch, then waits
+/// for the oldest submitted batch to retire; size never exceeds the ring's capacity.
+/// </summary>
+uint64_t UploadQueue::allocateStaging(uint64_t size)
+{
+	updateCompleted();
+
+	uint64_t offset = mRing.allocate(size, StagingAlignment);
+	while (offset == StagingRing::InvalidOffset)
+	{
+		if (mRing.hasOpenAllocations())
+		{
+			submitOpenBatch();
+		}
+
+		mpCopyQueue->wait(mRing.getOldestFenceValue());
+		updateCompleted();
+
+		offset = mRing.allocate(size, StagingAlignment);
+	}
+	return offset;
+}
+
+void UploadQueue::submitOpenBatch()
+{
+	if (mOpenCopies == 0)
+	{
+		return;
+	}
+
+	mpCopyQueue->submit(mOpenFenceValue);
+	mRing.close(mOpenFenceValue);
+	++mSubmitCount;
+
+	++mOpenFenceValue;
+	mOpenBytes = 0;
+	mOpenCopies = 0;
+}
+
+void UploadQueue::updateCompleted()
+{
+	mCompletedFenceValue = mpCopyQueue->getCompletedValue();
+	mRing.retire(mCompletedFenceValue);
+}
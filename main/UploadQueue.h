@@ -0,0 +1,83 @@
+#ifndef __RENDERER_UPLOADQUEUE_H__
+#define __RENDERER_UPLOADQUEUE_H__
+
+#include <cstdint>
+#include <mutex>
+
+#include "StagingRing.h"
+
+// Copy engine that UploadQueue records into. Handles are opaque so the queue does not depend on D3D12.
+class ICopyQueue
+{
+public:
+	virtual ~ICopyQueue() {}
+
+	// Records a copy from the staging buffer into pDestination, opening a new batch if needed.
+	virtual void copy(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) = 0;
+	// Submits the copies recorded since the last submit and signals fenceValue once they are done.
+	virtual void submit(uint64_t fenceValue) = 0;
+	virtual uint64_t getCompletedValue() = 0;
+	// Blocks the calling thread until fenceValue has been signalled.
+	virtual void wait(uint64_t fenceValue) = 0;
+};
+
+// When an open batch is submitted without being asked to.
+struct UploadBatchPolicy
+{
+	uint64_t maxBytes;
+	uint32_t maxCopies;
+};
+
+// Streams data into GPU-only resources through a staging ring on a copy queue.
+// Uploads are gathered into batches, each one submission signalling one fence value; the value
+// is returned as a ticket, so a consumer only waits for the batch holding what it reads.
+class UploadQueue
+{
+public:
+	// Staging offsets are aligned to this; enough for any buffer copy.
+	static const uint64_t StagingAlignment = 16;
+
+	UploadQueue();
+	~UploadQueue();
+
+	void initialize(ICopyQueue* pCopyQueue, uint8_t* pStaging, uint64_t stagingSize, const UploadBatchPolicy& policy);
+	// Submits what is left and waits for the copy queue to drain.
+	void destroy();
+
+	// Thread-safe. Copies size bytes of pData into pDestination at destinationOffset.
+	// Data larger than the staging ring is split, so the ticket covers every piece.
+	uint64_t upload(void* pDestination, uint64_t destinationOffset, const void* pData, uint64_t size);
+
+	// Submits the open batch, if any. Returns the ticket of the newest submitted batch.
+	uint64_t flush();
+	// Makes sure ticket's batch has been submitted. Returns false if it has already completed,
+	// in which case nothing needs to wait for it.
+	bool submit(uint64_t ticket);
+
+	bool isComplete(uint64_t ticket);
+	// Blocks until ticket's batch has completed, submitting it first if needed.
+	void wait(uint64_t ticket);
+
+	uint64_t getSubmitCount() const { return mSubmitCount; }
+
+private:
+	uint64_t allocateStaging(uint64_t size);
+	void submitOpenBatch();
+	void updateCompleted();
+
+	ICopyQueue* mpCopyQueue;
+	uint8_t* mpStaging;
+	UploadBatchPolicy mPolicy;
+	StagingRing mRing;
+
+	// Fence value the open batch will signal; every earlier value has been submitted.
+	uint64_t mOpenFenceValue;
+	uint64_t mOpenBytes;
+	uint32_t mOpenCopies;
+	uint64_t mCompletedFenceValue;
+	uint64_t mSubmitCount;
+
+	std::mutex mMutex;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "UploadRingBuffer.h"
+
+#include <cstring>
+#include <exception>
+
+UploadRingBuffer::UploadRingBuffer()
+	: mResource(nullptr)
+	, mAllocator()
+{
+
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	if (mResource != nullptr)
+	{
+		mResource->Unmap(0, nullptr);
+	}
+}
+
+HRESULT UploadRingBuffer::Create(ID3D12Device* pDevice, UINT64 frameSize, UINT frameCount)
+{
+	// Keep every frame region 256-byte aligned so constant buffer views can start anywhere.
+	frameSize = (frameSize + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) & ~static_cast<UINT64>(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+
+	D3D12_HEAP_PROPERTIES heapProp{};
+	heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
+	heapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProp.CreationNodeMask = 0;
+	heapProp.VisibleNodeMask = 0;
+
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Alignment = 0;
+	resDesc.Width = frameSize * frameCount;
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.SampleDesc.Quality = 0;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	HRESULT hr = pDevice->CreateCommittedResource(
+		&heapProp,
+		D3D12_HEAP_FLAG_NONE,
+		&resDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mResource)
+	);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// We do not intend to read from this resource on the CPU.
+	D3D12_RANGE readRange;
+	readRange.Begin = 0;
+	readRange.End = 0;
+
+	UINT8* pDataBegin = nullptr;
+	hr = mResource->Map(0, &readRange, reinterpret_cast<void**>(&pDataBegin));
+	if (FAILED(hr))
+	{
+		mResource.Reset();
+		return hr;
+	}
+
+	mAllocator.initialize(pDataBegin, mResource->GetGPUVirtualAddress(), frameSize, frameCount);
+	return S_OK;
+}
+
+LinearAllocation UploadRingBuffer::allocate(UINT64 size, UINT64 alignment)
+{
+	LinearAllocation allocation = mAllocator.allocate(size, alignment);
+	if (!allocation.isValid())
+	{
+		OutputDebugStringA("ERROR: UploadRingBuffer is out of memory for this frame\n");
+		throw std::exception("UploadRingBuffer is out of memory");
+	}
+	return allocation;
+}
+
+LinearAllocation UploadRingBuffer::push(const void* pData, UINT64 size, UINT64 alignment)
+{
+	LinearAllocation allocation = allocate(size, alignment);
+	memcpy(allocation.pCPU, pData, static_cast<size_t>(size));
+	return allocation;
+}
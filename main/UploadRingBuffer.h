@@ -0,0 +1,34 @@
+#ifndef __RENDERER_UPLOADRINGBUFFER_H__
+#define __RENDERER_UPLOADRINGBUFFER_H__
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include "LinearAllocator.h"
+
+using namespace Microsoft::WRL;
+
+// Persistently mapped UPLOAD heap buffer holding one FrameLinearAllocator region per frame.
+// Mapped once in Create() and never unmapped, so per-object constants cost a memcpy only.
+class UploadRingBuffer
+{
+public:
+	UploadRingBuffer();
+	~UploadRingBuffer();
+
+	HRESULT Create(ID3D12Device* pDevice, UINT64 frameSize, UINT frameCount);
+
+	void beginFrame(UINT frameIndex) { mAllocator.beginFrame(frameIndex); }
+
+	LinearAllocation allocate(UINT64 size, UINT64 alignment = FrameLinearAllocator::DefaultAlignment);
+	LinearAllocation push(const void* pData, UINT64 size, UINT64 alignment = FrameLinearAllocator::DefaultAlignment);
+
+	ID3D12Resource* getResource() const { return mResource.Get(); }
+	const FrameLinearAllocator& getAllocator() const { return mAllocator; }
+
+private:
+	ComPtr<ID3D12Resource> mResource;
+	FrameLinearAllocator mAllocator;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef __CORE_WORKSTEALINGQUEUE_H__
+#define __CORE_WORKSTEALINGQUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Chase-Lev work-stealing deque of pointers with a fixed power-of-two capacity.
+// push / pop are called by the owning thread only and work on the bottom end (LIFO),
+// steal may be called by any thread and takes from the top end (FIFO).
+template<class T, uint32_t Capacity>
+class WorkStealingQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	WorkStealingQueue()
+		: mTop(0)
+		, mTopPadding()
+		, mBottom(0)
+		, mBottomPadding()
+		, mItems()
+	{
+		for (std::atomic<T*>& item : mItems)
+		{
+			item.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	// Returns false when the queue is full.
+	bool push(T* pItem)
+	{
+		const int64_t bottom = mBottom.load(std::memory_order_relaxed);
+		const int64_t top = mTop.load(std::memory_order_acquire);
+		if (bottom - top >= static_cast<int64_t>(Capacity))
+		{
+			return false;
+		}
+
+		mItems[bottom & Mask].store(pItem, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		mBottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	T* pop()
+	{
+		const int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+		mBottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = mTop.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// Empty
+			mBottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* pItem = mItems[bottom & Mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// Last item, race against thieves for it.
+			if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				pItem = nullptr;
+			}
+			mBottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return pItem;
+	}
+
+	T* steal()
+	{
+		int64_t top = mTop.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = mBottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		T* pItem = mItems[top & Mask].load(std::memory_order_relaxed);
+		if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return pItem;
+	}
+
+	bool empty() const
+	{
+		return mBottom.load(std::memory_order_relaxed) <= mTop.load(std::memory_order_relaxed);
+	}
+
+private:
+	static const int64_t Mask = Capacity - 1;
+
+	static const size_t CacheLineSize = 64;
+
+	// Owner and thieves touch different ends; keep them on separate cache lines.
+	// Padding instead of alignas, since the queue is heap allocated.
+	std::atomic<int64_t> mTop;
+	char mTopPadding[CacheLineSize - sizeof(std::atomic<int64_t>)];
+	std::atomic<int64_t> mBottom;
+	char mBottomPadding[CacheLineSize - sizeof(std::atomic<int64_t>)];
+	std::atomic<T*> mItems[Capacity];
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "TestFramework.h"
+
+#include <random>
+#include <vector>
+
+#include "BoundsStore.h"
+#include "Frustum.h"
+
+namespace
+{
+	// Row-vector left-handed perspective, 90 degree field of view, square aspect, D3D depth.
+	// The camera sits at the origin looking down +z.
+	Frustum MakeFrustum(float nearZ, float farZ)
+	{
+		const float depthScale = farZ / (farZ - nearZ);
+		const float values[16] =
+		{
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, depthScale, 1.0f,
+			0.0f, 0.0f, -nearZ * depthScale, 0.0f,
+		};
+		return Frustum::FromViewProjection(XMFLOAT4X4(values));
+	}
+
+	bool IsPointInside(const Frustum& frustum, float x, float y, float z)
+	{
+		for (const XMFLOAT4& plane : frustum.planes)
+		{
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Half of the volumes straddle a frustum plane, so both outcomes and the boundary are common
+	void FillRandom(BoundsStore* pStore, uint32_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+		std::uniform_real_distribution<float> size(0.1f, 10.0f);
+
+		pStore->resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const Vector3 extents(size(random), size(random), size(random));
+			const float radius = mathf::Sqrtf(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+			pStore->set(i, Vector3(position(random), position(random), position(random)), extents, radius);
+		}
+	}
+}
+
+TEST_CASE(Frustum, PlanesOfPerspective)
+{
+	const Frustum frustum = MakeFrustum(1.0f, 100.0f);
+
+	CHECK(IsPointInside(frustum, 0.0f, 0.0f, 10.0f));
+	CHECK(IsPointInside(frustum, 9.0f, -9.0f, 10.0f));
+	CHECK(!IsPointInside(frustum, 0.0f, 0.0f, 0.5f));
+	CHECK(!IsPointInside(frustum, 0.0f, 0.0f, 101.0f));
+	CHECK(!IsPointInside(frustum, 11.0f, 0.0f, 10.0f));
+	CHECK(!IsPointInside(frustum, 0.0f, 11.0f, 10.0f));
+	CHECK(!IsPointInside(frustum, 0.0f, 0.0f, -10.0f));
+
+	// Normalized, so plane distances are in world units
+	const XMFLOAT4& nearPlane = frustum.planes[Frustum::Near];
+	CHECK(nearPlane.z == 1.0f && nearPlane.w == -1.0f);
+}
+
+TEST_CASE(BoundsStore, BoxAndSphereBothReject)
+{
+	const Frustum frustum = MakeFrustum(1.0f, 100.0f);
+	BoundsStore store;
+	store.resize(4);
+	// Inside
+	store.set(0, Vector3(0.0f, 0.0f, 50.0f), Vector3(1.0f, 1.0f, 1.0f), 1.8f);
+	// Straddles the far plane
+	store.set(1, Vector3(0.0f, 0.0f, 101.0f), Vector3(2.0f, 2.0f, 2.0f), 3.5f);
+	// Long flat box reaching through the near plane, but its tight sphere stays behind it
+	store.set(2, Vector3(0.0f, 0.0f, -2.0f), Vector3(0.5f, 0.5f, 5.0f), 0.5f);
+	// Sphere reaching in, box behind: the box rejects it
+	store.set(3, Vector3(0.0f, 0.0f, -2.0f), Vector3(0.5f, 0.5f, 0.5f), 5.0f);
+
+	uint32_t visible[4];
+	CHECK(store.cullScalar(frustum, visible) == 2);
+	CHECK(visible[0] == 0 && visible[1] == 1);
+	CHECK(store.cull(frustum, visible) == 2);
+	CHECK(visible[0] == 0 && visible[1] == 1);
+}
+
+/// <summary>
+/// Every count up to 37 runs the 8-wide, 4-wide and scalar tail paths; the results must match
+/// the scalar reference exactly, in the same order.
+/// </summary>
+TEST_CASE(BoundsStore, SimdMatchesScalar)
+{
+	const Frustum frustum = MakeFrustum(0.5f, 120.0f);
+
+	for (uint32_t count = 0; count <= 37; ++count)
+	{
+		BoundsStore store;
+		FillRandom(&store, count, count);
+
+		std::vector<uint32_t> expected(count + 1), actual(count + 1);
+		const uint32_t expectedCount = store.cullScalar(frustum, expected.data());
+		REQUIRE(store.cull(frustum, actual.data()) == expectedCount);
+		for (uint32_t i = 0; i < expectedCount; ++i)
+		{
+			REQUIRE(actual[i] == expected[i]);
+		}
+	}
+
+	BoundsStore store;
+	FillRandom(&store, 100003, 7);
+	std::vector<uint32_t> expected(store.size()), actual(store.size());
+	const uint32_t expectedCount = store.cullScalar(frustum, expected.data());
+	CHECK(expectedCount > 0 && expectedCount < store.size());
+	REQUIRE(store.cull(frustum, actual.data()) == expectedCount);
+	CHECK(expected == actual);
+}
+
+BENCHMARK(BoundsStore, Cull)
+{
+	const uint32_t count = static_cast<uint32_t>(1000000 * Test::GetBenchmarkScale()) + 1;
+	const uint32_t frameCount = 20;
+	const Frustum frustum = MakeFrustum(0.5f, 120.0f);
+
+	BoundsStore store;
+	FillRandom(&store, count, 1);
+	std::vector<uint32_t> visible(count);
+
+	uint32_t visibleCount = 0;
+	int64_t begin = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		visibleCount += store.cullScalar(frustum, visible.data());
+	}
+	int64_t end = Test::GetTime();
+	Test::Report("BoundsStore::cullScalar", static_cast<uint64_t>(frameCount) * count, end - begin);
+
+	begin = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		visibleCount += store.cull(frustum, visible.data());
+	}
+	end = Test::GetTime();
+#if defined(__AVX2__)
+	Test::Report("BoundsStore::cull (AVX2)", static_cast<uint64_t>(frameCount) * count, end - begin);
+#else
+	Test::Report("BoundsStore::cull (SSE)", static_cast<uint64_t>(frameCount) * count, end - begin);
+#endif
+	Test::Consume(visibleCount);
+}
@@ -0,0 +1,320 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "BundleCache.h"
+
+namespace
+{
+	// Hands out unique tokens and counts destroys of anything it did not hand out or destroyed twice.
+	class FakeBundleRecorder final : public IBundleRecorder
+	{
+	public:
+		FakeBundleRecorder()
+			: mNextBundle(1)
+			, mRecordCount(0)
+			, mInvalidDestroyCount(0)
+		{
+		}
+
+		void* record(const BundleKey&, const BundleDraw&) override
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			void* pBundle = reinterpret_cast<void*>(mNextBundle++);
+			mLive.insert(pBundle);
+			++mRecordCount;
+			return pBundle;
+		}
+
+		void destroy(void* pBundle) override
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mLive.erase(pBundle) == 0)
+			{
+				++mInvalidDestroyCount;
+			}
+		}
+
+		bool isLive(void* pBundle) const
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mLive.count(pBundle) != 0;
+		}
+
+		size_t getLiveCount() const
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mLive.size();
+		}
+
+		uint32_t getRecordCount() const { return mRecordCount; }
+		uint32_t getInvalidDestroyCount() const { return mInvalidDestroyCount; }
+
+	private:
+		mutable std::mutex mMutex;
+		std::set<void*> mLive;
+		uintptr_t mNextBundle;
+		uint32_t mRecordCount;
+		uint32_t mInvalidDestroyCount;
+	};
+
+	const void* MeshA = reinterpret_cast<const void*>(0x100);
+	const void* MeshB = reinterpret_cast<const void*>(0x200);
+	const void* PsoA = reinterpret_cast<const void*>(0x1000);
+	const void* PsoB = reinterpret_cast<const void*>(0x2000);
+	const void* RootSignature = reinterpret_cast<const void*>(0x10000);
+
+	BundleKey MakeKey(const void* pMesh, const void* pPipelineState)
+	{
+		BundleKey key = { pMesh, pPipelineState, RootSignature };
+		return key;
+	}
+
+	BundleDraw MakeDraw(uint32_t firstInstance, uint32_t instanceCount)
+	{
+		BundleDraw draw = { firstInstance, instanceCount, 1 };
+		return draw;
+	}
+}
+
+TEST_CASE(BundleCache, RecordsOnceDrawIsStable)
+{
+	FakeBundleRecorder recorder;
+	BundleCache cache;
+	cache.initialize(&recorder, 3);
+
+	const BundleKey key = MakeKey(MeshA, PsoA);
+	const BundleDraw draw = MakeDraw(0, 10);
+
+	CHECK(cache.acquire(key, draw, 1) == nullptr);
+	CHECK(cache.acquire(key, draw, 2) == nullptr);
+	void* pBundle = cache.acquire(key, draw, 3);
+	REQUIRE(pBundle != nullptr);
+	CHECK(cache.acquire(key, draw, 4) == pBundle);
+	CHECK(cache.acquire(key, draw, 5) == pBundle);
+	CHECK(cache.getRecordCount() == 1);
+	CHECK(cache.getHitCount() == 2);
+	CHECK(cache.getBundleCount() == 1);
+
+	// A draw changing every frame never gets a bundle
+	for (uint32_t frame = 0; frame < 10; ++frame)
+	{
+		CHECK(cache.acquire(MakeKey(MeshB, PsoA), MakeDraw(frame, 1), 6 + frame) == nullptr);
+	}
+	CHECK(recorder.getRecordCount() == 1);
+
+	cache.destroy();
+	CHECK(recorder.getLiveCount() == 0);
+	CHECK(recorder.getInvalidDestroyCount() == 0);
+}
+
+TEST_CASE(BundleCache, ChangedDrawRetiresUntilFenceCompletes)
+{
+	FakeBundleRecorder recorder;
+	BundleCache cache;
+	cache.initialize(&recorder, 1);
+
+	const BundleKey key = MakeKey(MeshA, PsoA);
+	void* pOld = cache.acquire(key, MakeDraw(0, 10), 1);
+	REQUIRE(pOld != nullptr);
+
+	void* pNew = cache.acquire(key, MakeDraw(0, 11), 2);
+	REQUIRE(pNew != nullptr);
+	CHECK(pNew != pOld);
+	CHECK(cache.getRetiredCount() == 1);
+
+	// Frame 2 no longer replays pOld, but frame 1 may still run on the GPU
+	cache.collect(0);
+	CHECK(recorder.isLive(pOld));
+	cache.collect(2);
+	CHECK(!recorder.isLive(pOld));
+	CHECK(recorder.isLive(pNew));
+	CHECK(cache.getRetiredCount() == 0);
+}
+
+TEST_CASE(BundleCache, InvalidateRetiresMatchingBundlesOnly)
+{
+	FakeBundleRecorder recorder;
+	BundleCache cache;
+	cache.initialize(&recorder, 1);
+
+	const BundleDraw draw = MakeDraw(0, 4);
+	void* pMeshAPsoA = cache.acquire(MakeKey(MeshA, PsoA), draw, 1);
+	void* pMeshBPsoA = cache.acquire(MakeKey(MeshB, PsoA), draw, 1);
+	void* pMeshAPsoB = cache.acquire(MakeKey(MeshA, PsoB), draw, 1);
+	void* pMeshBPsoB = cache.acquire(MakeKey(MeshB, PsoB), draw, 1);
+	CHECK(cache.getBundleCount() == 4);
+
+	cache.invalidatePipelineState(PsoA, 2);
+	CHECK(cache.getBundleCount() == 2);
+	CHECK(cache.getRetiredCount() == 2);
+
+	cache.invalidateMesh(MeshB, 3);
+	CHECK(cache.getBundleCount() == 1);
+	CHECK(cache.getRetiredCount() == 3);
+
+	cache.collect(2);
+	CHECK(!recorder.isLive(pMeshAPsoA));
+	CHECK(!recorder.isLive(pMeshBPsoA));
+	CHECK(recorder.isLive(pMeshBPsoB));
+	cache.collect(3);
+	CHECK(!recorder.isLive(pMeshBPsoB));
+	CHECK(recorder.isLive(pMeshAPsoB));
+
+	// The invalidated key starts over and records a new bundle
+	void* pRecorded = cache.acquire(MakeKey(MeshA, PsoA), draw, 4);
+	CHECK(pRecorded != nullptr && pRecorded != pMeshAPsoA);
+	CHECK(recorder.getInvalidDestroyCount() == 0);
+}
+
+/// <summary>
+/// A pipeline state published on the build thread invalidates with the fence value it read,
+/// which may be older than the frame the render thread already replayed the bundle in.
+/// </summary>
+TEST_CASE(BundleCache, InvalidateWaitsForLastAcquire)
+{
+	FakeBundleRecorder recorder;
+	BundleCache cache;
+	cache.initialize(&recorder, 1);
+
+	const BundleKey key = MakeKey(MeshA, PsoA);
+	void* pBundle = cache.acquire(key, MakeDraw(0, 1), 5);
+	REQUIRE(pBundle != nullptr);
+	CHECK(cache.acquire(key, MakeDraw(0, 1), 6) == pBundle);
+
+	cache.invalidatePipelineState(PsoA, 4);
+	cache.collect(5);
+	CHECK(recorder.isLive(pBundle));
+	cache.collect(6);
+	CHECK(!recorder.isLive(pBundle));
+}
+
+TEST_CASE(BundleCache, EvictsBundlesNotUsedSinceFence)
+{
+	FakeBundleRecorder recorder;
+	BundleCache cache;
+	cache.initialize(&recorder, 1);
+
+	void* pStale = cache.acquire(MakeKey(MeshA, PsoA), MakeDraw(0, 1), 1);
+	void* pUsed = cache.acquire(MakeKey(MeshB, PsoA), MakeDraw(0, 1), 1);
+	CHECK(cache.acquire(MakeKey(MeshB, PsoA), MakeDraw(0, 1), 3) == pUsed);
+
+	cache.evictUnused(2);
+	CHECK(!recorder.isLive(pStale));
+	CHECK(recorder.isLive(pUsed));
+	CHECK(cache.getBundleCount() == 1);
+}
+
+/// <summary>
+/// Workers acquire while another thread keeps invalidating; every bundle must be destroyed exactly once,
+/// and never before the last fence value it was handed out for has completed.
+/// </summary>
+TEST_CASE(BundleCache, ConcurrentAcquireAndInvalidate)
+{
+	FakeBundleRecorder recorder;
+	BundleCache cache;
+	cache.initialize(&recorder, 1);
+
+	const uint32_t workerCount = 3;
+	const uint32_t frameCount = 200;
+	const void* meshes[] = { MeshA, MeshB };
+	const void* pipelineStates[] = { PsoA, PsoB };
+
+	std::atomic<uint32_t> nullCount(0);
+	std::atomic<bool> isDone(false);
+	std::atomic<uint64_t> currentFence(1);
+
+	std::thread invalidator([&]()
+	{
+		uint32_t i = 0;
+		while (!isDone.load())
+		{
+			// Reads the fence value before the frame that acquires next, like a build thread would
+			cache.invalidatePipelineState(pipelineStates[i & 1], currentFence.load() - 1);
+			++i;
+			std::this_thread::yield();
+		}
+	});
+
+	uint32_t destroyedInFlight = 0;
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		const uint64_t fence = currentFence.load();
+		std::vector<std::vector<void*>> used(workerCount);
+		std::vector<std::thread> workers;
+		for (uint32_t worker = 0; worker < workerCount; ++worker)
+		{
+			workers.emplace_back([&, worker]()
+			{
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					const BundleKey key = MakeKey(meshes[i & 1], pipelineStates[(i >> 1) & 1]);
+					void* pBundle = cache.acquire(key, MakeDraw(worker, 1), fence);
+					if (pBundle == nullptr)
+					{
+						nullCount.fetch_add(1);
+					}
+					else
+					{
+						used[worker].push_back(pBundle);
+					}
+				}
+			});
+		}
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		// The GPU lags one frame behind: this frame's bundles must survive collecting the previous one
+		currentFence.store(fence + 1);
+		cache.collect(fence - 1);
+		for (const std::vector<void*>& bundles : used)
+		{
+			for (void* pBundle : bundles)
+			{
+				destroyedInFlight += recorder.isLive(pBundle) ? 0 : 1;
+			}
+		}
+	}
+
+	isDone.store(true);
+	invalidator.join();
+
+	CHECK(nullCount.load() == 0);
+	CHECK(destroyedInFlight == 0);
+	cache.collect(currentFence.load());
+	cache.destroy();
+	CHECK(recorder.getLiveCount() == 0);
+	CHECK(recorder.getInvalidDestroyCount() == 0);
+}
+
+BENCHMARK(BundleCache, AcquireHit)
+{
+	FakeBundleRecorder recorder;
+	BundleCache cache;
+	cache.initialize(&recorder, 1);
+
+	const uint32_t batchCount = 256;
+	std::vector<BundleKey> keys(batchCount);
+	for (uint32_t i = 0; i < batchCount; ++i)
+	{
+		keys[i] = MakeKey(reinterpret_cast<const void*>(static_cast<uintptr_t>(0x100 + i)), PsoA);
+		cache.acquire(keys[i], MakeDraw(i, 1), 1);
+	}
+
+	const uint32_t frameCount = static_cast<uint32_t>(1000 * Test::GetBenchmarkScale());
+	const int64_t start = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (uint32_t i = 0; i < batchCount; ++i)
+		{
+			Test::Consume(reinterpret_cast<uintptr_t>(cache.acquire(keys[i], MakeDraw(i, 1), 2 + frame)));
+		}
+	}
+	Test::Report("acquire", static_cast<uint64_t>(frameCount) * batchCount, Test::GetTime() - start);
+}
@@ -0,0 +1,400 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Bvh.h"
+
+namespace
+{
+	Aabb MakeAabb(float x, float y, float z, float halfSize)
+	{
+		Aabb bounds = { { x - halfSize, y - halfSize, z - halfSize }, { x + halfSize, y + halfSize, z + halfSize } };
+		return bounds;
+	}
+
+	std::vector<Aabb> MakeBounds(uint32_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+		std::vector<Aabb> bounds(count);
+		for (Aabb& box : bounds)
+		{
+			box = MakeAabb(position(random), position(random), position(random), size(random));
+		}
+		return bounds;
+	}
+
+	// Row-vector left-handed perspective looking down +z from the origin, 90 degree field of view
+	Frustum MakeFrustum(float nearZ, float farZ)
+	{
+		const float depthScale = farZ / (farZ - nearZ);
+		const float values[16] =
+		{
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, depthScale, 1.0f,
+			0.0f, 0.0f, -nearZ * depthScale, 0.0f,
+		};
+		return Frustum::FromViewProjection(XMFLOAT4X4(values));
+	}
+
+	// Brute-force references over the enlarged boxes of every live proxy
+
+	bool IsOverlapping(const Aabb& a, const Aabb& b)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			if (a.upper[i] < b.lower[i] || b.upper[i] < a.lower[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool IsOutside(const Frustum& frustum, const Aabb& bounds)
+	{
+		for (const XMFLOAT4& plane : frustum.planes)
+		{
+			// Corner farthest along the plane normal
+			const float x = (plane.x >= 0.0f) ? bounds.upper[0] : bounds.lower[0];
+			const float y = (plane.y >= 0.0f) ? bounds.upper[1] : bounds.lower[1];
+			const float z = (plane.z >= 0.0f) ? bounds.upper[2] : bounds.lower[2];
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool IntersectRay(const Aabb& bounds, const float origin[3], const float direction[3], float maxDistance, float* pDistance)
+	{
+		float tmin = 0.0f;
+		float tmax = maxDistance;
+		for (int i = 0; i < 3; ++i)
+		{
+			const float inverse = (direction[i] != 0.0f) ? 1.0f / direction[i] : FLT_MAX;
+			float t0 = (bounds.lower[i] - origin[i]) * inverse;
+			float t1 = (bounds.upper[i] - origin[i]) * inverse;
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			tmin = std::max(tmin, t0);
+			tmax = std::min(tmax, t1);
+			if (tmin > tmax)
+			{
+				return false;
+			}
+		}
+		*pDistance = tmin;
+		return true;
+	}
+
+	struct Reference
+	{
+		std::vector<uint32_t> proxies;
+
+		std::vector<uint32_t> queryOverlap(const Bvh& bvh, const Aabb& query) const
+		{
+			std::vector<uint32_t> result;
+			for (uint32_t proxy : proxies)
+			{
+				if (proxy != Bvh::InvalidIndex && IsOverlapping(bvh.getFatBounds(proxy), query))
+				{
+					result.push_back(bvh.getUserData(proxy));
+				}
+			}
+			std::sort(result.begin(), result.end());
+			return result;
+		}
+
+		std::vector<uint32_t> queryFrustum(const Bvh& bvh, const Frustum& frustum) const
+		{
+			std::vector<uint32_t> result;
+			for (uint32_t proxy : proxies)
+			{
+				if (proxy != Bvh::InvalidIndex && !IsOutside(frustum, bvh.getFatBounds(proxy)))
+				{
+					result.push_back(bvh.getUserData(proxy));
+				}
+			}
+			std::sort(result.begin(), result.end());
+			return result;
+		}
+
+		bool raycast(const Bvh& bvh, const float origin[3], const float direction[3], float maxDistance, float* pDistance) const
+		{
+			bool isHit = false;
+			float closest = maxDistance;
+			for (uint32_t proxy : proxies)
+			{
+				float distance;
+				if (proxy != Bvh::InvalidIndex && IntersectRay(bvh.getFatBounds(proxy), origin, direction, closest, &distance))
+				{
+					isHit = true;
+					closest = distance;
+				}
+			}
+			*pDistance = closest;
+			return isHit;
+		}
+	};
+
+	std::vector<uint32_t> Sorted(std::vector<uint32_t> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values;
+	}
+
+	/// <summary>
+	/// Random overlap, frustum and ray queries against the brute-force reference.
+	/// </summary>
+	void CheckQueries(const Bvh& bvh, const Reference& reference, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> size(1.0f, 60.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		for (uint32_t query = 0; query < 50; ++query)
+		{
+			const Aabb box = MakeAabb(position(random), position(random), position(random), size(random));
+			std::vector<uint32_t> result;
+			bvh.queryOverlap(box, result);
+			REQUIRE(Sorted(result) == reference.queryOverlap(bvh, box));
+		}
+
+		const Frustum frustums[] = { MakeFrustum(0.5f, 50.0f), MakeFrustum(1.0f, 150.0f), MakeFrustum(10.0f, 400.0f) };
+		for (const Frustum& frustum : frustums)
+		{
+			std::vector<uint32_t> result;
+			bvh.queryFrustum(frustum, result);
+			REQUIRE(Sorted(result) == reference.queryFrustum(bvh, frustum));
+		}
+
+		for (uint32_t query = 0; query < 200; ++query)
+		{
+			const float origin[3] = { position(random), position(random), position(random) };
+			const float direction[3] = { unit(random), unit(random), (query % 10 == 0) ? 0.0f : unit(random) };
+
+			uint32_t userData = Bvh::InvalidIndex;
+			float distance = 0.0f, expectedDistance = 0.0f;
+			const bool isHit = bvh.raycast(origin, direction, 500.0f, &userData, &distance);
+			REQUIRE(isHit == reference.raycast(bvh, origin, direction, 500.0f, &expectedDistance));
+			if (isHit)
+			{
+				// Ties may pick either object, but never a farther one
+				CHECK(distance == expectedDistance);
+			}
+		}
+	}
+}
+
+TEST_CASE(Bvh, BuildMatchesBruteForce)
+{
+	for (uint32_t count : { 1u, 2u, 3u, 17u, 1000u, 5000u })
+	{
+		const std::vector<Aabb> bounds = MakeBounds(count, count);
+		std::vector<uint32_t> userData(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			userData[i] = i * 3 + 1;
+		}
+
+		Bvh bvh;
+		Reference reference;
+		reference.proxies.resize(count);
+		bvh.build(bounds.data(), userData.data(), count, reference.proxies.data());
+
+		CHECK(bvh.getProxyCount() == count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			REQUIRE(bvh.getUserData(reference.proxies[i]) == userData[i]);
+		}
+		CheckQueries(bvh, reference, count);
+	}
+
+	Bvh empty;
+	std::vector<uint32_t> result;
+	empty.queryOverlap(MakeAabb(0.0f, 0.0f, 0.0f, 1000.0f), result);
+	CHECK(result.empty());
+	CHECK(empty.getHeight() == 0);
+}
+
+/// <summary>
+/// Incremental inserts, removals, reinserting updates and refits keep every query exact
+/// and the rotations keep the tree height logarithmic.
+/// </summary>
+TEST_CASE(Bvh, DynamicUpdatesMatchBruteForce)
+{
+	const uint32_t count = 3000;
+	std::vector<Aabb> bounds = MakeBounds(count, 42);
+
+	Bvh bvh(0.5f);
+	Reference reference;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		reference.proxies.push_back(bvh.insert(bounds[i], i));
+	}
+	CHECK(bvh.getHeight() <= 32);
+	CheckQueries(bvh, reference, 1);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+	uint32_t reinsertedCount = 0;
+	for (uint32_t round = 0; round < 5; ++round)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t& proxy = reference.proxies[i];
+			if (proxy == Bvh::InvalidIndex)
+			{
+				proxy = bvh.insert(bounds[i], i);
+				continue;
+			}
+
+			const uint32_t action = (i + round) % 10;
+			if (action == 0)
+			{
+				bvh.remove(proxy);
+				proxy = Bvh::InvalidIndex;
+				continue;
+			}
+
+			Aabb& box = bounds[i];
+			const float offset[3] = { step(random), step(random), step(random) };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				box.lower[axis] += offset[axis];
+				box.upper[axis] += offset[axis];
+			}
+			if (action == 1)
+			{
+				bvh.refit(proxy, box);
+			}
+			else
+			{
+				reinsertedCount += bvh.update(proxy, box) ? 1 : 0;
+			}
+			REQUIRE(bvh.getUserData(proxy) == i);
+		}
+		CheckQueries(bvh, reference, round + 2);
+	}
+
+	// Small steps inside the margin must not all reinsert
+	CHECK(reinsertedCount > 0 && reinsertedCount < 5 * count);
+	CHECK(bvh.getHeight() <= 32);
+
+	for (uint32_t& proxy : reference.proxies)
+	{
+		if (proxy != Bvh::InvalidIndex)
+		{
+			bvh.remove(proxy);
+			proxy = Bvh::InvalidIndex;
+		}
+	}
+	CHECK(bvh.getProxyCount() == 0);
+	CHECK(bvh.getHeight() == 0);
+}
+
+BENCHMARK(Bvh, Build)
+{
+	const uint32_t count = static_cast<uint32_t>(100000 * Test::GetBenchmarkScale()) + 1;
+	const std::vector<Aabb> bounds = MakeBounds(count, 1);
+	std::vector<uint32_t> userData(count), proxies(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		userData[i] = i;
+	}
+
+	Bvh bvh;
+	int64_t begin = Test::GetTime();
+	bvh.build(bounds.data(), userData.data(), count, proxies.data());
+	int64_t end = Test::GetTime();
+	Test::Report("Bvh::build (binned SAH)", count, end - begin);
+
+	Bvh incremental;
+	begin = Test::GetTime();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		incremental.insert(bounds[i], i);
+	}
+	end = Test::GetTime();
+	Test::Report("Bvh::insert", count, end - begin);
+	Test::Consume(static_cast<uint64_t>(bvh.getHeight() + incremental.getHeight()));
+}
+
+BENCHMARK(Bvh, Query)
+{
+	const uint32_t count = static_cast<uint32_t>(100000 * Test::GetBenchmarkScale()) + 1;
+	const uint32_t queryCount = 1000;
+	const std::vector<Aabb> bounds = MakeBounds(count, 1);
+	std::vector<uint32_t> userData(count);
+	Reference reference;
+	reference.proxies.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		userData[i] = i;
+	}
+
+	Bvh bvh;
+	bvh.build(bounds.data(), userData.data(), count, reference.proxies.data());
+
+	const std::vector<Aabb> queries = MakeBounds(queryCount, 2);
+	std::vector<uint32_t> result;
+	uint64_t found = 0;
+
+	int64_t begin = Test::GetTime();
+	for (const Aabb& query : queries)
+	{
+		const Aabb box = { { query.lower[0] - 10.0f, query.lower[1] - 10.0f, query.lower[2] - 10.0f }, { query.upper[0] + 10.0f, query.upper[1] + 10.0f, query.upper[2] + 10.0f } };
+		result.clear();
+		bvh.queryOverlap(box, result);
+		found += result.size();
+	}
+	int64_t end = Test::GetTime();
+	Test::Report("Bvh::queryOverlap", queryCount, end - begin);
+
+	begin = Test::GetTime();
+	for (uint32_t query = 0; query < queryCount / 10; ++query)
+	{
+		const Aabb& box = queries[query];
+		found += reference.queryOverlap(bvh, box).size();
+	}
+	end = Test::GetTime();
+	Test::Report("brute-force overlap", queryCount / 10, end - begin);
+
+	const Frustum frustum = MakeFrustum(1.0f, 150.0f);
+	begin = Test::GetTime();
+	for (uint32_t query = 0; query < 100; ++query)
+	{
+		result.clear();
+		bvh.queryFrustum(frustum, result);
+		found += result.size();
+	}
+	end = Test::GetTime();
+	Test::Report("Bvh::queryFrustum", 100, end - begin);
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	begin = Test::GetTime();
+	for (uint32_t query = 0; query < queryCount; ++query)
+	{
+		const float origin[3] = { unit(random) * 200.0f, unit(random) * 200.0f, unit(random) * 200.0f };
+		const float direction[3] = { unit(random), unit(random), unit(random) };
+		uint32_t hit;
+		float distance;
+		found += bvh.raycast(origin, direction, 500.0f, &hit, &distance) ? 1 : 0;
+	}
+	end = Test::GetTime();
+	Test::Report("Bvh::raycast", queryCount, end - begin);
+	Test::Consume(found);
+}
@@ -0,0 +1,262 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "DeferredReleaseQueue.h"
+
+namespace
+{
+	// Completes values only when told to.
+	class ManualFence final : public IFenceTimeline
+	{
+	public:
+		ManualFence() : mCompletedValue(0) {}
+
+		void signal(uint64_t) override {}
+		uint64_t getCompletedValue() override { return mCompletedValue.load(); }
+		void wait(uint64_t value) override { complete(value); }
+
+		void complete(uint64_t value) { mCompletedValue.store(value); }
+
+	private:
+		std::atomic<uint64_t> mCompletedValue;
+	};
+
+	// Records what was released and whether the fence had completed by then.
+	struct ReleaseLog
+	{
+		ManualFence* pFence;
+		std::vector<uint64_t> released;
+		uint32_t earlyCount;
+	};
+
+	struct Parked
+	{
+		ReleaseLog* pLog;
+		uint64_t fenceValue;
+	};
+
+	void ReleaseParked(void* pObject, uint64_t context)
+	{
+		Parked* pParked = static_cast<Parked*>(pObject);
+		if (pParked->pLog->pFence->getCompletedValue() < pParked->fenceValue)
+		{
+			++pParked->pLog->earlyCount;
+		}
+		pParked->pLog->released.push_back(context);
+	}
+
+	void CountRelease(void* pObject, uint64_t)
+	{
+		static_cast<std::atomic<uint32_t>*>(pObject)->fetch_add(1);
+	}
+}
+
+TEST_CASE(DeferredReleaseQueue, ReleasesAtOnceWithoutPendingWork)
+{
+	ManualFence fence;
+	FenceTracker tracker;
+	tracker.initialize(&fence);
+	DeferredReleaseQueue queue;
+
+	// Not initialized yet: nothing can be in flight
+	std::atomic<uint32_t> count(0);
+	queue.release(&CountRelease, &count, 0);
+	CHECK(count.load() == 1);
+
+	queue.initialize(&tracker);
+	queue.release(0, &CountRelease, &count, 0);
+	CHECK(count.load() == 2);
+	CHECK(queue.getPendingCount() == 0);
+
+	queue.release(&CountRelease, &count, 0);
+	CHECK(count.load() == 2);
+	CHECK(queue.getPendingCount() == 1);
+	queue.destroy();
+	CHECK(count.load() == 3);
+}
+
+TEST_CASE(DeferredReleaseQueue, ParksUntilFenceCompletes)
+{
+	ManualFence fence;
+	FenceTracker tracker;
+	tracker.initialize(&fence);
+	DeferredReleaseQueue queue;
+	queue.initialize(&tracker);
+
+	ReleaseLog log = { &fence, {}, 0 };
+	Parked frame1 = { &log, 1 };
+	Parked frame2 = { &log, 2 };
+
+	queue.release(&ReleaseParked, &frame1, 10);
+	queue.release(2, &ReleaseParked, &frame2, 20);
+	queue.release(&ReleaseParked, &frame1, 11);
+	tracker.signal();
+	queue.release(&ReleaseParked, &frame2, 21);
+	tracker.signal();
+	CHECK(queue.getPendingCount() == 4);
+
+	CHECK(queue.collect() == 0);
+	fence.complete(1);
+	CHECK(queue.collect() == 2);
+	REQUIRE(log.released.size() == 2);
+	CHECK(log.released[0] == 10);
+	CHECK(log.released[1] == 11);
+
+	fence.complete(2);
+	CHECK(queue.collect() == 2);
+	REQUIRE(log.released.size() == 4);
+	CHECK(log.released[2] == 20);
+	CHECK(log.released[3] == 21);
+	CHECK(log.earlyCount == 0);
+	CHECK(queue.getReleasedCount() == 4);
+}
+
+namespace
+{
+	struct Reparker
+	{
+		DeferredReleaseQueue* pQueue;
+		std::atomic<uint32_t> count;
+	};
+
+	// Parks another release while collect() is running
+	void ReleaseAndRepark(void* pObject, uint64_t context)
+	{
+		Reparker* pReparker = static_cast<Reparker*>(pObject);
+		pReparker->pQueue->release(context, &CountRelease, &pReparker->count, 0);
+	}
+}
+
+TEST_CASE(DeferredReleaseQueue, ReleaseFromReleaseFunctionWaitsForNextCollect)
+{
+	ManualFence fence;
+	FenceTracker tracker;
+	tracker.initialize(&fence);
+	DeferredReleaseQueue queue;
+	queue.initialize(&tracker);
+
+	Reparker reparker;
+	reparker.pQueue = &queue;
+	reparker.count.store(0);
+
+	queue.release(1, &ReleaseAndRepark, &reparker, 2);
+	fence.complete(1);
+	CHECK(queue.collect() == 1);
+	CHECK(reparker.count.load() == 0);
+	CHECK(queue.getPendingCount() == 1);
+
+	fence.complete(2);
+	CHECK(queue.collect() == 1);
+	CHECK(reparker.count.load() == 1);
+	CHECK(queue.getPendingCount() == 0);
+}
+
+TEST_CASE(DeferredReleaseQueue, DestroyReleasesEverything)
+{
+	ManualFence fence;
+	FenceTracker tracker;
+	tracker.initialize(&fence);
+	DeferredReleaseQueue queue;
+	queue.initialize(&tracker);
+
+	std::atomic<uint32_t> count(0);
+	for (uint64_t value = 1; value <= 5; ++value)
+	{
+		queue.release(value, &CountRelease, &count, 0);
+	}
+	CHECK(count.load() == 0);
+	queue.destroy();
+	CHECK(count.load() == 5);
+
+	// Later releases happen at once
+	queue.release(100, &CountRelease, &count, 0);
+	CHECK(count.load() == 6);
+	CHECK(queue.collect() == 0);
+}
+
+/// <summary>
+/// Threads park releases while the owner signals and collects; each object goes exactly once.
+/// </summary>
+TEST_CASE(DeferredReleaseQueue, ConcurrentRelease)
+{
+	ManualFence fence;
+	FenceTracker tracker;
+	tracker.initialize(&fence);
+	DeferredReleaseQueue queue;
+	queue.initialize(&tracker);
+
+	const uint32_t threadCount = 4;
+	const uint32_t perThread = 20000;
+	std::vector<std::atomic<uint32_t>> counts(threadCount * perThread);
+	for (std::atomic<uint32_t>& count : counts)
+	{
+		count.store(0);
+	}
+	std::atomic<uint32_t> finishedCount(0);
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (uint32_t i = 0; i < perThread; ++i)
+			{
+				queue.release(&CountRelease, &counts[t * perThread + i], 0);
+			}
+			finishedCount.fetch_add(1);
+		});
+	}
+
+	while (finishedCount.load() < threadCount)
+	{
+		fence.complete(tracker.signal() - 1);
+		queue.collect();
+		std::this_thread::yield();
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	tracker.waitIdle();
+	queue.collect();
+
+	uint32_t wrongCount = 0;
+	for (const std::atomic<uint32_t>& count : counts)
+	{
+		wrongCount += (count.load() == 1) ? 0 : 1;
+	}
+	CHECK(wrongCount == 0);
+	CHECK(queue.getPendingCount() == 0);
+	CHECK(queue.getReleasedCount() == threadCount * perThread);
+}
+
+BENCHMARK(DeferredReleaseQueue, ReleaseCollect)
+{
+	ManualFence fence;
+	FenceTracker tracker;
+	tracker.initialize(&fence);
+	DeferredReleaseQueue queue;
+	queue.initialize(&tracker);
+
+	const uint32_t frameCount = static_cast<uint32_t>(1000 * Test::GetBenchmarkScale());
+	const uint32_t perFrame = 256;
+	std::atomic<uint32_t> count(0);
+
+	const int64_t start = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (uint32_t i = 0; i < perFrame; ++i)
+		{
+			queue.release(&CountRelease, &count, i);
+		}
+		const uint64_t value = tracker.signal();
+		// The GPU runs two frames behind
+		fence.complete(value > 2 ? value - 2 : 0);
+		queue.collect();
+	}
+	Test::Report("release", static_cast<uint64_t>(frameCount) * perFrame, Test::GetTime() - start);
+	Test::Consume(count.load());
+}
@@ -0,0 +1,340 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+
+TEST_CASE(DescriptorAllocator, AllocatesFromTheFront)
+{
+	DescriptorAllocator allocator;
+	allocator.initialize(4, 8, 2);
+	CHECK(allocator.getCapacity() == 4 + 8 * 2);
+	CHECK(allocator.getPersistentCount() == 4);
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		CHECK(allocator.allocate() == i);
+	}
+	CHECK(allocator.allocate() == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.getAllocatedCount() == 4);
+
+	// Indices outside the persistent range are not ours to free
+	allocator.free(4, 0);
+	allocator.free(DescriptorAllocator::InvalidIndex, 0);
+	CHECK(allocator.getPendingCount() == 0);
+}
+
+/// <summary>
+/// A freed descriptor stays out of reach until collect() is told its fence value completed,
+/// however many times collect() runs before that.
+/// </summary>
+TEST_CASE(DescriptorAllocator, ReuseWaitsForFence)
+{
+	DescriptorAllocator allocator;
+	allocator.initialize(3, 0, 1);
+	const uint32_t a = allocator.allocate();
+	const uint32_t b = allocator.allocate();
+	const uint32_t c = allocator.allocate();
+
+	allocator.free(b, 5);
+	allocator.free(a, 6);
+	CHECK(allocator.getPendingCount() == 2);
+	CHECK(allocator.getAllocatedCount() == 3);
+	CHECK(allocator.allocate() == DescriptorAllocator::InvalidIndex);
+
+	allocator.collect(4);
+	CHECK(allocator.allocate() == DescriptorAllocator::InvalidIndex);
+	allocator.collect(4);
+	CHECK(allocator.getPendingCount() == 2);
+
+	allocator.collect(5);
+	CHECK(allocator.getPendingCount() == 1);
+	CHECK(allocator.getAllocatedCount() == 2);
+	CHECK(allocator.allocate() == b);
+	CHECK(allocator.allocate() == DescriptorAllocator::InvalidIndex);
+
+	// Freed after the earlier frees were taken in, with a value already complete
+	allocator.free(c, 1);
+	allocator.collect(5);
+	CHECK(allocator.allocate() == c);
+	allocator.collect(6);
+	CHECK(allocator.allocate() == a);
+	CHECK(allocator.getPendingCount() == 0);
+	CHECK(allocator.getAllocatedCount() == 3);
+}
+
+TEST_CASE(DescriptorAllocator, TransientRegionRunsOut)
+{
+	DescriptorAllocator allocator;
+	allocator.initialize(10, 16, 3);
+
+	// Frame 0 starts right after the persistent descriptors
+	CHECK(allocator.allocateTransient(10) == 10);
+	CHECK(allocator.allocateTransient(4) == 20);
+	CHECK(allocator.getTransientUsedCount() == 14);
+
+	// Too many for what is left fails without using any; a smaller request still fits
+	CHECK(allocator.allocateTransient(3) == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.getTransientUsedCount() == 14);
+	CHECK(allocator.allocateTransient(2) == 24);
+	CHECK(allocator.getTransientUsedCount() == 16);
+	CHECK(allocator.allocateTransient(1) == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.allocateTransient(0) == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.allocateTransient(~0u) == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.getTransientUsedCount() == 16);
+
+	// Each frame has a region of its own, reused every frameCount frames
+	allocator.beginFrame(1);
+	CHECK(allocator.getTransientUsedCount() == 0);
+	CHECK(allocator.allocateTransient(16) == 26);
+	CHECK(allocator.allocateTransient(1) == DescriptorAllocator::InvalidIndex);
+	allocator.beginFrame(2);
+	CHECK(allocator.allocateTransient(1) == 42);
+	allocator.beginFrame(3);
+	CHECK(allocator.allocateTransient(1) == 10);
+
+	// The persistent descriptors are untouched
+	CHECK(allocator.getAllocatedCount() == 0);
+	CHECK(allocator.allocate() == 0);
+
+	// Without a transient region every request fails
+	DescriptorAllocator persistentOnly;
+	persistentOnly.initialize(4, 0, 2);
+	CHECK(persistentOnly.allocateTransient(1) == DescriptorAllocator::InvalidIndex);
+}
+
+namespace
+{
+	const uint32_t NotOwned = 0;
+}
+
+/// <summary>
+/// Worker threads allocate and free while the owner signals a fence and collects behind it.
+/// No index is ever held twice, none comes back before its fence value completed, and the counts
+/// balance once everything is freed.
+/// </summary>
+TEST_CASE(DescriptorAllocator, ConcurrentAllocateFreeCollect)
+{
+	const uint32_t persistentCount = 256;
+	const uint32_t threadCount = 4;
+	const uint32_t perThread = 50000;
+
+	DescriptorAllocator allocator;
+	allocator.initialize(persistentCount, 0, 1);
+
+	std::vector<std::atomic<uint32_t>> owners(persistentCount);
+	std::vector<std::atomic<uint64_t>> freedFenceValues(persistentCount);
+	for (uint32_t i = 0; i < persistentCount; ++i)
+	{
+		owners[i].store(NotOwned);
+		freedFenceValues[i].store(0);
+	}
+
+	// The value the next signal will carry, and the last value the "GPU" completed. Frees carry the
+	// next value, which completes two collects later, so collecting one value early shows up.
+	std::atomic<uint64_t> nextFenceValue(1);
+	std::atomic<uint64_t> completedFenceValue(0);
+	std::atomic<uint32_t> duplicateCount(0);
+	std::atomic<uint32_t> earlyReuseCount(0);
+	std::atomic<uint32_t> badIndexCount(0);
+	std::atomic<uint32_t> finishedCount(0);
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			std::mt19937 random(t + 1);
+			std::vector<uint32_t> held;
+			for (uint32_t i = 0; i < perThread; ++i)
+			{
+				if (held.size() < 32 && (held.empty() || (random() & 1) != 0))
+				{
+					const uint32_t index = allocator.allocate();
+					if (index == DescriptorAllocator::InvalidIndex)
+					{
+						// Everything is waiting on the fence; let the owner collect
+						std::this_thread::yield();
+						continue;
+					}
+					if (index >= persistentCount)
+					{
+						badIndexCount.fetch_add(1);
+						continue;
+					}
+					if (freedFenceValues[index].load() > completedFenceValue.load())
+					{
+						earlyReuseCount.fetch_add(1);
+					}
+					uint32_t expected = NotOwned;
+					if (!owners[index].compare_exchange_strong(expected, t + 1))
+					{
+						duplicateCount.fetch_add(1);
+					}
+					held.push_back(index);
+				}
+				else
+				{
+					const size_t at = random() % held.size();
+					const uint32_t index = held[at];
+					held[at] = held.back();
+					held.pop_back();
+
+					const uint64_t fenceValue = nextFenceValue.load();
+					owners[index].store(NotOwned);
+					freedFenceValues[index].store(fenceValue);
+					allocator.free(index, fenceValue);
+				}
+			}
+			for (uint32_t index : held)
+			{
+				const uint64_t fenceValue = nextFenceValue.load();
+				owners[index].store(NotOwned);
+				freedFenceValues[index].store(fenceValue);
+				allocator.free(index, fenceValue);
+			}
+			finishedCount.fetch_add(1);
+		});
+	}
+
+	// The GPU runs one fence value behind
+	while (finishedCount.load() < threadCount)
+	{
+		const uint64_t signaled = nextFenceValue.fetch_add(1);
+		completedFenceValue.store(signaled - 1);
+		allocator.collect(signaled - 1);
+		std::this_thread::yield();
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	CHECK(duplicateCount.load() == 0);
+	CHECK(earlyReuseCount.load() == 0);
+	CHECK(badIndexCount.load() == 0);
+
+	completedFenceValue.store(nextFenceValue.load());
+	allocator.collect(completedFenceValue.load());
+	CHECK(allocator.getPendingCount() == 0);
+	CHECK(allocator.getAllocatedCount() == 0);
+
+	// Every descriptor is back on the free list exactly once
+	std::vector<uint32_t> indices;
+	for (uint32_t index = allocator.allocate(); index != DescriptorAllocator::InvalidIndex; index = allocator.allocate())
+	{
+		indices.push_back(index);
+	}
+	std::sort(indices.begin(), indices.end());
+	CHECK(indices.size() == persistentCount);
+	CHECK(std::adjacent_find(indices.begin(), indices.end()) == indices.end());
+	CHECK(allocator.getAllocatedCount() == persistentCount);
+}
+
+/// <summary>
+/// Threads take transient ranges of random sizes until the region runs out; the ranges never
+/// overlap and cover exactly what the allocator reports as used.
+/// </summary>
+TEST_CASE(DescriptorAllocator, ConcurrentTransient)
+{
+	const uint32_t persistentCount = 8;
+	const uint32_t perFrame = 20000;
+	const uint32_t threadCount = 4;
+
+	DescriptorAllocator allocator;
+	allocator.initialize(persistentCount, perFrame, 2);
+
+	for (uint32_t frame = 0; frame < 4; ++frame)
+	{
+		allocator.beginFrame(frame);
+		const uint32_t begin = persistentCount + perFrame * (frame % 2);
+
+		std::vector<std::atomic<uint32_t>> useCounts(perFrame);
+		for (std::atomic<uint32_t>& count : useCounts)
+		{
+			count.store(0);
+		}
+		std::atomic<uint32_t> outOfRangeCount(0);
+		std::atomic<uint32_t> allocatedTotal(0);
+
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < threadCount; ++t)
+		{
+			threads.emplace_back([&, t]()
+			{
+				std::mt19937 random(frame * threadCount + t);
+				uint32_t failedInARow = 0;
+				while (failedInARow < 64)
+				{
+					const uint32_t count = 1 + random() % 16;
+					const uint32_t first = allocator.allocateTransient(count);
+					if (first == DescriptorAllocator::InvalidIndex)
+					{
+						++failedInARow;
+						continue;
+					}
+					failedInARow = 0;
+					if (first < begin || first + count > begin + perFrame)
+					{
+						outOfRangeCount.fetch_add(1);
+						continue;
+					}
+					for (uint32_t i = 0; i < count; ++i)
+					{
+						useCounts[first - begin + i].fetch_add(1);
+					}
+					allocatedTotal.fetch_add(count);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		uint32_t overlapCount = 0;
+		for (const std::atomic<uint32_t>& count : useCounts)
+		{
+			overlapCount += (count.load() > 1) ? 1 : 0;
+		}
+		CHECK(outOfRangeCount.load() == 0);
+		CHECK(overlapCount == 0);
+		CHECK(allocator.getTransientUsedCount() == allocatedTotal.load());
+		CHECK(allocator.getTransientUsedCount() <= perFrame);
+		// Stopped within one largest request of the end
+		CHECK(allocator.getTransientUsedCount() > perFrame - 16);
+	}
+}
+
+BENCHMARK(DescriptorAllocator, AllocateFreeCollect)
+{
+	DescriptorAllocator allocator;
+	allocator.initialize(4096, 0, 1);
+
+	const uint32_t frameCount = static_cast<uint32_t>(2000 * Test::GetBenchmarkScale());
+	const uint32_t perFrame = 512;
+	std::vector<uint32_t> indices(perFrame);
+
+	uint64_t total = 0;
+	const int64_t start = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (uint32_t i = 0; i < perFrame; ++i)
+		{
+			indices[i] = allocator.allocate();
+			total += indices[i];
+		}
+		for (uint32_t i = 0; i < perFrame; ++i)
+		{
+			allocator.free(indices[i], frame + 1);
+		}
+		// The GPU runs two frames behind
+		allocator.collect(frame > 1 ? frame - 1 : 0);
+	}
+	Test::Report("allocate + free", static_cast<uint64_t>(frameCount) * perFrame, Test::GetTime() - start);
+	Test::Consume(total);
+}
@@ -0,0 +1,254 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "FenceTracker.h"
+
+namespace
+{
+	// A queue whose "GPU" completes values only when told to, or when waited on.
+	class FakeFenceTimeline final : public IFenceTimeline
+	{
+	public:
+		FakeFenceTimeline()
+			: mSignaledValue(0)
+			, mCompletedValue(0)
+			, mReadCount(0)
+			, mWaitCount(0)
+		{
+		}
+
+		void signal(uint64_t value) override { mSignaledValue = value; }
+		uint64_t getCompletedValue() override
+		{
+			mReadCount.fetch_add(1);
+			return mCompletedValue.load();
+		}
+		void wait(uint64_t value) override
+		{
+			++mWaitCount;
+			complete(value);
+		}
+
+		void complete(uint64_t value) { mCompletedValue.store(value); }
+
+		uint64_t getSignaledValue() const { return mSignaledValue; }
+		uint32_t getReadCount() const { return mReadCount.load(); }
+		uint32_t getWaitCount() const { return mWaitCount; }
+
+	private:
+		uint64_t mSignaledValue;
+		std::atomic<uint64_t> mCompletedValue;
+		std::atomic<uint32_t> mReadCount;
+		uint32_t mWaitCount;
+	};
+}
+
+TEST_CASE(FenceTracker, SignalMovesToNextValue)
+{
+	FakeFenceTimeline timeline;
+	timeline.complete(10);
+	FenceTracker tracker;
+	tracker.initialize(&timeline, 10);
+
+	CHECK(tracker.getCurrentValue() == 11);
+	CHECK(tracker.getCompletedValue() == 10);
+	CHECK(tracker.isComplete(10));
+
+	CHECK(tracker.signal() == 11);
+	CHECK(timeline.getSignaledValue() == 11);
+	CHECK(tracker.getCurrentValue() == 12);
+	CHECK(tracker.getLastSignaledValue() == 11);
+	CHECK(!tracker.isComplete(11));
+
+	timeline.complete(11);
+	CHECK(tracker.isComplete(11));
+	CHECK(tracker.getCompletedValue() == 11);
+}
+
+TEST_CASE(FenceTracker, ReadsFenceOnlyWhenBehind)
+{
+	FakeFenceTimeline timeline;
+	FenceTracker tracker;
+	tracker.initialize(&timeline);
+
+	tracker.signal();
+	tracker.signal();
+	timeline.complete(2);
+	CHECK(tracker.poll() == 2);
+
+	const uint32_t reads = timeline.getReadCount();
+	CHECK(tracker.isComplete(1));
+	CHECK(tracker.isComplete(2));
+	CHECK(timeline.getReadCount() == reads);
+	CHECK(!tracker.isComplete(3));
+	CHECK(timeline.getReadCount() == reads + 1);
+
+	// The cached value never moves back, even if a stale read comes in
+	timeline.complete(1);
+	CHECK(tracker.poll() == 2);
+}
+
+TEST_CASE(FenceTracker, WaitBlocksOnlyWhenIncomplete)
+{
+	FakeFenceTimeline timeline;
+	FenceTracker tracker;
+	tracker.initialize(&timeline);
+
+	const uint64_t first = tracker.signal();
+	timeline.complete(first);
+	tracker.wait(first);
+	CHECK(timeline.getWaitCount() == 0);
+
+	tracker.signal();
+	tracker.waitIdle();
+	CHECK(timeline.getWaitCount() == 1);
+	CHECK(timeline.getSignaledValue() == 3);
+	CHECK(tracker.getCompletedValue() == 3);
+	CHECK(tracker.getCurrentValue() == 4);
+}
+
+TEST_CASE(FenceTracker, RetiresCompletedInEnqueueOrder)
+{
+	FakeFenceTimeline timeline;
+	FenceTracker tracker;
+	tracker.initialize(&timeline);
+
+	std::vector<int> ran;
+	tracker.enqueue(3, [&ran]() { ran.push_back(3); });
+	tracker.enqueue(1, [&ran]() { ran.push_back(1); });
+	tracker.enqueue(2, [&ran]() { ran.push_back(2); });
+	tracker.enqueue(1, [&ran]() { ran.push_back(10); });
+	CHECK(tracker.getPendingCount() == 4);
+
+	CHECK(tracker.retire() == 0);
+	CHECK(ran.empty());
+
+	timeline.complete(2);
+	CHECK(tracker.retire() == 3);
+	REQUIRE(ran.size() == 3);
+	CHECK(ran[0] == 1);
+	CHECK(ran[1] == 2);
+	CHECK(ran[2] == 10);
+	CHECK(tracker.getPendingCount() == 1);
+
+	// Callbacks enqueued by a callback wait for the next retire()
+	tracker.enqueue(3, [&]() { tracker.enqueue(1, [&ran]() { ran.push_back(11); }); });
+	timeline.complete(3);
+	CHECK(tracker.retire() == 2);
+	CHECK(ran.size() == 4 && ran[3] == 3);
+	CHECK(tracker.retire() == 1);
+	CHECK(ran.size() == 5 && ran[4] == 11);
+	CHECK(tracker.getPendingCount() == 0);
+}
+
+TEST_CASE(FenceTracker, DestroyDropsCallbacks)
+{
+	FakeFenceTimeline timeline;
+	uint32_t runCount = 0;
+	{
+		FenceTracker tracker;
+		tracker.initialize(&timeline);
+		tracker.enqueue(1, [&runCount]() { ++runCount; });
+		tracker.enqueue(5, [&runCount]() { ++runCount; });
+		tracker.retire();
+		tracker.enqueue(1, [&runCount]() { ++runCount; });
+		tracker.destroy();
+		CHECK(tracker.getPendingCount() == 0);
+		CHECK(tracker.retire() == 0);
+	}
+	CHECK(runCount == 0);
+}
+
+/// <summary>
+/// Threads enqueue while the owner signals and retires; every callback runs exactly once, after its value.
+/// </summary>
+TEST_CASE(FenceTracker, ConcurrentEnqueue)
+{
+	FakeFenceTimeline timeline;
+	FenceTracker tracker;
+	tracker.initialize(&timeline);
+
+	const uint32_t threadCount = 4;
+	const uint32_t perThread = 20000;
+	std::vector<std::atomic<uint32_t>> runs(threadCount * perThread);
+	for (std::atomic<uint32_t>& run : runs)
+	{
+		run.store(0);
+	}
+	std::atomic<uint32_t> earlyCount(0);
+	std::atomic<uint32_t> finishedCount(0);
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (uint32_t i = 0; i < perThread; ++i)
+			{
+				const uint64_t value = tracker.getCurrentValue();
+				const uint32_t index = t * perThread + i;
+				tracker.enqueue(value, [&, value, index]()
+				{
+					if (timeline.getCompletedValue() < value)
+					{
+						earlyCount.fetch_add(1);
+					}
+					runs[index].fetch_add(1);
+				});
+			}
+			finishedCount.fetch_add(1);
+		});
+	}
+
+	while (finishedCount.load() < threadCount)
+	{
+		timeline.complete(tracker.signal() - 1);
+		tracker.retire();
+		std::this_thread::yield();
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	tracker.waitIdle();
+	tracker.retire();
+
+	uint32_t wrongCount = 0;
+	for (const std::atomic<uint32_t>& run : runs)
+	{
+		wrongCount += (run.load() == 1) ? 0 : 1;
+	}
+	CHECK(wrongCount == 0);
+	CHECK(earlyCount.load() == 0);
+	CHECK(tracker.getPendingCount() == 0);
+}
+
+BENCHMARK(FenceTracker, EnqueueRetire)
+{
+	FakeFenceTimeline timeline;
+	FenceTracker tracker;
+	tracker.initialize(&timeline);
+
+	const uint32_t frameCount = static_cast<uint32_t>(1000 * Test::GetBenchmarkScale());
+	const uint32_t perFrame = 256;
+	uint64_t sum = 0;
+
+	const int64_t start = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		const uint64_t value = tracker.getCurrentValue();
+		for (uint32_t i = 0; i < perFrame; ++i)
+		{
+			tracker.enqueue(value, [&sum, i]() { sum += i; });
+		}
+		tracker.signal();
+		// The GPU runs two frames behind
+		timeline.complete(value > 2 ? value - 2 : 0);
+		tracker.retire();
+	}
+	Test::Report("callback", static_cast<uint64_t>(frameCount) * perFrame, Test::GetTime() - start);
+	Test::Consume(sum);
+}
@@ -0,0 +1,295 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "FramePacer.h"
+
+namespace
+{
+	// 60 Hz, in microseconds
+	const uint64_t RefreshInterval = 16667;
+
+	class FakeClock final : public IFrameClock
+	{
+	public:
+		FakeClock() : mTime(1000000) {}
+
+		uint64_t now() override { return mTime; }
+
+		void advance(uint64_t microseconds) { mTime += microseconds; }
+		void setTime(uint64_t time) { mTime = std::max(mTime, time); }
+
+	private:
+		uint64_t mTime;
+	};
+
+	// A swap chain of FakeClock time: it takes frames up to its capacity and shows one per vertical
+	// blank, freeing its slot. waitForSlot blocks while it is full by moving the clock on to the next
+	// frame shown, or by the whole timeout when the display is stalled, as it is while minimized.
+	class FakePresentQueue final : public IPresentQueue
+	{
+	public:
+		FakePresentQueue(FakeClock& clock, uint32_t capacity)
+			: mClock(clock)
+			, mCapacity(capacity)
+			, mShowTimes()
+			, mIsStalled(false)
+			, mWaitCount(0)
+			, mLastTimeout(0)
+		{
+
+		}
+
+		bool waitForSlot(uint32_t timeoutMilliseconds) override
+		{
+			++mWaitCount;
+			mLastTimeout = timeoutMilliseconds;
+
+			retire();
+			if (mShowTimes.size() < mCapacity)
+			{
+				return true;
+			}
+			const uint64_t deadline = mClock.now() + timeoutMilliseconds * 1000ull;
+			if (mIsStalled || mShowTimes.front() > deadline)
+			{
+				mClock.setTime(deadline);
+				return false;
+			}
+			mClock.setTime(mShowTimes.front());
+			mShowTimes.pop_front();
+			return true;
+		}
+
+		// Queues a frame; it is shown on the first vertical blank after the frame before it.
+		void present()
+		{
+			retire();
+			const uint64_t previous = mShowTimes.empty() ? mClock.now() : mShowTimes.back();
+			mShowTimes.push_back((previous / RefreshInterval + 1) * RefreshInterval);
+		}
+
+		void setStalled(bool isStalled) { mIsStalled = isStalled; }
+
+		uint32_t getQueuedCount() const { return static_cast<uint32_t>(mShowTimes.size()); }
+		uint32_t getWaitCount() const { return mWaitCount; }
+		uint32_t getLastTimeout() const { return mLastTimeout; }
+
+	private:
+		void retire()
+		{
+			while (!mIsStalled && !mShowTimes.empty() && mShowTimes.front() <= mClock.now())
+			{
+				mShowTimes.pop_front();
+			}
+		}
+
+		FakeClock& mClock;
+		uint32_t mCapacity;
+		std::deque<uint64_t> mShowTimes;
+		bool mIsStalled;
+		uint32_t mWaitCount;
+		uint32_t mLastTimeout;
+	};
+
+	// The game and render threads of MainProject one after the other: input is read before or
+	// after beginFrame, the frame takes cpuTime, and Present blocks while the swap chain is full.
+	void RunFrames(FramePacer& pacer, FakeClock& clock, FakePresentQueue& queue, uint64_t firstFrame, uint32_t frameCount, uint64_t cpuTime)
+	{
+		const bool isLateLatch = pacer.getSettings().lateLatchInput;
+		for (uint64_t frame = firstFrame; frame < firstFrame + frameCount; ++frame)
+		{
+			if (!isLateLatch)
+			{
+				pacer.markInputSampled(frame);
+			}
+			pacer.beginFrame(frame);
+			if (isLateLatch)
+			{
+				pacer.markInputSampled(frame);
+			}
+
+			clock.advance(cpuTime);
+
+			queue.waitForSlot(FramePacer::WaitTimeoutMilliseconds);
+			queue.present();
+			pacer.markPresented(frame);
+		}
+	}
+
+	bool IsNear(uint64_t value, uint64_t expected, uint64_t tolerance)
+	{
+		return value + tolerance >= expected && value <= expected + tolerance;
+	}
+
+	// The moving averages round each sample down to a sixteenth
+	const uint64_t AverageTolerance = 32;
+}
+
+TEST_CASE(FramePacer, Settings)
+{
+	const FramePacingSettings lowLatency = FramePacingSettings::LowLatency();
+	CHECK(lowLatency.maxFramesInFlight == 1);
+	CHECK(lowLatency.waitForPresentQueue);
+	CHECK(lowLatency.lateLatchInput);
+
+	const FramePacingSettings throughput = FramePacingSettings::Throughput();
+	CHECK(throughput.maxFramesInFlight > lowLatency.maxFramesInFlight);
+	CHECK(!throughput.waitForPresentQueue);
+	CHECK(!throughput.lateLatchInput);
+
+	// At least one frame is always in flight
+	FramePacingSettings none = lowLatency;
+	none.maxFramesInFlight = 0;
+	FakeClock clock;
+	FramePacer pacer;
+	pacer.initialize(&clock, nullptr, none);
+	CHECK(pacer.getSettings().maxFramesInFlight == 1);
+}
+
+/// <summary>
+/// LowLatency blocks at the start of the frame for what is left of the refresh interval after
+/// the CPU work; Throughput never waits there.
+/// </summary>
+TEST_CASE(FramePacer, WaitTime)
+{
+	const uint64_t cpuTime = 3000;
+
+	FakeClock clock;
+	FakePresentQueue queue(clock, 1);
+	FramePacer pacer;
+	pacer.initialize(&clock, &queue, FramePacingSettings::LowLatency());
+
+	// Nothing queued yet: no wait
+	pacer.beginFrame(0);
+	CHECK(pacer.getAverageWaitTime() == 0);
+	CHECK(queue.getWaitCount() == 1);
+	CHECK(queue.getLastTimeout() == FramePacer::WaitTimeoutMilliseconds);
+
+	RunFrames(pacer, clock, queue, 0, 300, cpuTime);
+	CHECK(IsNear(pacer.getAverageWaitTime(), RefreshInterval - cpuTime, AverageTolerance));
+	CHECK(pacer.getTimeoutCount() == 0);
+
+	// Heavier frames leave less to wait for
+	RunFrames(pacer, clock, queue, 300, 300, 12000);
+	CHECK(IsNear(pacer.getAverageWaitTime(), RefreshInterval - 12000, AverageTolerance));
+
+	FakeClock throughputClock;
+	FakePresentQueue throughputQueue(throughputClock, FramePacingSettings::Throughput().maxFramesInFlight);
+	FramePacer throughput;
+	throughput.initialize(&throughputClock, &throughputQueue, FramePacingSettings::Throughput());
+	RunFrames(throughput, throughputClock, throughputQueue, 0, 300, cpuTime);
+	CHECK(throughput.getAverageWaitTime() == 0);
+	CHECK(throughputQueue.getQueuedCount() == FramePacingSettings::Throughput().maxFramesInFlight);
+
+	// Without a present queue there is nothing to wait for
+	FakeClock unqueuedClock;
+	FramePacer unqueued;
+	unqueued.initialize(&unqueuedClock, nullptr, FramePacingSettings::LowLatency());
+	const uint64_t start = unqueuedClock.now();
+	unqueued.beginFrame(0);
+	CHECK(unqueuedClock.now() == start);
+	CHECK(unqueued.getAverageWaitTime() == 0);
+}
+
+/// <summary>
+/// A display that stops taking frames holds beginFrame for WaitTimeoutMilliseconds, not forever;
+/// each timeout is counted and frames go on at the display's pace once it resumes.
+/// </summary>
+TEST_CASE(FramePacer, TimeoutWhileStalled)
+{
+	FakeClock clock;
+	FakePresentQueue queue(clock, 1);
+	FramePacer pacer;
+	pacer.initialize(&clock, &queue, FramePacingSettings::LowLatency());
+
+	RunFrames(pacer, clock, queue, 0, 10, 3000);
+	CHECK(pacer.getTimeoutCount() == 0);
+
+	queue.setStalled(true);
+	const uint64_t start = clock.now();
+	pacer.beginFrame(10);
+	CHECK(clock.now() - start == FramePacer::WaitTimeoutMilliseconds * 1000ull);
+	CHECK(pacer.getTimeoutCount() == 1);
+	// The timed out wait is part of the average like any other
+	CHECK(pacer.getAverageWaitTime() > 60000);
+
+	pacer.beginFrame(10);
+	CHECK(pacer.getTimeoutCount() == 2);
+	CHECK(clock.now() - start == 2 * FramePacer::WaitTimeoutMilliseconds * 1000ull);
+
+	queue.setStalled(false);
+	RunFrames(pacer, clock, queue, 10, 300, 3000);
+	CHECK(pacer.getTimeoutCount() == 2);
+	CHECK(IsNear(pacer.getAverageWaitTime(), RefreshInterval - 3000, AverageTolerance));
+
+	// initialize starts the counts over
+	pacer.initialize(&clock, &queue, FramePacingSettings::LowLatency());
+	CHECK(pacer.getTimeoutCount() == 0);
+	CHECK(pacer.getAverageWaitTime() == 0);
+}
+
+/// <summary>
+/// LowLatency reads input after the wait, so only the CPU work lies between input and Present.
+/// Throughput reads it first and then blocks in Present behind its queued frames, for a whole
+/// refresh interval each frame once the queue is full.
+/// </summary>
+TEST_CASE(FramePacer, LatencyLowLatencyVsThroughput)
+{
+	const uint64_t cpuTime = 3000;
+
+	FakeClock lowLatencyClock;
+	FakePresentQueue lowLatencyQueue(lowLatencyClock, FramePacingSettings::LowLatency().maxFramesInFlight);
+	FramePacer lowLatency;
+	lowLatency.initialize(&lowLatencyClock, &lowLatencyQueue, FramePacingSettings::LowLatency());
+	RunFrames(lowLatency, lowLatencyClock, lowLatencyQueue, 0, 300, cpuTime);
+
+	FakeClock throughputClock;
+	FakePresentQueue throughputQueue(throughputClock, FramePacingSettings::Throughput().maxFramesInFlight);
+	FramePacer throughput;
+	throughput.initialize(&throughputClock, &throughputQueue, FramePacingSettings::Throughput());
+	RunFrames(throughput, throughputClock, throughputQueue, 0, 300, cpuTime);
+
+	CHECK(lowLatency.getAverageLatency() == cpuTime);
+	CHECK(IsNear(throughput.getAverageLatency(), RefreshInterval, AverageTolerance));
+	CHECK(lowLatency.getAverageLatency() * 4 < throughput.getAverageLatency());
+
+	// Both run at the display rate all the same
+	const uint64_t lowLatencyTime = lowLatencyClock.now();
+	const uint64_t throughputTime = throughputClock.now();
+	RunFrames(lowLatency, lowLatencyClock, lowLatencyQueue, 300, 60, cpuTime);
+	RunFrames(throughput, throughputClock, throughputQueue, 300, 60, cpuTime);
+	CHECK(IsNear(lowLatencyClock.now() - lowLatencyTime, 60 * RefreshInterval, RefreshInterval));
+	CHECK(IsNear(throughputClock.now() - throughputTime, 60 * RefreshInterval, RefreshInterval));
+}
+
+TEST_CASE(FramePacer, LatencyIsTrackedPerFrame)
+{
+	FakeClock clock;
+	FramePacer pacer;
+	pacer.initialize(&clock, nullptr, FramePacingSettings::Throughput());
+
+	// A frame whose input was never read is left out
+	pacer.markPresented(5);
+	CHECK(pacer.getAverageLatency() == 0);
+
+	// The game thread samples frames 1 and 2 while frame 0 is still on its way to Present
+	pacer.markInputSampled(0);
+	clock.advance(1000);
+	pacer.markInputSampled(1);
+	clock.advance(1000);
+	pacer.markInputSampled(2);
+	clock.advance(1000);
+	pacer.markPresented(0);
+	CHECK(pacer.getAverageLatency() == 3000);
+
+	// Later samples of the same slot replace earlier ones
+	pacer.initialize(&clock, nullptr, FramePacingSettings::Throughput());
+	pacer.markInputSampled(1);
+	clock.advance(500);
+	pacer.markInputSampled(9);
+	clock.advance(500);
+	pacer.markPresented(9);
+	CHECK(pacer.getAverageLatency() == 500);
+}
@@ -0,0 +1,256 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "FramePipeline.h"
+
+namespace
+{
+	// Frame data with a value derived from the frame number, so a slot overwritten while
+	// the render stage reads it shows up as a mismatch.
+	struct TestFrame
+	{
+		uint64_t frameNumber;
+		uint64_t payload[8];
+
+		void fill(uint64_t number)
+		{
+			frameNumber = number;
+			for (uint64_t& value : payload)
+			{
+				value = number * 2654435761u;
+			}
+		}
+
+		bool isConsistent() const
+		{
+			for (const uint64_t& value : payload)
+			{
+				if (value != frameNumber * 2654435761u)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	const uint32_t SlotCount = 3;
+
+	// Stands in for the work of a stage; sleeping lets the stages overlap even on a single core.
+	void Work(std::chrono::microseconds cost)
+	{
+		if (cost.count() > 0)
+		{
+			std::this_thread::sleep_for(cost);
+		}
+	}
+
+	// Runs frameCount frames through a pipeline on an update and a render thread and returns
+	// the nanoseconds taken. Counts frames the render stage saw out of order or torn.
+	int64_t RunPipeline(FramePipeline<TestFrame, SlotCount>& pipeline, uint64_t frameCount, std::chrono::microseconds updateCost, std::chrono::microseconds renderCost, uint32_t* pBadFrameCount, uint32_t* pLatencyViolationCount)
+	{
+		std::atomic<uint32_t> badFrameCount(0);
+		std::atomic<uint32_t> latencyViolationCount(0);
+
+		const int64_t start = Test::GetTime();
+		std::thread render([&]()
+		{
+			for (uint64_t expected = 0; expected < frameCount; ++expected)
+			{
+				const TestFrame* pFrame = pipeline.beginRender();
+				if (pFrame == nullptr)
+				{
+					return;
+				}
+				Work(renderCost);
+				if (pFrame->frameNumber != expected || !pFrame->isConsistent())
+				{
+					badFrameCount.fetch_add(1);
+				}
+				pipeline.endRender();
+			}
+		});
+
+		for (uint64_t frame = 0; frame < frameCount; ++frame)
+		{
+			TestFrame* pFrame = pipeline.beginUpdate();
+			if (pFrame == nullptr)
+			{
+				break;
+			}
+			// Only this thread publishes, so the count can only have gone down since the wait
+			if (pipeline.getPendingCount() >= pipeline.getMaxLatency())
+			{
+				latencyViolationCount.fetch_add(1);
+			}
+			Work(updateCost);
+			pFrame->fill(frame);
+			pipeline.endUpdate();
+		}
+		render.join();
+
+		*pBadFrameCount = badFrameCount.load();
+		*pLatencyViolationCount = latencyViolationCount.load();
+		return Test::GetTime() - start;
+	}
+}
+
+TEST_CASE(FramePipeline, RendersEveryFrameInOrder)
+{
+	for (uint32_t latency = 1; latency <= SlotCount; ++latency)
+	{
+		FramePipeline<TestFrame, SlotCount> pipeline;
+		pipeline.setMaxLatency(latency);
+
+		uint32_t badFrameCount = 0;
+		uint32_t latencyViolationCount = 0;
+		RunPipeline(pipeline, 20000, std::chrono::microseconds(0), std::chrono::microseconds(0), &badFrameCount, &latencyViolationCount);
+		CHECK(badFrameCount == 0);
+		CHECK(latencyViolationCount == 0);
+		CHECK(pipeline.getPendingCount() == 0);
+	}
+}
+
+TEST_CASE(FramePipeline, ClampsMaxLatency)
+{
+	FramePipeline<TestFrame, SlotCount> pipeline;
+	CHECK(pipeline.getMaxLatency() == SlotCount);
+	pipeline.setMaxLatency(0);
+	CHECK(pipeline.getMaxLatency() == 1);
+	pipeline.setMaxLatency(100);
+	CHECK(pipeline.getMaxLatency() == SlotCount);
+	pipeline.setMaxLatency(2);
+	CHECK(pipeline.getMaxLatency() == 2);
+}
+
+/// <summary>
+/// With maxLatency frames pending the update stage waits for the render stage to release one,
+/// and raising the latency lets it go on at once.
+/// </summary>
+TEST_CASE(FramePipeline, UpdateWaitsAtMaxLatency)
+{
+	FramePipeline<TestFrame, SlotCount> pipeline;
+	pipeline.setMaxLatency(1);
+
+	TestFrame* pFirst = pipeline.beginUpdate();
+	REQUIRE(pFirst != nullptr);
+	pFirst->fill(0);
+	pipeline.endUpdate();
+	CHECK(pipeline.getPendingCount() == 1);
+
+	std::atomic<bool> isUpdating(false);
+	std::thread update([&]()
+	{
+		TestFrame* pFrame = pipeline.beginUpdate();
+		isUpdating.store(true);
+		if (pFrame != nullptr)
+		{
+			pFrame->fill(1);
+			pipeline.endUpdate();
+		}
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(!isUpdating.load());
+
+	// Consumed but not released yet: the slot is still in use
+	const TestFrame* pRendered = pipeline.beginRender();
+	REQUIRE(pRendered != nullptr);
+	CHECK(pRendered->frameNumber == 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(!isUpdating.load());
+
+	pipeline.endRender();
+	update.join();
+	CHECK(isUpdating.load());
+	CHECK(pipeline.getPendingCount() == 1);
+
+	// A second frame may be in flight once the bound is raised
+	pipeline.setMaxLatency(2);
+	TestFrame* pThird = pipeline.beginUpdate();
+	CHECK(pThird != nullptr && pThird != pipeline.beginRender());
+}
+
+TEST_CASE(FramePipeline, ShutdownUnblocksBothStages)
+{
+	// Render stage waiting for a frame that never comes
+	{
+		FramePipeline<TestFrame, SlotCount> pipeline;
+		std::atomic<bool> isReturned(false);
+		const TestFrame* pResult = reinterpret_cast<const TestFrame*>(1);
+		std::thread render([&]()
+		{
+			pResult = pipeline.beginRender();
+			isReturned.store(true);
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		CHECK(!isReturned.load());
+		pipeline.shutdown();
+		render.join();
+		CHECK(pResult == nullptr);
+	}
+
+	// Update stage waiting for a slot the render stage never releases
+	{
+		FramePipeline<TestFrame, SlotCount> pipeline;
+		for (uint32_t i = 0; i < SlotCount; ++i)
+		{
+			REQUIRE(pipeline.beginUpdate() != nullptr);
+			pipeline.endUpdate();
+		}
+		std::atomic<bool> isReturned(false);
+		TestFrame* pResult = reinterpret_cast<TestFrame*>(1);
+		std::thread update([&]()
+		{
+			pResult = pipeline.beginUpdate();
+			isReturned.store(true);
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		CHECK(!isReturned.load());
+		pipeline.shutdown();
+		update.join();
+		CHECK(pResult == nullptr);
+
+		// Every later begin call returns at once
+		CHECK(pipeline.beginUpdate() == nullptr);
+		CHECK(pipeline.beginRender() == nullptr);
+	}
+}
+
+/// <summary>
+/// Synthetic update and render stages of fixed cost. Serialized (latency 1) a frame costs
+/// update + render; overlapped it approaches max(update, render).
+/// </summary>
+BENCHMARK(FramePipeline, StageOverlap)
+{
+	struct StageCosts
+	{
+		uint32_t updateMicroseconds;
+		uint32_t renderMicroseconds;
+	};
+	const StageCosts costs[] = { { 2000, 2000 }, { 1000, 3000 }, { 3000, 1000 } };
+
+	const uint64_t frameCount = static_cast<uint64_t>(200 * Test::GetBenchmarkScale()) + 1;
+	for (const StageCosts& cost : costs)
+	{
+		for (uint32_t latency = 1; latency <= SlotCount; ++latency)
+		{
+			FramePipeline<TestFrame, SlotCount> pipeline;
+			pipeline.setMaxLatency(latency);
+
+			uint32_t badFrameCount = 0;
+			uint32_t latencyViolationCount = 0;
+			const int64_t time = RunPipeline(pipeline, frameCount,
+				std::chrono::microseconds(cost.updateMicroseconds), std::chrono::microseconds(cost.renderMicroseconds),
+				&badFrameCount, &latencyViolationCount);
+
+			char name[96];
+			snprintf(name, sizeof(name), "frame, update %u us, render %u us, latency %u", cost.updateMicroseconds, cost.renderMicroseconds, latency);
+			Test::Report(name, frameCount, time);
+		}
+	}
+}
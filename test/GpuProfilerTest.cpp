@@ -0,0 +1,434 @@
+#include "TestFramework.h"
+
+#include <string>
+#include <vector>
+
+#include "GpuProfiler.h"
+
+namespace
+{
+	// Queries of a queue that runs a command list when told to: each timestamp written in it gets
+	// the next GPU time, and a resolve copies the queries to where read() finds them.
+	class FakeTimestampQueries final : public ITimestampQueries
+	{
+	public:
+		explicit FakeTimestampQueries(uint32_t queryCount)
+			: mQueries(queryCount, 0)
+			, mResolved(queryCount, 0)
+			, mWriteCounts(queryCount, 0)
+			, mGpuTime(1000000)
+			, mTickStep(100)
+			, mCalibrateCount(0)
+			, mIsCalibrationValid(true)
+			, mOutOfRangeCount(0)
+		{
+			mCalibration.gpuTimestamp = 0;
+			mCalibration.cpuTime = 5000000000;
+			mCalibration.frequency = 10000000;
+		}
+
+		void writeTimestamp(void* pCommandList, uint32_t query) override
+		{
+			if (query >= mQueries.size())
+			{
+				++mOutOfRangeCount;
+				return;
+			}
+			++mWriteCounts[query];
+			Command command = { pCommandList, query, 0, false };
+			mCommands.push_back(command);
+		}
+
+		void resolve(void* pCommandList, uint32_t first, uint32_t count) override
+		{
+			if (first + count > mQueries.size())
+			{
+				++mOutOfRangeCount;
+				return;
+			}
+			Command command = { pCommandList, first, count, true };
+			mCommands.push_back(command);
+			mResolves.push_back(first);
+		}
+
+		bool read(uint32_t first, uint32_t count, uint64_t* pTimestamps) override
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				pTimestamps[i] = mResolved[first + i];
+			}
+			return true;
+		}
+
+		bool calibrate(GpuClockCalibration* pCalibration) override
+		{
+			++mCalibrateCount;
+			*pCalibration = mCalibration;
+			return mIsCalibrationValid;
+		}
+
+		// Runs everything recorded so far, in recording order
+		void execute()
+		{
+			for (const Command& command : mCommands)
+			{
+				if (command.isResolve)
+				{
+					for (uint32_t i = 0; i < command.count; ++i)
+					{
+						mResolved[command.query + i] = mQueries[command.query + i];
+					}
+				}
+				else
+				{
+					mGpuTime += mTickStep;
+					mQueries[command.query] = mGpuTime;
+				}
+			}
+			mCommands.clear();
+		}
+
+		GpuClockCalibration mCalibration;
+		std::vector<uint64_t> mQueries;
+		std::vector<uint64_t> mResolved;
+		std::vector<uint32_t> mWriteCounts;
+		std::vector<uint32_t> mResolves;
+		uint64_t mGpuTime;
+		uint64_t mTickStep;
+		uint32_t mCalibrateCount;
+		bool mIsCalibrationValid;
+		uint32_t mOutOfRangeCount;
+
+	private:
+		struct Command
+		{
+			void* pCommandList;
+			uint32_t query;
+			uint32_t count;
+			bool isResolve;
+		};
+
+		std::vector<Command> mCommands;
+	};
+
+	void* const CommandListA = reinterpret_cast<void*>(0x10);
+	void* const CommandListB = reinterpret_cast<void*>(0x20);
+
+	const ProfileZone ZoneA = { "A", __FILE__, __LINE__ };
+	const ProfileZone ZoneB = { "B", __FILE__, __LINE__ };
+	const ProfileZone ZoneC = { "C", __FILE__, __LINE__ };
+	const ProfileZone ZoneD = { "D", __FILE__, __LINE__ };
+}
+
+TEST_CASE(GpuProfiler, ToCpuTime)
+{
+	GpuClockCalibration calibration;
+	calibration.gpuTimestamp = 1000000;
+	calibration.cpuTime = 7000000000;
+	calibration.frequency = 24000000;
+
+	CHECK(calibration.toCpuTime(calibration.gpuTimestamp) == calibration.cpuTime);
+	// 24 ticks are one microsecond
+	CHECK(calibration.toCpuTime(calibration.gpuTimestamp + 24) == calibration.cpuTime + 1000);
+	CHECK(calibration.toCpuTime(calibration.gpuTimestamp - 48) == calibration.cpuTime - 2000);
+	// Whole seconds plus the remainder
+	CHECK(calibration.toCpuTime(calibration.gpuTimestamp + 24000000 * 3 + 6000000) == calibration.cpuTime + 3250000000);
+
+	// Days of ticks at a high frequency, where ticks * 10^9 overflows 64 bits
+	calibration.gpuTimestamp = 0;
+	calibration.cpuTime = 0;
+	calibration.frequency = 1000000007;
+	const uint64_t seconds = 500000;
+	CHECK(calibration.toCpuTime(seconds * calibration.frequency) == static_cast<int64_t>(seconds * 1000000000ull));
+	CHECK(calibration.toCpuTime(seconds * calibration.frequency + calibration.frequency / 2) == static_cast<int64_t>(seconds * 1000000000ull + 499999999));
+}
+
+/// <summary>
+/// Every frame in flight writes and resolves only its own range of queries.
+/// </summary>
+TEST_CASE(GpuProfiler, FramesUseTheirOwnQueryRange)
+{
+	const uint32_t frameCount = 3;
+	const uint32_t maxZoneCount = 4;
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(frameCount, maxZoneCount));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, frameCount, maxZoneCount);
+
+	for (uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+	{
+		std::vector<uint32_t> writesBefore = queries.mWriteCounts;
+
+		profiler.beginFrame(CommandListA, frameIndex);
+		profiler.beginZone(CommandListA, &ZoneA);
+		profiler.endZone(CommandListA);
+		profiler.beginZone(CommandListA, &ZoneB);
+		profiler.endZone(CommandListA);
+		profiler.endFrame(CommandListA);
+
+		uint32_t outsideCount = 0;
+		uint32_t insideCount = 0;
+		for (uint32_t query = 0; query < queries.mWriteCounts.size(); ++query)
+		{
+			const uint32_t written = queries.mWriteCounts[query] - writesBefore[query];
+			const bool isInside = (query / (maxZoneCount * 2)) == frameIndex;
+			(isInside ? insideCount : outsideCount) += written;
+		}
+		CHECK(insideCount == 6);
+		CHECK(outsideCount == 0);
+		REQUIRE(queries.mResolves.size() == frameIndex + 1);
+		CHECK(queries.mResolves.back() == frameIndex * maxZoneCount * 2);
+	}
+	CHECK(queries.mOutOfRangeCount == 0);
+}
+
+TEST_CASE(GpuProfiler, CollectsNestedZonesOnCpuTimeline)
+{
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(2, 8));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, 2, 8);
+
+	// Zones span command lists of the same queue
+	profiler.beginFrame(CommandListA, 1);
+	profiler.beginZone(CommandListA, &ZoneA);
+	profiler.beginZone(CommandListA, &ZoneB);
+	profiler.endZone(CommandListB);
+	profiler.endZone(CommandListB);
+	profiler.beginZone(CommandListB, &ZoneC);
+	profiler.endFrame(CommandListB);
+
+	CHECK(!profiler.collect(0));
+	queries.execute();
+	REQUIRE(profiler.collect(1));
+
+	const std::vector<GpuZoneTiming>& timings = profiler.getTimings();
+	REQUIRE(timings.size() == 4);
+	CHECK(timings[1].pZone == &ZoneA && timings[1].depth == 1);
+	CHECK(timings[2].pZone == &ZoneB && timings[2].depth == 2);
+	CHECK(timings[3].pZone == &ZoneC && timings[3].depth == 1);
+	CHECK(timings[0].depth == 0);
+
+	// Timestamps are 100 ticks of 10 MHz apart: 10 us each
+	const GpuClockCalibration& calibration = queries.mCalibration;
+	CHECK(timings[0].begin == calibration.toCpuTime(1000100));
+	CHECK(timings[1].begin - timings[0].begin == 10000);
+	CHECK(timings[2].end - timings[2].begin == 10000);
+	CHECK(timings[1].end - timings[1].begin == 30000);
+	CHECK(timings[3].begin - timings[1].end == 10000);
+	// Frame: 8 timestamps, 7 steps
+	CHECK(timings[0].end - timings[0].begin == 70000);
+	CHECK(profiler.getFrameTime() > 0.0699f && profiler.getFrameTime() < 0.0701f);
+
+	// Read once only
+	CHECK(!profiler.collect(1));
+}
+
+/// <summary>
+/// Zones past the limit are counted and write nothing, and the zones around them still close correctly.
+/// </summary>
+TEST_CASE(GpuProfiler, DropsZonesPastLimit)
+{
+	const uint32_t maxZoneCount = 3;
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(2, maxZoneCount));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, 2, maxZoneCount);
+
+	profiler.beginFrame(CommandListA, 0);
+	profiler.beginZone(CommandListA, &ZoneA);
+	profiler.beginZone(CommandListA, &ZoneB);
+	profiler.beginZone(CommandListA, &ZoneC);
+	profiler.endZone(CommandListA);
+	profiler.beginZone(CommandListA, &ZoneD);
+	profiler.endZone(CommandListA);
+	profiler.endZone(CommandListA);
+	profiler.endZone(CommandListA);
+	profiler.endFrame(CommandListA);
+	CHECK(profiler.getDroppedZoneCount() == 2);
+
+	// Only the queries of the frame's range, each written once
+	uint32_t wrongCount = 0;
+	for (uint32_t query = 0; query < queries.mWriteCounts.size(); ++query)
+	{
+		wrongCount += (queries.mWriteCounts[query] == ((query < maxZoneCount * 2) ? 1u : 0u)) ? 0 : 1;
+	}
+	CHECK(wrongCount == 0);
+	CHECK(queries.mOutOfRangeCount == 0);
+
+	queries.execute();
+	REQUIRE(profiler.collect(0));
+	const std::vector<GpuZoneTiming>& timings = profiler.getTimings();
+	REQUIRE(timings.size() == 3);
+	CHECK(timings[1].pZone == &ZoneA && timings[2].pZone == &ZoneB);
+	// B closes before A, and A before the frame
+	CHECK(timings[2].end < timings[1].end);
+	CHECK(timings[1].end < timings[0].end);
+
+	// The next frame has the whole range again
+	profiler.beginFrame(CommandListA, 1);
+	profiler.beginZone(CommandListA, &ZoneA);
+	profiler.endFrame(CommandListA);
+	CHECK(profiler.getDroppedZoneCount() == 2);
+}
+
+TEST_CASE(GpuProfiler, EndFrameClosesOpenZones)
+{
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(1, 4));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, 1, 4);
+
+	profiler.beginFrame(CommandListA, 0);
+	profiler.beginZone(CommandListA, &ZoneA);
+	profiler.beginZone(CommandListA, &ZoneB);
+	profiler.endFrame(CommandListA);
+	// An unmatched endZone is ignored
+	profiler.endZone(CommandListA);
+
+	CHECK(queries.mWriteCounts[0] == 1 && queries.mWriteCounts[1] == 1);
+	CHECK(queries.mWriteCounts[2] == 1 && queries.mWriteCounts[3] == 1);
+	CHECK(queries.mWriteCounts[4] == 1 && queries.mWriteCounts[5] == 1);
+	CHECK(queries.mWriteCounts[6] == 0);
+
+	queries.execute();
+	REQUIRE(profiler.collect(0));
+	const std::vector<GpuZoneTiming>& timings = profiler.getTimings();
+	REQUIRE(timings.size() == 3);
+	CHECK(timings[2].end <= timings[1].end && timings[1].end <= timings[0].end);
+}
+
+TEST_CASE(GpuProfiler, ClampsEndBeforeBegin)
+{
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(1, 2));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, 1, 2);
+
+	profiler.beginFrame(CommandListA, 0);
+	profiler.beginZone(CommandListA, &ZoneA);
+	profiler.endZone(CommandListB);
+	profiler.endFrame(CommandListB);
+	queries.execute();
+	// Command list B's timestamp came out earlier than A's
+	queries.mResolved[3] = queries.mResolved[2] - 50;
+
+	REQUIRE(profiler.collect(0));
+	CHECK(profiler.getTimings()[1].end == profiler.getTimings()[1].begin);
+}
+
+TEST_CASE(GpuProfiler, RecalibratesEveryInterval)
+{
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(2, 2));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, 2, 2, 4);
+
+	for (uint32_t frame = 0; frame < 12; ++frame)
+	{
+		profiler.beginFrame(CommandListA, frame % 2);
+		profiler.endFrame(CommandListA);
+		queries.execute();
+		CHECK(profiler.collect(frame % 2));
+	}
+	// The first collect, then every fourth
+	CHECK(queries.mCalibrateCount == 3);
+
+	// A failed calibration fails the collect and is retried on the next one
+	queries.mIsCalibrationValid = false;
+	for (uint32_t frame = 0; frame < 4; ++frame)
+	{
+		profiler.beginFrame(CommandListA, 0);
+		profiler.endFrame(CommandListA);
+		queries.execute();
+		profiler.collect(0);
+	}
+	const uint32_t failedCount = queries.mCalibrateCount;
+	profiler.beginFrame(CommandListA, 0);
+	profiler.endFrame(CommandListA);
+	queries.execute();
+	CHECK(!profiler.collect(0));
+	CHECK(queries.mCalibrateCount == failedCount + 1);
+
+	queries.mIsCalibrationValid = true;
+	profiler.beginFrame(CommandListA, 0);
+	profiler.endFrame(CommandListA);
+	queries.execute();
+	CHECK(profiler.collect(0));
+}
+
+TEST_CASE(GpuProfiler, InvalidateForgetsRecordedFrames)
+{
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(2, 2));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, 2, 2);
+
+	profiler.beginFrame(CommandListA, 0);
+	profiler.endFrame(CommandListA);
+	profiler.beginFrame(CommandListA, 1);
+	profiler.endFrame(CommandListA);
+	queries.execute();
+
+	profiler.invalidate();
+	CHECK(!profiler.collect(0));
+	CHECK(!profiler.collect(1));
+	CHECK(!profiler.collect(2));
+}
+
+TEST_CASE(GpuProfiler, PushesToProfilerTrack)
+{
+	Profiler::createInstance();
+	Profiler* pProfiler = Profiler::getInstance();
+	pProfiler->setEnabled(true);
+	{
+		FakeTimestampQueries queries(GpuProfiler::GetQueryCount(1, 4));
+		GpuProfiler profiler;
+		profiler.initialize(&queries, 1, 4);
+
+		for (uint32_t frame = 0; frame < 3; ++frame)
+		{
+			profiler.beginFrame(CommandListA, 0);
+			profiler.beginZone(CommandListA, &ZoneA);
+			profiler.endFrame(CommandListA);
+			queries.execute();
+			profiler.collect(0);
+		}
+
+		pProfiler->collect();
+		CHECK(pProfiler->getEventCount() == 6);
+		const std::string trace = pProfiler->exportChromeTrace();
+		CHECK(trace.find("\"name\":\"GPU\"") != std::string::npos);
+		CHECK(trace.find("\"name\":\"GPU Frame\"") != std::string::npos);
+	}
+	Profiler::destoryInstance();
+}
+
+BENCHMARK(GpuProfiler, RecordAndCollect)
+{
+	const uint32_t frameCount = 3;
+	const uint32_t maxZoneCount = 64;
+	FakeTimestampQueries queries(GpuProfiler::GetQueryCount(frameCount, maxZoneCount));
+	GpuProfiler profiler;
+	profiler.initialize(&queries, frameCount, maxZoneCount);
+
+	const uint32_t frames = static_cast<uint32_t>(20000 * Test::GetBenchmarkScale());
+	int64_t recordTime = 0;
+	int64_t collectTime = 0;
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		const uint32_t frameIndex = frame % frameCount;
+
+		int64_t start = Test::GetTime();
+		profiler.beginFrame(CommandListA, frameIndex);
+		for (uint32_t zone = 1; zone < maxZoneCount; ++zone)
+		{
+			profiler.beginZone(CommandListA, &ZoneA);
+			profiler.endZone(CommandListA);
+		}
+		profiler.endFrame(CommandListA);
+		recordTime += Test::GetTime() - start;
+
+		queries.execute();
+
+		start = Test::GetTime();
+		profiler.collect(frameIndex);
+		collectTime += Test::GetTime() - start;
+	}
+	Test::Report("recorded zone", static_cast<uint64_t>(frames) * maxZoneCount, recordTime);
+	Test::Report("collected zone", static_cast<uint64_t>(frames) * maxZoneCount, collectTime);
+	Test::Consume(static_cast<uint64_t>(profiler.getTimings().size()));
+}
@@ -0,0 +1,159 @@
+#include "TestFramework.h"
+
+#include <vector>
+
+#include "InstanceBatcher.h"
+
+namespace
+{
+	// Counts what Renderer::recordBatches would record for the batches: a pipeline state change
+	// and a vertex / index buffer change when they differ from the previous batch, and one draw per batch.
+	struct RecordingCommandList
+	{
+		const void* pPipelineState = nullptr;
+		const void* pMesh = nullptr;
+		uint32_t pipelineStateChangeCount = 0;
+		uint32_t meshChangeCount = 0;
+		uint32_t drawCount = 0;
+		uint32_t instanceCount = 0;
+
+		void record(const std::vector<InstanceBatch>& batches)
+		{
+			for (const InstanceBatch& batch : batches)
+			{
+				if (batch.pPipelineState != pPipelineState)
+				{
+					pPipelineState = batch.pPipelineState;
+					++pipelineStateChangeCount;
+				}
+				if (batch.pMesh != pMesh)
+				{
+					pMesh = batch.pMesh;
+					++meshChangeCount;
+				}
+				++drawCount;
+				instanceCount += batch.instanceCount;
+			}
+		}
+	};
+
+	// Opaque keys standing in for Mesh and ID3D12PipelineState
+	const int Meshes[3] = {};
+	const int PipelineStates[2] = {};
+
+	InstanceData MakeInstance(uint32_t id)
+	{
+		InstanceData data = {};
+		data.world._41 = static_cast<float>(id);
+		data.world._44 = 1.0f;
+		return data;
+	}
+
+	uint32_t GetId(const InstanceData& data)
+	{
+		return static_cast<uint32_t>(data.world._41);
+	}
+}
+
+TEST_CASE(InstanceBatcher, GroupsByMeshAndPipelineState)
+{
+	InstanceBatcher batcher;
+
+	// Interleaved, the worst case for the last-key shortcut in submit()
+	const uint32_t cubeCount = 100000;
+	for (uint32_t i = 0; i < cubeCount; ++i)
+	{
+		batcher.submit(&Meshes[i % 3], &PipelineStates[(i / 3) % 2], MakeInstance(i));
+	}
+	batcher.build();
+
+	RecordingCommandList commandList;
+	commandList.record(batcher.getBatches());
+	CHECK(commandList.drawCount == 6);
+	CHECK(commandList.instanceCount == cubeCount);
+	CHECK(commandList.pipelineStateChangeCount == 2);
+	CHECK(batcher.getInstances().size() == cubeCount);
+}
+
+TEST_CASE(InstanceBatcher, InstancesAreContiguousPerBatch)
+{
+	InstanceBatcher batcher;
+	for (uint32_t i = 0; i < 1000; ++i)
+	{
+		batcher.submit(&Meshes[(i * 7) % 3], &PipelineStates[(i / 5) % 2], MakeInstance(i));
+	}
+	batcher.build();
+
+	const std::vector<InstanceBatch>& batches = batcher.getBatches();
+	const std::vector<InstanceData>& instances = batcher.getInstances();
+	uint32_t nextInstance = 0;
+	std::vector<bool> isSeen(1000, false);
+	for (const InstanceBatch& batch : batches)
+	{
+		CHECK(batch.firstInstance == nextInstance);
+		nextInstance += batch.instanceCount;
+
+		uint32_t previousId = 0;
+		for (uint32_t n = batch.firstInstance; n < batch.firstInstance + batch.instanceCount; ++n)
+		{
+			const uint32_t id = GetId(instances[n]);
+			REQUIRE(id < 1000 && !isSeen[id]);
+			isSeen[id] = true;
+
+			// Every instance is in the batch of its own mesh and pipeline state, in submission order
+			CHECK(batch.pMesh == &Meshes[(id * 7) % 3]);
+			CHECK(batch.pPipelineState == &PipelineStates[(id / 5) % 2]);
+			CHECK(n == batch.firstInstance || id > previousId);
+			previousId = id;
+		}
+	}
+	CHECK(nextInstance == 1000);
+
+	// Batches sharing a pipeline state are adjacent
+	for (size_t i = 2; i < batches.size(); ++i)
+	{
+		CHECK(batches[i].pPipelineState == batches[i - 1].pPipelineState || batches[i].pPipelineState != batches[i - 2].pPipelineState);
+	}
+}
+
+TEST_CASE(InstanceBatcher, ClearStartsOver)
+{
+	InstanceBatcher batcher;
+	batcher.submit(&Meshes[0], &PipelineStates[0], MakeInstance(1));
+	batcher.build();
+	batcher.clear();
+
+	batcher.submit(&Meshes[1], &PipelineStates[1], MakeInstance(2));
+	batcher.submit(&Meshes[1], &PipelineStates[1], MakeInstance(3));
+	batcher.build();
+
+	REQUIRE(batcher.getBatches().size() == 1);
+	CHECK(batcher.getBatches()[0].pMesh == &Meshes[1]);
+	CHECK(batcher.getBatches()[0].firstInstance == 0);
+	CHECK(batcher.getBatches()[0].instanceCount == 2);
+	CHECK(GetId(batcher.getInstances()[1]) == 3);
+}
+
+BENCHMARK(InstanceBatcher, SubmitAndBuild)
+{
+	const uint32_t cubeCount = 100000;
+	const uint32_t frameCount = static_cast<uint32_t>(100 * Test::GetBenchmarkScale()) + 1;
+	InstanceBatcher batcher;
+
+	uint64_t drawCount = 0;
+	const int64_t begin = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		batcher.clear();
+		for (uint32_t i = 0; i < cubeCount; ++i)
+		{
+			batcher.submit(&Meshes[(i / 1000) % 3], &PipelineStates[(i / 3000) % 2], MakeInstance(i));
+		}
+		batcher.build();
+		drawCount += batcher.getBatches().size();
+	}
+	const int64_t end = Test::GetTime();
+
+	Test::Consume(drawCount);
+	Test::Report("100k cubes: submit + build, per cube", static_cast<uint64_t>(frameCount) * cubeCount, end - begin);
+}
@@ -0,0 +1,295 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "WorkStealingQueue.h"
+
+namespace
+{
+	// Arithmetic the compiler cannot fold away
+	uint64_t Spin(uint64_t iterations)
+	{
+		uint64_t value = iterations;
+		for (uint64_t i = 0; i < iterations; ++i)
+		{
+			value = value * 6364136223846793005ull + 1442695040888963407ull;
+		}
+		return value;
+	}
+}
+
+TEST_CASE(WorkStealingQueue, OwnerIsLifoThievesAreFifo)
+{
+	WorkStealingQueue<int, 4> queue;
+	int items[5] = { 0, 1, 2, 3, 4 };
+
+	CHECK(queue.pop() == nullptr);
+	CHECK(queue.steal() == nullptr);
+	for (int i = 0; i < 4; ++i)
+	{
+		CHECK(queue.push(&items[i]));
+	}
+	CHECK(!queue.push(&items[4]));
+
+	CHECK(queue.steal() == &items[0]);
+	CHECK(queue.pop() == &items[3]);
+	CHECK(queue.push(&items[4]));
+	CHECK(queue.pop() == &items[4]);
+	CHECK(queue.steal() == &items[1]);
+	CHECK(queue.pop() == &items[2]);
+	CHECK(queue.empty());
+	CHECK(queue.pop() == nullptr);
+}
+
+/// <summary>
+/// The owner pushes and pops while thieves steal; every item must be taken exactly once.
+/// Small bursts keep the deque near empty, where pop and steal race for the last item.
+/// </summary>
+TEST_CASE(WorkStealingQueue, StealRacesTakeEachItemOnce)
+{
+	const uint32_t itemCount = 200000;
+	const uint32_t thiefCount = 3;
+	WorkStealingQueue<uint32_t, 64> queue;
+
+	std::vector<uint32_t> items(itemCount);
+	std::unique_ptr<std::atomic<uint32_t>[]> takenCounts(new std::atomic<uint32_t>[itemCount]);
+	for (uint32_t i = 0; i < itemCount; ++i)
+	{
+		items[i] = i;
+		takenCounts[i].store(0);
+	}
+
+	std::atomic<bool> isDone(false);
+	std::atomic<uint32_t> stolenCount(0);
+	std::vector<std::thread> thieves;
+	for (uint32_t t = 0; t < thiefCount; ++t)
+	{
+		thieves.emplace_back([&]()
+		{
+			while (!isDone.load(std::memory_order_acquire))
+			{
+				uint32_t* pItem = queue.steal();
+				if (pItem != nullptr)
+				{
+					takenCounts[*pItem].fetch_add(1);
+					stolenCount.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		});
+	}
+
+	uint32_t next = 0;
+	while (next < itemCount)
+	{
+		const uint32_t burst = 1 + next % 7;
+		for (uint32_t i = 0; i < burst && next < itemCount; ++i)
+		{
+			if (queue.push(&items[next]))
+			{
+				++next;
+			}
+		}
+		if (next % 64 == 0)
+		{
+			// Lets the thieves in even on a single core
+			std::this_thread::yield();
+		}
+		for (uint32_t i = 0; i < burst / 2 + 1; ++i)
+		{
+			uint32_t* pItem = queue.pop();
+			if (pItem != nullptr)
+			{
+				takenCounts[*pItem].fetch_add(1);
+			}
+		}
+	}
+	while (uint32_t* pItem = queue.pop())
+	{
+		takenCounts[*pItem].fetch_add(1);
+	}
+
+	isDone.store(true, std::memory_order_release);
+	for (std::thread& thief : thieves)
+	{
+		thief.join();
+	}
+
+	for (uint32_t i = 0; i < itemCount; ++i)
+	{
+		REQUIRE(takenCounts[i].load() == 1);
+	}
+	// The race above is only exercised if the thieves actually got some items
+	CHECK(stolenCount.load() > 0);
+}
+
+TEST_CASE(JobSystem, ParallelForCoversEveryIndexOnce)
+{
+	JobSystem jobSystem;
+	jobSystem.onInit(4);
+	CHECK(jobSystem.getWorkerCount() == 4);
+
+	const uint32_t count = 100003;
+	std::unique_ptr<std::atomic<uint32_t>[]> visits(new std::atomic<uint32_t>[count]);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		visits[i].store(0);
+	}
+
+	for (uint32_t grainSize : { 1u, 7u, 1000u, 200000u })
+	{
+		jobSystem.parallelFor(count, grainSize, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				visits[i].fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		REQUIRE(visits[i].load() == 4);
+	}
+	jobSystem.onDestroy();
+}
+
+TEST_CASE(JobSystem, NestedJobsWaitInsideJobs)
+{
+	JobSystem jobSystem;
+	jobSystem.onInit(3);
+
+	// Outer jobs run on workers and wait on their own inner jobs, which lands in their own deques
+	std::atomic<uint32_t> sum(0);
+	jobSystem.parallelFor(64, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t outer = begin; outer < end; ++outer)
+		{
+			jobSystem.parallelFor(100, 10, [&](uint32_t innerBegin, uint32_t innerEnd)
+			{
+				sum.fetch_add(innerEnd - innerBegin, std::memory_order_relaxed);
+			});
+		}
+	});
+	CHECK(sum.load() == 6400);
+	jobSystem.onDestroy();
+}
+
+TEST_CASE(JobSystem, RunFromManyThreads)
+{
+	JobSystem jobSystem;
+	jobSystem.onInit(2);
+
+	struct Data
+	{
+		std::atomic<uint32_t> count;
+	};
+	Data data;
+	data.count.store(0);
+
+	// Submitters that are not workers all go through the shared queue
+	std::vector<std::thread> submitters;
+	for (uint32_t t = 0; t < 4; ++t)
+	{
+		submitters.emplace_back([&]()
+		{
+			for (uint32_t round = 0; round < 200; ++round)
+			{
+				Job jobs[16];
+				for (Job& job : jobs)
+				{
+					job.pFunction = [](void* pData, uint32_t begin, uint32_t end)
+					{
+						static_cast<Data*>(pData)->count.fetch_add(end - begin, std::memory_order_relaxed);
+					};
+					job.pData = &data;
+					job.begin = 0;
+					job.end = 3;
+				}
+				JobCounter counter;
+				jobSystem.run(jobs, 16, &counter);
+				jobSystem.wait(&counter);
+			}
+		});
+	}
+	for (std::thread& submitter : submitters)
+	{
+		submitter.join();
+	}
+
+	CHECK(data.count.load() == 4 * 200 * 16 * 3);
+	jobSystem.onDestroy();
+}
+
+TEST_CASE(JobSystem, RunsInlineWithoutWorkers)
+{
+	JobSystem jobSystem;
+	uint32_t sum = 0;
+	jobSystem.parallelFor(10, 2, [&](uint32_t begin, uint32_t end)
+	{
+		sum += end - begin;
+	});
+	CHECK(sum == 10);
+}
+
+/// <summary>
+/// Speed-up of parallelFor over fixed work as workers are added.
+/// </summary>
+BENCHMARK(JobSystem, ParallelForScaling)
+{
+	const uint32_t itemCount = static_cast<uint32_t>(100000 * Test::GetBenchmarkScale()) + 1;
+	const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	const uint32_t maxWorkerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+
+	std::vector<uint64_t> results(itemCount);
+	for (uint32_t workerCount = 0; workerCount <= maxWorkerCount; workerCount = (workerCount == 0) ? 1 : workerCount * 2)
+	{
+		JobSystem jobSystem;
+		if (workerCount > 0)
+		{
+			jobSystem.onInit(workerCount);
+		}
+
+		const int64_t begin = Test::GetTime();
+		for (uint32_t frame = 0; frame < 10; ++frame)
+		{
+			jobSystem.parallelFor(itemCount, 256, [&](uint32_t rangeBegin, uint32_t rangeEnd)
+			{
+				for (uint32_t i = rangeBegin; i < rangeEnd; ++i)
+				{
+					results[i] = Spin(200);
+				}
+			});
+		}
+		const int64_t end = Test::GetTime();
+
+		char name[64];
+		snprintf(name, sizeof(name), "parallelFor, caller + %u workers", workerCount);
+		Test::Report(name, 10ull * itemCount, end - begin);
+		jobSystem.onDestroy();
+	}
+	Test::Consume(results[itemCount / 2]);
+}
+
+BENCHMARK(JobSystem, EmptyJobOverhead)
+{
+	JobSystem jobSystem;
+	jobSystem.onInit(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+
+	const uint32_t jobCount = static_cast<uint32_t>(1000000 * Test::GetBenchmarkScale()) + 1;
+	std::atomic<uint32_t> count(0);
+	const int64_t begin = Test::GetTime();
+	jobSystem.parallelFor(jobCount, 1, [&](uint32_t, uint32_t)
+	{
+		count.fetch_add(1, std::memory_order_relaxed);
+	});
+	const int64_t end = Test::GetTime();
+
+	Test::Report("empty job, grain size 1", jobCount, end - begin);
+	Test::Consume(count.load());
+	jobSystem.onDestroy();
+}
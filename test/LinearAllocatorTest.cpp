@@ -0,0 +1,120 @@
+#include "TestFramework.h"
+
+#include <vector>
+
+#include "LinearAllocator.h"
+
+namespace
+{
+	// Stands in for the persistently mapped upload buffer and its GPU virtual address
+	const uint64_t FakeGpuBase = 0x100000000ull;
+
+	struct FakeUploadBuffer
+	{
+		FakeUploadBuffer(uint64_t frameSize, uint32_t frameCount)
+			: memory(static_cast<size_t>(frameSize * frameCount))
+			, allocator()
+		{
+			allocator.initialize(memory.data(), FakeGpuBase, frameSize, frameCount);
+		}
+
+		std::vector<uint8_t> memory;
+		FrameLinearAllocator allocator;
+	};
+}
+
+TEST_CASE(LinearAllocator, AllocationsAreAlignedAndSequential)
+{
+	FakeUploadBuffer buffer(4096, 3);
+	FrameLinearAllocator& allocator = buffer.allocator;
+
+	const LinearAllocation first = allocator.allocate(100);
+	const LinearAllocation second = allocator.allocate(4, 16);
+	const LinearAllocation third = allocator.allocate(64);
+	REQUIRE(first.isValid() && second.isValid() && third.isValid());
+
+	CHECK(first.offset == 0);
+	CHECK(second.offset == 112);
+	CHECK(third.offset == 256);
+	CHECK(third.pCPU == buffer.memory.data() + 256);
+	CHECK(third.gpuAddress == FakeGpuBase + 256);
+	CHECK(allocator.getUsedSize() == 320);
+}
+
+TEST_CASE(LinearAllocator, FullFrameFailsWithoutAdvancing)
+{
+	FakeUploadBuffer buffer(1024, 2);
+	FrameLinearAllocator& allocator = buffer.allocator;
+
+	CHECK(allocator.allocate(1000).isValid());
+	CHECK(!allocator.allocate(100).isValid());
+	CHECK(!allocator.allocate(0).isValid());
+	CHECK(allocator.getUsedSize() == 1000);
+
+	// A smaller request that still fits after the failed one
+	const LinearAllocation tail = allocator.allocate(8, 8);
+	CHECK(tail.isValid() && tail.offset == 1000);
+}
+
+TEST_CASE(LinearAllocator, FramesUseDisjointRegions)
+{
+	const uint64_t frameSize = 2048;
+	FakeUploadBuffer buffer(frameSize, 3);
+	FrameLinearAllocator& allocator = buffer.allocator;
+
+	for (uint32_t frame = 0; frame < 3; ++frame)
+	{
+		allocator.beginFrame(frame);
+		const LinearAllocation allocation = allocator.allocate(frameSize);
+		REQUIRE(allocation.isValid());
+		CHECK(allocation.offset == frame * frameSize);
+		CHECK(!allocator.allocate(1).isValid());
+	}
+}
+
+TEST_CASE(LinearAllocator, RingWrapsAndRewinds)
+{
+	const uint64_t frameSize = 1024;
+	FakeUploadBuffer buffer(frameSize, 3);
+	FrameLinearAllocator& allocator = buffer.allocator;
+
+	allocator.beginFrame(1);
+	allocator.allocate(512);
+
+	// Frame 4 reuses frame 1's region, which starts empty again
+	allocator.beginFrame(4);
+	CHECK(allocator.getFrameIndex() == 1);
+	CHECK(allocator.getUsedSize() == 0);
+	const LinearAllocation allocation = allocator.allocate(frameSize);
+	CHECK(allocation.isValid() && allocation.offset == frameSize);
+
+	// Rewinding the same frame twice hands out the same memory again
+	allocator.beginFrame(4);
+	CHECK(allocator.allocate(16).offset == frameSize);
+}
+
+BENCHMARK(LinearAllocator, Allocate)
+{
+	const uint64_t frameSize = 4 * 1024 * 1024;
+	FakeUploadBuffer buffer(frameSize, 3);
+	FrameLinearAllocator& allocator = buffer.allocator;
+
+	// One frame of 256-byte constant buffers per beginFrame
+	const uint64_t perFrame = frameSize / 256;
+	const uint64_t frameCount = static_cast<uint64_t>(2000 * Test::GetBenchmarkScale()) + 1;
+
+	uint64_t sum = 0;
+	const int64_t begin = Test::GetTime();
+	for (uint64_t frame = 0; frame < frameCount; ++frame)
+	{
+		allocator.beginFrame(static_cast<uint32_t>(frame));
+		for (uint64_t i = 0; i < perFrame; ++i)
+		{
+			sum += allocator.allocate(192).offset;
+		}
+	}
+	const int64_t end = Test::GetTime();
+
+	Test::Consume(sum);
+	Test::Report("allocate(192) + beginFrame", frameCount * perFrame, end - begin);
+}
@@ -0,0 +1,159 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CommandListPool.h"
+#include "JobSystem.h"
+#include "ParallelCommandRecorder.h"
+
+namespace
+{
+	// Lists that remember what was recorded into them and which thread touched them
+	struct FakeCommandList
+	{
+		bool isOpen = false;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+		std::thread::id resetThread;
+	};
+
+	class FakeCommandListFactory final : public ICommandListFactory
+	{
+	public:
+		void* create() override
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mLists.emplace_back(new FakeCommandList());
+			return mLists.back().get();
+		}
+
+		void reset(void* pHandle) override
+		{
+			FakeCommandList* pList = static_cast<FakeCommandList*>(pHandle);
+			pList->isOpen = true;
+			pList->resetThread = std::this_thread::get_id();
+		}
+
+		int32_t close(void* pHandle) override
+		{
+			FakeCommandList* pList = static_cast<FakeCommandList*>(pHandle);
+			if (!pList->isOpen)
+			{
+				return -1;
+			}
+			pList->isOpen = false;
+			return (failedBegin == pList->begin) ? failedResult : 0;
+		}
+
+		void destroy(void*) override {}
+
+		// Lists whose range starts here fail to close
+		uint32_t failedBegin = ~0u;
+		int32_t failedResult = 0;
+
+	private:
+		std::mutex mMutex;
+		std::vector<std::unique_ptr<FakeCommandList>> mLists;
+	};
+}
+
+TEST_CASE(ParallelCommandRecorder, ComputeRangeCount)
+{
+	CHECK(ParallelCommandRecorder::ComputeRangeCount(0, 8, 16) == 1);
+	CHECK(ParallelCommandRecorder::ComputeRangeCount(15, 8, 16) == 1);
+	CHECK(ParallelCommandRecorder::ComputeRangeCount(64, 8, 16) == 4);
+	CHECK(ParallelCommandRecorder::ComputeRangeCount(1000, 8, 16) == 8);
+	CHECK(ParallelCommandRecorder::ComputeRangeCount(1000, 8, 0) == 8);
+}
+
+/// <summary>
+/// Every range is recorded once into its own list, lists come back in range order
+/// and are closed by the recorder; acquiring happens on the calling thread.
+/// </summary>
+TEST_CASE(ParallelCommandRecorder, RecordsRangesInOrderAndClosesLists)
+{
+	JobSystem jobSystem;
+	jobSystem.onInit(3);
+
+	FakeCommandListFactory factory;
+	CommandListPool pool;
+	pool.initialize(&factory, 2);
+	ParallelCommandRecorder recorder;
+	recorder.initialize(&pool, 8, 10);
+
+	for (uint32_t frame = 0; frame < 4; ++frame)
+	{
+		pool.beginFrame(frame % 2);
+
+		const uint32_t itemCount = 1000 + frame;
+		std::atomic<uint32_t> recordedCount(0);
+		std::atomic<uint32_t> closedListCount(0);
+		const std::vector<void*>& handles = recorder.record(itemCount, [&](void* pHandle, uint32_t begin, uint32_t end)
+		{
+			FakeCommandList* pList = static_cast<FakeCommandList*>(pHandle);
+			if (!pList->isOpen)
+			{
+				closedListCount.fetch_add(1);
+			}
+			pList->begin = begin;
+			pList->end = end;
+			recordedCount.fetch_add(end - begin);
+		});
+
+		REQUIRE(handles.size() == 8);
+		CHECK(recordedCount.load() == itemCount);
+		CHECK(closedListCount.load() == 0);
+		CHECK(recorder.getCloseResult() == 0);
+
+		uint32_t next = 0;
+		for (void* pHandle : handles)
+		{
+			const FakeCommandList* pList = static_cast<const FakeCommandList*>(pHandle);
+			CHECK(!pList->isOpen);
+			CHECK(pList->begin == next);
+			CHECK(pList->resetThread == std::this_thread::get_id());
+			next = pList->end;
+		}
+		CHECK(next == itemCount);
+	}
+
+	// Two frames in flight, eight lists each
+	CHECK(pool.getCreatedCount() == 16);
+	pool.destroy();
+	jobSystem.onDestroy();
+}
+
+TEST_CASE(ParallelCommandRecorder, ReportsFailedClose)
+{
+	JobSystem jobSystem;
+	jobSystem.onInit(2);
+
+	FakeCommandListFactory factory;
+	CommandListPool pool;
+	pool.initialize(&factory, 1);
+	ParallelCommandRecorder recorder;
+	recorder.initialize(&pool, 4, 1);
+
+	const int32_t DeviceRemoved = static_cast<int32_t>(0x887A0005);
+	factory.failedBegin = 2;
+	factory.failedResult = DeviceRemoved;
+	recorder.record(8, [](void* pHandle, uint32_t begin, uint32_t end)
+	{
+		static_cast<FakeCommandList*>(pHandle)->begin = begin;
+		static_cast<FakeCommandList*>(pHandle)->end = end;
+	});
+	CHECK(recorder.getCloseResult() == DeviceRemoved);
+
+	// The result belongs to one record() only
+	factory.failedBegin = ~0u;
+	pool.beginFrame(0);
+	recorder.record(8, [](void*, uint32_t, uint32_t) {});
+	CHECK(recorder.getCloseResult() == 0);
+
+	pool.destroy();
+	jobSystem.onDestroy();
+}
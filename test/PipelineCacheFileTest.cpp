@@ -0,0 +1,251 @@
+#include "TestFramework.h"
+
+#include <cstring>
+#include <vector>
+
+#include "PipelineCacheFile.h"
+
+namespace
+{
+	PipelineCacheFingerprint TestFingerprint()
+	{
+		PipelineCacheFingerprint fingerprint;
+		fingerprint.vendorId = 0x10de;
+		fingerprint.deviceId = 0x2684;
+		fingerprint.subSysId = 0x16f4;
+		fingerprint.revision = 0xa1;
+		fingerprint.driverVersion = 0x001f000e000c1234ull;
+		fingerprint.applicationVersion = 1;
+		return fingerprint;
+	}
+
+	std::vector<uint8_t> MakeBlob(uint32_t size, uint8_t seed)
+	{
+		std::vector<uint8_t> blob(size);
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			blob[i] = static_cast<uint8_t>(seed + i * 7);
+		}
+		return blob;
+	}
+
+	// Three entries of different sizes, written in key order: 10, 20, 30.
+	std::vector<uint8_t> MakeFileData()
+	{
+		PipelineCacheFile file;
+		file.setFingerprint(TestFingerprint());
+		const std::vector<uint8_t> blob10 = MakeBlob(100, 1);
+		const std::vector<uint8_t> blob20 = MakeBlob(1, 2);
+		const std::vector<uint8_t> blob30 = MakeBlob(300, 3);
+		file.store(30, blob30.data(), blob30.size());
+		file.store(10, blob10.data(), blob10.size());
+		file.store(20, blob20.data(), blob20.size());
+
+		std::vector<uint8_t> data;
+		file.serialize(data);
+		return data;
+	}
+
+	// Header: magic, version, fingerprint (4 x uint32, 2 x uint64), entry count
+	const size_t HeaderSize = 4 + 4 + 16 + 16 + 4;
+	// Entry: key, checksum, size, then the blob
+	const size_t EntryHeaderSize = 8 + 8 + 4;
+}
+
+TEST_CASE(PipelineCacheFile, RoundTrip)
+{
+	const std::vector<uint8_t> data = MakeFileData();
+	CHECK(data.size() == HeaderSize + 3 * EntryHeaderSize + 100 + 1 + 300);
+
+	PipelineCacheFile file;
+	file.setFingerprint(TestFingerprint());
+	CHECK(file.deserialize(data.data(), data.size()) == PipelineCacheFile::Loaded);
+	CHECK(!file.isDirty());
+	CHECK(file.size() == 3);
+
+	const std::vector<uint8_t>* pBlob = file.find(10);
+	REQUIRE(pBlob != nullptr);
+	CHECK(*pBlob == MakeBlob(100, 1));
+	pBlob = file.find(20);
+	REQUIRE(pBlob != nullptr);
+	CHECK(*pBlob == MakeBlob(1, 2));
+	pBlob = file.find(30);
+	REQUIRE(pBlob != nullptr);
+	CHECK(*pBlob == MakeBlob(300, 3));
+	CHECK(file.find(40) == nullptr);
+
+	// The same contents give the same bytes, whatever order they were stored in
+	std::vector<uint8_t> again;
+	file.serialize(again);
+	CHECK(again == data);
+}
+
+TEST_CASE(PipelineCacheFile, EmptyAndZeroSizedEntries)
+{
+	PipelineCacheFile file;
+	file.setFingerprint(TestFingerprint());
+	file.store(5, nullptr, 0);
+
+	std::vector<uint8_t> data;
+	file.serialize(data);
+
+	PipelineCacheFile loaded;
+	loaded.setFingerprint(TestFingerprint());
+	CHECK(loaded.deserialize(data.data(), data.size()) == PipelineCacheFile::Loaded);
+	REQUIRE(loaded.find(5) != nullptr);
+	CHECK(loaded.find(5)->empty());
+
+	file.clear();
+	file.serialize(data);
+	CHECK(data.size() == HeaderSize);
+	CHECK(loaded.deserialize(data.data(), data.size()) == PipelineCacheFile::Loaded);
+	CHECK(loaded.size() == 0);
+}
+
+/// <summary>
+/// A cut inside any entry keeps the entries before it and reports Damaged; a cut inside the header loads nothing.
+/// </summary>
+TEST_CASE(PipelineCacheFile, TruncatedFileIsDamaged)
+{
+	const std::vector<uint8_t> data = MakeFileData();
+	const size_t firstEnd = HeaderSize + EntryHeaderSize + 100;
+	const size_t secondEnd = firstEnd + EntryHeaderSize + 1;
+
+	uint32_t wrongCount = 0;
+	for (size_t size = HeaderSize; size < data.size(); ++size)
+	{
+		PipelineCacheFile file;
+		file.setFingerprint(TestFingerprint());
+		const PipelineCacheFile::LoadResult result = file.deserialize(data.data(), size);
+
+		const uint32_t expectedCount = (size >= secondEnd) ? 2 : (size >= firstEnd) ? 1 : 0;
+		if (result != PipelineCacheFile::Damaged || !file.isDirty() || file.size() != expectedCount)
+		{
+			++wrongCount;
+		}
+	}
+	CHECK(wrongCount == 0);
+
+	for (size_t size = 0; size < HeaderSize; ++size)
+	{
+		PipelineCacheFile file;
+		file.setFingerprint(TestFingerprint());
+		CHECK(file.deserialize(data.data(), size) == PipelineCacheFile::InvalidHeader);
+		CHECK(file.isDirty());
+		CHECK(file.size() == 0);
+	}
+}
+
+TEST_CASE(PipelineCacheFile, ChecksumMismatchIsDamaged)
+{
+	std::vector<uint8_t> data = MakeFileData();
+	// Flip a byte in the blob of the second entry (key 20)
+	const size_t secondBlob = HeaderSize + EntryHeaderSize + 100 + EntryHeaderSize;
+	data[secondBlob] ^= 0x40;
+
+	PipelineCacheFile file;
+	file.setFingerprint(TestFingerprint());
+	CHECK(file.deserialize(data.data(), data.size()) == PipelineCacheFile::Damaged);
+	CHECK(file.isDirty());
+	CHECK(file.size() == 2);
+	CHECK(file.find(10) != nullptr);
+	CHECK(file.find(20) == nullptr);
+	CHECK(file.find(30) != nullptr);
+
+	// A damaged checksum field is caught the same way
+	data = MakeFileData();
+	data[HeaderSize + 8] ^= 0x01;
+	CHECK(file.deserialize(data.data(), data.size()) == PipelineCacheFile::Damaged);
+	CHECK(file.find(10) == nullptr);
+	CHECK(file.size() == 2);
+}
+
+TEST_CASE(PipelineCacheFile, FingerprintMismatchDiscardsEverything)
+{
+	const std::vector<uint8_t> data = MakeFileData();
+
+	PipelineCacheFingerprint fingerprints[6];
+	for (PipelineCacheFingerprint& fingerprint : fingerprints)
+	{
+		fingerprint = TestFingerprint();
+	}
+	fingerprints[0].vendorId++;
+	fingerprints[1].deviceId++;
+	fingerprints[2].subSysId++;
+	fingerprints[3].revision++;
+	fingerprints[4].driverVersion++;
+	fingerprints[5].applicationVersion++;
+
+	for (const PipelineCacheFingerprint& fingerprint : fingerprints)
+	{
+		PipelineCacheFile file;
+		file.setFingerprint(fingerprint);
+		CHECK(file.deserialize(data.data(), data.size()) == PipelineCacheFile::FingerprintMismatch);
+		CHECK(file.isDirty());
+		CHECK(file.size() == 0);
+	}
+}
+
+TEST_CASE(PipelineCacheFile, RejectsBadHeader)
+{
+	std::vector<uint8_t> data = MakeFileData();
+	PipelineCacheFile file;
+	file.setFingerprint(TestFingerprint());
+
+	data[0] ^= 0xff;
+	CHECK(file.deserialize(data.data(), data.size()) == PipelineCacheFile::InvalidHeader);
+	CHECK(file.isDirty());
+
+	data = MakeFileData();
+	const uint32_t version = PipelineCacheFile::FormatVersion + 1;
+	memcpy(&data[4], &version, sizeof(version));
+	CHECK(file.deserialize(data.data(), data.size()) == PipelineCacheFile::VersionMismatch);
+	CHECK(file.isDirty());
+	CHECK(file.size() == 0);
+}
+
+TEST_CASE(PipelineCacheFile, RemoveUnusedKeepsRequestedEntries)
+{
+	const std::vector<uint8_t> data = MakeFileData();
+	PipelineCacheFile file;
+	file.setFingerprint(TestFingerprint());
+	REQUIRE(file.deserialize(data.data(), data.size()) == PipelineCacheFile::Loaded);
+
+	// 10 is requested, 40 is new; 20 and 30 are never asked for
+	file.markUsed(10);
+	const std::vector<uint8_t> blob40 = MakeBlob(4, 4);
+	file.store(40, blob40.data(), blob40.size());
+	file.clearDirty();
+
+	CHECK(file.removeUnused() == 2);
+	CHECK(file.isDirty());
+	CHECK(file.size() == 2);
+	CHECK(file.find(10) != nullptr);
+	CHECK(file.find(40) != nullptr);
+
+	// Nothing left to drop: stays clean
+	file.clearDirty();
+	CHECK(file.removeUnused() == 0);
+	CHECK(!file.isDirty());
+
+	// Loading again forgets what was requested before
+	REQUIRE(file.deserialize(data.data(), data.size()) == PipelineCacheFile::Loaded);
+	CHECK(file.removeUnused() == 3);
+	CHECK(file.size() == 0);
+}
+
+TEST_CASE(PipelineCacheFile, ChangesMarkDirty)
+{
+	PipelineCacheFile file;
+	CHECK(!file.isDirty());
+	CHECK(!file.remove(1));
+	file.clear();
+	CHECK(!file.isDirty());
+
+	const uint8_t byte = 1;
+	file.store(1, &byte, 1);
+	CHECK(file.isDirty());
+	file.clearDirty();
+	CHECK(file.remove(1));
+	CHECK(file.isDirty());
+}
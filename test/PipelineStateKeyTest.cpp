@@ -0,0 +1,239 @@
+#include "TestFramework.h"
+
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "PipelineStateKey.h"
+
+namespace
+{
+	const uint8_t VertexShader[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4 };
+	const uint8_t PixelShader[] = { 0x44, 0x58, 0x42, 0x43, 5, 6, 7, 8, 9 };
+
+	const D3D12_INPUT_ELEMENT_DESC InputElements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	};
+
+	const D3D12_SO_DECLARATION_ENTRY StreamOutputEntries[] =
+	{
+		{ 0, "SV_POSITION", 0, 0, 4, 0 },
+	};
+	const UINT StreamOutputStrides[] = { 16 };
+
+	// The storage a description points into, so fields behind pointers can be changed too.
+	struct TestPipeline
+	{
+		std::vector<uint8_t> vertexShader;
+		std::vector<uint8_t> pixelShader;
+		std::vector<D3D12_INPUT_ELEMENT_DESC> inputElements;
+		std::vector<D3D12_SO_DECLARATION_ENTRY> streamOutputEntries;
+		std::vector<UINT> streamOutputStrides;
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+
+		TestPipeline()
+			: vertexShader(VertexShader, VertexShader + sizeof(VertexShader))
+			, pixelShader(PixelShader, PixelShader + sizeof(PixelShader))
+			, inputElements(InputElements, InputElements + 2)
+			, streamOutputEntries(StreamOutputEntries, StreamOutputEntries + 1)
+			, streamOutputStrides(StreamOutputStrides, StreamOutputStrides + 1)
+			, desc()
+		{
+			desc.VS = { vertexShader.data(), vertexShader.size() };
+			desc.PS = { pixelShader.data(), pixelShader.size() };
+			desc.StreamOutput.pSODeclaration = streamOutputEntries.data();
+			desc.StreamOutput.NumEntries = 1;
+			desc.StreamOutput.pBufferStrides = streamOutputStrides.data();
+			desc.StreamOutput.NumStrides = 1;
+
+			desc.BlendState.IndependentBlendEnable = 1;
+			for (D3D12_RENDER_TARGET_BLEND_DESC& blend : desc.BlendState.RenderTarget)
+			{
+				blend.SrcBlend = D3D12_BLEND_ONE;
+				blend.DestBlend = D3D12_BLEND_ZERO;
+				blend.BlendOp = D3D12_BLEND_OP_ADD;
+				blend.SrcBlendAlpha = D3D12_BLEND_ONE;
+				blend.DestBlendAlpha = D3D12_BLEND_ZERO;
+				blend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+				blend.LogicOp = D3D12_LOGIC_OP_NOOP;
+				blend.RenderTargetWriteMask = 0xf;
+			}
+			desc.SampleMask = 0xffffffff;
+
+			desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+			desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+			desc.RasterizerState.DepthClipEnable = 1;
+
+			desc.DepthStencilState.DepthEnable = 1;
+			desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+			desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+			desc.DepthStencilState.StencilReadMask = 0xff;
+			desc.DepthStencilState.StencilWriteMask = 0xff;
+			const D3D12_DEPTH_STENCILOP_DESC stencilOp = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS };
+			desc.DepthStencilState.FrontFace = stencilOp;
+			desc.DepthStencilState.BackFace = stencilOp;
+
+			desc.InputLayout = { inputElements.data(), static_cast<UINT>(inputElements.size()) };
+			desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			desc.NumRenderTargets = 2;
+			desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.RTVFormats[1] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			desc.SampleDesc.Count = 1;
+		}
+
+		uint64_t hash() const { return HashGraphicsPipelineDesc(desc, 7); }
+	};
+
+	struct Change
+	{
+		const char* pName;
+		std::function<void(TestPipeline&)> apply;
+	};
+}
+
+/// <summary>
+/// Each change touches one field the compiled pipeline depends on and must give a key of its own.
+/// </summary>
+TEST_CASE(PipelineStateKey, EveryFieldChangesTheKey)
+{
+	const std::vector<Change> changes =
+	{
+		{ "VS bytes", [](TestPipeline& p) { p.vertexShader[5] ^= 1; } },
+		{ "VS length", [](TestPipeline& p) { p.desc.VS.BytecodeLength--; } },
+		{ "PS bytes", [](TestPipeline& p) { p.pixelShader[8] ^= 1; } },
+		{ "DS", [](TestPipeline& p) { p.desc.DS = { p.vertexShader.data(), p.vertexShader.size() }; } },
+		{ "HS", [](TestPipeline& p) { p.desc.HS = { p.vertexShader.data(), p.vertexShader.size() }; } },
+		{ "GS", [](TestPipeline& p) { p.desc.GS = { p.vertexShader.data(), p.vertexShader.size() }; } },
+		{ "SO stream", [](TestPipeline& p) { p.streamOutputEntries[0].Stream = 1; } },
+		{ "SO semantic", [](TestPipeline& p) { p.streamOutputEntries[0].SemanticName = "COLOR"; } },
+		{ "SO semantic index", [](TestPipeline& p) { p.streamOutputEntries[0].SemanticIndex = 1; } },
+		{ "SO start component", [](TestPipeline& p) { p.streamOutputEntries[0].StartComponent = 1; } },
+		{ "SO component count", [](TestPipeline& p) { p.streamOutputEntries[0].ComponentCount = 3; } },
+		{ "SO output slot", [](TestPipeline& p) { p.streamOutputEntries[0].OutputSlot = 1; } },
+		{ "SO entry count", [](TestPipeline& p) { p.desc.StreamOutput.NumEntries = 0; } },
+		{ "SO stride", [](TestPipeline& p) { p.streamOutputStrides[0] = 32; } },
+		{ "SO stride count", [](TestPipeline& p) { p.desc.StreamOutput.NumStrides = 0; } },
+		{ "SO rasterized stream", [](TestPipeline& p) { p.desc.StreamOutput.RasterizedStream = 1; } },
+		{ "alpha to coverage", [](TestPipeline& p) { p.desc.BlendState.AlphaToCoverageEnable = 1; } },
+		{ "independent blend", [](TestPipeline& p) { p.desc.BlendState.IndependentBlendEnable = 0; } },
+		{ "blend enable", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[1].BlendEnable = 1; } },
+		{ "logic op enable", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[1].LogicOpEnable = 1; } },
+		{ "src blend", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; } },
+		{ "dest blend", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA; } },
+		{ "blend op", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[0].BlendOp = D3D12_BLEND_OP_SUBTRACT; } },
+		{ "src blend alpha", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_SRC_ALPHA; } },
+		{ "dest blend alpha", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA; } },
+		{ "blend op alpha", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_SUBTRACT; } },
+		{ "logic op", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_CLEAR; } },
+		{ "write mask", [](TestPipeline& p) { p.desc.BlendState.RenderTarget[1].RenderTargetWriteMask = 0x7; } },
+		{ "sample mask", [](TestPipeline& p) { p.desc.SampleMask = 1; } },
+		{ "fill mode", [](TestPipeline& p) { p.desc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME; } },
+		{ "cull mode", [](TestPipeline& p) { p.desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; } },
+		{ "front counter clockwise", [](TestPipeline& p) { p.desc.RasterizerState.FrontCounterClockwise = 1; } },
+		{ "depth bias", [](TestPipeline& p) { p.desc.RasterizerState.DepthBias = 1; } },
+		{ "depth bias clamp", [](TestPipeline& p) { p.desc.RasterizerState.DepthBiasClamp = 0.5f; } },
+		{ "slope scaled depth bias", [](TestPipeline& p) { p.desc.RasterizerState.SlopeScaledDepthBias = 0.5f; } },
+		{ "depth clip", [](TestPipeline& p) { p.desc.RasterizerState.DepthClipEnable = 0; } },
+		{ "multisample", [](TestPipeline& p) { p.desc.RasterizerState.MultisampleEnable = 1; } },
+		{ "antialiased line", [](TestPipeline& p) { p.desc.RasterizerState.AntialiasedLineEnable = 1; } },
+		{ "forced sample count", [](TestPipeline& p) { p.desc.RasterizerState.ForcedSampleCount = 4; } },
+		{ "conservative raster", [](TestPipeline& p) { p.desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON; } },
+		{ "depth enable", [](TestPipeline& p) { p.desc.DepthStencilState.DepthEnable = 0; } },
+		{ "depth write mask", [](TestPipeline& p) { p.desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; } },
+		{ "depth func", [](TestPipeline& p) { p.desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL; } },
+		{ "stencil enable", [](TestPipeline& p) { p.desc.DepthStencilState.StencilEnable = 1; } },
+		{ "stencil read mask", [](TestPipeline& p) { p.desc.DepthStencilState.StencilReadMask = 0x0f; } },
+		{ "stencil write mask", [](TestPipeline& p) { p.desc.DepthStencilState.StencilWriteMask = 0x0f; } },
+		{ "front stencil fail", [](TestPipeline& p) { p.desc.DepthStencilState.FrontFace.StencilFailOp = D3D12_STENCIL_OP_ZERO; } },
+		{ "front stencil depth fail", [](TestPipeline& p) { p.desc.DepthStencilState.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_ZERO; } },
+		{ "front stencil pass", [](TestPipeline& p) { p.desc.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE; } },
+		{ "front stencil func", [](TestPipeline& p) { p.desc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_NEVER; } },
+		{ "back stencil fail", [](TestPipeline& p) { p.desc.DepthStencilState.BackFace.StencilFailOp = D3D12_STENCIL_OP_ZERO; } },
+		{ "back stencil depth fail", [](TestPipeline& p) { p.desc.DepthStencilState.BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_ZERO; } },
+		{ "back stencil pass", [](TestPipeline& p) { p.desc.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_INCR; } },
+		{ "back stencil func", [](TestPipeline& p) { p.desc.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_NEVER; } },
+		{ "input semantic", [](TestPipeline& p) { p.inputElements[1].SemanticName = "NORMAL"; } },
+		{ "input semantic index", [](TestPipeline& p) { p.inputElements[1].SemanticIndex = 1; } },
+		{ "input format", [](TestPipeline& p) { p.inputElements[0].Format = DXGI_FORMAT_R32G32B32A32_FLOAT; } },
+		{ "input slot", [](TestPipeline& p) { p.inputElements[0].InputSlot = 2; } },
+		{ "input offset", [](TestPipeline& p) { p.inputElements[1].AlignedByteOffset = 16; } },
+		{ "input class", [](TestPipeline& p) { p.inputElements[1].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA; } },
+		{ "instance step rate", [](TestPipeline& p) { p.inputElements[1].InstanceDataStepRate = 2; } },
+		{ "input element count", [](TestPipeline& p) { p.desc.InputLayout.NumElements = 1; } },
+		{ "strip cut", [](TestPipeline& p) { p.desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF; } },
+		{ "topology", [](TestPipeline& p) { p.desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; } },
+		{ "render target count", [](TestPipeline& p) { p.desc.NumRenderTargets = 1; } },
+		{ "render target format", [](TestPipeline& p) { p.desc.RTVFormats[1] = DXGI_FORMAT_R8G8B8A8_UNORM; } },
+		{ "depth format", [](TestPipeline& p) { p.desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT; } },
+		{ "sample count", [](TestPipeline& p) { p.desc.SampleDesc.Count = 4; } },
+		{ "sample quality", [](TestPipeline& p) { p.desc.SampleDesc.Quality = 1; } },
+		{ "node mask", [](TestPipeline& p) { p.desc.NodeMask = 2; } },
+		{ "flags", [](TestPipeline& p) { p.desc.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; } },
+	};
+
+	const uint64_t baseHash = TestPipeline().hash();
+	std::unordered_set<uint64_t> hashes;
+	hashes.insert(baseHash);
+	for (const Change& change : changes)
+	{
+		TestPipeline pipeline;
+		change.apply(pipeline);
+		if (!hashes.insert(pipeline.hash()).second)
+		{
+			Test::Fail(__FILE__, __LINE__, (std::string("key did not change: ") + change.pName).c_str());
+		}
+	}
+
+	// The root signature is identified by the hash passed in
+	const TestPipeline pipeline;
+	CHECK(HashGraphicsPipelineDesc(pipeline.desc, 8) != baseHash);
+}
+
+TEST_CASE(PipelineStateKey, IgnoresWhatDoesNotReachTheDriver)
+{
+	const uint64_t baseHash = TestPipeline().hash();
+
+	// Addresses and cached blobs differ between runs
+	TestPipeline pipeline;
+	pipeline.desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(0x1000);
+	pipeline.desc.CachedPSO.pCachedBlob = VertexShader;
+	pipeline.desc.CachedPSO.CachedBlobSizeInBytes = sizeof(VertexShader);
+	CHECK(pipeline.hash() == baseHash);
+
+	// The same contents at other addresses
+	TestPipeline copy;
+	std::vector<uint8_t> vertexShader(copy.vertexShader);
+	std::vector<D3D12_INPUT_ELEMENT_DESC> inputElements(copy.inputElements);
+	std::string semantic = "POSITION";
+	inputElements[0].SemanticName = semantic.c_str();
+	copy.desc.VS.pShaderBytecode = vertexShader.data();
+	copy.desc.InputLayout.pInputElementDescs = inputElements.data();
+	CHECK(copy.hash() == baseHash);
+
+	// Render target slots past NumRenderTargets
+	TestPipeline unusedSlots;
+	unusedSlots.desc.RTVFormats[5] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	unusedSlots.desc.BlendState.RenderTarget[5].BlendEnable = 1;
+	CHECK(unusedSlots.hash() == baseHash);
+
+	// Without independent blending only the first blend state counts
+	TestPipeline shared;
+	shared.desc.BlendState.IndependentBlendEnable = 0;
+	const uint64_t sharedHash = shared.hash();
+	shared.desc.BlendState.RenderTarget[1].BlendEnable = 1;
+	CHECK(shared.hash() == sharedHash);
+
+	// Null arrays count as empty whatever their counts say
+	TestPipeline empty;
+	empty.desc.StreamOutput = D3D12_STREAM_OUTPUT_DESC();
+	empty.desc.InputLayout = D3D12_INPUT_LAYOUT_DESC();
+	const uint64_t emptyHash = empty.hash();
+	empty.desc.StreamOutput.NumEntries = 3;
+	empty.desc.StreamOutput.NumStrides = 2;
+	empty.desc.InputLayout.NumElements = 4;
+	CHECK(empty.hash() == emptyHash);
+}
@@ -0,0 +1,260 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace
+{
+	// The profiler instance for one test. Zones are recorded on threads started by RunThread only,
+	// since a thread caches its ring and must not outlive the profiler it registered with.
+	struct ScopedProfiler
+	{
+		ScopedProfiler()
+		{
+			Profiler::createInstance();
+			Profiler::getInstance()->setEnabled(true);
+		}
+
+		~ScopedProfiler()
+		{
+			Profiler::destoryInstance();
+		}
+
+		Profiler* operator->() const { return Profiler::getInstance(); }
+	};
+
+	template<typename Function>
+	void RunThread(Function function)
+	{
+		std::thread thread(function);
+		thread.join();
+	}
+
+	size_t CountOccurrences(const std::string& text, const std::string& pattern)
+	{
+		size_t count = 0;
+		for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + pattern.size()))
+		{
+			++count;
+		}
+		return count;
+	}
+
+	const ProfileZone TestZone = { "Test", __FILE__, __LINE__ };
+}
+
+TEST_CASE(Profiler, RingDrainsInOrderAndDropsWhenFull)
+{
+	ProfileEventRing ring;
+	for (uint64_t i = 0; i < 10; ++i)
+	{
+		ring.push(&TestZone, i, i + 1);
+	}
+
+	std::vector<ProfileEvent> events;
+	CHECK(ring.drain(&events) == 10);
+	REQUIRE(events.size() == 10);
+	for (uint64_t i = 0; i < 10; ++i)
+	{
+		CHECK(events[i].begin == i && events[i].end == i + 1 && events[i].pZone == &TestZone);
+	}
+	CHECK(ring.drain(&events) == 0);
+
+	// Wraps around the end of the storage; the events past the capacity are counted, not written
+	for (uint32_t i = 0; i < ProfileEventRing::Capacity + 5; ++i)
+	{
+		ring.push(&TestZone, 100 + i, 0);
+	}
+	CHECK(ring.getDroppedCount() == 5);
+
+	events.clear();
+	CHECK(ring.drain(&events) == ProfileEventRing::Capacity);
+	CHECK(events.front().begin == 100);
+	CHECK(events.back().begin == 100 + ProfileEventRing::Capacity - 1);
+
+	ring.push(&TestZone, 7, 8);
+	events.clear();
+	CHECK(ring.drain(&events) == 1);
+	CHECK(events[0].begin == 7);
+}
+
+/// <summary>
+/// The consumer drains while the producer pushes; every event arrives once and in order, or is counted as dropped.
+/// </summary>
+TEST_CASE(Profiler, RingConcurrentDrain)
+{
+	ProfileEventRing ring;
+	const uint64_t eventCount = 500000;
+
+	std::atomic<bool> isDone(false);
+	std::thread producer([&ring, &isDone, eventCount]()
+	{
+		for (uint64_t i = 0; i < eventCount; ++i)
+		{
+			ring.push(&TestZone, i, i);
+		}
+		isDone.store(true);
+	});
+
+	std::vector<ProfileEvent> events;
+	while (!isDone.load())
+	{
+		ring.drain(&events);
+		std::this_thread::yield();
+	}
+	producer.join();
+	ring.drain(&events);
+
+	CHECK(events.size() + ring.getDroppedCount() == eventCount);
+	uint32_t outOfOrderCount = 0;
+	for (size_t i = 1; i < events.size(); ++i)
+	{
+		outOfOrderCount += (events[i].begin > events[i - 1].begin) ? 0 : 1;
+	}
+	CHECK(outOfOrderCount == 0);
+}
+
+TEST_CASE(Profiler, CollectsZonesPerThread)
+{
+	ScopedProfiler profiler;
+
+	RunThread([]()
+	{
+		Profiler::SetThreadName("Main \"render\"");
+		PROFILE_ZONE("Outer");
+		{
+			PROFILE_ZONE("Inner");
+		}
+	});
+	RunThread([]()
+	{
+		Profiler::SetThreadName("Worker");
+		for (int i = 0; i < 3; ++i)
+		{
+			PROFILE_ZONE("Job");
+		}
+	});
+
+	profiler->collect();
+	CHECK(profiler->getEventCount() == 5);
+	CHECK(profiler->getDroppedCount() == 0);
+
+	const std::string trace = profiler->exportChromeTrace();
+	CHECK(CountOccurrences(trace, "\"ph\":\"X\"") == 5);
+	CHECK(CountOccurrences(trace, "\"name\":\"Job\"") == 3);
+	CHECK(CountOccurrences(trace, "\"name\":\"Outer\"") == 1);
+	CHECK(CountOccurrences(trace, "\"name\":\"Inner\"") == 1);
+	// Thread names are escaped
+	CHECK(trace.find("\"name\":\"Main \\\"render\\\"\"") != std::string::npos);
+	CHECK(trace.find("\"name\":\"Worker\"") != std::string::npos);
+	// Inner finishes and is recorded before Outer on the first thread
+	CHECK(trace.find("\"name\":\"Inner\"") < trace.find("\"name\":\"Outer\""));
+
+	profiler->clear();
+	CHECK(profiler->getEventCount() == 0);
+}
+
+TEST_CASE(Profiler, DisabledRecordsNothing)
+{
+	ScopedProfiler profiler;
+	profiler->setEnabled(false);
+
+	RunThread([]()
+	{
+		PROFILE_ZONE("Skipped");
+	});
+	profiler->collect();
+	CHECK(profiler->getEventCount() == 0);
+
+	// A zone that started while disabled stays unrecorded after enabling
+	RunThread([&profiler]()
+	{
+		PROFILE_ZONE("Started disabled");
+		profiler->setEnabled(true);
+	});
+	profiler->collect();
+	CHECK(profiler->getEventCount() == 0);
+}
+
+TEST_CASE(Profiler, CaptureLimitCountsDropped)
+{
+	ScopedProfiler profiler;
+	profiler->setCaptureLimit(10);
+
+	RunThread([]()
+	{
+		for (int i = 0; i < 25; ++i)
+		{
+			PROFILE_ZONE("Zone");
+		}
+	});
+	profiler->collect();
+	CHECK(profiler->getEventCount() == 10);
+	CHECK(profiler->getDroppedCount() == 15);
+}
+
+/// <summary>
+/// Steady tracks take steady_clock nanoseconds and are exported on the same time line as the CPU zones.
+/// </summary>
+TEST_CASE(Profiler, SteadyTrackExportsSteadyTime)
+{
+	ScopedProfiler profiler;
+	static const ProfileZone GpuZone = { "Gpu", __FILE__, __LINE__ };
+
+	ProfileEventRing* pTrack = profiler->addSteadyTrack("GPU");
+	const int64_t now = Test::GetTime();
+	pTrack->push(&GpuZone, static_cast<uint64_t>(now), static_cast<uint64_t>(now + 2500));
+	profiler->collect();
+	CHECK(profiler->getEventCount() == 1);
+
+	const std::string trace = profiler->exportChromeTrace();
+	char expected[128];
+	snprintf(expected, sizeof(expected), "\"ts\":%.3f,\"dur\":2.500}", profiler->steadyToMicroseconds(now));
+	CHECK(trace.find(expected) != std::string::npos);
+	CHECK(trace.find("\"name\":\"GPU\"") != std::string::npos);
+}
+
+/// <summary>
+/// Cost of one PROFILE_ZONE: two timestamps and a push when enabled, one flag load when not.
+/// </summary>
+BENCHMARK(Profiler, ZoneOverhead)
+{
+	ScopedProfiler profiler;
+	profiler->setCaptureLimit(0);
+
+	const uint32_t batchCount = static_cast<uint32_t>(200 * Test::GetBenchmarkScale());
+	const uint32_t perBatch = ProfileEventRing::Capacity / 2;
+
+	RunThread([&profiler, batchCount, perBatch]()
+	{
+		int64_t enabledTime = 0;
+		for (uint32_t batch = 0; batch < batchCount; ++batch)
+		{
+			const int64_t start = Test::GetTime();
+			for (uint32_t i = 0; i < perBatch; ++i)
+			{
+				PROFILE_ZONE("Overhead");
+			}
+			enabledTime += Test::GetTime() - start;
+			profiler->collect();
+		}
+		Test::Report("enabled zone", static_cast<uint64_t>(batchCount) * perBatch, enabledTime);
+
+		profiler->setEnabled(false);
+		const int64_t start = Test::GetTime();
+		for (uint32_t batch = 0; batch < batchCount; ++batch)
+		{
+			for (uint32_t i = 0; i < perBatch; ++i)
+			{
+				PROFILE_ZONE("Overhead");
+			}
+		}
+		Test::Report("disabled zone", static_cast<uint64_t>(batchCount) * perBatch, Test::GetTime() - start);
+	});
+	Test::Consume(profiler->getDroppedCount());
+}
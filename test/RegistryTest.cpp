@@ -0,0 +1,208 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "Object.h"
+#include "Registry.h"
+
+TEST_CASE(ComponentPool, RemoveSwapsLastIntoHole)
+{
+	ComponentPool<int> pool;
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		pool.add(100 + i, i, static_cast<int>(i * 10));
+	}
+
+	pool.remove(1);
+	CHECK(pool.size() == 4);
+	CHECK(!pool.has(1));
+	CHECK(pool.get(1) == nullptr);
+
+	// The last component now fills the hole, and its sparse entry follows it
+	CHECK(pool.getDenseIndex(4) == 1);
+	CHECK(pool.data()[1] == 40);
+	CHECK(pool.entities()[1] == 104);
+	CHECK(pool.entityIndices()[1] == 4);
+	CHECK(*pool.get(4) == 40);
+	CHECK(*pool.get(3) == 30);
+
+	// Removing the last component moves nothing
+	pool.remove(3);
+	CHECK(pool.getDenseIndex(4) == 1);
+	CHECK(pool.getDenseIndex(2) == 2);
+	CHECK(pool.size() == 3);
+}
+
+TEST_CASE(ComponentPool, AddReplacesAndRemoveIgnoresMissing)
+{
+	ComponentPool<int> pool;
+	pool.add(7, 7, 1);
+	pool.add(7, 7, 2);
+	CHECK(pool.size() == 1);
+	CHECK(*pool.get(7) == 2);
+
+	pool.remove(3);
+	pool.remove(1000);
+	CHECK(pool.size() == 1);
+
+	pool.remove(7);
+	pool.remove(7);
+	CHECK(pool.size() == 0);
+	CHECK(!pool.has(7));
+}
+
+TEST_CASE(ComponentPool, RandomRemovalsStayConsistent)
+{
+	ComponentPool<uint32_t> pool;
+	std::vector<bool> isPresent(1000, false);
+	uint32_t seed = 12345;
+	for (uint32_t step = 0; step < 20000; ++step)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		const uint32_t index = (seed >> 8) % 1000;
+		if ((seed & 3) != 0)
+		{
+			pool.add(index, index, index * 3);
+			isPresent[index] = true;
+		}
+		else
+		{
+			pool.remove(index);
+			isPresent[index] = false;
+		}
+	}
+
+	uint32_t presentCount = 0;
+	for (uint32_t index = 0; index < 1000; ++index)
+	{
+		REQUIRE(pool.has(index) == isPresent[index]);
+		if (isPresent[index])
+		{
+			++presentCount;
+			REQUIRE(*pool.get(index) == index * 3);
+			REQUIRE(pool.entityIndices()[pool.getDenseIndex(index)] == index);
+		}
+	}
+	CHECK(pool.size() == presentCount);
+}
+
+TEST_CASE(Registry, StaleHandlesAreRejected)
+{
+	Registry registry;
+	const Entity first = registry.create();
+	const Entity second = registry.create();
+	CHECK(Registry::GetIndex(first) == 0);
+	CHECK(Registry::GetIndex(second) == 1);
+
+	TransformComponent transform = {};
+	transform.position = Vector3(1.0f, 2.0f, 3.0f);
+	registry.add(first, transform);
+	registry.add(first, MaterialComponent{ 5 });
+
+	registry.destroy(first);
+	CHECK(!registry.isAlive(first));
+	CHECK(registry.getAliveCount() == 1);
+	CHECK(registry.getPool<TransformComponent>().size() == 0);
+	CHECK(registry.getPool<MaterialComponent>().size() == 0);
+
+	// The index is reused with a new generation; the old handle stays dead
+	const Entity reused = registry.create();
+	CHECK(Registry::GetIndex(reused) == 0);
+	CHECK(Registry::GetGeneration(reused) == 1);
+	CHECK(registry.isAlive(reused));
+	CHECK(!registry.isAlive(first));
+	CHECK(!registry.has<TransformComponent>(reused));
+
+	// Destroying through a stale handle does nothing
+	registry.add(reused, transform);
+	registry.destroy(first);
+	CHECK(registry.isAlive(reused));
+	CHECK(registry.has<TransformComponent>(reused));
+}
+
+TEST_CASE(Registry, ForEachVisitsEntitiesWithAllComponents)
+{
+	Registry registry;
+	std::vector<Entity> entities;
+	for (uint32_t i = 0; i < 10; ++i)
+	{
+		const Entity entity = registry.create();
+		entities.push_back(entity);
+
+		TransformComponent transform = {};
+		transform.position = Vector3(static_cast<float>(i), 0.0f, 0.0f);
+		registry.add(entity, transform);
+		if (i % 2 == 0)
+		{
+			registry.add(entity, MaterialComponent{ i });
+		}
+	}
+	registry.remove<MaterialComponent>(entities[4]);
+	registry.destroy(entities[6]);
+
+	std::vector<uint32_t> visited;
+	registry.forEach<MaterialComponent, TransformComponent>([&](Entity entity, MaterialComponent& material, TransformComponent& transform)
+	{
+		CHECK(static_cast<uint32_t>(transform.position.x) == material.keywords);
+		CHECK(entity == entities[material.keywords]);
+		visited.push_back(material.keywords);
+	});
+
+	std::sort(visited.begin(), visited.end());
+	CHECK((visited == std::vector<uint32_t>{ 0, 2, 8 }));
+}
+
+/// <summary>
+/// Moves 1M entities per frame, once through the packed transform pool and once through
+/// one heap-allocated GameObject / Transform per entity.
+/// </summary>
+BENCHMARK(Registry, IterateEntities)
+{
+	const uint32_t count = static_cast<uint32_t>(1000000 * Test::GetBenchmarkScale()) + 1;
+	const uint32_t frameCount = 20;
+
+	Registry registry;
+	registry.reserve(count);
+	std::vector<std::unique_ptr<GameObject>> objects;
+	objects.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		TransformComponent transform = {};
+		transform.position = Vector3(static_cast<float>(i), 0.0f, 0.0f);
+		transform.rotation = Quaternion(0.0f, 0.0f, 0.0f, 1.0f);
+		transform.scale = Vector3(1.0f, 1.0f, 1.0f);
+		registry.add(registry.create(), transform);
+
+		objects.emplace_back(new GameObject());
+		objects.back()->getTransform()->setLocalPosition(transform.position);
+	}
+
+	int64_t begin = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		registry.forEach<TransformComponent>([](Entity, TransformComponent& transform)
+		{
+			transform.position.y += 0.01f;
+		});
+	}
+	int64_t end = Test::GetTime();
+	Test::Report("Registry::forEach<TransformComponent>", static_cast<uint64_t>(frameCount) * count, end - begin);
+
+	begin = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (const std::unique_ptr<GameObject>& pObject : objects)
+		{
+			Transform* pTransform = pObject->getTransform();
+			Vector3 position = pTransform->getLocalPosition();
+			position.y += 0.01f;
+			pTransform->setLocalPosition(position);
+		}
+	}
+	end = Test::GetTime();
+	Test::Report("GameObject / Transform", static_cast<uint64_t>(frameCount) * count, end - begin);
+
+	Test::Consume(static_cast<uint64_t>(registry.getPool<TransformComponent>().data()[count / 2].position.y + objects[count / 2]->getTransform()->getLocalPosition().y));
+}
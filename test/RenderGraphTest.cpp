@@ -0,0 +1,436 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "RenderGraph.h"
+
+namespace
+{
+	const RenderGraph::ExecuteFunction NoExecute;
+
+	uint32_t CountBarriers(const std::vector<RenderGraphBarrier>& barriers, RenderGraphBarrier::Type type, uint32_t resource)
+	{
+		uint32_t count = 0;
+		for (const RenderGraphBarrier& barrier : barriers)
+		{
+			count += (barrier.type == type && barrier.resource == resource) ? 1 : 0;
+		}
+		return count;
+	}
+
+	struct TestAccess
+	{
+		uint32_t pass;
+		uint32_t resource;
+		uint32_t state;
+		bool isWrite;
+	};
+
+	/// <summary>
+	/// Runs the compiled barriers over several frames and checks them against the accesses:
+	/// every transition starts from the state the resource is in, every pass finds its resources
+	/// in the states it asked for, imported resources end in their final state, and a transient
+	/// taking over memory another transient owns (from this frame or the previous one) gets an
+	/// aliasing barrier before its first pass.
+	/// </summary>
+	void CheckExecution(const RenderGraph& graph, const std::vector<TestAccess>& accesses, const std::vector<uint32_t>& initialStates,
+		const std::vector<uint32_t>& finalStates, uint64_t sizes[])
+	{
+		const uint32_t resourceCount = graph.getResourceCount();
+		std::vector<uint32_t> states(resourceCount);
+		for (uint32_t resource = 0; resource < resourceCount; ++resource)
+		{
+			states[resource] = graph.isTransient(resource) ? graph.getTransientCreationState(resource) : initialStates[resource];
+		}
+
+		const auto memoryOverlaps = [&](uint32_t a, uint32_t b)
+		{
+			const uint64_t offsetA = graph.getTransientOffset(a);
+			const uint64_t offsetB = graph.getTransientOffset(b);
+			return offsetA < offsetB + sizes[b] && offsetB < offsetA + sizes[a];
+		};
+
+		// Transients whose data is in the heap right now; the heap starts out unused
+		std::vector<uint32_t> owners;
+		for (uint32_t frame = 0; frame < 3; ++frame)
+		{
+			std::vector<bool> isUsed(resourceCount, false);
+			for (uint32_t pass : graph.getSchedule())
+			{
+				const std::vector<RenderGraphBarrier>& barriers = graph.getPassBarriers(pass);
+				for (const RenderGraphBarrier& barrier : barriers)
+				{
+					if (barrier.type == RenderGraphBarrier::Transition)
+					{
+						REQUIRE(states[barrier.resource] == barrier.stateBefore);
+						REQUIRE(barrier.stateBefore != barrier.stateAfter);
+						states[barrier.resource] = barrier.stateAfter;
+					}
+				}
+
+				for (const TestAccess& access : accesses)
+				{
+					if (access.pass != pass)
+					{
+						continue;
+					}
+
+					const uint32_t resource = access.resource;
+					if (access.isWrite)
+					{
+						REQUIRE(states[resource] == access.state);
+					}
+					else
+					{
+						REQUIRE((states[resource] & access.state) == access.state);
+						REQUIRE((states[resource] & ~RenderGraphState::ReadOnly) == 0);
+					}
+
+					if (!graph.isTransient(resource) || isUsed[resource])
+					{
+						continue;
+					}
+					isUsed[resource] = true;
+
+					bool isTakenOver = false;
+					for (size_t i = 0; i < owners.size();)
+					{
+						if (owners[i] != resource && memoryOverlaps(owners[i], resource))
+						{
+							isTakenOver = true;
+							owners.erase(owners.begin() + i);
+						}
+						else
+						{
+							++i;
+						}
+					}
+					if (std::find(owners.begin(), owners.end(), resource) == owners.end())
+					{
+						owners.push_back(resource);
+					}
+					if (isTakenOver)
+					{
+						REQUIRE(CountBarriers(barriers, RenderGraphBarrier::Aliasing, resource) == 1);
+					}
+				}
+			}
+
+			for (const RenderGraphBarrier& barrier : graph.getFinalBarriers())
+			{
+				REQUIRE(barrier.type == RenderGraphBarrier::Transition);
+				REQUIRE(states[barrier.resource] == barrier.stateBefore);
+				states[barrier.resource] = barrier.stateAfter;
+			}
+			for (uint32_t resource = 0; resource < resourceCount; ++resource)
+			{
+				if (!graph.isTransient(resource))
+				{
+					REQUIRE(states[resource] == finalStates[resource]);
+				}
+				else if (graph.getTransientOffset(resource) != RenderGraph::InvalidOffset)
+				{
+					REQUIRE(states[resource] == graph.getTransientCreationState(resource));
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(RenderGraph, CullsPassesNothingNeeds)
+{
+	RenderGraph graph;
+	const uint32_t backBuffer = graph.importResource("BackBuffer", RenderGraphState::Present, RenderGraphState::Present);
+	const uint32_t scene = graph.createTransient("Scene", 1024, 256);
+	const uint32_t unused = graph.createTransient("Unused", 1024, 256);
+
+	const uint32_t draw = graph.addPass("Draw", NoExecute);
+	graph.write(draw, scene, RenderGraphState::RenderTarget);
+	const uint32_t debug = graph.addPass("Debug", NoExecute);
+	graph.read(debug, scene, RenderGraphState::PixelShaderResource);
+	graph.write(debug, unused, RenderGraphState::RenderTarget);
+	const uint32_t readback = graph.addPass("Readback", NoExecute);
+	graph.read(readback, scene, RenderGraphState::CopySource);
+	graph.setSideEffect(readback);
+	const uint32_t present = graph.addPass("Present", NoExecute);
+	graph.read(present, scene, RenderGraphState::PixelShaderResource);
+	graph.write(present, backBuffer, RenderGraphState::RenderTarget);
+
+	REQUIRE(graph.compile());
+	CHECK(!graph.isPassCulled(draw));
+	CHECK(graph.isPassCulled(debug));
+	CHECK(!graph.isPassCulled(readback));
+	CHECK(!graph.isPassCulled(present));
+	CHECK(graph.getSchedule().size() == 3);
+	CHECK(graph.getSchedule()[0] == draw);
+	CHECK(graph.getTransientOffset(unused) == RenderGraph::InvalidOffset);
+
+	// Readback and Present read Scene in different states: both are entered with one barrier
+	uint32_t sceneTransitions = 0;
+	for (uint32_t pass : graph.getSchedule())
+	{
+		sceneTransitions += CountBarriers(graph.getPassBarriers(pass), RenderGraphBarrier::Transition, scene);
+	}
+	// RenderTarget -> both read states, and back at the start of the next frame
+	CHECK(sceneTransitions == 2);
+	CHECK(graph.getTransientCreationState(scene) == (RenderGraphState::PixelShaderResource | RenderGraphState::CopySource));
+}
+
+TEST_CASE(RenderGraph, RejectsInvalidGraphs)
+{
+	RenderGraph graph;
+	uint32_t texture = graph.createTransient("Texture", 64, 1);
+	uint32_t pass = graph.addPass("Reader", NoExecute);
+	graph.read(pass, texture, RenderGraphState::PixelShaderResource);
+	graph.setSideEffect(pass);
+	CHECK(!graph.compile());
+	CHECK(graph.getError().find("before any pass writes it") != std::string::npos);
+
+	graph.clear();
+	texture = graph.createTransient("Texture", 64, 1);
+	pass = graph.addPass("Writer", NoExecute);
+	graph.write(pass, texture, RenderGraphState::PixelShaderResource);
+	CHECK(!graph.compile());
+
+	graph.clear();
+	texture = graph.createTransient("Texture", 64, 1);
+	pass = graph.addPass("Writer", NoExecute);
+	graph.write(pass, texture, RenderGraphState::RenderTarget);
+	graph.write(pass, texture, RenderGraphState::UnorderedAccess);
+	CHECK(!graph.compile());
+	CHECK(graph.getError().find("two states") != std::string::npos);
+}
+
+/// <summary>
+/// A and B share memory. B takes it over from A within the frame, and A takes it back from B
+/// at the start of the next frame, so both need an aliasing barrier on their first pass.
+/// C lives across both and has memory of its own.
+/// </summary>
+TEST_CASE(RenderGraph, AliasingBarriersForSharedMemory)
+{
+	RenderGraph graph;
+	const uint32_t backBuffer = graph.importResource("BackBuffer", RenderGraphState::Present, RenderGraphState::Present);
+	const uint32_t a = graph.createTransient("A", 4096, 256);
+	const uint32_t b = graph.createTransient("B", 4096, 256);
+	const uint32_t c = graph.createTransient("C", 1024, 256);
+
+	const uint32_t writeA = graph.addPass("WriteA", NoExecute);
+	graph.write(writeA, a, RenderGraphState::RenderTarget);
+	graph.write(writeA, c, RenderGraphState::UnorderedAccess);
+	const uint32_t readA = graph.addPass("ReadA", NoExecute);
+	graph.read(readA, a, RenderGraphState::PixelShaderResource);
+	graph.read(readA, c, RenderGraphState::NonPixelShaderResource);
+	graph.write(readA, b, RenderGraphState::RenderTarget);
+	const uint32_t readB = graph.addPass("ReadB", NoExecute);
+	graph.read(readB, b, RenderGraphState::PixelShaderResource);
+	graph.read(readB, c, RenderGraphState::PixelShaderResource);
+	graph.write(readB, backBuffer, RenderGraphState::RenderTarget);
+
+	REQUIRE(graph.compile());
+
+	// A and B overlap in lifetime at ReadA, so they cannot share memory there
+	CHECK(graph.getTransientOffset(a) != graph.getTransientOffset(b));
+
+	// Make lifetimes disjoint: B written only after A's last read
+	graph.clear();
+	const uint32_t backBuffer2 = graph.importResource("BackBuffer", RenderGraphState::Present, RenderGraphState::Present);
+	const uint32_t a2 = graph.createTransient("A", 4096, 256);
+	const uint32_t b2 = graph.createTransient("B", 4096, 256);
+	const uint32_t c2 = graph.createTransient("C", 1024, 256);
+	const uint32_t pass0 = graph.addPass("WriteA", NoExecute);
+	graph.write(pass0, a2, RenderGraphState::RenderTarget);
+	const uint32_t pass1 = graph.addPass("ReadA", NoExecute);
+	graph.read(pass1, a2, RenderGraphState::PixelShaderResource);
+	graph.write(pass1, c2, RenderGraphState::RenderTarget);
+	const uint32_t pass2 = graph.addPass("WriteB", NoExecute);
+	graph.read(pass2, c2, RenderGraphState::PixelShaderResource);
+	graph.write(pass2, b2, RenderGraphState::UnorderedAccess);
+	const uint32_t pass3 = graph.addPass("ReadB", NoExecute);
+	graph.read(pass3, b2, RenderGraphState::PixelShaderResource);
+	graph.write(pass3, backBuffer2, RenderGraphState::RenderTarget);
+
+	REQUIRE(graph.compile());
+	CHECK(graph.getTransientOffset(a2) == graph.getTransientOffset(b2));
+	CHECK(graph.getTransientOffset(c2) >= 4096);
+	CHECK(CountBarriers(graph.getPassBarriers(pass0), RenderGraphBarrier::Aliasing, a2) == 1);
+	CHECK(CountBarriers(graph.getPassBarriers(pass2), RenderGraphBarrier::Aliasing, b2) == 1);
+	CHECK(CountBarriers(graph.getPassBarriers(pass1), RenderGraphBarrier::Aliasing, c2) == 0);
+
+	// B's aliasing barrier comes before any transition of B in the same batch
+	const std::vector<RenderGraphBarrier>& barriers = graph.getPassBarriers(pass2);
+	for (const RenderGraphBarrier& barrier : barriers)
+	{
+		if (barrier.resource == b2)
+		{
+			CHECK(barrier.type == RenderGraphBarrier::Aliasing);
+			break;
+		}
+	}
+
+	const RenderGraphMemoryReport report = graph.getMemoryReport();
+	CHECK(report.transientCount == 3);
+	CHECK(report.aliasedSize == graph.getTransientHeapSize());
+	CHECK(report.getSavedSize() == 4096);
+}
+
+/// <summary>
+/// Random graphs: transients whose lifetimes overlap never share memory, and simulated
+/// execution over several frames finds every state and aliasing barrier where it must be.
+/// </summary>
+TEST_CASE(RenderGraph, RandomGraphsExecuteConsistently)
+{
+	const uint32_t WriteStates[] = { RenderGraphState::RenderTarget, RenderGraphState::DepthWrite, RenderGraphState::UnorderedAccess, RenderGraphState::CopyDest };
+	const uint32_t ReadStates[] = { RenderGraphState::PixelShaderResource, RenderGraphState::NonPixelShaderResource, RenderGraphState::CopySource, RenderGraphState::DepthRead };
+
+	std::mt19937 random(3);
+	for (uint32_t iteration = 0; iteration < 300; ++iteration)
+	{
+		RenderGraph graph;
+		const uint32_t importedCount = 1 + random() % 2;
+		const uint32_t transientCount = 2 + random() % 10;
+		const uint32_t passCount = 2 + random() % 14;
+
+		uint64_t sizes[16] = {};
+		std::vector<uint32_t> initialStates, finalStates;
+		for (uint32_t i = 0; i < importedCount; ++i)
+		{
+			graph.importResource("Imported", RenderGraphState::Present, RenderGraphState::Present);
+			initialStates.push_back(RenderGraphState::Present);
+			finalStates.push_back(RenderGraphState::Present);
+		}
+		for (uint32_t i = 0; i < transientCount; ++i)
+		{
+			const uint32_t resource = importedCount + i;
+			sizes[resource] = 256 * (1 + random() % 8);
+			graph.createTransient("Transient", sizes[resource], 256);
+			initialStates.push_back(0);
+			finalStates.push_back(0);
+		}
+		const uint32_t resourceCount = importedCount + transientCount;
+
+		std::vector<TestAccess> accesses;
+		std::vector<bool> isWritten(resourceCount, false);
+		for (uint32_t i = 0; i < importedCount; ++i)
+		{
+			isWritten[i] = true;
+		}
+		for (uint32_t p = 0; p < passCount; ++p)
+		{
+			const uint32_t pass = graph.addPass("Pass", NoExecute);
+			std::vector<bool> isAccessed(resourceCount, false);
+
+			const uint32_t readCount = random() % 3;
+			for (uint32_t i = 0; i < readCount; ++i)
+			{
+				const uint32_t resource = random() % resourceCount;
+				if (!isWritten[resource] || isAccessed[resource])
+				{
+					continue;
+				}
+				isAccessed[resource] = true;
+				TestAccess access = { pass, resource, ReadStates[random() % 4], false };
+				graph.read(pass, resource, access.state);
+				accesses.push_back(access);
+			}
+
+			const uint32_t writeCount = 1 + random() % 2;
+			for (uint32_t i = 0; i < writeCount; ++i)
+			{
+				const uint32_t resource = random() % resourceCount;
+				if (isAccessed[resource])
+				{
+					continue;
+				}
+				isAccessed[resource] = true;
+				isWritten[resource] = true;
+				TestAccess access = { pass, resource, WriteStates[random() % 4], true };
+				graph.write(pass, resource, access.state);
+				accesses.push_back(access);
+			}
+
+			if (random() % 4 == 0)
+			{
+				graph.setSideEffect(pass);
+			}
+		}
+
+		REQUIRE(graph.compile());
+
+		// Lifetimes in schedule positions
+		const std::vector<uint32_t>& schedule = graph.getSchedule();
+		std::vector<uint32_t> firstUse(resourceCount, ~0u), lastUse(resourceCount, 0);
+		for (uint32_t position = 0; position < schedule.size(); ++position)
+		{
+			for (const TestAccess& access : accesses)
+			{
+				if (access.pass == schedule[position])
+				{
+					firstUse[access.resource] = std::min(firstUse[access.resource], position);
+					lastUse[access.resource] = std::max(lastUse[access.resource], position);
+				}
+			}
+		}
+		for (uint32_t x = importedCount; x < resourceCount; ++x)
+		{
+			const uint64_t offsetX = graph.getTransientOffset(x);
+			REQUIRE((offsetX == RenderGraph::InvalidOffset) == (firstUse[x] == ~0u));
+			if (offsetX == RenderGraph::InvalidOffset)
+			{
+				continue;
+			}
+			REQUIRE(offsetX % 256 == 0);
+			REQUIRE(offsetX + sizes[x] <= graph.getTransientHeapSize());
+			for (uint32_t y = x + 1; y < resourceCount; ++y)
+			{
+				const uint64_t offsetY = graph.getTransientOffset(y);
+				if (offsetY == RenderGraph::InvalidOffset)
+				{
+					continue;
+				}
+				const bool livesOverlap = firstUse[x] <= lastUse[y] && firstUse[y] <= lastUse[x];
+				const bool memoryOverlaps = offsetX < offsetY + sizes[y] && offsetY < offsetX + sizes[x];
+				REQUIRE(!(livesOverlap && memoryOverlaps));
+			}
+		}
+
+		CheckExecution(graph, accesses, initialStates, finalStates, sizes);
+	}
+}
+
+BENCHMARK(RenderGraph, Compile)
+{
+	const uint32_t compileCount = static_cast<uint32_t>(2000 * Test::GetBenchmarkScale()) + 1;
+
+	// A deferred-style chain: each pass reads the previous two targets and writes one
+	RenderGraph graph;
+	const uint32_t backBuffer = graph.importResource("BackBuffer", RenderGraphState::Present, RenderGraphState::Present);
+	std::vector<uint32_t> targets;
+	for (uint32_t i = 0; i < 64; ++i)
+	{
+		targets.push_back(graph.createTransient("Target", 1024 * 1024 * (1 + i % 4), 65536));
+	}
+	for (uint32_t i = 0; i < 64; ++i)
+	{
+		const uint32_t pass = graph.addPass("Pass", NoExecute);
+		for (uint32_t back = 1; back <= 2 && back <= i; ++back)
+		{
+			graph.read(pass, targets[i - back], RenderGraphState::PixelShaderResource);
+		}
+		graph.write(pass, targets[i], RenderGraphState::RenderTarget);
+	}
+	const uint32_t present = graph.addPass("Present", NoExecute);
+	graph.read(present, targets.back(), RenderGraphState::PixelShaderResource);
+	graph.write(present, backBuffer, RenderGraphState::RenderTarget);
+
+	const int64_t begin = Test::GetTime();
+	for (uint32_t i = 0; i < compileCount; ++i)
+	{
+		graph.compile();
+	}
+	const int64_t end = Test::GetTime();
+
+	Test::Report("RenderGraph::compile, 65 passes", compileCount, end - begin);
+	Test::Consume(graph.getTransientHeapSize());
+}
@@ -0,0 +1,167 @@
+#include "TestFramework.h"
+
+#include <cmath>
+#include <random>
+
+#include "ResolutionController.h"
+
+namespace
+{
+	bool Near(float a, float b)
+	{
+		return std::fabs(a - b) < 1.0e-4f;
+	}
+
+	// GPU time growing with the pixel count: fullTime at scale 1
+	float ModelFrameTime(float fullTime, float scale)
+	{
+		return fullTime * scale * scale;
+	}
+}
+
+TEST_CASE(ResolutionController, StaysInsideBand)
+{
+	ResolutionController controller;
+	controller.initialize(ResolutionSettings::Default());
+
+	const float target = controller.getSettings().targetFrameTime;
+	for (uint32_t frame = 0; frame < 500; ++frame)
+	{
+		// Swings up to 9% around the target, inside the 10% hysteresis
+		controller.update(target * ((frame & 1) ? 1.09f : 0.91f));
+	}
+	CHECK(Near(controller.getScale(), 1.0f));
+	CHECK(controller.getChangeCount() == 0);
+}
+
+TEST_CASE(ResolutionController, DropsStraightToFittingScale)
+{
+	ResolutionController controller;
+	controller.initialize(ResolutionSettings::Default());
+	const ResolutionSettings& settings = controller.getSettings();
+
+	// Twice the budget: sqrt(1/2) = 0.707 rounds down to 0.70 in one change
+	CHECK(Near(controller.update(settings.targetFrameTime * 2.0f), 0.70f));
+	CHECK(controller.getChangeCount() == 1);
+
+	// Frames still in flight at the old scale are ignored while settling
+	for (uint32_t frame = 0; frame < settings.settleFrames; ++frame)
+	{
+		CHECK(Near(controller.update(settings.targetFrameTime * 4.0f), 0.70f));
+	}
+	CHECK(controller.getChangeCount() == 1);
+
+	// Barely over budget still drops at least one step
+	CHECK(Near(controller.update(settings.targetFrameTime * 1.11f), 0.65f));
+}
+
+TEST_CASE(ResolutionController, ClampsToRange)
+{
+	ResolutionController controller;
+	controller.initialize(ResolutionSettings::Default());
+	const ResolutionSettings& settings = controller.getSettings();
+
+	for (uint32_t frame = 0; frame < 100; ++frame)
+	{
+		controller.update(settings.targetFrameTime * 100.0f);
+	}
+	CHECK(Near(controller.getScale(), settings.minScale));
+
+	for (uint32_t frame = 0; frame < 1000; ++frame)
+	{
+		controller.update(0.1f);
+	}
+	CHECK(Near(controller.getScale(), settings.maxScale));
+}
+
+/// <summary>
+/// A scene costing 1.8 times the budget at full scale settles on the largest scale that fits
+/// instead of bouncing between two steps.
+/// </summary>
+TEST_CASE(ResolutionController, SettlesWithoutOscillating)
+{
+	ResolutionController controller;
+	controller.initialize(ResolutionSettings::Default());
+	const ResolutionSettings& settings = controller.getSettings();
+	const float fullTime = settings.targetFrameTime * 1.8f;
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> jitter(0.97f, 1.03f);
+
+	float scale = controller.getScale();
+	for (uint32_t frame = 0; frame < 2000; ++frame)
+	{
+		scale = controller.update(ModelFrameTime(fullTime, scale) * jitter(random));
+	}
+
+	// 0.75 costs 1.8 * 0.5625 = 1.01 of the budget; 0.80 would cost 1.15, over the band
+	CHECK(Near(scale, 0.75f));
+	CHECK(controller.getChangeCount() <= 3);
+	CHECK(ModelFrameTime(fullTime, scale) < settings.targetFrameTime * (1.0f + settings.hysteresis));
+}
+
+TEST_CASE(ResolutionController, ClimbsOneStepAtATime)
+{
+	ResolutionController controller;
+	controller.initialize(ResolutionSettings::Default());
+	const ResolutionSettings& settings = controller.getSettings();
+
+	controller.update(settings.targetFrameTime * 100.0f);
+	CHECK(Near(controller.getScale(), settings.minScale));
+
+	// The load disappears: each change is a single step up
+	float previous = controller.getScale();
+	uint32_t changeCount = controller.getChangeCount();
+	for (uint32_t frame = 0; frame < 200; ++frame)
+	{
+		const float scale = controller.update(1.0f);
+		if (controller.getChangeCount() != changeCount)
+		{
+			CHECK(Near(scale - previous, settings.scaleStep));
+			changeCount = controller.getChangeCount();
+		}
+		previous = scale;
+	}
+	CHECK(Near(controller.getScale(), settings.maxScale));
+}
+
+TEST_CASE(ResolutionController, SanitizesSettingsAndSizes)
+{
+	ResolutionSettings settings = ResolutionSettings::Default();
+	settings.minScale = 0.9f;
+	settings.maxScale = 0.8f;
+	settings.scaleStep = 0.0f;
+
+	ResolutionController controller;
+	controller.initialize(settings);
+	CHECK(Near(controller.getSettings().minScale, 0.8f));
+	CHECK(Near(controller.getScale(), 0.8f));
+	controller.update(settings.targetFrameTime * 10.0f);
+	CHECK(Near(controller.getScale(), 0.8f));
+
+	controller.initialize(ResolutionSettings::Default());
+	controller.update(settings.targetFrameTime * 100.0f);
+	CHECK(controller.getScaledSize(1920) == 960);
+	CHECK(controller.getScaledSize(1) == 1);
+
+	controller.reset();
+	CHECK(Near(controller.getScale(), 1.0f));
+	CHECK(controller.getScaledSize(1080) == 1080);
+}
+
+BENCHMARK(ResolutionController, Update)
+{
+	ResolutionController controller;
+	controller.initialize(ResolutionSettings::Default());
+	const float fullTime = controller.getSettings().targetFrameTime * 1.8f;
+
+	const uint32_t frameCount = static_cast<uint32_t>(1000000 * Test::GetBenchmarkScale());
+	float scale = controller.getScale();
+	const int64_t start = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		scale = controller.update(ModelFrameTime(fullTime, scale) * ((frame & 1) ? 1.02f : 0.98f));
+	}
+	Test::Report("update", frameCount, Test::GetTime() - start);
+	Test::Consume(controller.getChangeCount());
+}
@@ -0,0 +1,265 @@
+#include "TestFramework.h"
+
+#include <string>
+#include <vector>
+
+#include "RootSignatureBuilder.h"
+
+#ifndef _WIN32
+// d3d12.lib exists only on Windows. The builder is checked up to the desc it hands over,
+// so elsewhere serialization only records that it was reached.
+namespace
+{
+	uint32_t gSerializeCount = 0;
+}
+
+HRESULT D3D12SerializeRootSignature(const D3D12_ROOT_SIGNATURE_DESC*, D3D_ROOT_SIGNATURE_VERSION, ID3DBlob** ppBlob, ID3DBlob** ppErrorBlob)
+{
+	++gSerializeCount;
+	*ppBlob = nullptr;
+	if (ppErrorBlob != nullptr)
+	{
+		*ppErrorBlob = nullptr;
+	}
+	return S_OK;
+}
+#endif
+
+namespace
+{
+	D3D12_DESCRIPTOR_RANGE MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE type, uint32_t count, uint32_t baseRegister)
+	{
+		D3D12_DESCRIPTOR_RANGE range{};
+		range.RangeType = type;
+		range.NumDescriptors = count;
+		range.BaseShaderRegister = baseRegister;
+		range.RegisterSpace = 0;
+		range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+		return range;
+	}
+
+	bool Contains(const std::string& text, const std::string& pattern)
+	{
+		return text.find(pattern) != std::string::npos;
+	}
+}
+
+TEST_CASE(RootSignatureBuilder, ParameterCosts)
+{
+	RootSignatureBuilder builder;
+	CHECK(builder.getCost() == 0);
+
+	// Constants cost one DWORD per value
+	CHECK(builder.addConstants(1, 0, 0, D3D12_SHADER_VISIBILITY_ALL) == 0);
+	CHECK(builder.getCost() == 1);
+	CHECK(builder.addConstants(16, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX) == 1);
+	CHECK(builder.getCost() == 17);
+
+	// Root descriptors are 64-bit addresses
+	CHECK(builder.addCBV(2, 0, D3D12_SHADER_VISIBILITY_ALL) == 2);
+	CHECK(builder.getCost() == 19);
+	CHECK(builder.addSRV(0, 0, D3D12_SHADER_VISIBILITY_PIXEL) == 3);
+	CHECK(builder.getCost() == 21);
+	CHECK(builder.addUAV(0, 0, D3D12_SHADER_VISIBILITY_ALL) == 4);
+	CHECK(builder.getCost() == 23);
+
+	// A table costs one DWORD however many ranges it holds
+	const D3D12_DESCRIPTOR_RANGE ranges[] =
+	{
+		MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 0),
+		MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 0),
+		MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 3),
+	};
+	CHECK(builder.addTable(ranges, 3, D3D12_SHADER_VISIBILITY_ALL) == 5);
+	CHECK(builder.getCost() == 24);
+	CHECK(builder.addTable(ranges, 1, D3D12_SHADER_VISIBILITY_ALL) == 6);
+	CHECK(builder.getCost() == 25);
+
+	// Static samplers are free
+	D3D12_STATIC_SAMPLER_DESC sampler{};
+	sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	builder.addStaticSampler(sampler);
+	CHECK(builder.getCost() == 25);
+	CHECK(builder.getParameterCount() == 7);
+	CHECK(builder.validate());
+	CHECK(builder.getError().empty());
+
+	D3D12_ROOT_PARAMETER parameter{};
+	parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	parameter.Constants.Num32BitValues = 7;
+	CHECK(RootSignatureBuilder::GetParameterCost(parameter) == 7);
+	parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+	CHECK(RootSignatureBuilder::GetParameterCost(parameter) == 2);
+	parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	CHECK(RootSignatureBuilder::GetParameterCost(parameter) == 2);
+	parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	CHECK(RootSignatureBuilder::GetParameterCost(parameter) == 2);
+	parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	CHECK(RootSignatureBuilder::GetParameterCost(parameter) == 1);
+}
+
+TEST_CASE(RootSignatureBuilder, RejectsOverSixtyFourDwords)
+{
+	// 60 + 2 + 1 + 1 = 64: exactly at the limit
+	RootSignatureBuilder builder;
+	builder.addConstants(60, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+	builder.addCBV(1, 0, D3D12_SHADER_VISIBILITY_ALL);
+	const D3D12_DESCRIPTOR_RANGE range = MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	builder.addTable(&range, 1, D3D12_SHADER_VISIBILITY_ALL);
+	builder.addTable(&range, 1, D3D12_SHADER_VISIBILITY_PIXEL);
+	CHECK(builder.getCost() == RootSignatureBuilder::MaxCost);
+	CHECK(builder.validate());
+
+	D3D12_ROOT_SIGNATURE_DESC desc{};
+	CHECK(builder.build(&desc) == S_OK);
+
+	// One more DWORD is refused, and build leaves the desc alone
+	builder.addConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_ALL);
+	CHECK(builder.getCost() == 65);
+	CHECK(!builder.validate());
+	CHECK(Contains(builder.getError(), "65 DWORDs"));
+	CHECK(Contains(builder.getError(), "64"));
+
+	D3D12_ROOT_SIGNATURE_DESC rejected{};
+	rejected.NumParameters = 12345;
+	CHECK(builder.build(&rejected) == E_INVALIDARG);
+	CHECK(rejected.NumParameters == 12345);
+	CHECK(rejected.pParameters == nullptr);
+
+	// Root descriptors alone: 32 fit, the 33rd does not
+	RootSignatureBuilder descriptors;
+	for (uint32_t i = 0; i < 32; ++i)
+	{
+		descriptors.addSRV(i, 0, D3D12_SHADER_VISIBILITY_ALL);
+	}
+	CHECK(descriptors.validate());
+	descriptors.addUAV(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+	CHECK(!descriptors.validate());
+	CHECK(descriptors.getCost() == 66);
+}
+
+TEST_CASE(RootSignatureBuilder, RejectsEmptyParameters)
+{
+	const D3D12_DESCRIPTOR_RANGE range = MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+
+	RootSignatureBuilder zeroConstants;
+	zeroConstants.addCBV(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+	zeroConstants.addConstants(0, 1, 0, D3D12_SHADER_VISIBILITY_ALL);
+	CHECK(zeroConstants.getCost() == 2);
+	CHECK(!zeroConstants.validate());
+	CHECK(Contains(zeroConstants.getError(), "root parameter 1"));
+	CHECK(Contains(zeroConstants.getError(), "no constants"));
+
+	RootSignatureBuilder emptyTable;
+	emptyTable.addTable(&range, 1, D3D12_SHADER_VISIBILITY_ALL);
+	emptyTable.addTable(nullptr, 0, D3D12_SHADER_VISIBILITY_ALL);
+	CHECK(emptyTable.getCost() == 2);
+	CHECK(!emptyTable.validate());
+	CHECK(Contains(emptyTable.getError(), "root parameter 1"));
+	CHECK(Contains(emptyTable.getError(), "table without ranges"));
+
+	D3D12_ROOT_SIGNATURE_DESC desc{};
+	CHECK(emptyTable.build(&desc) == E_INVALIDARG);
+
+	// A layout with no parameters at all is valid
+	RootSignatureBuilder empty;
+	CHECK(empty.validate());
+	CHECK(empty.build(&desc) == S_OK);
+	CHECK(desc.NumParameters == 0);
+	CHECK(desc.pParameters == nullptr);
+	CHECK(desc.NumStaticSamplers == 0);
+	CHECK(desc.pStaticSamplers == nullptr);
+}
+
+/// <summary>
+/// Tables are added before parameters that reallocate the builder's storage, and from ranges that
+/// change afterwards. build must point every table at the builder's own copy of its ranges.
+/// </summary>
+TEST_CASE(RootSignatureBuilder, BuildFixesUpRangePointers)
+{
+	RootSignatureBuilder builder;
+	builder.setFlags(D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	std::vector<D3D12_DESCRIPTOR_RANGE> ranges =
+	{
+		MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 8, 0),
+		MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 1),
+	};
+	builder.addConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+	const uint32_t first = builder.addTable(ranges.data(), 2, D3D12_SHADER_VISIBILITY_ALL);
+
+	// The caller's ranges change and go away
+	ranges[0].NumDescriptors = 999;
+	ranges.assign(1, MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 3, 5));
+	const uint32_t second = builder.addTable(ranges.data(), 1, D3D12_SHADER_VISIBILITY_PIXEL);
+	ranges.clear();
+	ranges.shrink_to_fit();
+
+	// Enough parameters after the tables to move the parameter and range storage
+	for (uint32_t i = 0; i < 10; ++i)
+	{
+		builder.addSRV(i, 2, D3D12_SHADER_VISIBILITY_ALL);
+	}
+	D3D12_STATIC_SAMPLER_DESC sampler{};
+	sampler.ShaderRegister = 3;
+	builder.addStaticSampler(sampler);
+
+	D3D12_ROOT_SIGNATURE_DESC desc{};
+	REQUIRE(builder.build(&desc) == S_OK);
+	CHECK(desc.Flags == D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	REQUIRE(desc.NumParameters == 13);
+	REQUIRE(desc.NumStaticSamplers == 1);
+	CHECK(desc.pStaticSamplers[0].ShaderRegister == 3);
+
+	const D3D12_ROOT_PARAMETER& firstTable = desc.pParameters[first];
+	CHECK(firstTable.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE);
+	REQUIRE(firstTable.DescriptorTable.NumDescriptorRanges == 2);
+	CHECK(firstTable.DescriptorTable.pDescriptorRanges[0].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SRV);
+	CHECK(firstTable.DescriptorTable.pDescriptorRanges[0].NumDescriptors == 8);
+	CHECK(firstTable.DescriptorTable.pDescriptorRanges[1].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_UAV);
+	CHECK(firstTable.DescriptorTable.pDescriptorRanges[1].BaseShaderRegister == 1);
+
+	const D3D12_ROOT_PARAMETER& secondTable = desc.pParameters[second];
+	CHECK(secondTable.ShaderVisibility == D3D12_SHADER_VISIBILITY_PIXEL);
+	REQUIRE(secondTable.DescriptorTable.NumDescriptorRanges == 1);
+	CHECK(secondTable.DescriptorTable.pDescriptorRanges[0].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV);
+	CHECK(secondTable.DescriptorTable.pDescriptorRanges[0].NumDescriptors == 3);
+	CHECK(secondTable.DescriptorTable.pDescriptorRanges[0].BaseShaderRegister == 5);
+	CHECK(firstTable.DescriptorTable.pDescriptorRanges != secondTable.DescriptorTable.pDescriptorRanges);
+
+	// Other parameters are left as added
+	CHECK(desc.pParameters[0].Constants.Num32BitValues == 4);
+	CHECK(desc.pParameters[12].ParameterType == D3D12_ROOT_PARAMETER_TYPE_SRV);
+	CHECK(desc.pParameters[12].Descriptor.ShaderRegister == 9);
+	CHECK(desc.pParameters[12].Descriptor.RegisterSpace == 2);
+
+	// Building again after more parameters repoints the tables at the moved storage
+	for (uint32_t i = 0; i < 20; ++i)
+	{
+		const D3D12_DESCRIPTOR_RANGE range = MakeRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, i + 1, i);
+		builder.addTable(&range, 1, D3D12_SHADER_VISIBILITY_ALL);
+	}
+	REQUIRE(builder.build(&desc) == S_OK);
+	REQUIRE(desc.NumParameters == 33);
+	CHECK(desc.pParameters[first].DescriptorTable.pDescriptorRanges[1].NumDescriptors == 2);
+	CHECK(desc.pParameters[32].DescriptorTable.pDescriptorRanges[0].NumDescriptors == 20);
+}
+
+TEST_CASE(RootSignatureBuilder, SerializeOnlyValidLayouts)
+{
+	ID3DBlob* pSignature = nullptr;
+	ID3DBlob* pError = nullptr;
+
+	RootSignatureBuilder invalid;
+	invalid.addConstants(65, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+	CHECK(invalid.serialize(&pSignature, &pError) == E_INVALIDARG);
+	CHECK(pSignature == nullptr);
+
+#ifndef _WIN32
+	const uint32_t serializeCount = gSerializeCount;
+	RootSignatureBuilder valid;
+	valid.addConstants(1, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+	CHECK(valid.serialize(&pSignature, &pError) == S_OK);
+	CHECK(gSerializeCount == serializeCount + 1);
+#endif
+}
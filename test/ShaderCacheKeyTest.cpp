@@ -0,0 +1,295 @@
+#include "TestFramework.h"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ShaderCacheKey.h"
+
+namespace
+{
+	// Shader sources by name, standing in for the shader directory.
+	struct SourceMap
+	{
+		std::map<std::string, std::string> files;
+		uint32_t loadCount = 0;
+
+		ShaderSourceLoader loader()
+		{
+			return [this](const std::string& name, std::string* pSource)
+			{
+				++loadCount;
+				auto it = files.find(name);
+				if (it == files.end())
+				{
+					return false;
+				}
+				*pSource = it->second;
+				return true;
+			};
+		}
+	};
+
+	std::vector<std::string> Scan(const std::string& source)
+	{
+		std::vector<std::string> includes;
+		ScanShaderIncludes(source, includes);
+		return includes;
+	}
+
+	ShaderDesc TestDesc()
+	{
+		ShaderDesc desc;
+		desc.file = "shaders.hlsl";
+		desc.entryPoint = "PSMain";
+		desc.target = "ps_5_1";
+		desc.defines = { { "USE_SHADOWS", "1" } };
+		desc.flags = 0;
+		return desc;
+	}
+
+	SourceMap TestSources()
+	{
+		SourceMap sources;
+		sources.files["shaders.hlsl"] = "#include \"common.hlsli\"\n#include \"lighting.hlsli\"\nfloat4 PSMain() : SV_Target { return Light(); }\n";
+		sources.files["common.hlsli"] = "#define PI 3.14159\n";
+		sources.files["lighting.hlsli"] = "#include \"common.hlsli\"\nfloat4 Light() { return PI; }\n";
+		return sources;
+	}
+
+	uint64_t Hash(const ShaderDesc& desc, SourceMap& sources)
+	{
+		uint64_t hash = 0;
+		const bool isHashed = HashShader(desc, sources.loader(), &hash);
+		CHECK(isHashed);
+		return hash;
+	}
+}
+
+TEST_CASE(ShaderCacheKey, ScanFindsIncludesInOrder)
+{
+	const std::vector<std::string> includes = Scan(
+		"#include \"a.hlsli\"\n"
+		"  #  include <b.hlsli>\n"
+		"\t#include\t\"dir/c.hlsli\"\r\n"
+		"#ifdef X\n"
+		"#include \"conditional.hlsli\"\n"
+		"#endif\n");
+	REQUIRE(includes.size() == 4);
+	CHECK(includes[0] == "a.hlsli");
+	CHECK(includes[1] == "b.hlsli");
+	CHECK(includes[2] == "dir/c.hlsli");
+	CHECK(includes[3] == "conditional.hlsli");
+}
+
+TEST_CASE(ShaderCacheKey, ScanSkipsCommentsAndStrings)
+{
+	const std::vector<std::string> includes = Scan(
+		"// #include \"line_comment.hlsli\"\n"
+		"/* #include \"block_comment.hlsli\"\n"
+		"#include \"inside_block.hlsli\" */\n"
+		"static const char* s = \"\\\"#include \\\"in_string.hlsli\\\"\";\n"
+		"\"\n#include \"after_unterminated_string.hlsli\"\n"
+		"float x; #include \"not_line_start.hlsli\"\n"
+		"#includes \"wrong_keyword.hlsli\"\n"
+		"#include \"unterminated.hlsli\n"
+		"#include \"kept.hlsli\" // #include \"trailing.hlsli\"\n"
+		"/* a */ #include \"after_comment.hlsli\"\n");
+	REQUIRE(includes.size() == 3);
+	CHECK(includes[0] == "after_unterminated_string.hlsli");
+	CHECK(includes[1] == "kept.hlsli");
+	CHECK(includes[2] == "after_comment.hlsli");
+
+	// A comment that never closes hides the rest of the file
+	CHECK(Scan("/* #include \"a.hlsli\"\n#include \"b.hlsli\"\n").empty());
+}
+
+TEST_CASE(ShaderCacheKey, HashCoversSourcesAndDependencies)
+{
+	SourceMap sources = TestSources();
+	const ShaderDesc desc = TestDesc();
+
+	uint64_t hash = 0;
+	std::vector<std::string> dependencies;
+	REQUIRE(HashShader(desc, sources.loader(), &hash, &dependencies));
+	// Depth first in include order; common.hlsli is read once although it is included twice
+	REQUIRE(dependencies.size() == 3);
+	CHECK(dependencies[0] == "shaders.hlsl");
+	CHECK(dependencies[1] == "common.hlsli");
+	CHECK(dependencies[2] == "lighting.hlsli");
+	CHECK(Hash(desc, sources) == hash);
+
+	// An edit to any file, even one only included indirectly, changes the key
+	for (const auto& file : TestSources().files)
+	{
+		SourceMap edited = TestSources();
+		edited.files[file.first] += "\n// edited\n";
+		CHECK(Hash(desc, edited) != hash);
+	}
+
+	// A missing include fails instead of giving a key
+	SourceMap missing = TestSources();
+	missing.files.erase("lighting.hlsli");
+	uint64_t missingHash = 0;
+	CHECK(!HashShader(desc, missing.loader(), &missingHash));
+}
+
+TEST_CASE(ShaderCacheKey, HashCoversDescription)
+{
+	SourceMap sources = TestSources();
+	const uint64_t hash = Hash(TestDesc(), sources);
+
+	std::vector<ShaderDesc> descs(7, TestDesc());
+	descs[0].entryPoint = "VSMain";
+	descs[1].target = "ps_6_0";
+	descs[2].flags = 1;
+	descs[3].defines[0].value = "0";
+	descs[4].defines[0].name = "USE_SHADOW";
+	descs[5].defines.push_back({ "USE_FOG", "1" });
+	descs[6].defines.clear();
+
+	std::vector<uint64_t> hashes;
+	for (const ShaderDesc& desc : descs)
+	{
+		hashes.push_back(Hash(desc, sources));
+		CHECK(hashes.back() != hash);
+	}
+	for (size_t i = 0; i < hashes.size(); ++i)
+	{
+		for (size_t j = i + 1; j < hashes.size(); ++j)
+		{
+			CHECK(hashes[i] != hashes[j]);
+		}
+	}
+
+	// Moving characters between a define's name and value is a different key
+	ShaderDesc left = TestDesc();
+	left.defines[0] = { "AB", "C" };
+	ShaderDesc right = TestDesc();
+	right.defines[0] = { "A", "BC" };
+	CHECK(Hash(left, sources) != Hash(right, sources));
+}
+
+TEST_CASE(ShaderCacheKey, HashTerminatesOnIncludeCycles)
+{
+	SourceMap sources;
+	sources.files["a.hlsl"] = "#include \"b.hlsli\"\n";
+	sources.files["b.hlsli"] = "#include \"c.hlsli\"\n#include \"a.hlsl\"\n";
+	sources.files["c.hlsli"] = "#include \"b.hlsli\"\n#include \"c.hlsli\"\n";
+
+	ShaderDesc desc = TestDesc();
+	desc.file = "a.hlsl";
+
+	uint64_t hash = 0;
+	std::vector<std::string> dependencies;
+	REQUIRE(HashShader(desc, sources.loader(), &hash, &dependencies));
+	CHECK(dependencies.size() == 3);
+	CHECK(sources.loadCount == 3);
+
+	sources.files["c.hlsli"] += "// edited\n";
+	CHECK(Hash(desc, sources) != hash);
+}
+
+TEST_CASE(ShaderCacheKey, FormatHash)
+{
+	CHECK(FormatShaderHash(0) == "0000000000000000");
+	CHECK(FormatShaderHash(0x0123456789abcdefull) == "0123456789abcdef");
+	CHECK(FormatShaderHash(~0ull) == "ffffffffffffffff");
+}
+
+TEST_CASE(ShaderCacheEntry, RoundTrip)
+{
+	const uint8_t bytecode[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4, 5, 6, 7, 8 };
+	std::vector<uint8_t> entry;
+	ShaderCacheEntry::Write(42, bytecode, sizeof(bytecode), entry);
+	CHECK(entry.size() == ShaderCacheEntry::HeaderSize + sizeof(bytecode));
+
+	const uint8_t* pBytecode = nullptr;
+	size_t size = 0;
+	REQUIRE(ShaderCacheEntry::Parse(entry.data(), entry.size(), 42, &pBytecode, &size));
+	CHECK(pBytecode == entry.data() + ShaderCacheEntry::HeaderSize);
+	CHECK(size == sizeof(bytecode));
+	CHECK(memcmp(pBytecode, bytecode, sizeof(bytecode)) == 0);
+
+	// Empty bytecode is still a valid entry
+	ShaderCacheEntry::Write(7, nullptr, 0, entry);
+	CHECK(ShaderCacheEntry::Parse(entry.data(), entry.size(), 7, &pBytecode, &size));
+	CHECK(size == 0);
+}
+
+/// <summary>
+/// Each header field and every bytecode byte is checked; nothing is written to the outputs on failure.
+/// </summary>
+TEST_CASE(ShaderCacheEntry, RejectsDamagedEntries)
+{
+	const uint8_t bytecode[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4, 5, 6, 7, 8 };
+	std::vector<uint8_t> valid;
+	ShaderCacheEntry::Write(42, bytecode, sizeof(bytecode), valid);
+
+	const uint8_t* pBytecode = nullptr;
+	size_t size = 0;
+	const auto parse = [&pBytecode, &size](const std::vector<uint8_t>& entry, uint64_t key)
+	{
+		return ShaderCacheEntry::Parse(entry.data(), entry.size(), key, &pBytecode, &size);
+	};
+
+	// Asked for another key
+	CHECK(!parse(valid, 43));
+
+	// Flipping any byte: magic (0-3), version (4-7), key (8-15), size (16-23), checksum (24-31) or bytecode
+	uint32_t acceptedCount = 0;
+	for (size_t i = 0; i < valid.size(); ++i)
+	{
+		std::vector<uint8_t> damaged = valid;
+		damaged[i] ^= 0x10;
+		acceptedCount += parse(damaged, 42) ? 1 : 0;
+	}
+	CHECK(acceptedCount == 0);
+
+	// Truncated, or with bytes past the declared size
+	for (size_t length = 0; length < valid.size(); ++length)
+	{
+		std::vector<uint8_t> truncated(valid.begin(), valid.begin() + length);
+		acceptedCount += parse(truncated, 42) ? 1 : 0;
+	}
+	std::vector<uint8_t> extended = valid;
+	extended.push_back(0);
+	acceptedCount += parse(extended, 42) ? 1 : 0;
+	CHECK(acceptedCount == 0);
+
+	// A file from another format version with an otherwise valid header
+	std::vector<uint8_t> versioned = valid;
+	const uint32_t version = ShaderCacheEntry::FormatVersion + 1;
+	memcpy(&versioned[4], &version, sizeof(version));
+	CHECK(!parse(versioned, 42));
+
+	CHECK(pBytecode == nullptr);
+	CHECK(size == 0);
+}
+
+BENCHMARK(ShaderCacheKey, HashShader)
+{
+	SourceMap sources = TestSources();
+	// A source the size of a real shader file, with includes spread through it
+	std::string& main = sources.files["shaders.hlsl"];
+	for (uint32_t i = 0; i < 400; ++i)
+	{
+		main += "float4 Function" + std::to_string(i) + "(float4 x) { /* \"comment\" */ return x * " + std::to_string(i) + ".0; } // #include \"skip\"\n";
+	}
+
+	const uint32_t iterationCount = static_cast<uint32_t>(2000 * Test::GetBenchmarkScale());
+	const ShaderDesc desc = TestDesc();
+	const ShaderSourceLoader loader = sources.loader();
+
+	uint64_t total = 0;
+	const int64_t start = Test::GetTime();
+	for (uint32_t i = 0; i < iterationCount; ++i)
+	{
+		uint64_t hash = 0;
+		HashShader(desc, loader, &hash);
+		total += hash;
+	}
+	Test::Report("hash shader", iterationCount, Test::GetTime() - start);
+	Test::Consume(total);
+}
@@ -0,0 +1,97 @@
+#include "TestFramework.h"
+
+#include <string>
+#include <vector>
+
+#include "ShaderKeywords.h"
+
+TEST_CASE(ShaderKeywords, BitsFollowDeclarationOrder)
+{
+	ShaderKeywordSet keywords = { "NORMAL_MAP", "ALPHA_TEST", "SKINNED" };
+	CHECK(keywords.getCount() == 3);
+	CHECK(keywords.getBit("NORMAL_MAP") == 0);
+	CHECK(keywords.getBit("ALPHA_TEST") == 1);
+	CHECK(keywords.getBit("SKINNED") == 2);
+	CHECK(keywords.getBit("FOG") == ShaderKeywordSet::InvalidBit);
+	CHECK(keywords.getName(1) == "ALPHA_TEST");
+	CHECK(keywords.getKeyMask() == 0x7);
+	CHECK(keywords.getVariantCount() == 8);
+
+	// A name already taken is refused
+	CHECK(keywords.add("SKINNED") == ShaderKeywordSet::InvalidBit);
+	CHECK(keywords.add("FOG") == 3);
+	CHECK(keywords.getCount() == 4);
+
+	const ShaderKeywordSet empty;
+	CHECK(empty.getKeyMask() == 0);
+	CHECK(empty.getVariantCount() == 1);
+}
+
+TEST_CASE(ShaderKeywords, MakeKey)
+{
+	const ShaderKeywordSet keywords = { "NORMAL_MAP", "ALPHA_TEST", "SKINNED" };
+	CHECK(keywords.makeKey({}) == 0);
+	CHECK(keywords.makeKey({ "SKINNED" }) == 0x4);
+	CHECK(keywords.makeKey({ "SKINNED", "NORMAL_MAP" }) == 0x5);
+	// Duplicates and unknown names change nothing
+	CHECK(keywords.makeKey({ "ALPHA_TEST", "ALPHA_TEST", "FOG" }) == 0x2);
+	CHECK(keywords.makeKey({ "FOG", "normal_map" }) == 0);
+}
+
+TEST_CASE(ShaderKeywords, GetDefines)
+{
+	const ShaderKeywordSet keywords = { "NORMAL_MAP", "ALPHA_TEST", "SKINNED" };
+
+	std::vector<ShaderDefine> defines;
+	keywords.getDefines(0, defines);
+	CHECK(defines.empty());
+
+	// Declaration order whatever order the key was made in, appended to what is there
+	defines.push_back({ "EXISTING", "2" });
+	keywords.getDefines(keywords.makeKey({ "SKINNED", "NORMAL_MAP" }), defines);
+	REQUIRE(defines.size() == 3);
+	CHECK(defines[0].name == "EXISTING");
+	CHECK(defines[1].name == "NORMAL_MAP" && defines[1].value == "1");
+	CHECK(defines[2].name == "SKINNED" && defines[2].value == "1");
+
+	// Bits past the declared keywords are ignored
+	defines.clear();
+	keywords.getDefines(0xfff0 | 0x2, defines);
+	REQUIRE(defines.size() == 1);
+	CHECK(defines[0].name == "ALPHA_TEST");
+}
+
+TEST_CASE(ShaderKeywords, MaxKeywordsLimit)
+{
+	ShaderKeywordSet keywords;
+	for (uint32_t i = 0; i < ShaderKeywordSet::MaxKeywords; ++i)
+	{
+		CHECK(keywords.add("KEYWORD_" + std::to_string(i)) == i);
+	}
+	CHECK(keywords.getCount() == 12);
+	CHECK(keywords.getKeyMask() == 0xfff);
+	CHECK(keywords.getVariantCount() == 4096);
+
+	// The thirteenth is refused and leaves the set as it was
+	CHECK(keywords.add("ONE_TOO_MANY") == ShaderKeywordSet::InvalidBit);
+	CHECK(keywords.getCount() == ShaderKeywordSet::MaxKeywords);
+	CHECK(keywords.makeKey({ "ONE_TOO_MANY" }) == 0);
+
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < ShaderKeywordSet::MaxKeywords; ++i)
+	{
+		names.push_back(keywords.getName(i));
+	}
+	const uint32_t key = keywords.makeKey(names);
+	CHECK(key == keywords.getKeyMask());
+
+	std::vector<ShaderDefine> defines;
+	keywords.getDefines(key, defines);
+	REQUIRE(defines.size() == ShaderKeywordSet::MaxKeywords);
+	CHECK(defines.back().name == "KEYWORD_11");
+
+	// The list constructor stops at the limit the same way
+	const ShaderKeywordSet listed = { "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M", "N" };
+	CHECK(listed.getCount() == ShaderKeywordSet::MaxKeywords);
+	CHECK(listed.getBit("M") == ShaderKeywordSet::InvalidBit);
+}
@@ -0,0 +1,324 @@
+#include "TestFramework.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ShaderPermutationManager.h"
+
+namespace
+{
+	// Hands out one object per key and counts builds, publishes and releases. Builds of the
+	// keys in the blocked mask wait for openGate(); the keys in the failed mask fail.
+	class VariantFactory
+	{
+	public:
+		explicit VariantFactory(uint32_t variantCount)
+			: mVariants(variantCount)
+			, mBuildCounts(variantCount)
+			, mPublishCounts(variantCount)
+			, mReleaseCounts(variantCount)
+			, mWrongReplacedCount(0)
+			, mBlockedMask(0)
+			, mFailedMask(0)
+			, mIsGateOpen(true)
+		{
+			for (uint32_t key = 0; key < variantCount; ++key)
+			{
+				mVariants[key] = key;
+				mBuildCounts[key].store(0);
+				mPublishCounts[key].store(0);
+				mReleaseCounts[key].store(0);
+			}
+		}
+
+		void setFailed(uint32_t mask) { mFailedMask = mask; }
+
+		void closeGate(uint32_t blockedMask)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBlockedMask = blockedMask;
+			mIsGateOpen = false;
+		}
+
+		void openGate()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mIsGateOpen = true;
+			}
+			mCondition.notify_all();
+		}
+
+		void* getVariant(uint32_t key) { return &mVariants[key]; }
+
+		bool initialize(ShaderPermutationManager& manager, const ShaderKeywordSet& keywords)
+		{
+			return manager.initialize(keywords,
+				[this](uint32_t key) { return build(key); },
+				[this](void* pVariant) { mReleaseCounts[*static_cast<uint32_t*>(pVariant)].fetch_add(1); },
+				[this](uint32_t key, void* pReplaced)
+				{
+					mPublishCounts[key].fetch_add(1);
+					if (pReplaced != getVariant(0))
+					{
+						mWrongReplacedCount.fetch_add(1);
+					}
+				});
+		}
+
+		uint32_t getBuildCount(uint32_t key) const { return mBuildCounts[key].load(); }
+		uint32_t getPublishCount(uint32_t key) const { return mPublishCounts[key].load(); }
+		uint32_t getReleaseCount(uint32_t key) const { return mReleaseCounts[key].load(); }
+		uint32_t getWrongReplacedCount() const { return mWrongReplacedCount.load(); }
+
+	private:
+		void* build(uint32_t key)
+		{
+			mBuildCounts[key].fetch_add(1);
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				if (mBlockedMask & (1u << key))
+				{
+					mCondition.wait(lock, [this]() { return mIsGateOpen; });
+				}
+			}
+			return (mFailedMask & (1u << key)) ? nullptr : getVariant(key);
+		}
+
+		std::vector<uint32_t> mVariants;
+		std::vector<std::atomic<uint32_t>> mBuildCounts;
+		std::vector<std::atomic<uint32_t>> mPublishCounts;
+		std::vector<std::atomic<uint32_t>> mReleaseCounts;
+		std::atomic<uint32_t> mWrongReplacedCount;
+
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		uint32_t mBlockedMask;
+		uint32_t mFailedMask;
+		bool mIsGateOpen;
+	};
+
+	const ShaderKeywordSet TestKeywords = { "NORMAL_MAP", "ALPHA_TEST", "SKINNED" };
+}
+
+TEST_CASE(ShaderPermutationManager, FailedBaseVariant)
+{
+	VariantFactory factory(TestKeywords.getVariantCount());
+	factory.setFailed(1u << 0);
+
+	ShaderPermutationManager manager;
+	CHECK(!factory.initialize(manager, TestKeywords));
+	CHECK(factory.getBuildCount(0) == 1);
+	manager.destroy();
+	CHECK(factory.getReleaseCount(0) == 0);
+}
+
+/// <summary>
+/// While a variant's build is held back acquire keeps returning the base variant,
+/// and switches over once the variant is Ready.
+/// </summary>
+TEST_CASE(ShaderPermutationManager, BaseVariantUntilReady)
+{
+	VariantFactory factory(TestKeywords.getVariantCount());
+	factory.closeGate(1u << 5);
+
+	ShaderPermutationManager manager;
+	REQUIRE(factory.initialize(manager, TestKeywords));
+	CHECK(manager.getState(0) == ShaderPermutationManager::Ready);
+	CHECK(manager.acquire(0) == factory.getVariant(0));
+
+	CHECK(manager.getState(5) == ShaderPermutationManager::Missing);
+	for (int i = 0; i < 100; ++i)
+	{
+		CHECK(manager.acquire(5) == factory.getVariant(0));
+	}
+	CHECK(manager.getState(5) == ShaderPermutationManager::Pending);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CHECK(manager.acquire(5) == factory.getVariant(0));
+	CHECK(factory.getPublishCount(5) == 0);
+
+	factory.openGate();
+	manager.flush();
+	CHECK(manager.getState(5) == ShaderPermutationManager::Ready);
+	CHECK(manager.acquire(5) == factory.getVariant(5));
+	// Bits outside the keyword set are dropped
+	CHECK(manager.acquire(5 | 0x100) == factory.getVariant(5));
+	CHECK(factory.getBuildCount(5) == 1);
+
+	manager.destroy();
+	CHECK(factory.getReleaseCount(0) == 1);
+	CHECK(factory.getReleaseCount(5) == 1);
+}
+
+TEST_CASE(ShaderPermutationManager, FailedVariantFallsBackToBase)
+{
+	VariantFactory factory(TestKeywords.getVariantCount());
+	factory.setFailed(1u << 3);
+
+	ShaderPermutationManager manager;
+	REQUIRE(factory.initialize(manager, TestKeywords));
+	CHECK(manager.acquire(3) == factory.getVariant(0));
+	manager.flush();
+
+	CHECK(manager.getState(3) == ShaderPermutationManager::Failed);
+	CHECK(factory.getPublishCount(3) == 0);
+	// Not retried
+	for (int i = 0; i < 10; ++i)
+	{
+		CHECK(manager.acquire(3) == factory.getVariant(0));
+	}
+	manager.flush();
+	CHECK(factory.getBuildCount(3) == 1);
+
+	// Other variants are unaffected
+	manager.acquire(2);
+	manager.flush();
+	CHECK(manager.acquire(2) == factory.getVariant(2));
+
+	manager.destroy();
+	CHECK(factory.getReleaseCount(3) == 0);
+	CHECK(factory.getReleaseCount(0) == 1);
+}
+
+/// <summary>
+/// Render threads acquire every variant at once; each is built and published exactly once,
+/// replacing the base variant.
+/// </summary>
+TEST_CASE(ShaderPermutationManager, ConcurrentAcquirePublishesOnce)
+{
+	const uint32_t variantCount = TestKeywords.getVariantCount();
+	VariantFactory factory(variantCount);
+
+	ShaderPermutationManager manager;
+	REQUIRE(factory.initialize(manager, TestKeywords));
+
+	std::atomic<uint32_t> wrongCount(0);
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (uint32_t i = 0; i < 20000; ++i)
+			{
+				const uint32_t key = (i + t) % variantCount;
+				void* pVariant = manager.acquire(key);
+				if (pVariant != factory.getVariant(key) && pVariant != factory.getVariant(0))
+				{
+					wrongCount.fetch_add(1);
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	manager.flush();
+
+	CHECK(wrongCount.load() == 0);
+	CHECK(factory.getWrongReplacedCount() == 0);
+	CHECK(factory.getBuildCount(0) == 1);
+	CHECK(factory.getPublishCount(0) == 0);
+	for (uint32_t key = 1; key < variantCount; ++key)
+	{
+		CHECK(manager.getState(key) == ShaderPermutationManager::Ready);
+		CHECK(factory.getBuildCount(key) == 1);
+		CHECK(factory.getPublishCount(key) == 1);
+	}
+
+	manager.destroy();
+	for (uint32_t key = 0; key < variantCount; ++key)
+	{
+		CHECK(factory.getReleaseCount(key) == 1);
+	}
+}
+
+/// <summary>
+/// destroy finishes the build in progress, drops the queued ones and joins the build thread;
+/// flush returns at once when nothing is queued.
+/// </summary>
+TEST_CASE(ShaderPermutationManager, FlushAndDestroyJoinBuildThread)
+{
+	const uint32_t variantCount = TestKeywords.getVariantCount();
+	VariantFactory factory(variantCount);
+
+	ShaderPermutationManager manager;
+	REQUIRE(factory.initialize(manager, TestKeywords));
+	manager.flush();
+
+	factory.closeGate(~1u);
+	for (uint32_t key = 1; key < variantCount; ++key)
+	{
+		manager.acquire(key);
+	}
+
+	// flush waits for the held build
+	std::atomic<bool> isFlushed(false);
+	std::thread flusher([&]()
+	{
+		manager.flush();
+		isFlushed.store(true);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(!isFlushed.load());
+	CHECK(factory.getBuildCount(1) == 1);
+	CHECK(factory.getBuildCount(2) == 0);
+
+	// destroy waits as well, until the build in progress returns
+	std::atomic<bool> isDestroyed(false);
+	std::thread destroyer([&]()
+	{
+		manager.destroy();
+		isDestroyed.store(true);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(!isDestroyed.load());
+
+	factory.openGate();
+	destroyer.join();
+	flusher.join();
+	CHECK(isFlushed.load());
+
+	// Only the build that had started ran; its variant and the base one were released
+	for (uint32_t key = 2; key < variantCount; ++key)
+	{
+		CHECK(factory.getBuildCount(key) == 0);
+	}
+	CHECK(factory.getReleaseCount(0) == 1);
+	CHECK(factory.getReleaseCount(1) == 1);
+
+	// Destroying again, or reinitializing, is fine
+	manager.destroy();
+	REQUIRE(factory.initialize(manager, TestKeywords));
+	CHECK(factory.getBuildCount(0) == 2);
+	manager.destroy();
+	CHECK(factory.getReleaseCount(0) == 2);
+}
+
+BENCHMARK(ShaderPermutationManager, Acquire)
+{
+	const uint32_t variantCount = TestKeywords.getVariantCount();
+	VariantFactory factory(variantCount);
+
+	ShaderPermutationManager manager;
+	factory.initialize(manager, TestKeywords);
+	for (uint32_t key = 0; key < variantCount; ++key)
+	{
+		manager.acquire(key);
+	}
+	manager.flush();
+
+	const uint32_t iterationCount = static_cast<uint32_t>(10000000 * Test::GetBenchmarkScale());
+	uintptr_t total = 0;
+	const int64_t start = Test::GetTime();
+	for (uint32_t i = 0; i < iterationCount; ++i)
+	{
+		total += reinterpret_cast<uintptr_t>(manager.acquire(i));
+	}
+	Test::Report("acquire ready variant", iterationCount, Test::GetTime() - start);
+	Test::Consume(total);
+}
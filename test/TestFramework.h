@@ -0,0 +1,57 @@
+#ifndef __TEST_TESTFRAMEWORK_H__
+#define __TEST_TESTFRAMEWORK_H__
+
+#include <chrono>
+#include <cstdint>
+
+// Self-registering unit tests and benchmarks for the device-free modules of main/.
+// A case is named "Suite.Name"; CoreTests runs every test whose name starts with one of its
+// arguments, and the benchmarks instead when given --bench.
+namespace Test
+{
+	typedef void (*Function)();
+
+	struct Registrar
+	{
+		Registrar(const char* suite, const char* name, Function function, bool isBenchmark);
+	};
+
+	// Records a failed check of the running test; the test goes on unless it returns.
+	void Fail(const char* file, int line, const char* expression);
+
+	// One benchmark result: count operations in nanoseconds, printed with the rate per second.
+	void Report(const char* name, uint64_t count, int64_t nanoseconds);
+
+	// Scale for benchmark sizes, below 1 for a quick run (--quick)
+	double GetBenchmarkScale();
+
+	inline int64_t GetTime()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Keeps a result alive so the measured work is not optimized away.
+	void Consume(uint64_t value);
+}
+
+#define TEST_CONCAT_INNER(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_INNER(a, b)
+
+#define TEST_CASE(suite, name) \
+	static void TEST_CONCAT(suite, TEST_CONCAT(_, name))(); \
+	static const Test::Registrar TEST_CONCAT(suite, TEST_CONCAT(_registrar_, name))(#suite, #name, &TEST_CONCAT(suite, TEST_CONCAT(_, name)), false); \
+	static void TEST_CONCAT(suite, TEST_CONCAT(_, name))()
+
+#define BENCHMARK(suite, name) \
+	static void TEST_CONCAT(suite, TEST_CONCAT(_, name))(); \
+	static const Test::Registrar TEST_CONCAT(suite, TEST_CONCAT(_registrar_, name))(#suite, #name, &TEST_CONCAT(suite, TEST_CONCAT(_, name)), true); \
+	static void TEST_CONCAT(suite, TEST_CONCAT(_, name))()
+
+#define CHECK(expression) \
+	do { if (!(expression)) { Test::Fail(__FILE__, __LINE__, #expression); } } while (false)
+
+// Ends the running test when the check fails, for checks the rest of the test depends on.
+#define REQUIRE(expression) \
+	do { if (!(expression)) { Test::Fail(__FILE__, __LINE__, #expression); return; } } while (false)
+
+#endif
@@ -0,0 +1,121 @@
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Case
+	{
+		std::string name;
+		Test::Function function;
+		bool isBenchmark;
+	};
+
+	// Function-local, so registrars of other translation units can run first
+	std::vector<Case>& GetCases()
+	{
+		static std::vector<Case> cases;
+		return cases;
+	}
+
+	uint32_t gFailureCount = 0;
+	double gBenchmarkScale = 1.0;
+	volatile uint64_t gSink = 0;
+
+	bool IsSelected(const std::string& name, const std::vector<const char*>& filters)
+	{
+		if (filters.empty())
+		{
+			return true;
+		}
+		for (const char* filter : filters)
+		{
+			if (name.compare(0, strlen(filter), filter) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+Test::Registrar::Registrar(const char* suite, const char* name, Function function, bool isBenchmark)
+{
+	Case entry = { std::string(suite) + "." + name, function, isBenchmark };
+	GetCases().push_back(entry);
+}
+
+void Test::Fail(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	++gFailureCount;
+}
+
+void Test::Report(const char* name, uint64_t count, int64_t nanoseconds)
+{
+	const double seconds = static_cast<double>(nanoseconds) / 1.0e9;
+	printf("  %-40s %12llu ops %10.3f ms %10.2f ns/op %14.0f ops/s\n", name, static_cast<unsigned long long>(count),
+		seconds * 1000.0, static_cast<double>(nanoseconds) / static_cast<double>(count), static_cast<double>(count) / seconds);
+}
+
+double Test::GetBenchmarkScale()
+{
+	return gBenchmarkScale;
+}
+
+void Test::Consume(uint64_t value)
+{
+	gSink = gSink + value;
+}
+
+/// <summary>
+/// CoreTests [--bench] [--quick] [Suite.Name prefix ...]
+/// Returns the number of failed tests, so ctest sees any failure.
+/// </summary>
+int main(int argc, char** argv)
+{
+	bool isBenchmark = false;
+	std::vector<const char*> filters;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--bench") == 0)
+		{
+			isBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--quick") == 0)
+		{
+			gBenchmarkScale = 0.01;
+		}
+		else
+		{
+			filters.push_back(argv[i]);
+		}
+	}
+
+	uint32_t runCount = 0;
+	uint32_t failedCount = 0;
+	for (const Case& entry : GetCases())
+	{
+		if (entry.isBenchmark != isBenchmark || !IsSelected(entry.name, filters))
+		{
+			continue;
+		}
+
+		printf("%s\n", entry.name.c_str());
+		fflush(stdout);
+
+		const uint32_t failureCount = gFailureCount;
+		entry.function();
+		++runCount;
+		if (gFailureCount != failureCount)
+		{
+			++failedCount;
+		}
+	}
+
+	printf("%u %s run, %u failed\n", runCount, isBenchmark ? "benchmarks" : "tests", failedCount);
+	return (runCount == 0) ? 1 : static_cast<int>(failedCount);
+}
@@ -0,0 +1,251 @@
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+namespace
+{
+	struct Allocation
+	{
+		uint32_t handle;
+		uint64_t size;
+		uint64_t alignment;
+	};
+
+	// Allocations lie inside the range, are aligned, do not overlap, and add up to the statistics.
+	void CheckConsistent(const TlsfAllocator& allocator, const std::vector<Allocation>& allocations)
+	{
+		std::vector<std::pair<uint64_t, uint64_t>> ranges;
+		uint64_t allocatedSize = 0;
+		for (const Allocation& allocation : allocations)
+		{
+			const uint64_t offset = allocator.getOffset(allocation.handle);
+			REQUIRE(offset % allocation.alignment == 0);
+			REQUIRE(allocator.getSize(allocation.handle) == allocation.size);
+			REQUIRE(offset + allocation.size <= allocator.getTotalSize());
+			ranges.push_back(std::make_pair(offset, offset + allocation.size));
+			allocatedSize += allocation.size;
+		}
+
+		std::sort(ranges.begin(), ranges.end());
+		for (size_t i = 1; i < ranges.size(); ++i)
+		{
+			REQUIRE(ranges[i - 1].second <= ranges[i].first);
+		}
+
+		const TlsfStatistics statistics = allocator.getStatistics();
+		REQUIRE(statistics.allocationCount == allocations.size());
+		REQUIRE(statistics.allocatedSize == allocatedSize);
+	}
+}
+
+TEST_CASE(TlsfAllocator, FreeCoalescesNeighbours)
+{
+	TlsfAllocator allocator;
+	allocator.initialize(1024);
+
+	const uint32_t a = allocator.allocate(256, 1);
+	const uint32_t b = allocator.allocate(256, 1);
+	const uint32_t c = allocator.allocate(256, 1);
+	const uint32_t d = allocator.allocate(256, 1);
+	CHECK(allocator.getOffset(a) == 0 && allocator.getOffset(d) == 768);
+	CHECK(allocator.allocate(1, 1) == TlsfAllocator::InvalidHandle);
+
+	// Two separate holes, neither large enough for 512
+	allocator.free(a);
+	allocator.free(c);
+	CHECK(allocator.getStatistics().freeBlockCount == 2);
+	CHECK(allocator.getStatistics().getFragmentation() == 0.5f);
+	CHECK(allocator.allocate(512, 1) == TlsfAllocator::InvalidHandle);
+
+	// b merges with both neighbours into [0, 768)
+	allocator.free(b);
+	TlsfStatistics statistics = allocator.getStatistics();
+	CHECK(statistics.freeBlockCount == 1);
+	CHECK(statistics.largestFreeBlock == 768);
+	CHECK(statistics.getFragmentation() == 0.0f);
+
+	const uint32_t e = allocator.allocate(768, 1);
+	CHECK(e != TlsfAllocator::InvalidHandle && allocator.getOffset(e) == 0);
+
+	allocator.free(d);
+	allocator.free(e);
+	statistics = allocator.getStatistics();
+	CHECK(allocator.isEmpty());
+	CHECK(statistics.freeBlockCount == 1 && statistics.largestFreeBlock == 1024);
+}
+
+TEST_CASE(TlsfAllocator, AlignmentPaddingStaysFree)
+{
+	TlsfAllocator allocator;
+	allocator.initialize(1 << 20);
+
+	const uint32_t small = allocator.allocate(100, 1);
+	const uint32_t aligned = allocator.allocate(4096, 65536);
+	CHECK(allocator.getOffset(aligned) == 65536);
+
+	// The padding [100, 65536) is a free block of its own and is used by later allocations
+	const uint32_t padded = allocator.allocate(60000, 1);
+	CHECK(allocator.getOffset(padded) < 65536);
+
+	allocator.free(small);
+	allocator.free(aligned);
+	allocator.free(padded);
+	CHECK(allocator.getStatistics().freeBlockCount == 1);
+}
+
+/// <summary>
+/// Random allocations and frees against a shadow list. With alignment 1 a failed allocation
+/// means no free block is large enough. Freeing everything leaves a single block.
+/// </summary>
+TEST_CASE(TlsfAllocator, RandomAllocateFree)
+{
+	const uint64_t totalSize = 64ull << 20;
+	TlsfAllocator allocator;
+	allocator.initialize(totalSize);
+
+	std::mt19937 random(11);
+	std::vector<Allocation> allocations;
+	for (uint32_t step = 0; step < 50000; ++step)
+	{
+		const bool isAllocating = allocations.empty() || (random() % 100) < 55;
+		if (isAllocating)
+		{
+			const uint64_t size = (random() % 4 == 0) ? 1 + random() % (1 << 20) : 1 + random() % 4096;
+			const uint64_t alignment = (random() % 2 == 0) ? 1 : 1ull << (random() % 17);
+			const uint32_t handle = allocator.allocate(size, alignment);
+			if (handle != TlsfAllocator::InvalidHandle)
+			{
+				Allocation allocation = { handle, size, alignment };
+				allocations.push_back(allocation);
+			}
+			else if (alignment == 1)
+			{
+				REQUIRE(allocator.getStatistics().largestFreeBlock < size);
+			}
+		}
+		else
+		{
+			const size_t index = random() % allocations.size();
+			allocator.free(allocations[index].handle);
+			allocations[index] = allocations.back();
+			allocations.pop_back();
+		}
+
+		if (step % 1000 == 0)
+		{
+			CheckConsistent(allocator, allocations);
+		}
+	}
+	CheckConsistent(allocator, allocations);
+
+	for (const Allocation& allocation : allocations)
+	{
+		allocator.free(allocation.handle);
+	}
+	const TlsfStatistics statistics = allocator.getStatistics();
+	CHECK(allocator.isEmpty());
+	CHECK(statistics.freeBlockCount == 1);
+	CHECK(statistics.largestFreeBlock == totalSize);
+}
+
+TEST_CASE(TlsfAllocator, CompactMovesAllocationsDown)
+{
+	TlsfAllocator allocator;
+	allocator.initialize(1 << 16);
+
+	std::vector<Allocation> allocations;
+	for (uint32_t i = 0; i < 64; ++i)
+	{
+		const uint64_t alignment = (i % 3 == 0) ? 256 : 1;
+		Allocation allocation = { allocator.allocate(1000, alignment), 1000, alignment };
+		allocations.push_back(allocation);
+	}
+	// Free every other one: plenty of free space, all of it in holes
+	std::vector<Allocation> kept;
+	for (uint32_t i = 0; i < allocations.size(); ++i)
+	{
+		if (i % 2 == 0)
+		{
+			allocator.free(allocations[i].handle);
+		}
+		else
+		{
+			kept.push_back(allocations[i]);
+		}
+	}
+	const float fragmentation = allocator.getStatistics().getFragmentation();
+
+	std::vector<TlsfMove> moves;
+	const uint32_t moveCount = allocator.compact(16, moves);
+	CHECK(moveCount > 0 && moveCount <= 16);
+	CHECK(moves.size() == moveCount);
+
+	// Both ends are live until the data is copied
+	for (Allocation& allocation : kept)
+	{
+		for (const TlsfMove& move : moves)
+		{
+			if (move.from == allocation.handle)
+			{
+				CHECK(allocator.getOffset(move.to) < allocator.getOffset(move.from));
+				CHECK(allocator.getSize(move.to) == allocation.size);
+				Allocation copy = { move.to, allocation.size, allocation.alignment };
+				allocation = copy;
+				allocator.free(move.from);
+				break;
+			}
+		}
+	}
+	CheckConsistent(allocator, kept);
+	CHECK(allocator.getStatistics().getFragmentation() < fragmentation);
+}
+
+BENCHMARK(TlsfAllocator, AllocateFree)
+{
+	const uint32_t operationCount = static_cast<uint32_t>(2000000 * Test::GetBenchmarkScale()) + 1;
+	TlsfAllocator allocator;
+	allocator.initialize(256ull << 20);
+
+	std::mt19937 random(1);
+	std::vector<uint64_t> sizes(4096);
+	for (uint64_t& size : sizes)
+	{
+		size = 256 + random() % (256 * 1024);
+	}
+
+	// Keeps about 1000 allocations alive, freeing random ones
+	std::vector<uint32_t> handles;
+	handles.reserve(2048);
+	uint64_t failedCount = 0;
+	const int64_t begin = Test::GetTime();
+	for (uint32_t i = 0; i < operationCount; ++i)
+	{
+		if (handles.size() < 1000 || (i & 1) == 0)
+		{
+			const uint32_t handle = allocator.allocate(sizes[i & 4095], 256);
+			if (handle != TlsfAllocator::InvalidHandle)
+			{
+				handles.push_back(handle);
+			}
+			else
+			{
+				++failedCount;
+			}
+		}
+		else
+		{
+			const size_t index = (i * 2654435761u) % handles.size();
+			allocator.free(handles[index]);
+			handles[index] = handles.back();
+			handles.pop_back();
+		}
+	}
+	const int64_t end = Test::GetTime();
+
+	Test::Report("TlsfAllocator allocate / free", operationCount, end - begin);
+	Test::Consume(failedCount + handles.size());
+}
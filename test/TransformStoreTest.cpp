@@ -0,0 +1,358 @@
+#include "TestFramework.h"
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Transform.h"
+#include "TransformStore.h"
+
+namespace
+{
+	struct TransformData
+	{
+		Vector3 position;
+		Quaternion rotation;
+		Vector3 scale;
+	};
+
+	std::vector<TransformData> MakeTransforms(uint32_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> range(-1.0f, 1.0f);
+
+		std::vector<TransformData> transforms(count);
+		for (TransformData& data : transforms)
+		{
+			float x = range(random), y = range(random), z = range(random), w = range(random);
+			const float length = std::sqrt(x * x + y * y + z * z + w * w) + 1.0e-6f;
+			x /= length; y /= length; z /= length; w /= length;
+
+			data.position = Vector3(range(random) * 100.0f, range(random) * 100.0f, range(random) * 100.0f);
+			data.rotation = Quaternion(x, y, z, w);
+			data.scale = Vector3(1.0f + range(random) * 0.5f, 1.0f + range(random) * 0.5f, 1.0f + range(random) * 0.5f);
+		}
+		return transforms;
+	}
+
+	bool IsNear(const XMFLOAT4X4& lhs, const XMFLOAT4X4& rhs)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				const float tolerance = 1.0e-4f * (1.0f + std::fabs(rhs.m[row][column]));
+				if (std::fabs(lhs.m[row][column] - rhs.m[row][column]) > tolerance)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	XMFLOAT4X4 ToFloat4x4(const XMMATRIX& matrix)
+	{
+		XMFLOAT4X4 result;
+		XMStoreFloat4x4(&result, matrix);
+		return result;
+	}
+}
+
+TEST_CASE(TransformStore, BatchKernelMatchesTransform)
+{
+	const std::vector<TransformData> transforms = MakeTransforms(64, 1);
+	TransformStore store;
+	for (const TransformData& data : transforms)
+	{
+		store.add(data.position, data.rotation, data.scale);
+	}
+
+	// Every start and length up to 19, so the 8-wide, 4-wide and scalar tails all run
+	std::vector<XMFLOAT4X4> matrices(64);
+	for (uint32_t first = 0; first < 8; ++first)
+	{
+		for (uint32_t count = 1; count <= 19; ++count)
+		{
+			store.computeLocalMatrices(first, count, matrices.data());
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const TransformData& data = transforms[first + i];
+				Transform transform;
+				transform.setLocalPosition(data.position);
+				transform.setLocalRotation(data.rotation);
+				transform.setLocalScale(data.scale);
+				REQUIRE(IsNear(matrices[i], ToFloat4x4(transform.getLocalMatrix())));
+			}
+		}
+	}
+}
+
+TEST_CASE(TransformStore, SettersRoundTrip)
+{
+	TransformStore store;
+	const uint32_t index = store.add(Vector3(1.0f, 2.0f, 3.0f), Quaternion(0.0f, 0.0f, 0.0f, 1.0f), Vector3(1.0f, 1.0f, 1.0f));
+	store.setLocalPosition(index, Vector3(4.0f, 5.0f, 6.0f));
+	store.setLocalScale(index, Vector3(2.0f, 2.0f, 2.0f));
+
+	CHECK(store.getLocalPosition(index).y == 5.0f);
+	CHECK(store.getLocalScale(index).z == 2.0f);
+	CHECK(store.getLocalRotation(index).w == 1.0f);
+
+	store.updateWorldMatrices();
+	const XMFLOAT4X4& world = store.getWorldMatrix(index);
+	CHECK(world._11 == 2.0f && world._22 == 2.0f && world._33 == 2.0f);
+	CHECK(world._41 == 4.0f && world._42 == 5.0f && world._43 == 6.0f);
+}
+
+namespace
+{
+	// Depth-first: each root has 9 children with 10 leaves each, 100 nodes per root.
+	// Returns the parent of every node, InvalidIndex for roots.
+	std::vector<uint32_t> MakeHierarchy(uint32_t rootCount)
+	{
+		std::vector<uint32_t> parents;
+		for (uint32_t root = 0; root < rootCount; ++root)
+		{
+			const uint32_t rootIndex = static_cast<uint32_t>(parents.size());
+			parents.push_back(TransformStore::InvalidIndex);
+			for (uint32_t child = 0; child < 9; ++child)
+			{
+				const uint32_t childIndex = static_cast<uint32_t>(parents.size());
+				parents.push_back(rootIndex);
+				for (uint32_t leaf = 0; leaf < 10; ++leaf)
+				{
+					parents.push_back(childIndex);
+				}
+			}
+		}
+		return parents;
+	}
+
+	struct Hierarchy
+	{
+		explicit Hierarchy(uint32_t rootCount)
+			: parents(MakeHierarchy(rootCount))
+			, transforms(MakeTransforms(static_cast<uint32_t>(parents.size()), 3))
+			, objects(new Transform[parents.size()])
+			, store()
+		{
+			store.reserve(static_cast<uint32_t>(parents.size()));
+			for (uint32_t i = 0; i < parents.size(); ++i)
+			{
+				const TransformData& data = transforms[i];
+				objects[i].setLocalPosition(data.position);
+				objects[i].setLocalRotation(data.rotation);
+				objects[i].setLocalScale(data.scale);
+				if (parents[i] != TransformStore::InvalidIndex)
+				{
+					objects[i].setParent(&objects[parents[i]]);
+				}
+				store.add(data.position, data.rotation, data.scale, parents[i]);
+			}
+		}
+
+		bool isSame(uint32_t index)
+		{
+			return IsNear(store.getWorldMatrix(index), ToFloat4x4(objects[index].getWorldMatrix()));
+		}
+
+		std::vector<uint32_t> parents;
+		std::vector<TransformData> transforms;
+		std::unique_ptr<Transform[]> objects;
+		TransformStore store;
+	};
+}
+
+TEST_CASE(TransformStore, WorldMatricesMatchTransformHierarchy)
+{
+	Hierarchy hierarchy(3);
+	TransformStore& store = hierarchy.store;
+	CHECK(store.getSubtreeSize(0) == 100);
+	CHECK(store.getSubtreeSize(1) == 11);
+	CHECK(store.getParent(2) == 1);
+
+	CHECK(store.updateWorldMatrices() == 300);
+	for (uint32_t i = 0; i < 300; ++i)
+	{
+		REQUIRE(hierarchy.isSame(i));
+	}
+
+	// Moving a child of the second root rebuilds its 11 nodes only
+	const Vector3 position(5.0f, -2.0f, 1.0f);
+	store.setLocalPosition(112, position);
+	hierarchy.objects[112].setLocalPosition(position);
+	CHECK(store.updateWorldMatrices() == 11);
+	CHECK(store.updateWorldMatrices() == 0);
+	for (uint32_t i = 0; i < 300; ++i)
+	{
+		REQUIRE(hierarchy.isSame(i));
+	}
+
+	// A root rebuilds its whole subtree, once even though a descendant changed as well
+	store.setLocalScale(200, Vector3(2.0f, 2.0f, 2.0f));
+	store.setLocalScale(250, Vector3(0.5f, 0.5f, 0.5f));
+	hierarchy.objects[200].setLocalScale(Vector3(2.0f, 2.0f, 2.0f));
+	hierarchy.objects[250].setLocalScale(Vector3(0.5f, 0.5f, 0.5f));
+	CHECK(store.updateWorldMatrices() == 100);
+	for (uint32_t i = 200; i < 300; ++i)
+	{
+		REQUIRE(hierarchy.isSame(i));
+	}
+}
+
+TEST_CASE(TransformStore, AddKeepsDepthFirstOrder)
+{
+	TransformStore store;
+	const Vector3 zero(0.0f, 0.0f, 0.0f);
+	const Vector3 one(1.0f, 1.0f, 1.0f);
+	const Quaternion identity(0.0f, 0.0f, 0.0f, 1.0f);
+
+	const uint32_t root = store.add(zero, identity, one);
+	const uint32_t child = store.add(zero, identity, one, root);
+	const uint32_t grandchild = store.add(zero, identity, one, child);
+	CHECK(store.add(zero, identity, one, root) == 3);
+
+	// child's subtree no longer ends at the tail, and an index past the tail is no parent
+	CHECK(store.add(zero, identity, one, child) == TransformStore::InvalidIndex);
+	CHECK(store.add(zero, identity, one, 10) == TransformStore::InvalidIndex);
+	CHECK(store.size() == 4);
+	CHECK(store.getSubtreeSize(root) == 4);
+	CHECK(store.getParent(grandchild) == child);
+}
+
+TEST_CASE(Transform, DirtyFlagsReachChildren)
+{
+	Transform parent;
+	Transform child;
+	child.setLocalPosition(Vector3(1.0f, 0.0f, 0.0f));
+	child.setParent(&parent);
+	CHECK(ToFloat4x4(child.getWorldMatrix())._41 == 1.0f);
+
+	// Cached until the parent moves
+	parent.setLocalPosition(Vector3(0.0f, 3.0f, 0.0f));
+	const XMFLOAT4X4 world = ToFloat4x4(child.getWorldMatrix());
+	CHECK(world._41 == 1.0f && world._42 == 3.0f);
+
+	// A cycle is refused
+	parent.setParent(&child);
+	CHECK(parent.getParent() == nullptr);
+
+	child.setParent(nullptr);
+	CHECK(ToFloat4x4(child.getWorldMatrix())._42 == 0.0f);
+	CHECK(parent.getChildren().empty());
+}
+
+/// <summary>
+/// 100k-node static hierarchy where 1% of the nodes move every frame.
+/// </summary>
+BENCHMARK(TransformStore, StaticHierarchyWithMovers)
+{
+	const uint32_t rootCount = static_cast<uint32_t>(1000 * Test::GetBenchmarkScale()) + 1;
+	const uint32_t frameCount = 100;
+	Hierarchy hierarchy(rootCount);
+	const uint32_t count = static_cast<uint32_t>(hierarchy.parents.size());
+	const uint32_t moverCount = count / 100;
+
+	std::mt19937 random(4);
+	std::vector<uint32_t> movers(static_cast<size_t>(moverCount) * frameCount);
+	for (uint32_t& mover : movers)
+	{
+		mover = random() % count;
+	}
+	hierarchy.store.updateWorldMatrices();
+
+	uint64_t updated = 0;
+	int64_t begin = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (uint32_t n = 0; n < moverCount; ++n)
+		{
+			const uint32_t i = movers[frame * moverCount + n];
+			hierarchy.store.setLocalPosition(i, hierarchy.transforms[(i + frame) % count].position);
+		}
+		updated += hierarchy.store.updateWorldMatrices();
+	}
+	int64_t end = Test::GetTime();
+	Test::Report("TransformStore 1% movers, per node", static_cast<uint64_t>(frameCount) * count, end - begin);
+
+	float sum = 0.0f;
+	begin = Test::GetTime();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (uint32_t n = 0; n < moverCount; ++n)
+		{
+			const uint32_t i = movers[frame * moverCount + n];
+			hierarchy.objects[i].setLocalPosition(hierarchy.transforms[(i + frame) % count].position);
+		}
+		// Every renderable asks for its world matrix, which is cached unless it or a parent moved
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, hierarchy.objects[i].getWorldMatrix());
+			sum += world._41;
+		}
+	}
+	end = Test::GetTime();
+	Test::Report("Transform 1% movers, per node", static_cast<uint64_t>(frameCount) * count, end - begin);
+
+	Test::Consume(updated + static_cast<uint64_t>(sum));
+}
+
+/// <summary>
+/// Local matrices of every transform, once through Transform (one TRS per object) and once
+/// through the SoA batch kernel, at 1k / 100k / 1M transforms.
+/// </summary>
+BENCHMARK(TransformStore, PerObjectVersusBatch)
+{
+	const uint32_t sizes[] = { 1000, 100000, 1000000 };
+	for (uint32_t size : sizes)
+	{
+		const uint32_t count = static_cast<uint32_t>(size * Test::GetBenchmarkScale()) + 1;
+		const uint32_t repeat = 10000000 / size + 1;
+		const std::vector<TransformData> transforms = MakeTransforms(count, 2);
+
+		std::unique_ptr<Transform[]> objects(new Transform[count]);
+		TransformStore store;
+		store.reserve(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			objects[i].setLocalRotation(transforms[i].rotation);
+			objects[i].setLocalScale(transforms[i].scale);
+			store.add(transforms[i].position, transforms[i].rotation, transforms[i].scale);
+		}
+
+		float sum = 0.0f;
+		int64_t begin = Test::GetTime();
+		for (uint32_t n = 0; n < repeat; ++n)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				// Moving the object makes getWorldMatrix rebuild it
+				objects[i].setLocalPosition(transforms[i].position);
+				XMFLOAT4X4 world;
+				XMStoreFloat4x4(&world, objects[i].getWorldMatrix());
+				sum += world._41;
+			}
+		}
+		int64_t end = Test::GetTime();
+
+		char name[64];
+		snprintf(name, sizeof(name), "Transform::getWorldMatrix %u", size);
+		Test::Report(name, static_cast<uint64_t>(repeat) * count, end - begin);
+
+		std::vector<XMFLOAT4X4> matrices(count);
+		begin = Test::GetTime();
+		for (uint32_t n = 0; n < repeat; ++n)
+		{
+			store.computeLocalMatrices(0, count, matrices.data());
+			sum += matrices[n % count]._41;
+		}
+		end = Test::GetTime();
+
+		snprintf(name, sizeof(name), "TransformStore::computeLocalMatrices %u", size);
+		Test::Report(name, static_cast<uint64_t>(repeat) * count, end - begin);
+		Test::Consume(static_cast<uint64_t>(sum));
+	}
+}
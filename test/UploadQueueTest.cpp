@@ -0,0 +1,302 @@
+#include "TestFramework.h"
+
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "StagingRing.h"
+#include "UploadQueue.h"
+
+TEST_CASE(StagingRing, WrapsAndRetiresByFence)
+{
+	StagingRing ring;
+	ring.initialize(256);
+
+	CHECK(ring.allocate(0, 16) == StagingRing::InvalidOffset);
+	CHECK(ring.allocate(257, 16) == StagingRing::InvalidOffset);
+
+	CHECK(ring.allocate(100, 16) == 0);
+	CHECK(ring.allocate(50, 16) == 112);
+	ring.close(1);
+	CHECK(ring.allocate(80, 16) == 176);
+	ring.close(2);
+	CHECK(ring.getUsedSize() == 256);
+	CHECK(ring.allocate(1, 1) == StagingRing::InvalidOffset);
+	CHECK(ring.getOldestFenceValue() == 1);
+
+	// Batch 1 gives back [0, 162); the next allocation wraps to the front
+	ring.retire(1);
+	CHECK(ring.getUsedSize() == 256 - 162);
+	CHECK(ring.allocate(64, 16) == 0);
+	CHECK(ring.allocate(64, 16) == 64);
+	CHECK(ring.allocate(64, 16) == StagingRing::InvalidOffset);
+	ring.close(3);
+
+	// Retiring is in order and up to the completed value
+	ring.retire(2);
+	CHECK(ring.hasPendingBatches());
+	CHECK(ring.getOldestFenceValue() == 3);
+	ring.retire(5);
+	CHECK(!ring.hasPendingBatches());
+	CHECK(ring.getUsedSize() == 0);
+
+	// Empty again: the whole capacity is contiguous
+	CHECK(ring.allocate(256, 16) == 0);
+}
+
+/// <summary>
+/// The tail skipped at the end of the buffer by a wrapping allocation is given back with its batch.
+/// </summary>
+TEST_CASE(StagingRing, SkippedTailIsAccounted)
+{
+	StagingRing ring;
+	ring.initialize(100);
+
+	CHECK(ring.allocate(60, 4) == 0);
+	ring.close(1);
+	CHECK(ring.allocate(30, 4) == 60);
+	ring.close(2);
+	ring.retire(1);
+
+	// [90, 100) is too small for 20 bytes, so it is skipped and the allocation starts at 0
+	CHECK(ring.allocate(20, 4) == 0);
+	CHECK(ring.getUsedSize() == 30 + 10 + 20);
+	ring.close(3);
+	ring.retire(2);
+	CHECK(ring.getUsedSize() == 30);
+	ring.retire(3);
+	CHECK(ring.getUsedSize() == 0);
+}
+
+namespace
+{
+	// Executes copies only when the "GPU" is advanced, reading the staging memory at that time,
+	// so staging space reused too early shows up as corrupted destination data.
+	class FakeCopyQueue final : public ICopyQueue
+	{
+	public:
+		explicit FakeCopyQueue(const uint8_t* pStaging)
+			: mpStaging(pStaging)
+		{
+		}
+
+		void copy(void* pDestination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) override
+		{
+			Copy copy = { static_cast<std::vector<uint8_t>*>(pDestination), destinationOffset, stagingOffset, size };
+			mRecorded.push_back(copy);
+		}
+
+		void submit(uint64_t fenceValue) override
+		{
+			CHECK(fenceValue > mLastSubmitted);
+			mLastSubmitted = fenceValue;
+			Batch batch = { fenceValue, mRecorded };
+			mSubmitted.push_back(batch);
+			mRecorded.clear();
+		}
+
+		uint64_t getCompletedValue() override { return mCompleted; }
+
+		void wait(uint64_t fenceValue) override
+		{
+			while (mCompleted < fenceValue && !mSubmitted.empty())
+			{
+				advance();
+			}
+			++waitCount;
+		}
+
+		// Executes the oldest submitted batch
+		bool advance()
+		{
+			if (mSubmitted.empty())
+			{
+				return false;
+			}
+
+			const Batch& batch = mSubmitted.front();
+			for (const Copy& copy : batch.copies)
+			{
+				memcpy(copy.pDestination->data() + copy.destinationOffset, mpStaging + copy.stagingOffset, static_cast<size_t>(copy.size));
+			}
+			mCompleted = batch.fenceValue;
+			mSubmitted.pop_front();
+			return true;
+		}
+
+		uint64_t getPendingCount() const { return mSubmitted.size(); }
+		size_t getRecordedCount() const { return mRecorded.size(); }
+
+		uint32_t waitCount = 0;
+
+	private:
+		struct Copy
+		{
+			std::vector<uint8_t>* pDestination;
+			uint64_t destinationOffset;
+			uint64_t stagingOffset;
+			uint64_t size;
+		};
+
+		struct Batch
+		{
+			uint64_t fenceValue;
+			std::vector<Copy> copies;
+		};
+
+		const uint8_t* mpStaging;
+		std::vector<Copy> mRecorded;
+		std::deque<Batch> mSubmitted;
+		uint64_t mLastSubmitted = 0;
+		uint64_t mCompleted = 0;
+	};
+
+	std::vector<uint8_t> MakeData(uint64_t size, uint32_t seed)
+	{
+		std::vector<uint8_t> data(static_cast<size_t>(size));
+		std::mt19937 random(seed);
+		for (uint8_t& value : data)
+		{
+			value = static_cast<uint8_t>(random());
+		}
+		return data;
+	}
+}
+
+TEST_CASE(UploadQueue, BatchesByPolicyAndTickets)
+{
+	std::vector<uint8_t> staging(4096);
+	FakeCopyQueue copyQueue(staging.data());
+	UploadBatchPolicy policy = { 900, 3 };
+	UploadQueue queue;
+	queue.initialize(&copyQueue, staging.data(), staging.size(), policy);
+
+	std::vector<uint8_t> destination(1024);
+	const std::vector<uint8_t> data = MakeData(1024, 1);
+
+	// Three copies reach maxCopies: they share ticket 1, which is submitted by the third
+	CHECK(queue.upload(&destination, 0, data.data(), 10) == 1);
+	CHECK(queue.upload(&destination, 10, data.data() + 10, 10) == 1);
+	CHECK(queue.getSubmitCount() == 0);
+	CHECK(queue.upload(&destination, 20, data.data() + 20, 10) == 1);
+	CHECK(queue.getSubmitCount() == 1);
+
+	// maxBytes closes the next batch after one upload
+	CHECK(queue.upload(&destination, 30, data.data() + 30, 994) == 2);
+	CHECK(queue.getSubmitCount() == 2);
+
+	CHECK(queue.upload(&destination, 0, data.data(), 1) == 3);
+	CHECK(!queue.isComplete(1));
+	CHECK(queue.submit(3));
+	CHECK(queue.getSubmitCount() == 3);
+	CHECK(queue.flush() == 3);
+	CHECK(queue.getSubmitCount() == 3);
+
+	copyQueue.advance();
+	CHECK(queue.isComplete(1));
+	CHECK(!queue.isComplete(2));
+	CHECK(!queue.submit(1));
+
+	queue.wait(3);
+	CHECK(queue.isComplete(3));
+	CHECK(destination == data);
+	queue.destroy();
+}
+
+/// <summary>
+/// Random uploads through a small ring: wrap-around, waits on a full ring and uploads split
+/// into pieces larger than the ring must all land intact.
+/// </summary>
+TEST_CASE(UploadQueue, DataSurvivesWrapAround)
+{
+	std::vector<uint8_t> staging(1000);
+	FakeCopyQueue copyQueue(staging.data());
+	UploadBatchPolicy policy = { 300, 4 };
+	UploadQueue queue;
+	queue.initialize(&copyQueue, staging.data(), staging.size(), policy);
+
+	std::mt19937 random(5);
+	std::uniform_int_distribution<uint32_t> sizes(1, 400);
+	const std::vector<uint8_t> data = MakeData(64 * 1024, 2);
+	std::vector<uint8_t> destination(data.size());
+
+	uint64_t offset = 0;
+	uint64_t lastTicket = 0;
+	while (offset < data.size())
+	{
+		uint64_t size = sizes(random);
+		// Now and then, more than the whole ring
+		if (random() % 16 == 0)
+		{
+			size = 2500;
+		}
+		size = (offset + size < data.size()) ? size : data.size() - offset;
+
+		const uint64_t ticket = queue.upload(&destination, offset, data.data() + offset, size);
+		CHECK(ticket >= lastTicket);
+		lastTicket = ticket;
+		offset += size;
+
+		// The GPU runs behind, sometimes by several batches
+		if (random() % 3 == 0)
+		{
+			copyQueue.advance();
+		}
+	}
+
+	queue.wait(lastTicket);
+	CHECK(copyQueue.getPendingCount() == 0);
+	CHECK(copyQueue.waitCount > 0);
+	CHECK(destination == data);
+	queue.destroy();
+}
+
+TEST_CASE(UploadQueue, DestroySubmitsAndDrains)
+{
+	std::vector<uint8_t> staging(256);
+	FakeCopyQueue copyQueue(staging.data());
+	UploadBatchPolicy policy = { 1 << 20, 100 };
+	UploadQueue queue;
+	queue.initialize(&copyQueue, staging.data(), staging.size(), policy);
+
+	std::vector<uint8_t> destination(64);
+	const std::vector<uint8_t> data = MakeData(64, 3);
+	queue.upload(&destination, 0, data.data(), 64);
+	CHECK(queue.getSubmitCount() == 0);
+
+	queue.destroy();
+	CHECK(copyQueue.getPendingCount() == 0);
+	CHECK(copyQueue.getRecordedCount() == 0);
+	CHECK(destination == data);
+}
+
+BENCHMARK(UploadQueue, SmallUploads)
+{
+	const uint32_t uploadCount = static_cast<uint32_t>(1000000 * Test::GetBenchmarkScale()) + 1;
+	std::vector<uint8_t> staging(4 * 1024 * 1024);
+	FakeCopyQueue copyQueue(staging.data());
+	UploadBatchPolicy policy = { 256 * 1024, 256 };
+	UploadQueue queue;
+	queue.initialize(&copyQueue, staging.data(), staging.size(), policy);
+
+	std::vector<uint8_t> destination(64 * 1024);
+	const std::vector<uint8_t> data = MakeData(256, 4);
+
+	const int64_t begin = Test::GetTime();
+	for (uint32_t i = 0; i < uploadCount; ++i)
+	{
+		queue.upload(&destination, (i * 256) % destination.size(), data.data(), data.size());
+		if (i % 1024 == 0)
+		{
+			while (copyQueue.advance())
+			{
+			}
+		}
+	}
+	queue.destroy();
+	const int64_t end = Test::GetTime();
+
+	Test::Report("UploadQueue::upload, 256 bytes", uploadCount, end - begin);
+	Test::Consume(destination[0]);
+}